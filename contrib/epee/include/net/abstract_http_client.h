@@ -63,8 +63,11 @@ namespace http
   public:
     abstract_http_client() {}
     virtual ~abstract_http_client() {}
+    //! `unix://<path>` addresses are routed to `set_local_server`, everything else to `set_server(host, port, ...)`
     bool set_server(const std::string& address, boost::optional<login> user, ssl_options_t ssl_options = ssl_support_t::e_ssl_support_autodetect);
     virtual bool set_proxy(const std::string& address);
+    //! Use the local stream socket at `path` instead of a TCP server. Clients without local transport return false.
+    virtual bool set_local_server(std::string path, boost::optional<login> user);
     virtual void set_server(std::string host, std::string port, boost::optional<login> user, ssl_options_t ssl_options = ssl_support_t::e_ssl_support_autodetect) = 0;
     virtual void set_auto_connect(bool auto_connect) = 0;
     virtual bool connect(std::chrono::milliseconds timeout) = 0;
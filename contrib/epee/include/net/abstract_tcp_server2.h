@@ -368,6 +368,11 @@ namespace net_utils
 
     size_t get_threads_count(){return m_threads_count;}
 
+    /// Give each server thread its own io_service and spread accepted connections over them,
+    /// instead of having all threads share one. Must be called before run_server, and is
+    /// ignored when the server runs on an external io_service.
+    void set_reactor_per_thread(bool enable){m_reactor_per_thread = enable;}
+
     void set_connection_filter(i_connection_filter* pfilter);
 
     void set_default_remote(epee::net_utils::network_address remote)
@@ -468,8 +473,8 @@ namespace net_utils
     }
 
   private:
-    /// Run the server's io_service loop.
-    bool worker_thread();
+    /// Run the given io_service loop.
+    bool worker_thread(boost::asio::io_service& io_service);
     /// Handle completion of an asynchronous accept operation.
     void handle_accept_ipv4(const boost::system::error_code& e);
     void handle_accept_ipv6(const boost::system::error_code& e);
@@ -477,6 +482,10 @@ namespace net_utils
 
     bool is_thread_worker();
 
+    /// io_service the next accepted connection will live on
+    boost::asio::io_service& next_connection_io_service();
+    bool connections_multithreaded() const { return m_reactors.empty() && 1 < m_threads_count; }
+
     const std::shared_ptr<typename connection<t_protocol_handler>::shared_state> m_state;
 
     /// The io_service used to perform asynchronous operations.
@@ -492,6 +501,11 @@ namespace net_utils
     std::unique_ptr<worker> m_io_service_local_instance;
     boost::asio::io_service& io_service_;    
 
+    /// With a reactor per thread, io_services for threads other than the one running io_service_
+    bool m_reactor_per_thread;
+    std::vector<std::unique_ptr<worker>> m_reactors;
+    std::atomic<size_t> m_next_reactor;
+
     /// Acceptor used to listen for incoming connections.
     boost::asio::ip::tcp::acceptor acceptor_;
     boost::asio::ip::tcp::acceptor acceptor_ipv6;
@@ -38,6 +38,7 @@
 #include <functional>
 
 #include "net_helper.h"
+#include "local_stream_client.h"
 #include "http_client_base.h"
 #include "string_tools.h"
 #include "string_tools_lexical.h"
@@ -875,6 +876,7 @@ namespace net_utils
 			}
 		};
 		typedef http_simple_client_template<blocked_mode_client> http_simple_client;
+		typedef http_simple_client_template<local_blocked_mode_client> http_local_client;
 	}
 }
 }
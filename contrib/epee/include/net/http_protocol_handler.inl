@@ -40,6 +40,7 @@
 #define HTTP_MAX_URI_LEN		 9000 
 #define HTTP_MAX_HEADER_LEN		 100000
 #define HTTP_MAX_STARTING_NEWLINES       8
+#define HTTP_INLINE_BODY_MAX_SIZE        16384
 
 namespace epee
 {
@@ -603,10 +604,19 @@ namespace net_utils
 
 		LOG_PRINT_L3("HTTP_RESPONSE_HEAD: << \r\n" << response_data);
 
-		if ((response.m_body.size() && (query_info.m_http_method != http::http_method_head)) || (query_info.m_http_method == http::http_method_options))
-			response_data += response.m_body;
-
-		m_psnd_hndlr->do_send(byte_slice{std::move(response_data)});
+		const bool send_body = (response.m_body.size() && (query_info.m_http_method != http::http_method_head)) || (query_info.m_http_method == http::http_method_options);
+		if (send_body && response.m_body.size() > HTTP_INLINE_BODY_MAX_SIZE)
+		{
+			// large (typically binary) bodies are handed over as their own slice rather than copied after the header
+			m_psnd_hndlr->do_send(byte_slice{std::move(response_data)});
+			m_psnd_hndlr->do_send(byte_slice{std::move(response.m_body)});
+		}
+		else
+		{
+			if (send_body)
+				response_data += response.m_body;
+			m_psnd_hndlr->do_send(byte_slice{std::move(response_data)});
+		}
 		m_psnd_hndlr->send_done();
 		return res;
 	}
@@ -34,6 +34,7 @@
 #include <boost/bind/bind.hpp>
 
 #include "net/abstract_tcp_server2.h"
+#include "net/local_stream_server.h"
 #include "http_protocol_handler.h"
 #include "net/http_server_handlers_map2.h"
 
@@ -90,8 +91,24 @@ namespace epee
       return true;
     }
 
+    //! Additionally serve the same handlers on a local socket, must be called after `init`
+    bool init_local(const std::string& socket_path, size_t max_connections = 16)
+    {
+      m_local_server.reset(new local_server_t(m_net_server.get_config_object()));
+      if (!m_local_server->init_server(socket_path, max_connections))
+      {
+        m_local_server.reset();
+        LOG_ERROR("Failed to bind local socket server");
+        return false;
+      }
+      return true;
+    }
+
     bool run(size_t threads_count, bool wait = true)
     {
+      if (m_local_server && !m_local_server->run_server(threads_count))
+        LOG_ERROR("Failed to run local socket server!");
+
       //go to loop
       MINFO("Run net_service loop( " << threads_count << " threads)...");
       if(!m_net_server.run_server(threads_count, wait))
@@ -106,6 +123,8 @@ namespace epee
 
     bool deinit()
     {
+      if (m_local_server)
+        m_local_server->deinit_server();
       return m_net_server.deinit_server();
     }
 
@@ -116,6 +135,8 @@ namespace epee
 
     bool send_stop_signal()
     {
+      if (m_local_server)
+        m_local_server->send_stop_signal();
       m_net_server.send_stop_signal();
       return true;
     }
@@ -131,6 +152,9 @@ namespace epee
     }
 
   protected: 
+    typedef net_utils::local_stream_server<net_utils::http::http_custom_handler<t_connection_context> > local_server_t;
+
     net_utils::boosted_tcp_server<net_utils::http::http_custom_handler<t_connection_context> > m_net_server;
+    std::unique_ptr<local_server_t> m_local_server;
   };
 }
@@ -0,0 +1,92 @@
+// Copyright (c) 2018-2022, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/utility/string_ref.hpp>
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+#include <boost/asio/local/stream_protocol.hpp>
+#endif
+
+#include "net/net_ssl.h"
+
+namespace epee
+{
+namespace net_utils
+{
+  /*! Blocking client for a local stream socket (a Unix domain socket), with
+      the interface `http::http_simple_client_template` expects of its
+      transport. The "host" is the socket path and the port is ignored.
+
+      TLS is pointless on a socket that never leaves the host, so SSL options
+      are accepted and ignored. Reads use a much larger window than the TCP
+      client, so large responses arrive in few pieces. */
+  class local_blocked_mode_client
+  {
+  public:
+    local_blocked_mode_client();
+    ~local_blocked_mode_client();
+
+    local_blocked_mode_client(const local_blocked_mode_client&) = delete;
+    local_blocked_mode_client& operator=(const local_blocked_mode_client&) = delete;
+
+    void set_ssl(ssl_options_t) noexcept {}
+
+    bool connect(const std::string& path, const std::string& port, std::chrono::milliseconds timeout);
+    bool disconnect();
+    bool is_connected(bool *ssl = NULL);
+
+    bool send(const boost::string_ref buff, std::chrono::milliseconds timeout);
+    //! Reads whatever is available, up to the read window. An empty `buff` means the peer closed.
+    bool recv(std::string& buff, std::chrono::milliseconds timeout);
+
+    uint64_t get_bytes_sent() const noexcept { return m_bytes_sent; }
+    uint64_t get_bytes_received() const noexcept { return m_bytes_received; }
+
+  private:
+    //! Runs the pending operation until `ec` is set or `timeout` elapses
+    void run_until_done(boost::system::error_code& ec, std::chrono::milliseconds timeout);
+
+    boost::asio::io_service m_io_service;
+    boost::asio::steady_timer m_deadline;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    boost::asio::local::stream_protocol::socket m_socket;
+#endif
+    bool m_connected;
+    uint64_t m_bytes_sent;
+    uint64_t m_bytes_received;
+  };
+} // namespace net_utils
+} // namespace epee
@@ -0,0 +1,355 @@
+// Copyright (c) 2018-2022, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/write.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+#include <boost/asio/local/stream_protocol.hpp>
+#endif
+
+#include "byte_slice.h"
+#include "misc_log_ex.h"
+#include "net/net_utils_base.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "net.local"
+
+namespace epee
+{
+namespace net_utils
+{
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  /*! Serves a protocol handler (such as `http::http_custom_handler`) over a
+      local stream socket, ie a Unix domain socket. Clients on the same host
+      skip the TCP/IP stack entirely, and access is controlled by the socket
+      file permissions, which are set to owner only.
+
+      Each request's response is written with a single gather write straight
+      from the buffers handed to `do_send`, so large bodies are never copied
+      into a send queue. */
+  template<class t_protocol_handler>
+  class local_stream_server
+  {
+  public:
+    typedef typename t_protocol_handler::connection_context t_connection_context;
+    typedef typename t_protocol_handler::config_type t_config;
+
+    explicit local_stream_server(t_config& config)
+      : m_io_service(), m_config(config), m_path(), m_max_connections(0), m_connections(0)
+    {}
+
+    ~local_stream_server()
+    {
+      try { deinit_server(); }
+      catch (...) { /* ignore */ }
+    }
+
+    local_stream_server(const local_stream_server&) = delete;
+    local_stream_server& operator=(const local_stream_server&) = delete;
+
+    static constexpr bool is_supported() noexcept
+    {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+      return true;
+#else
+      return false;
+#endif
+    }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    bool init_server(const std::string& path, size_t max_connections)
+    {
+      typedef boost::asio::local::stream_protocol protocol;
+      CHECK_AND_ASSERT_MES(!path.empty(), false, "Empty local socket path");
+      CHECK_AND_ASSERT_MES(max_connections > 0, false, "Local socket server needs at least one connection");
+      try
+      {
+        boost::system::error_code ec;
+        if (boost::filesystem::status(path, ec).type() == boost::filesystem::socket_file)
+        {
+          // a leftover from an unclean shutdown can be reused, a live server can not
+          protocol::socket probe(m_io_service);
+          probe.connect(protocol::endpoint(path), ec);
+          CHECK_AND_ASSERT_MES(ec, false, "Local socket " << path << " is already in use");
+          boost::filesystem::remove(path, ec);
+        }
+
+        m_acceptor.reset(new protocol::acceptor(m_io_service));
+        const protocol::endpoint endpoint(path);
+        m_acceptor->open(endpoint.protocol());
+        m_acceptor->bind(endpoint);
+        m_acceptor->listen();
+        boost::filesystem::permissions(path, boost::filesystem::owner_read | boost::filesystem::owner_write);
+      }
+      catch (const std::exception& e)
+      {
+        MERROR("Failed to bind local socket " << path << ": " << e.what());
+        m_acceptor.reset();
+        return false;
+      }
+      m_path = path;
+      m_max_connections = max_connections;
+      return true;
+    }
+#else
+    bool init_server(const std::string& path, size_t)
+    {
+      MERROR("Local sockets are not supported on this platform, can not bind " << path);
+      return false;
+    }
+#endif
+
+    bool run_server(size_t threads_count)
+    {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+      CHECK_AND_ASSERT_MES(m_acceptor, false, "Local socket server is not initialized");
+      CHECK_AND_ASSERT_MES(m_threads.empty(), false, "Local socket server is already running");
+      MGINFO("Serving on local socket " << m_path);
+      do_accept();
+      for (size_t i = 0; i < std::max<size_t>(threads_count, 1); ++i)
+        m_threads.emplace_back([this]{ worker_thread(); });
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    void send_stop_signal()
+    {
+      m_io_service.stop();
+    }
+
+    bool deinit_server()
+    {
+      send_stop_signal();
+      for (auto& thread : m_threads)
+        thread.join();
+      m_threads.clear();
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+      if (m_acceptor)
+      {
+        boost::system::error_code ec;
+        m_acceptor->close(ec);
+        m_acceptor.reset();
+        boost::filesystem::remove(m_path, ec);
+      }
+#endif
+      return true;
+    }
+
+    const std::string& get_path() const noexcept { return m_path; }
+    size_t get_connections_count() const noexcept { return m_connections; }
+
+  private:
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    class connection: public i_service_endpoint, public std::enable_shared_from_this<connection>
+    {
+    public:
+      connection(local_stream_server& server)
+        : m_server(server)
+        , m_socket(server.m_io_service)
+        , m_context()
+        , m_handler(this, server.m_config, m_context)
+        , m_buffer(65536)
+        , m_queue()
+        , m_want_close(false)
+        , m_closed(false)
+      {
+        static_cast<connection_context_base&>(m_context) = connection_context_base{
+          boost::uuids::random_generator()(), ipv4_network_address{MAKE_IP(127, 0, 0, 1), 0}, true, false
+        };
+      }
+
+      boost::asio::local::stream_protocol::socket& socket() noexcept { return m_socket; }
+
+      void start()
+      {
+        m_handler.after_init_connection();
+        do_read();
+      }
+
+      void shutdown()
+      {
+        if (m_closed)
+          return;
+        m_closed = true;
+        boost::system::error_code ec;
+        m_socket.shutdown(boost::asio::local::stream_protocol::socket::shutdown_both, ec);
+        m_socket.close(ec);
+        m_handler.release_protocol();
+        --m_server.m_connections;
+      }
+
+      //i_service_endpoint
+      virtual bool do_send(byte_slice message) override
+      {
+        m_queue.push_back(std::move(message));
+        return true;
+      }
+      virtual bool close() override
+      {
+        m_want_close = true;
+        return true;
+      }
+      virtual bool send_done() override { return true; }
+      virtual bool call_run_once_service_io() override { return false; }
+      virtual bool request_callback() override { return false; }
+      virtual boost::asio::io_service& get_io_service() override { return m_server.m_io_service; }
+      virtual bool add_ref() override { return true; }
+      virtual bool release() override { return true; }
+
+    private:
+      void do_read()
+      {
+        auto self = this->shared_from_this();
+        m_socket.async_read_some(boost::asio::buffer(m_buffer), [this, self](const boost::system::error_code& ec, size_t bytes_transferred)
+        {
+          if (ec)
+          {
+            if (ec != boost::asio::error::eof && ec != boost::asio::error::operation_aborted)
+              MDEBUG("Local connection read failed: " << ec.message());
+            shutdown();
+            return;
+          }
+          const bool keep = m_handler.handle_recv(m_buffer.data(), bytes_transferred);
+          flush(keep && !m_want_close);
+        });
+      }
+
+      void flush(const bool keep_reading)
+      {
+        if (m_queue.empty())
+        {
+          if (keep_reading)
+            do_read();
+          else
+            shutdown();
+          return;
+        }
+
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.reserve(m_queue.size());
+        for (const byte_slice& message : m_queue)
+          buffers.emplace_back(message.data(), message.size());
+
+        auto self = this->shared_from_this();
+        boost::asio::async_write(m_socket, buffers, [this, self, keep_reading](const boost::system::error_code& ec, size_t)
+        {
+          m_queue.clear();
+          if (ec || !keep_reading)
+          {
+            if (ec && ec != boost::asio::error::operation_aborted)
+              MDEBUG("Local connection write failed: " << ec.message());
+            shutdown();
+            return;
+          }
+          do_read();
+        });
+      }
+
+      local_stream_server& m_server;
+      boost::asio::local::stream_protocol::socket m_socket;
+      t_connection_context m_context;
+      t_protocol_handler m_handler;
+      std::vector<char> m_buffer;
+      std::vector<byte_slice> m_queue;
+      bool m_want_close;
+      bool m_closed;
+    };
+
+    void do_accept()
+    {
+      auto conn = std::make_shared<connection>(*this);
+      m_acceptor->async_accept(conn->socket(), [this, conn](const boost::system::error_code& ec)
+      {
+        if (ec == boost::asio::error::operation_aborted)
+          return;
+        if (ec)
+        {
+          MDEBUG("Failed to accept local connection: " << ec.message());
+        }
+        else if (m_connections >= m_max_connections)
+        {
+          MWARNING("Too many local connections (" << m_max_connections << "), refusing a new one");
+          boost::system::error_code ignored;
+          conn->socket().close(ignored);
+        }
+        else
+        {
+          ++m_connections;
+          conn->start();
+        }
+        do_accept();
+      });
+    }
+
+    void worker_thread()
+    {
+      for (;;)
+      {
+        try
+        {
+          m_io_service.run();
+          return;
+        }
+        catch (const std::exception& e)
+        {
+          MERROR("Exception in local socket server thread: " << e.what());
+        }
+        catch (...)
+        {
+          MERROR("Unknown exception in local socket server thread");
+        }
+      }
+    }
+#endif
+
+    boost::asio::io_service m_io_service;
+    t_config& m_config;
+    std::string m_path;
+    size_t m_max_connections;
+    std::atomic<size_t> m_connections;
+    std::vector<boost::thread> m_threads;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    std::unique_ptr<boost::asio::local::stream_protocol::acceptor> m_acceptor;
+#endif
+  };
+} // namespace net_utils
+} // namespace epee
@@ -0,0 +1,158 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "misc_language.h"
+
+#include <deque>
+#include <iterator>
+#include <set>
+#include <stddef.h>
+
+namespace epee
+{
+namespace misc_utils
+{
+
+// Median over a window of at most `capacity` items, in insertion order.
+// Unlike rolling_median_t, items can be removed from either end, so a
+// window over block heights can be rewound when blocks are popped and
+// extended again without rebuilding it. All updates are O(log n).
+template<typename Item>
+class window_median_t
+{
+public:
+  explicit window_median_t(size_t capacity): m_capacity(capacity) {}
+
+  size_t capacity() const { return m_capacity; }
+  size_t size() const { return m_items.size(); }
+  bool empty() const { return m_items.empty(); }
+  bool full() const { return m_items.size() >= m_capacity; }
+
+  // oldest first
+  const std::deque<Item> &items() const { return m_items; }
+  const Item &front() const { return m_items.front(); }
+  const Item &back() const { return m_items.back(); }
+
+  void clear()
+  {
+    m_items.clear();
+    m_lo.clear();
+    m_hi.clear();
+  }
+
+  // adds a newest item, dropping the oldest one if the window is full
+  void push_back(Item v)
+  {
+    if (m_capacity == 0)
+      return;
+    if (full())
+      pop_front();
+    m_items.push_back(v);
+    add(v);
+  }
+
+  // adds an oldest item, only valid if the window is not full
+  void push_front(Item v)
+  {
+    if (full())
+      return;
+    m_items.push_front(v);
+    add(v);
+  }
+
+  void pop_back()
+  {
+    remove(m_items.back());
+    m_items.pop_back();
+  }
+
+  void pop_front()
+  {
+    remove(m_items.front());
+    m_items.pop_front();
+  }
+
+  //returns median item (or average of 2 when item count is even), as median() does for a vector
+  Item median() const
+  {
+    if (m_lo.empty())
+      return Item();
+    const Item &v = *m_lo.rbegin();
+    if (m_lo.size() > m_hi.size())
+      return v;
+    return get_mid<Item>(v, *m_hi.begin());
+  }
+
+private:
+  // m_lo holds the lower half and the median, m_hi the upper half;
+  // m_lo has as many items as m_hi, or one more
+  void add(const Item &v)
+  {
+    if (m_lo.empty() || !(*m_lo.rbegin() < v))
+      m_lo.insert(v);
+    else
+      m_hi.insert(v);
+    rebalance();
+  }
+
+  void remove(const Item &v)
+  {
+    // if v equals the largest low item, that one is as good as any other copy
+    if (!(*m_lo.rbegin() < v))
+      m_lo.erase(m_lo.find(v));
+    else
+      m_hi.erase(m_hi.find(v));
+    rebalance();
+  }
+
+  void rebalance()
+  {
+    if (m_lo.size() > m_hi.size() + 1)
+    {
+      auto i = std::prev(m_lo.end());
+      m_hi.insert(*i);
+      m_lo.erase(i);
+    }
+    else if (m_hi.size() > m_lo.size())
+    {
+      auto i = m_hi.begin();
+      m_lo.insert(*i);
+      m_hi.erase(i);
+    }
+  }
+
+  size_t m_capacity;
+  std::deque<Item> m_items;
+  std::multiset<Item> m_lo;
+  std::multiset<Item> m_hi;
+};
+
+}
+}
@@ -135,6 +135,8 @@ namespace http
     http::url_content parsed{};
     const bool r = parse_url(address, parsed);
     CHECK_AND_ASSERT_MES(r, false, "failed to parse url: " << address);
+    if (parsed.schema == "unix")
+      return set_local_server(parsed.host + parsed.uri, std::move(user));
     set_server(std::move(parsed.host), std::to_string(parsed.port), std::move(user), std::move(ssl_options));
     return true;
   }
@@ -143,6 +145,12 @@ namespace http
   {
     return false;
   }
+
+  bool epee::net_utils::http::abstract_http_client::set_local_server(std::string path, boost::optional<login> user)
+  {
+    MERROR("This client has no local socket transport, can not use " << path);
+    return false;
+  }
 }
 }
 }
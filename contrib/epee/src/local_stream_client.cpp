@@ -0,0 +1,221 @@
+// Copyright (c) 2018-2022, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "net/local_stream_client.h"
+
+#include <boost/asio/read.hpp>
+#include <boost/asio/write.hpp>
+
+#include "misc_log_ex.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "net.local"
+
+namespace
+{
+  constexpr const std::size_t local_read_window = 256 * 1024;
+}
+
+namespace epee
+{
+namespace net_utils
+{
+  local_blocked_mode_client::local_blocked_mode_client()
+    : m_io_service()
+    , m_deadline(m_io_service)
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    , m_socket(m_io_service)
+#endif
+    , m_connected(false)
+    , m_bytes_sent(0)
+    , m_bytes_received(0)
+  {}
+
+  local_blocked_mode_client::~local_blocked_mode_client()
+  {
+    try { disconnect(); }
+    catch (...) { /* ignore */ }
+  }
+
+  void local_blocked_mode_client::run_until_done(boost::system::error_code& ec, const std::chrono::milliseconds timeout)
+  {
+    bool timed_out = false;
+    m_deadline.expires_from_now(timeout);
+    m_deadline.async_wait([this, &timed_out](const boost::system::error_code& error)
+    {
+      if (error == boost::asio::error::operation_aborted)
+        return;
+      timed_out = true;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+      boost::system::error_code ignored;
+      m_socket.cancel(ignored);
+#endif
+    });
+
+    while (ec == boost::asio::error::would_block)
+    {
+      m_io_service.reset();
+      m_io_service.run_one();
+    }
+
+    // let the timer handler run before `timed_out` goes out of scope
+    m_deadline.cancel();
+    m_io_service.reset();
+    m_io_service.run();
+
+    if (timed_out)
+      ec = boost::asio::error::timed_out;
+  }
+
+  bool local_blocked_mode_client::connect(const std::string& path, const std::string&, const std::chrono::milliseconds timeout)
+  {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    disconnect();
+    try
+    {
+      boost::system::error_code ec = boost::asio::error::would_block;
+      m_socket.async_connect(boost::asio::local::stream_protocol::endpoint(path), [&ec](const boost::system::error_code& error) { ec = error; });
+      run_until_done(ec, timeout);
+      if (ec)
+      {
+        MDEBUG("Failed to connect to local socket " << path << ": " << ec.message());
+        disconnect();
+        return false;
+      }
+    }
+    catch (const std::exception& e)
+    {
+      MERROR("Failed to connect to local socket " << path << ": " << e.what());
+      disconnect();
+      return false;
+    }
+    m_connected = true;
+    return true;
+#else
+    MERROR("Local sockets are not supported on this platform, can not connect to " << path);
+    return false;
+#endif
+  }
+
+  bool local_blocked_mode_client::disconnect()
+  {
+    m_connected = false;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    boost::system::error_code ec;
+    if (m_socket.is_open())
+    {
+      m_socket.shutdown(boost::asio::local::stream_protocol::socket::shutdown_both, ec);
+      m_socket.close(ec);
+    }
+#endif
+    return true;
+  }
+
+  bool local_blocked_mode_client::is_connected(bool *ssl)
+  {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    if (!m_connected || !m_socket.is_open())
+      return false;
+    if (ssl)
+      *ssl = false;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  bool local_blocked_mode_client::send(const boost::string_ref buff, const std::chrono::milliseconds timeout)
+  {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    try
+    {
+      boost::system::error_code ec = boost::asio::error::would_block;
+      boost::asio::async_write(m_socket, boost::asio::buffer(buff.data(), buff.size()), [&ec](const boost::system::error_code& error, std::size_t) { ec = error; });
+      run_until_done(ec, timeout);
+      if (ec)
+      {
+        LOG_PRINT_L3("Problems at local socket write: " << ec.message());
+        m_connected = false;
+        return false;
+      }
+      m_bytes_sent += buff.size();
+      return true;
+    }
+    catch (const std::exception& e)
+    {
+      LOG_ERROR("Some problems at local socket send, message: " << e.what());
+      m_connected = false;
+      return false;
+    }
+#else
+    return false;
+#endif
+  }
+
+  bool local_blocked_mode_client::recv(std::string& buff, const std::chrono::milliseconds timeout)
+  {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    try
+    {
+      boost::system::error_code ec = boost::asio::error::would_block;
+      std::size_t bytes_transferred = 0;
+      buff.resize(local_read_window);
+      m_socket.async_read_some(boost::asio::buffer(&buff[0], buff.size()), [&ec, &bytes_transferred](const boost::system::error_code& error, std::size_t bytes)
+      {
+        ec = error;
+        bytes_transferred = bytes;
+      });
+      run_until_done(ec, timeout);
+      if (ec == boost::asio::error::eof)
+      {
+        buff.clear();
+        return true;
+      }
+      if (ec)
+      {
+        MDEBUG("Problems at local socket read: " << ec.message());
+        m_connected = false;
+        return false;
+      }
+      m_bytes_received += bytes_transferred;
+      buff.resize(bytes_transferred);
+      return true;
+    }
+    catch (const std::exception& e)
+    {
+      LOG_ERROR("Some problems at local socket read, message: " << e.what());
+      m_connected = false;
+      return false;
+    }
+#else
+    return false;
+#endif
+  }
+} // namespace net_utils
+} // namespace epee
@@ -26,12 +26,14 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <chrono>
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include "common/unordered_containers_boost_serialization.h"
 #include "common/command_line.h"
 #include "common/varint.h"
+#include "common/threadpool.h"
 #include "serialization/crypto.h"
 #include "cryptonote_basic/cryptonote_boost_serialization.h"
 #include "cryptonote_core/tx_pool.h"
@@ -48,6 +50,10 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
+// txes read and decoded per batch: one batch is applied while the next one
+// is decoded on the compute threadpool, so at most two are held in memory
+#define DECODE_BATCH_TXES 4096
+
 static uint64_t records_per_sync = 200;
 static uint64_t db_flags = 0;
 static MDB_dbi dbi_relative_rings;
@@ -66,6 +72,7 @@ struct output_data
   output_data(): amount(0), offset(0) {}
   output_data(uint64_t a, uint64_t i): amount(a), offset(i) {}
   bool operator==(const output_data &other) const { return other.amount == amount && other.offset == offset; }
+  bool operator<(const output_data &other) const { return amount < other.amount || (amount == other.amount && offset < other.offset); }
 };
 
 //
@@ -367,36 +374,99 @@ static bool for_all_transactions(const std::string &filename, uint64_t &start_id
 
   bool fret = true;
 
+  // Blobs are read on this thread, since the read txn belongs to it, and
+  // decoded on the compute threadpool while the previous batch is handed
+  // to f, which needs to see the txes in order.
+  struct batch_t
+  {
+    std::vector<uint64_t> idx;
+    std::vector<blobdata> blobs;
+    std::vector<cryptonote::transaction_prefix> txs;
+    std::unique_ptr<bool[]> ok;
+  } batches[2];
+  MDB_cursor_op op = MDB_SET;
   k.mv_size = sizeof(uint64_t);
   k.mv_data = &start_idx;
-  MDB_cursor_op op = MDB_SET;
-  while (1)
+  auto read_batch = [&](batch_t &batch)
   {
-    int ret = mdb_cursor_get(cur, &k, &v, op);
-    op = MDB_NEXT;
-    if (ret == MDB_NOTFOUND)
-      break;
-    if (ret)
-      throw std::runtime_error("Failed to enumerate transactions: " + std::string(mdb_strerror(ret)));
-
-    if (k.mv_size != sizeof(uint64_t))
-      throw std::runtime_error("Bad key size");
-    const uint64_t idx = *(uint64_t*)k.mv_data;
-    if (idx < start_idx)
-      continue;
+    batch.idx.clear();
+    batch.blobs.clear();
+    while (batch.idx.size() < DECODE_BATCH_TXES)
+    {
+      int ret = mdb_cursor_get(cur, &k, &v, op);
+      op = MDB_NEXT;
+      if (ret == MDB_NOTFOUND)
+        break;
+      if (ret)
+        throw std::runtime_error("Failed to enumerate transactions: " + std::string(mdb_strerror(ret)));
+
+      if (k.mv_size != sizeof(uint64_t))
+        throw std::runtime_error("Bad key size");
+      const uint64_t idx = *(uint64_t*)k.mv_data;
+      if (idx < start_idx)
+        continue;
+      batch.idx.push_back(idx);
+      batch.blobs.push_back(blobdata(reinterpret_cast<char*>(v.mv_data), v.mv_size));
+    }
+  };
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  auto decode_batch = [&](batch_t &batch, tools::threadpool::waiter &waiter)
+  {
+    const size_t n = batch.blobs.size();
+    batch.txs.clear();
+    batch.txs.resize(n);
+    batch.ok.reset(new bool[n]);
+    const size_t threads = std::max<size_t>(tpool.get_max_concurrency(), 1);
+    for (size_t t = 0; t < threads; ++t)
+    {
+      const size_t begin = n * t / threads, end = n * (t + 1) / threads;
+      if (begin == end)
+        continue;
+      tpool.submit(&waiter, [&batch, begin, end](){
+        for (size_t i = begin; i < end; ++i)
+        {
+          binary_archive<false> ba{epee::strspan<std::uint8_t>(batch.blobs[i])};
+          batch.ok[i] = do_serialize(ba, batch.txs[i]);
+        }
+      }, true);
+    }
+  };
 
-    cryptonote::transaction_prefix tx;
-    blobdata bd;
-    bd.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
-    binary_archive<false> ba{epee::strspan<std::uint8_t>(bd)};
-    bool r = do_serialize(ba, tx);
-    CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
+  size_t current = 0;
+  read_batch(batches[current]);
+  {
+    tools::threadpool::waiter waiter(tpool);
+    decode_batch(batches[current], waiter);
+    if (!waiter.wait())
+      throw std::runtime_error("Failed to decode transactions");
+  }
+  while (!batches[current].idx.empty())
+  {
+    batch_t &batch = batches[current], &next = batches[current ^ 1];
+    read_batch(next);
+    tools::threadpool::waiter waiter(tpool);
+    decode_batch(next, waiter);
 
-    start_idx = *(uint64_t*)k.mv_data;
-    if (!f(tx)) {
-      fret = false;
-      break;
+    for (size_t i = 0; i < batch.idx.size(); ++i)
+    {
+      if (!batch.ok[i])
+      {
+        MERROR("Failed to parse transaction from blob");
+        fret = false;
+        break;
+      }
+      start_idx = batch.idx[i];
+      if (!f(batch.txs[i]))
+      {
+        fret = false;
+        break;
+      }
     }
+    if (!waiter.wait())
+      throw std::runtime_error("Failed to decode transactions");
+    if (!fret)
+      break;
+    current ^= 1;
   }
 
   mdb_cursor_close(cur);
@@ -889,25 +959,36 @@ static std::vector<crypto::key_image> get_key_images(MDB_txn *txn, const output_
   return key_images;
 }
 
-static void add_key_image(MDB_txn *txn, const output_data &od, const crypto::key_image &ki)
+static void add_key_images(MDB_txn *txn, std::vector<std::pair<output_data, crypto::key_image>> &key_images)
 {
-  MDB_val k, v;
-  k.mv_data = (void*)&od;
-  k.mv_size = sizeof(od);
-  int dbr = mdb_get(txn, dbi_outputs, &k, &v);
-  CHECK_AND_ASSERT_THROW_MES(!dbr || dbr == MDB_NOTFOUND, "Failed to get output");
-  std::string data;
-  if (!dbr)
+  // sorting groups all the key images for an output together, so each record
+  // is read and written once per batch, and the writes come in key order
+  std::stable_sort(key_images.begin(), key_images.end(), [](const std::pair<output_data, crypto::key_image> &a, const std::pair<output_data, crypto::key_image> &b){
+    return a.first < b.first;
+  });
+  for (size_t i = 0; i < key_images.size(); )
   {
-    CHECK_AND_ASSERT_THROW_MES(v.mv_size % 32 == 0, "Unexpected record size");
-    data = std::string((const char*)v.mv_data, v.mv_size);
-  }
-  data += std::string((const char*)&ki, sizeof(ki));
+    const output_data &od = key_images[i].first;
+    MDB_val k, v;
+    k.mv_data = (void*)&od;
+    k.mv_size = sizeof(od);
+    int dbr = mdb_get(txn, dbi_outputs, &k, &v);
+    CHECK_AND_ASSERT_THROW_MES(!dbr || dbr == MDB_NOTFOUND, "Failed to get output");
+    std::string data;
+    if (!dbr)
+    {
+      CHECK_AND_ASSERT_THROW_MES(v.mv_size % 32 == 0, "Unexpected record size");
+      data = std::string((const char*)v.mv_data, v.mv_size);
+    }
+    for (; i < key_images.size() && key_images[i].first == od; ++i)
+      data += std::string((const char*)&key_images[i].second, sizeof(crypto::key_image));
 
-  v.mv_data = (void*)data.data();
-  v.mv_size = data.size();
-  dbr = mdb_put(txn, dbi_outputs, &k, &v, 0);
-  CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to set outputs: " + std::string(mdb_strerror(dbr)));
+    v.mv_data = (void*)data.data();
+    v.mv_size = data.size();
+    dbr = mdb_put(txn, dbi_outputs, &k, &v, 0);
+    CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to set outputs: " + std::string(mdb_strerror(dbr)));
+  }
+  key_images.clear();
 }
 
 static bool get_stat(MDB_txn *txn, const char *key, uint64_t &data)
@@ -944,6 +1025,70 @@ static void inc_stat(MDB_txn *txn, const char *key)
   set_stat(txn, key, data);
 }
 
+struct chain_reaction
+{
+  output_data od;
+  size_t ring_size;
+};
+
+static std::vector<chain_reaction> find_chain_reactions(const std::vector<output_data> &spent, const bool &stop_requested)
+{
+  // Each shard of the spent list checks the rings its outputs appear in
+  // from its own read txn. Outputs deduced in this pass are only seen by
+  // the next pass, which converges to the same set as marking them as we go.
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  const size_t n_shards = std::min<size_t>(spent.size(), std::max<size_t>(tpool.get_max_concurrency(), 1) * 4);
+  std::vector<std::vector<chain_reaction>> found(n_shards);
+  tools::threadpool::waiter waiter(tpool);
+  for (size_t shard = 0; shard < n_shards; ++shard)
+  {
+    const size_t begin = spent.size() * shard / n_shards, end = spent.size() * (shard + 1) / n_shards;
+    tpool.submit(&waiter, [&, shard, begin, end](){
+      MDB_txn *txn;
+      int dbr = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+      CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to create LMDB transaction: " + std::string(mdb_strerror(dbr)));
+      epee::misc_utils::auto_scope_leave_caller txn_dtor = epee::misc_utils::create_scope_leave_handler([&](){mdb_txn_abort(txn);});
+      MDB_cursor *cur;
+      dbr = mdb_cursor_open(txn, dbi_spent, &cur);
+      CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to open LMDB cursor: " + std::string(mdb_strerror(dbr)));
+      epee::misc_utils::auto_scope_leave_caller cur_dtor = epee::misc_utils::create_scope_leave_handler([&](){mdb_cursor_close(cur);});
+
+      for (size_t i = begin; i < end && !stop_requested; ++i)
+      {
+        const output_data &od = spent[i];
+        std::vector<crypto::key_image> key_images = get_key_images(txn, od);
+        for (const crypto::key_image &ki: key_images)
+        {
+          std::vector<uint64_t> relative_ring;
+          CHECK_AND_ASSERT_THROW_MES(get_relative_ring(txn, ki, relative_ring), "Relative ring not found");
+          std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(relative_ring);
+          size_t known = 0;
+          uint64_t last_unknown = 0;
+          for (uint64_t out: absolute)
+          {
+            output_data new_od(od.amount, out);
+            if (is_output_spent(cur, new_od))
+              ++known;
+            else
+              last_unknown = out;
+          }
+          if (known == absolute.size() - 1)
+            found[shard].push_back({output_data(od.amount, last_unknown), absolute.size()});
+        }
+      }
+    }, true);
+  }
+  if (!waiter.wait())
+    throw std::runtime_error("Failed to scan rings for chain reactions");
+
+  std::vector<chain_reaction> reactions;
+  for (const auto &f: found)
+    reactions.insert(reactions.end(), f.begin(), f.end());
+  std::sort(reactions.begin(), reactions.end(), [](const chain_reaction &a, const chain_reaction &b){ return a.od < b.od; });
+  reactions.erase(std::unique(reactions.begin(), reactions.end(), [](const chain_reaction &a, const chain_reaction &b){ return a.od == b.od; }), reactions.end());
+  return reactions;
+}
+
 static void open_db(const std::string &filename, MDB_env **env, MDB_txn **txn, MDB_cursor **cur, MDB_dbi *dbi)
 {
   tools::create_directories_if_necessary(filename);
@@ -1393,10 +1538,12 @@ int main(int argc, char* argv[])
     size_t records = 0;
     const std::string filename = inputs[n];
     std::vector<std::pair<uint64_t, uint64_t>> blackballs;
+    std::vector<std::pair<output_data, crypto::key_image>> key_images;
     uint64_t n_txes;
+    uint64_t processed_txidx = start_idx, batch_start_txidx = start_idx;
+    auto batch_start_time = std::chrono::steady_clock::now();
     for_all_transactions(filename, start_idx, n_txes, [&](const cryptonote::transaction_prefix &tx)->bool
     {
-      std::cout << "\r" << start_idx << "/" << n_txes << "         \r" << std::flush;
       const bool miner_tx = tx.vin.size() == 1 && tx.vin[0].type() == typeid(txin_gen);
       for (const auto &in: tx.vin)
       {
@@ -1409,7 +1556,7 @@ int main(int argc, char* argv[])
         const std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(txin.key_offsets);
         if (n == 0)
           for (uint64_t out: absolute)
-            add_key_image(txn, output_data(txin.amount, out), txin.k_image);
+            key_images.push_back(std::make_pair(output_data(txin.amount, out), txin.k_image));
 
         std::vector<uint64_t> relative_ring;
         std::vector<uint64_t> new_ring = canonicalize(txin.key_offsets);
@@ -1528,7 +1675,7 @@ int main(int argc, char* argv[])
             inc_per_amount_outputs(txn, txin.amount, 0, 1);
         }
       }
-      set_processed_txidx(txn, canonical, start_idx+1);
+      processed_txidx = start_idx + 1;
       if (!opt_rct_only)
       {
         for (const auto &out: tx.vout)
@@ -1553,6 +1700,13 @@ int main(int argc, char* argv[])
           ringdb.blackball(blackballs);
           blackballs.clear();
         }
+        add_key_images(txn, key_images);
+        set_processed_txidx(txn, canonical, processed_txidx);
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(now - batch_start_time).count();
+        std::cout << "\r" << processed_txidx << "/" << n_txes << " (" << (uint64_t)((processed_txidx - batch_start_txidx) / std::max(seconds, 0.001)) << " tx/s)         \r" << std::flush;
+        batch_start_txidx = processed_txidx;
+        batch_start_time = now;
         mdb_cursor_close(cur);
         dbr = mdb_txn_commit(txn);
         CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn creating/opening database: " + std::string(mdb_strerror(dbr)));
@@ -1572,10 +1726,17 @@ int main(int argc, char* argv[])
       }
       return true;
     });
+    if (!blackballs.empty())
+    {
+      ringdb.blackball(blackballs);
+      blackballs.clear();
+    }
+    add_key_images(txn, key_images);
+    set_processed_txidx(txn, canonical, processed_txidx);
     mdb_cursor_close(cur);
     dbr = mdb_txn_commit(txn);
     CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to commit txn creating/opening database: " + std::string(mdb_strerror(dbr)));
-    LOG_PRINT_L0("blockchain from " << inputs[n] << " processed till tx idx " << start_idx);
+    LOG_PRINT_L0("blockchain from " << inputs[n] << " processed till tx idx " << processed_txidx);
     if (stop_requested)
       break;
   }
@@ -1596,6 +1757,17 @@ int main(int argc, char* argv[])
   {
     LOG_PRINT_L0("Secondary pass on " << work_spent.size() << " spent outputs");
 
+    // read-only, and done before the write txn is opened: a thread may only
+    // hold one txn on the env, and this one also runs some of the shards
+    std::vector<output_data> scan_spent = std::move(work_spent);
+    work_spent.clear();
+    const std::vector<chain_reaction> reactions = find_chain_reactions(scan_spent, stop_requested);
+    if (stop_requested)
+    {
+      MINFO("Stopping secondary passes. Secondary passes are not incremental, they will re-run fully.");
+      return 0;
+    }
+
     int dbr = resize_env(cache_dir.c_str());
     CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to resize LMDB database: " + std::string(mdb_strerror(dbr)));
 
@@ -1606,47 +1778,21 @@ int main(int argc, char* argv[])
     dbr = mdb_cursor_open(txn, dbi_spent, &cur);
     CHECK_AND_ASSERT_THROW_MES(!dbr, "Failed to open LMDB cursor: " + std::string(mdb_strerror(dbr)));
 
+    // reactions are sorted, so the spent table is written in key order
     std::vector<std::pair<uint64_t, uint64_t>> blackballs;
-    std::vector<output_data> scan_spent = std::move(work_spent);
-    work_spent.clear();
-    for (const output_data &od: scan_spent)
+    for (const chain_reaction &reaction: reactions)
     {
-      std::vector<crypto::key_image> key_images = get_key_images(txn, od);
-      for (const crypto::key_image &ki: key_images)
-      {
-        std::vector<uint64_t> relative_ring;
-        CHECK_AND_ASSERT_THROW_MES(get_relative_ring(txn, ki, relative_ring), "Relative ring not found");
-        std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(relative_ring);
-        size_t known = 0;
-        uint64_t last_unknown = 0;
-        for (uint64_t out: absolute)
-        {
-          output_data new_od(od.amount, out);
-          if (is_output_spent(cur, new_od))
-            ++known;
-          else
-            last_unknown = out;
-        }
-        if (known == absolute.size() - 1)
-        {
-          const std::pair<uint64_t, uint64_t> output = std::make_pair(od.amount, last_unknown);
-          if (opt_verbose)
-          {
-            MINFO("Marking output " << output.first << "/" << output.second << " as spent, due to being used in a " <<
-                absolute.size() << "-ring where all other outputs are known to be spent");
-          }
-          blackballs.push_back(output);
-          if (add_spent_output(cur, output_data(od.amount, last_unknown)))
-            inc_stat(txn, od.amount ? "pre-rct-chain-reaction" : "rct-chain-reaction");
-          work_spent.push_back(output_data(od.amount, last_unknown));
-        }
-      }
-
-      if (stop_requested)
+      const std::pair<uint64_t, uint64_t> output = std::make_pair(reaction.od.amount, reaction.od.offset);
+      if (!add_spent_output(cur, reaction.od))
+        continue;
+      if (opt_verbose)
       {
-        MINFO("Stopping secondary passes. Secondary passes are not incremental, they will re-run fully.");
-        return 0;
+        MINFO("Marking output " << output.first << "/" << output.second << " as spent, due to being used in a " <<
+            reaction.ring_size << "-ring where all other outputs are known to be spent");
       }
+      blackballs.push_back(output);
+      inc_stat(txn, reaction.od.amount ? "pre-rct-chain-reaction" : "rct-chain-reaction");
+      work_spent.push_back(reaction.od);
     }
     if (!blackballs.empty())
     {
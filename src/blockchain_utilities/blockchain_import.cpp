@@ -29,14 +29,21 @@
 #include <atomic>
 #include <cstdio>
 #include <algorithm>
+#include <deque>
 #include <fstream>
 
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/optional/optional.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include <unistd.h>
 #include "misc_log_ex.h"
+#include "common/threadpool.h"
 #include "bootstrap_file.h"
 #include "bootstrap_serialization.h"
+#include "blockchain_import_progress.h"
 #include "blocks/blocks.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "serialization/binary_utils.h" // dump_binary(), parse_binary()
@@ -127,32 +134,246 @@ int pop_blocks(cryptonote::core& core, int num_blocks)
   return num_blocks;
 }
 
-int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &blocks, bool force)
+struct import_batch
 {
-  if (blocks.empty())
-    return 0;
-  if (!force && blocks.size() < db_batch_size)
-    return 0;
+  uint64_t start_height; // height of the first block in the batch
+  uint64_t end_offset; // file offset of the chunk following the batch
+  std::vector<block_complete_entry> blocks;
+  std::vector<crypto::hash> hashes;
+};
+
+// Reads the bootstrap file and decodes it into verification batches on its
+// own thread, so reading, deserializing and hashing the next batches overlap
+// with verifying and committing the current one. At most max_batches decoded
+// batches are held ahead of the consumer. Only decoding runs ahead: PoW,
+// proofs and ring signatures are all checked by the consumer, since each
+// batch is verified against the chain the previous one committed.
+class batch_reader
+{
+public:
+  batch_reader(std::ifstream &import_file, uint8_t major_version, uint64_t height, uint64_t block_stop, size_t max_batches, BootstrapIndex *index):
+    m_import_file(import_file), m_major_version(major_version), m_height(height), m_block_stop(block_stop),
+    m_offset(import_file.tellg()), m_max_batches(std::max<size_t>(max_batches, 1)), m_index(index), m_done(false), m_stop(false)
+  {
+  }
 
-  // wait till we can verify a full HOH without extra, for speed
-  uint64_t new_height = core.get_blockchain_storage().get_db().height() + blocks.size();
-  if (!force && new_height % HASH_OF_HASHES_STEP)
-    return 0;
+  ~batch_reader()
+  {
+    stop();
+  }
 
-  std::vector<crypto::hash> hashes;
-  for (const auto &b: blocks)
+  void start()
+  {
+    boost::thread::attributes attrs;
+    attrs.set_stack_size(THREAD_STACK_SIZE);
+    m_thread = boost::thread(attrs, [this](){ run(); });
+  }
+
+  void stop()
   {
-    cryptonote::block block;
-    if (!parse_and_validate_block_from_blob(b.block, block))
     {
-      MERROR("Failed to parse block: "
-          << epee::string_tools::buff_to_hex_nodelimer(b.block));
-      core.cleanup_handle_incoming_blocks();
-      return 1;
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cond.notify_all();
+    if (m_thread.joinable())
+      m_thread.join();
+  }
+
+  // returns false once the input is exhausted, throws if reading failed
+  bool pop(import_batch &batch)
+  {
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    while (m_batches.empty() && !m_done)
+      m_cond.wait(lock);
+    if (m_batches.empty())
+    {
+      if (!m_error.empty())
+        throw std::runtime_error(m_error);
+      return false;
+    }
+    batch = std::move(m_batches.front());
+    m_batches.pop_front();
+    m_cond.notify_all();
+    return true;
+  }
+
+private:
+  // checksum is set from the index when there is one, and left at boost::none otherwise
+  bool read_chunk(std::string &chunk, boost::optional<uint64_t> &checksum)
+  {
+    uint32_t chunk_size;
+    char buf[sizeof(chunk_size)];
+    m_import_file.read(buf, sizeof(chunk_size));
+    if (!m_import_file)
+    {
+      MINFO("End of file reached");
+      return false;
+    }
+    if (!::serialization::parse_binary(std::string(buf, sizeof(chunk_size)), chunk_size))
+      throw std::runtime_error("Error in deserialization of chunk size");
+    MDEBUG("chunk_size: " << chunk_size);
+    if (chunk_size > BUFFER_SIZE)
+    {
+      MWARNING("WARNING: chunk_size " << chunk_size << " > BUFFER_SIZE " << BUFFER_SIZE);
+      throw std::runtime_error("Aborting: chunk size exceeds buffer size");
+    }
+    if (chunk_size > CHUNK_SIZE_WARNING_THRESHOLD)
+      MINFO("NOTE: chunk_size " << chunk_size << " > " << CHUNK_SIZE_WARNING_THRESHOLD);
+    else if (chunk_size == 0)
+      throw std::runtime_error("ERROR: chunk_size == 0");
+
+    chunk.resize(chunk_size);
+    m_import_file.read(&chunk[0], chunk_size);
+    if (!m_import_file)
+    {
+      if (m_import_file.eof())
+      {
+        MINFO("End of file reached - file was truncated");
+        return false;
+      }
+      throw std::runtime_error("ERROR: unexpected end of file: bytes read before error: " +
+          std::to_string(m_import_file.gcount()) + " of chunk_size " + std::to_string(chunk_size));
+    }
+    checksum = boost::none;
+    BootstrapIndex::entry e;
+    if (m_index && m_index->get(m_height, e))
+    {
+      if (e.offset != m_offset || e.size != chunk_size)
+        throw std::runtime_error("Bootstrap index does not match the file at height " + std::to_string(m_height));
+      checksum = e.checksum;
+    }
+    m_offset += sizeof(chunk_size) + chunk_size;
+    return true;
+  }
+
+  void decode_chunk(const std::string &chunk, const boost::optional<uint64_t> &checksum, block_complete_entry &bce, crypto::hash &hash) const
+  {
+    if (checksum && BootstrapIndex::get_checksum(chunk.data(), chunk.size()) != *checksum)
+      throw std::runtime_error("Chunk checksum mismatch");
+
+    bootstrap::block_package bp;
+    bool res;
+    if (m_major_version == 0)
+    {
+      bootstrap::block_package_1 bp1;
+      res = ::serialization::parse_binary(chunk, bp1);
+      if (res)
+      {
+        bp.block = std::move(bp1.block);
+        bp.txs = std::move(bp1.txs);
+      }
+    }
+    else
+      res = ::serialization::parse_binary(chunk, bp);
+    if (!res)
+      throw std::runtime_error("Error in deserialization of chunk");
+
+    bce.pruned = false;
+    cryptonote::block_to_blob(bp.block, bce.block);
+    bce.txs.reserve(bp.txs.size());
+    for (const auto &tx: bp.txs)
+    {
+      bce.txs.push_back({cryptonote::blobdata(), crypto::null_hash});
+      cryptonote::tx_to_blob(tx, bce.txs.back().blob);
+    }
+    hash = cryptonote::get_block_hash(bp.block);
+  }
+
+  void run()
+  {
+    MLOG_SET_THREAD_NAME("import reader");
+    try
+    {
+      bool eof = false;
+      while (!eof)
+      {
+        // same boundaries as the serial import: full batches ending on a hash of hashes step
+        std::vector<std::string> chunks;
+        std::vector<boost::optional<uint64_t>> checksums;
+        const uint64_t start_height = m_height;
+        while (true)
+        {
+          std::string chunk;
+          boost::optional<uint64_t> checksum;
+          if (m_height > m_block_stop || !read_chunk(chunk, checksum))
+          {
+            eof = true;
+            break;
+          }
+          chunks.push_back(std::move(chunk));
+          checksums.push_back(checksum);
+          ++m_height;
+          if (bootstrap::is_import_batch_end(chunks.size(), m_height, db_batch_size))
+            break;
+          boost::unique_lock<boost::mutex> lock(m_mutex);
+          if (m_stop)
+            return;
+        }
+        if (chunks.empty())
+          break;
+
+        import_batch batch;
+        batch.start_height = start_height;
+        batch.end_offset = m_offset;
+        batch.blocks.resize(chunks.size());
+        batch.hashes.resize(chunks.size());
+        std::atomic<bool> failed(false);
+        tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+        tools::threadpool::waiter waiter(tpool);
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+          tpool.submit(&waiter, [&, i](){
+            try { decode_chunk(chunks[i], checksums[i], batch.blocks[i], batch.hashes[i]); }
+            catch (const std::exception &e) { MERROR("Failed to decode block " << start_height + i << ": " << e.what()); failed = true; }
+          }, true);
+        }
+        if (!waiter.wait() || failed)
+          throw std::runtime_error("Failed to decode blocks at height " + std::to_string(start_height));
+
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (m_batches.size() >= m_max_batches && !m_stop)
+          m_cond.wait(lock);
+        if (m_stop)
+          return;
+        m_batches.push_back(std::move(batch));
+        m_cond.notify_all();
+      }
     }
-    hashes.push_back(cryptonote::get_block_hash(block));
+    catch (const std::exception &e)
+    {
+      boost::unique_lock<boost::mutex> lock(m_mutex);
+      m_error = e.what();
+    }
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    m_done = true;
+    m_cond.notify_all();
   }
-  core.prevalidate_block_hashes(core.get_blockchain_storage().get_db().height(), hashes, {});
+
+  std::ifstream &m_import_file;
+  const uint8_t m_major_version;
+  uint64_t m_height;
+  const uint64_t m_block_stop;
+  uint64_t m_offset;
+  const size_t m_max_batches;
+  BootstrapIndex *m_index;
+
+  boost::thread m_thread;
+  boost::mutex m_mutex;
+  boost::condition_variable m_cond;
+  std::deque<import_batch> m_batches;
+  bool m_done;
+  bool m_stop;
+  std::string m_error;
+};
+
+int add_batch(cryptonote::core &core, import_batch &batch)
+{
+  std::vector<block_complete_entry> &blocks = batch.blocks;
+  if (blocks.empty())
+    return 0;
+
+  core.prevalidate_block_hashes(core.get_blockchain_storage().get_db().height(), batch.hashes, {});
 
   std::vector<block> pblocks;
   if (!core.prepare_handle_incoming_blocks(blocks, pblocks))
@@ -170,15 +391,16 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
   size_t blockidx = 0;
   for(const block_complete_entry& block_entry: blocks)
   {
-    // process transactions
-    for(auto& tx_blob: block_entry.txs)
+    // process transactions, parsed and syntax checked in parallel on the compute threadpool;
+    // proofs are verified on this thread
+    std::vector<tx_verification_context> tvc(block_entry.txs.size());
+    core.handle_incoming_txs(epee::to_span(block_entry.txs), epee::to_mut_span(tvc), relay_method::block, true);
+    for (size_t i = 0; i < tvc.size(); ++i)
     {
-      tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-      core.handle_incoming_tx(tx_blob, tvc, relay_method::block, true);
-      if(tvc.m_verifivation_failed)
+      if(tvc[i].m_verifivation_failed)
       {
         cryptonote::transaction transaction;
-        if (cryptonote::parse_and_validate_tx_from_blob(tx_blob.blob, transaction))
+        if (cryptonote::parse_and_validate_tx_from_blob(block_entry.txs[i].blob, transaction))
           MERROR("Transaction verification failed, tx_id = " << cryptonote::get_transaction_hash(transaction));
         else
           MERROR("Transaction verification failed, transaction is unparsable");
@@ -214,7 +436,58 @@ int check_flush(cryptonote::core &core, std::vector<block_complete_entry> &block
   if (!core.cleanup_handle_incoming_blocks())
     return 1;
 
-  blocks.clear();
+  return 0;
+}
+
+// The progress file records the chain height, top block hash and bootstrap
+// file offset after each committed batch, so a resumed import can seek
+// straight to where it stopped instead of scanning the file again.
+uint64_t load_import_progress(const std::string &path, cryptonote::core &core, uint64_t height)
+{
+  const boost::optional<bootstrap::import_progress> progress = bootstrap::load_import_progress(path);
+  if (!progress)
+    return 0;
+  if (progress->height != height || height == 0 || core.get_blockchain_storage().get_block_id_by_height(height - 1) != progress->top_hash)
+  {
+    MINFO("Import progress file " << path << " does not match the blockchain, scanning bootstrap file");
+    return 0;
+  }
+  return progress->offset;
+}
+
+int import_verified(cryptonote::core& core, std::ifstream& import_file, uint8_t major_version, uint64_t& h, uint64_t block_stop,
+    uint64_t& num_imported, const std::string& import_file_path, const std::string& progress_path)
+{
+  // chunks are checked against the bootstrap index checksums, when the file has one
+  BootstrapIndex index;
+  const bool indexed = index.open(import_file_path);
+  batch_reader reader(import_file, major_version, h, block_stop, 2, indexed ? &index : NULL);
+  reader.start();
+
+  import_batch batch;
+  try
+  {
+    while (reader.pop(batch))
+    {
+      const int ret = add_batch(core, batch);
+      if (ret)
+        return ret;
+      const bootstrap::import_progress progress = bootstrap::get_import_progress(batch.start_height, batch.hashes, batch.end_offset);
+      h = progress.height;
+      num_imported += batch.blocks.size();
+      bootstrap::save_import_progress(progress_path, progress);
+      std::cout << refresh_string << "block " << h-1
+        << " / " << block_stop
+        << "\r" << std::flush;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cout << refresh_string;
+    MFATAL("exception while importing, height=" << h << ": " << e.what());
+    return 2;
+  }
+  std::cout << refresh_string;
   return 0;
 }
 
@@ -233,16 +506,36 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
     return false;
   }
 
+  const std::string progress_path = import_file_path + ".progress";
   uint64_t block_first;
   uint64_t start_height = 1, seek_height;
+  uint64_t resume_offset = 0;
   if (opt_resume)
+  {
     start_height = core.get_blockchain_storage().get_current_blockchain_height();
+    resume_offset = load_import_progress(progress_path, core, start_height);
+  }
 
   seek_height = start_height;
   BootstrapFile bootstrap;
   std::streampos pos;
-  // BootstrapFile bootstrap(import_file_path);
-  uint64_t total_source_blocks = bootstrap.count_blocks(import_file_path, pos, seek_height, block_first);
+  uint64_t total_source_blocks;
+  if (resume_offset)
+  {
+    // the header gives the block range, no need to scan the whole file
+    std::ifstream header_file(import_file_path, std::ios_base::binary | std::ifstream::in);
+    uint8_t major_version, minor_version;
+    uint64_t block_last;
+    bootstrap.seek_to_first_chunk(header_file, major_version, minor_version, block_first, block_last);
+    total_source_blocks = block_last - block_first + 1;
+    pos = resume_offset;
+    MINFO("Resuming import at height " << start_height << ", file offset " << resume_offset);
+  }
+  else
+  {
+    // BootstrapFile bootstrap(import_file_path);
+    total_source_blocks = bootstrap.count_blocks(import_file_path, pos, seek_height, block_first);
+  }
   MINFO("bootstrap file last block number: " << total_source_blocks+block_first-1 << " (zero-based height)  total blocks: " << total_source_blocks);
 
   if (total_source_blocks+block_first-1 <= start_height)
@@ -296,13 +589,19 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
   MINFO("Reading blockchain from bootstrap file...");
   std::cout << ENDL;
 
-  std::vector<block_complete_entry> blocks;
-
   // Skip to start_height before we start adding.
+  if (resume_offset)
+  {
+    import_file.seekg(pos);
+    bytes_read = resume_offset;
+    h = start_height;
+  }
+  else
   {
     bool q2 = false;
     import_file.seekg(pos);
-    bytes_read = bootstrap.count_bytes(import_file, start_height-seek_height, h, q2);
+    // an indexed file is positioned exactly on start_height already
+    bytes_read = start_height > seek_height ? bootstrap.count_bytes(import_file, start_height-seek_height, h, q2) : 0;
     if (q2)
     {
       quit = 2;
@@ -311,6 +610,17 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
     h = start_height;
   }
 
+  if (opt_verify)
+  {
+    const int ret = import_verified(core, import_file, major_version, h, block_stop, num_imported, import_file_path, progress_path);
+    if (ret)
+    {
+      import_file.close();
+      return ret;
+    }
+    quit = 1;
+  }
+
   if (use_batch)
   {
     uint64_t bytes, h2;
@@ -433,29 +743,6 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
             << "\r" << std::flush;
         }
 
-        if (opt_verify)
-        {
-          cryptonote::blobdata block;
-          cryptonote::block_to_blob(bp.block, block);
-          std::vector<tx_blob_entry> txs;
-          for (const auto &tx: bp.txs)
-          {
-            txs.push_back({cryptonote::blobdata(), crypto::null_hash});
-            cryptonote::tx_to_blob(tx, txs.back().blob);
-          }
-          block_complete_entry bce;
-          bce.pruned = false;
-          bce.block = std::move(block);
-          bce.txs = std::move(txs);
-          blocks.push_back(bce);
-          int ret = check_flush(core, blocks, false);
-          if (ret)
-          {
-            quit = 2; // make sure we don't commit partial block data
-            break;
-          }
-        }
-        else
         {
           std::vector<std::pair<transaction, blobdata>> txs;
           std::vector<transaction> archived_txs;
@@ -510,6 +797,7 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
               std::cout << ENDL << "[- batch commit at height " << h-1 << " -]" << ENDL;
               core.get_blockchain_storage().get_db().batch_stop();
               pos = import_file.tellg();
+              bootstrap::save_import_progress(progress_path, {h, core.get_blockchain_storage().get_db().top_block_hash(), (uint64_t)pos});
               bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
               import_file.seekg(pos);
               core.get_blockchain_storage().get_db().batch_start(db_batch_size, bytes);
@@ -532,13 +820,6 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
 quitting:
   import_file.close();
 
-  if (opt_verify)
-  {
-    int ret = check_flush(core, blocks, true);
-    if (ret)
-      return ret;
-  }
-
   if (use_batch)
   {
     if (quit > 1)
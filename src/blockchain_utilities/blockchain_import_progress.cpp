@@ -0,0 +1,101 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+#include "misc_log_ex.h"
+#include "file_io_utils.h"
+#include "string_tools.h"
+#include "cryptonote_config.h"
+#include "blockchain_import_progress.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+namespace cryptonote
+{
+  namespace bootstrap
+  {
+
+    bool is_import_batch_end(size_t batch_blocks, uint64_t next_height, uint64_t batch_size)
+    {
+      return batch_blocks >= batch_size && next_height % HASH_OF_HASHES_STEP == 0;
+    }
+
+    import_progress get_import_progress(uint64_t start_height, const std::vector<crypto::hash>& hashes, uint64_t end_offset)
+    {
+      CHECK_AND_ASSERT_THROW_MES(!hashes.empty(), "Empty import batch");
+      return {start_height + hashes.size(), hashes.back(), end_offset};
+    }
+
+    std::string format_import_progress(const import_progress& progress)
+    {
+      std::stringstream ss;
+      ss << progress.height << " " << epee::string_tools::pod_to_hex(progress.top_hash) << " " << progress.offset << std::endl;
+      return ss.str();
+    }
+
+    bool parse_import_progress(const std::string& data, import_progress& progress)
+    {
+      std::istringstream iss(data);
+      std::string hash_hex;
+      if (!(iss >> progress.height >> hash_hex >> progress.offset))
+        return false;
+      return epee::string_tools::hex_to_pod(hash_hex, progress.top_hash);
+    }
+
+    bool save_import_progress(const std::string& path, const import_progress& progress)
+    {
+      if (!epee::file_io_utils::save_string_to_file(path, format_import_progress(progress)))
+      {
+        MWARNING("Failed to save import progress to " << path);
+        return false;
+      }
+      return true;
+    }
+
+    boost::optional<import_progress> load_import_progress(const std::string& path)
+    {
+      boost::system::error_code ec;
+      if (!boost::filesystem::exists(path, ec))
+        return boost::none;
+      std::string data;
+      if (!epee::file_io_utils::load_file_to_string(path, data))
+        return boost::none;
+      import_progress progress;
+      if (!parse_import_progress(data, progress))
+      {
+        MWARNING("Ignoring invalid import progress file " << path);
+        return boost::none;
+      }
+      return progress;
+    }
+
+  }
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/optional/optional.hpp>
+
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+  namespace bootstrap
+  {
+
+    // Where a verified import stood after its last committed batch: the chain
+    // height, the hash of the block below it and the bootstrap file offset of
+    // the next chunk. Saved next to the bootstrap file as <file>.progress.
+    struct import_progress
+    {
+      uint64_t height;
+      crypto::hash top_hash;
+      uint64_t offset;
+    };
+
+    // A batch ends once it holds at least batch_size blocks and the next block
+    // starts a hash of hashes step, so batches line up with the precomputed
+    // block hashes and with the boundaries of the serial import.
+    bool is_import_batch_end(size_t batch_blocks, uint64_t next_height, uint64_t batch_size);
+
+    // Progress after committing the batch of hashes starting at start_height
+    // and ending just before end_offset. hashes must not be empty.
+    import_progress get_import_progress(uint64_t start_height, const std::vector<crypto::hash>& hashes, uint64_t end_offset);
+
+    std::string format_import_progress(const import_progress& progress);
+    bool parse_import_progress(const std::string& data, import_progress& progress);
+
+    bool save_import_progress(const std::string& path, const import_progress& progress);
+    // returns boost::none if the file is missing or invalid
+    boost::optional<import_progress> load_import_progress(const std::string& path);
+
+  }
+}
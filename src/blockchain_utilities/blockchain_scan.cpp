@@ -0,0 +1,165 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "common/threadpool.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "blockchain_scan.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+// Blocks per job. Partial results are merged after each round of one job
+// per thread, so this also bounds how much per-range state is alive at once.
+#define SCAN_MIN_RANGE_BLOCKS 100
+#define SCAN_MAX_RANGE_BLOCKS 10000
+
+using namespace cryptonote;
+
+BlockchainScanner::BlockchainScanner(BlockchainDB &db): m_db(db)
+{
+}
+
+bool BlockchainScanner::scan_range(uint64_t start, uint64_t stop, const std::vector<std::unique_ptr<ScanVisitor>> &visitors,
+    bool prunable_sizes, const std::atomic<bool> *stop_requested) const
+{
+  try
+  {
+    ScannedBlock b;
+    for (uint64_t h = start; h < stop; ++h)
+    {
+      if (stop_requested && *stop_requested)
+        break;
+
+      b.height = h;
+      b.tx_hashes.clear();
+      b.txs.clear();
+      b.tx_sizes.clear();
+      b.bad_txs.clear();
+
+      cryptonote::blobdata bd = m_db.get_block_blob_from_height(h);
+      b.block = cryptonote::block();
+      if (!cryptonote::parse_and_validate_block_from_blob(bd, b.block))
+      {
+        MERROR("Bad block from db at height " << h);
+        return false;
+      }
+      b.block_size = bd.size();
+
+      b.tx_hashes.reserve(b.block.tx_hashes.size());
+      b.txs.reserve(b.block.tx_hashes.size());
+      b.tx_sizes.reserve(b.block.tx_hashes.size());
+      for (const auto &tx_id: b.block.tx_hashes)
+      {
+        if (tx_id == crypto::null_hash)
+        {
+          MERROR("Null tx hash in block at height " << h);
+          return false;
+        }
+        if (!m_db.get_pruned_tx_blob(tx_id, bd))
+        {
+          MERROR("Tx " << tx_id << " not found in db");
+          return false;
+        }
+        cryptonote::transaction tx;
+        if (!cryptonote::parse_and_validate_tx_base_from_blob(bd, tx))
+        {
+          b.bad_txs.push_back(tx_id);
+          continue;
+        }
+        size_t size = bd.size();
+        if (prunable_sizes && m_db.get_prunable_tx_blob(tx_id, bd))
+          size += bd.size();
+        b.tx_hashes.push_back(tx_id);
+        b.txs.push_back(std::move(tx));
+        b.tx_sizes.push_back(size);
+      }
+
+      for (const auto &v: visitors)
+        if (!v->visit(b))
+          return false;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Error scanning blocks " << start << " to " << stop << ": " << e.what());
+    return false;
+  }
+  return true;
+}
+
+bool BlockchainScanner::scan(uint64_t start, uint64_t stop, const std::atomic<bool> *stop_requested)
+{
+  if (m_visitors.empty() || start >= stop)
+    return true;
+
+  bool prunable_sizes = false;
+  for (const ScanVisitor *v: m_visitors)
+    prunable_sizes |= v->needs_prunable_sizes();
+
+  tools::threadpool &tpool = tools::threadpool::getInstanceForCompute();
+  const uint64_t threads = std::max<uint64_t>(tpool.get_max_concurrency(), 1);
+  const uint64_t range_blocks = std::min<uint64_t>(SCAN_MAX_RANGE_BLOCKS,
+      std::max<uint64_t>(SCAN_MIN_RANGE_BLOCKS, (stop - start + threads - 1) / threads));
+
+  uint64_t round_start = start;
+  while (round_start < stop)
+  {
+    const uint64_t round_stop = std::min<uint64_t>(stop, round_start + threads * range_blocks);
+    const size_t n_ranges = (round_stop - round_start + range_blocks - 1) / range_blocks;
+
+    std::vector<std::vector<std::unique_ptr<ScanVisitor>>> partials(n_ranges);
+    std::unique_ptr<bool[]> ok(new bool[n_ranges]);
+    tools::threadpool::waiter waiter(tpool);
+    for (size_t r = 0; r < n_ranges; ++r)
+    {
+      for (const ScanVisitor *v: m_visitors)
+        partials[r].push_back(v->clone());
+      const uint64_t range_start = round_start + r * range_blocks;
+      const uint64_t range_stop = std::min<uint64_t>(round_stop, range_start + range_blocks);
+      tpool.submit(&waiter, [&, r, range_start, range_stop](){
+        ok[r] = scan_range(range_start, range_stop, partials[r], prunable_sizes, stop_requested);
+      }, true);
+    }
+    if (!waiter.wait())
+      return false;
+
+    for (size_t r = 0; r < n_ranges; ++r)
+    {
+      if (!ok[r])
+        return false;
+      for (size_t v = 0; v < m_visitors.size(); ++v)
+        m_visitors[v]->merge(*partials[r][v]);
+    }
+
+    MINFO("Scanned up to height " << round_stop - 1 << " of " << stop - 1);
+    if (stop_requested && *stop_requested)
+      break;
+    round_start = round_stop;
+  }
+  return true;
+}
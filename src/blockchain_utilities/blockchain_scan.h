@@ -0,0 +1,91 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "blockchain_db/blockchain_db.h"
+
+// One block as handed to the scan visitors: the block and its transactions
+// are read from the database and decoded once, whatever the number of
+// visitors looking at them.
+struct ScannedBlock
+{
+  uint64_t height;
+  cryptonote::block block;
+  size_t block_size;
+  std::vector<crypto::hash> tx_hashes;
+  std::vector<cryptonote::transaction> txs; // prunable data not parsed
+  std::vector<size_t> tx_sizes; // pruned size, plus prunable size when requested
+  std::vector<crypto::hash> bad_txs; // txes whose blob failed to parse
+};
+
+// A visitor accumulates its results over a contiguous range of blocks.
+// The scanner clones one visitor per range, visits the ranges in parallel,
+// then merges the partial results back in height order, so visit() never
+// needs to be thread safe, and merge() is always given the range which
+// immediately follows the ones already merged.
+class ScanVisitor
+{
+public:
+  virtual ~ScanVisitor() {}
+
+  // a fresh, empty visitor with the same settings
+  virtual std::unique_ptr<ScanVisitor> clone() const = 0;
+
+  // returns false to abort the scan
+  virtual bool visit(const ScannedBlock &b) = 0;
+
+  // fold the results of the next range into this one
+  virtual void merge(ScanVisitor &next) = 0;
+
+  virtual bool needs_prunable_sizes() const { return false; }
+};
+
+class BlockchainScanner
+{
+public:
+  BlockchainScanner(cryptonote::BlockchainDB &db);
+
+  void add_visitor(ScanVisitor &visitor) { m_visitors.push_back(&visitor); }
+
+  // scans blocks [start, stop), stopping early (but still merging the
+  // blocks already visited) when stop_requested becomes true
+  bool scan(uint64_t start, uint64_t stop, const std::atomic<bool> *stop_requested = NULL);
+
+private:
+  bool scan_range(uint64_t start, uint64_t stop, const std::vector<std::unique_ptr<ScanVisitor>> &visitors,
+      bool prunable_sizes, const std::atomic<bool> *stop_requested) const;
+
+  cryptonote::BlockchainDB &m_db;
+  std::vector<ScanVisitor*> m_visitors;
+};
@@ -0,0 +1,409 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <iomanip>
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "time_helper.h"
+#include "blockchain_scan_visitors.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
+
+using namespace cryptonote;
+
+namespace
+{
+  std::string format_day(uint64_t timestamp)
+  {
+    struct tm tm;
+    char timebuf[64];
+    if (!epee::misc_utils::get_gmt_time(timestamp, tm) || !strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &tm))
+      return "?";
+    return timebuf;
+  }
+
+  bool same_date(const struct tm &a, const struct tm &b)
+  {
+    return a.tm_year == b.tm_year && a.tm_mon == b.tm_mon && a.tm_mday == b.tm_mday;
+  }
+
+  template<typename T>
+  void update_min_max(T &min_value, T &max_value, T value)
+  {
+    if (value < min_value)
+      min_value = value;
+    if (value > max_value)
+      max_value = value;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------
+void StatsVisitor::day_stats::add(const day_stats &other)
+{
+  blocks += other.blocks;
+  top_height = std::max(top_height, other.top_height);
+  txs += other.txs;
+  bytes += other.bytes;
+  emission += other.emission;
+  fees += other.fees;
+  if (other.min_diff && (!min_diff || other.min_diff < min_diff))
+    min_diff = other.min_diff;
+  max_diff = std::max(max_diff, other.max_diff);
+  tot_diff += other.tot_diff;
+  min_ins = std::min(min_ins, other.min_ins);
+  max_ins = std::max(max_ins, other.max_ins);
+  min_outs = std::min(min_outs, other.min_outs);
+  max_outs = std::max(max_outs, other.max_outs);
+  min_rings = std::min(min_rings, other.min_rings);
+  max_rings = std::max(max_rings, other.max_rings);
+  tot_ins += other.tot_ins;
+  tot_outs += other.tot_outs;
+  tot_rings += other.tot_rings;
+  for (int i = 0; i < 24; ++i)
+    tx_hours[i] += other.tx_hours[i];
+}
+//---------------------------------------------------------------------------------------------------
+StatsVisitor::StatsVisitor(BlockchainDB &db, const options &opts): m_db(db), m_opts(opts)
+{
+}
+//---------------------------------------------------------------------------------------------------
+std::unique_ptr<ScanVisitor> StatsVisitor::clone() const
+{
+  return std::unique_ptr<ScanVisitor>(new StatsVisitor(m_db, m_opts));
+}
+//---------------------------------------------------------------------------------------------------
+bool StatsVisitor::visit(const ScannedBlock &b)
+{
+  if (!b.bad_txs.empty())
+  {
+    MERROR("Bad txn " << b.bad_txs.front() << " from db at height " << b.height);
+    return false;
+  }
+
+  struct tm tm = {};
+  epee::misc_utils::get_gmt_time(b.block.timestamp, tm);
+  if (m_runs.empty() || !same_date(m_runs.back().tm, tm))
+    m_runs.push_back({tm, day_stats()});
+  day_stats &ds = m_runs.back().stats;
+
+  ds.blocks++;
+  ds.top_height = b.height + 1;
+  ds.bytes += b.block_size;
+
+  const unsigned int hour = tm.tm_hour;
+  uint64_t tx_fee_amount = 0;
+  for (size_t i = 0; i < b.txs.size(); ++i)
+  {
+    const transaction &tx = b.txs[i];
+    ds.bytes += b.tx_sizes[i];
+    ds.txs++;
+    if (m_opts.fees || m_opts.emission)
+      tx_fee_amount += get_tx_fee(tx);
+    if (m_opts.hours)
+      ds.tx_hours[hour]++;
+    if (m_opts.inputs)
+    {
+      update_min_max<uint32_t>(ds.min_ins, ds.max_ins, tx.vin.size());
+      ds.tot_ins += tx.vin.size();
+    }
+    if (m_opts.ringsize && !tx.vin.empty() && tx.vin[0].type() == typeid(txin_to_key))
+    {
+      const uint32_t ring_size = boost::get<txin_to_key>(tx.vin[0]).key_offsets.size();
+      update_min_max<uint32_t>(ds.min_rings, ds.max_rings, ring_size);
+      ds.tot_rings += ring_size;
+    }
+    if (m_opts.outputs)
+    {
+      update_min_max<uint32_t>(ds.min_outs, ds.max_outs, tx.vout.size());
+      ds.tot_outs += tx.vout.size();
+    }
+  }
+  if (m_opts.diff)
+  {
+    const difficulty_type diff = m_db.get_block_difficulty(b.height);
+    if (!ds.min_diff || diff < ds.min_diff)
+      ds.min_diff = diff;
+    if (diff > ds.max_diff)
+      ds.max_diff = diff;
+    ds.tot_diff += diff;
+  }
+  if (m_opts.emission)
+    ds.emission += get_outs_money_amount(b.block.miner_tx) - tx_fee_amount;
+  if (m_opts.fees)
+    ds.fees += tx_fee_amount;
+  return true;
+}
+//---------------------------------------------------------------------------------------------------
+void StatsVisitor::add_run(const day_run &run)
+{
+  // Same day boundaries as the serial tool always had: a new day starts when
+  // the day of the month moves forward, or wraps around at a month end, but
+  // not for a block stamped back at the end of the previous month. Blocks
+  // stamped back otherwise are counted in the current day.
+  bool new_day = m_days.empty();
+  if (!new_day)
+  {
+    const struct tm &prev = m_days.back().tm;
+    new_day = (run.tm.tm_mday > prev.tm_mday || (run.tm.tm_mday == 1 && prev.tm_mday > 27))
+      && !(prev.tm_mday == 1 && run.tm.tm_mday > 27);
+  }
+  if (new_day)
+    m_days.push_back(run);
+  else
+    m_days.back().stats.add(run.stats);
+}
+//---------------------------------------------------------------------------------------------------
+void StatsVisitor::merge(ScanVisitor &next)
+{
+  // whether a block opens a new day depends on the day opened before it, so
+  // ranges only group their blocks by date, and the days are decided here
+  StatsVisitor &other = static_cast<StatsVisitor&>(next);
+  for (const day_run &run: other.m_runs)
+    add_run(run);
+  other.m_runs.clear();
+}
+//---------------------------------------------------------------------------------------------------
+void StatsVisitor::print(std::ostream &o) const
+{
+  // spit out a comment that GnuPlot can use as an index
+  o << ENDL << "# DATA" << ENDL;
+  o << "Date\tBlocks/day\tBlocks\tTxs/Day\tTxs\tBytes/Day\tBytes";
+  if (m_opts.emission)
+    o << "\tEmission/day\tEmission";
+  if (m_opts.fees)
+    o << "\tFees/day\tFees";
+  if (m_opts.diff)
+    o << "\tDiffMin\tDiffMax\tDiffAvg";
+  if (m_opts.inputs)
+    o << "\tInMin\tInMax\tInAvg";
+  if (m_opts.outputs)
+    o << "\tOutMin\tOutMax\tOutAvg";
+  if (m_opts.ringsize)
+    o << "\tRingMin\tRingMax\tRingAvg";
+  if (m_opts.inputs || m_opts.outputs || m_opts.ringsize)
+    o << std::setprecision(2) << std::fixed;
+  if (m_opts.hours)
+  {
+    char buf[8];
+    for (unsigned int i = 0; i < 24; i++)
+    {
+      snprintf(buf, sizeof(buf), "\t%02u:00", i);
+      o << buf;
+    }
+  }
+  o << ENDL;
+
+  uint64_t total_txs = 0, total_bytes = 0;
+  boost::multiprecision::uint128_t total_emission = 0, total_fees = 0;
+  for (const day_run &day: m_days)
+  {
+    const day_stats &ds = day.stats;
+    const uint64_t txs = ds.txs ? ds.txs : 1;
+    total_txs += ds.txs;
+    total_bytes += ds.bytes;
+    char timebuf[64];
+    strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &day.tm);
+    o << timebuf << "\t" << ds.blocks << "\t" << ds.top_height << "\t" << ds.txs << "\t" << total_txs << "\t" << ds.bytes << "\t" << total_bytes;
+    if (m_opts.emission)
+    {
+      total_emission += ds.emission;
+      o << "\t" << print_money(ds.emission) << "\t" << print_money(total_emission);
+    }
+    if (m_opts.fees)
+    {
+      total_fees += ds.fees;
+      o << "\t" << print_money(ds.fees) << "\t" << print_money(total_fees);
+    }
+    if (m_opts.diff)
+      o << "\t" << ds.min_diff << "\t" << ds.max_diff << "\t" << ds.tot_diff / ds.blocks;
+    if (m_opts.inputs)
+      o << "\t" << (ds.max_ins ? ds.min_ins : 0) << "\t" << ds.max_ins << "\t" << ds.tot_ins * 1.0 / txs;
+    if (m_opts.outputs)
+      o << "\t" << (ds.max_outs ? ds.min_outs : 0) << "\t" << ds.max_outs << "\t" << ds.tot_outs * 1.0 / txs;
+    if (m_opts.ringsize)
+      o << "\t" << (ds.max_rings ? ds.min_rings : 0) << "\t" << ds.max_rings << "\t" << ds.tot_rings * 1.0 / txs;
+    if (m_opts.hours)
+      for (int i = 0; i < 24; i++)
+        o << "\t" << ds.tx_hours[i];
+    o << ENDL;
+  }
+}
+//---------------------------------------------------------------------------------------------------
+UsageVisitor::UsageVisitor(bool rct_only): m_rct_only(rct_only), m_created(0)
+{
+}
+//---------------------------------------------------------------------------------------------------
+std::unique_ptr<ScanVisitor> UsageVisitor::clone() const
+{
+  return std::unique_ptr<ScanVisitor>(new UsageVisitor(m_rct_only));
+}
+//---------------------------------------------------------------------------------------------------
+void UsageVisitor::add_outputs(const transaction &tx)
+{
+  for (const auto &out: tx.vout)
+    if (!m_rct_only || !out.amount)
+      ++m_created;
+}
+//---------------------------------------------------------------------------------------------------
+void UsageVisitor::add_inputs(const transaction &tx)
+{
+  for (const auto &in: tx.vin)
+  {
+    if (in.type() != typeid(txin_to_key))
+      continue;
+    const auto &txin = boost::get<txin_to_key>(in);
+    if (m_rct_only && txin.amount != 0)
+      continue;
+    auto &refs = m_refs[txin.amount];
+    const std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(txin.key_offsets);
+    for (uint64_t index: absolute)
+      ++refs[index];
+  }
+}
+//---------------------------------------------------------------------------------------------------
+bool UsageVisitor::visit(const ScannedBlock &b)
+{
+  if (!b.bad_txs.empty())
+  {
+    MERROR("Bad txn " << b.bad_txs.front() << " from db at height " << b.height);
+    return false;
+  }
+  add_outputs(b.block.miner_tx);
+  add_outputs(b.block.protocol_tx);
+  for (const auto &tx: b.txs)
+  {
+    add_outputs(tx);
+    add_inputs(tx);
+  }
+  return true;
+}
+//---------------------------------------------------------------------------------------------------
+void UsageVisitor::merge(ScanVisitor &next)
+{
+  UsageVisitor &other = static_cast<UsageVisitor&>(next);
+  m_created += other.m_created;
+  for (auto &amount: other.m_refs)
+  {
+    auto &refs = m_refs[amount.first];
+    if (refs.empty())
+    {
+      refs = std::move(amount.second);
+      continue;
+    }
+    for (const auto &index: amount.second)
+      refs[index.first] += index.second;
+  }
+}
+//---------------------------------------------------------------------------------------------------
+void UsageVisitor::print() const
+{
+  std::map<uint64_t, uint64_t> counts;
+  uint64_t referenced = 0;
+  for (const auto &amount: m_refs)
+  {
+    for (const auto &index: amount.second)
+      counts[index.second]++;
+    referenced += amount.second.size();
+  }
+  if (m_created > referenced)
+    counts[0] = m_created - referenced;
+
+  uint64_t total = 0;
+  for (const auto &c: counts)
+    total += c.second;
+  if (total == 0)
+  {
+    MINFO("No outputs to process");
+    return;
+  }
+  for (const auto &c: counts)
+  {
+    float percent = 100.f * c.second / total;
+    MINFO(std::to_string(c.second) << " outputs used " << c.first << " times (" << percent << "%)");
+  }
+}
+//---------------------------------------------------------------------------------------------------
+AssetAuditVisitor::AssetAuditVisitor(const std::string &delimiter): m_delimiter(delimiter)
+{
+}
+//---------------------------------------------------------------------------------------------------
+std::unique_ptr<ScanVisitor> AssetAuditVisitor::clone() const
+{
+  return std::unique_ptr<ScanVisitor>(new AssetAuditVisitor(m_delimiter));
+}
+//---------------------------------------------------------------------------------------------------
+bool AssetAuditVisitor::visit(const ScannedBlock &b)
+{
+  const std::string date = format_day(b.block.timestamp);
+  const std::string &d = m_delimiter;
+
+  // Check TX versions
+  if (b.block.miner_tx.version != 2)
+    m_out << date << d << b.height << d << get_transaction_hash(b.block.miner_tx) << d << "invalid miner TX version detected" << d << "version:" << b.block.miner_tx.version << std::endl;
+  if (b.block.protocol_tx.version != 2)
+    m_out << date << d << b.height << d << get_transaction_hash(b.block.protocol_tx) << d << "invalid protocol TX version detected" << d << "version:" << b.block.protocol_tx.version << std::endl;
+
+  // The miner and protocol txes only ever pay out SAL
+  for (const auto &out: b.block.miner_tx.vout)
+  {
+    std::string asset_type;
+    if (!cryptonote::get_output_asset_type(out, asset_type))
+      throw std::runtime_error("Aborting: failed to get output asset type from miner_tx at height " + std::to_string(b.height));
+    if (asset_type != "SAL")
+      throw std::runtime_error("Aborting: invalid output asset type from miner_tx at height " + std::to_string(b.height));
+  }
+  for (const auto &out: b.block.protocol_tx.vout)
+  {
+    std::string asset_type;
+    if (!cryptonote::get_output_asset_type(out, asset_type))
+      throw std::runtime_error("Aborting: failed to get output asset type from protocol_tx at height " + std::to_string(b.height));
+    if (asset_type != "SAL")
+      throw std::runtime_error("Aborting: invalid output asset type from protocol_tx at height " + std::to_string(b.height));
+  }
+
+  for (const auto &tx_id: b.bad_txs)
+    m_out << date << d << b.height << d << tx_id << d << "invalid TX detected" << d << std::endl;
+  for (size_t i = 0; i < b.txs.size(); ++i)
+    if (b.txs[i].version != 2)
+      m_out << date << d << b.height << d << b.tx_hashes[i] << d << "invalid TX version detected" << d << "version:" << b.txs[i].version << std::endl;
+  return true;
+}
+//---------------------------------------------------------------------------------------------------
+void AssetAuditVisitor::merge(ScanVisitor &next)
+{
+  AssetAuditVisitor &other = static_cast<AssetAuditVisitor&>(next);
+  m_out << other.m_out.str();
+}
+//---------------------------------------------------------------------------------------------------
+void AssetAuditVisitor::print(std::ostream &o) const
+{
+  // spit out a comment that GnuPlot can use as an index
+  o << ENDL << "# DATA" << ENDL;
+  o << "Date" << m_delimiter << "Height" << m_delimiter << "Transaction ID" << m_delimiter << "Reason" << m_delimiter << "Extra Information" << ENDL;
+  o << m_out.str();
+}
@@ -0,0 +1,139 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <ctime>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include "cryptonote_basic/difficulty.h"
+#include "blockchain_scan.h"
+
+// Per UTC day chain growth, as printed by blockchain_stats. Aborts on a tx
+// which fails to parse.
+class StatsVisitor: public ScanVisitor
+{
+public:
+  struct options
+  {
+    bool inputs = false;
+    bool outputs = false;
+    bool ringsize = false;
+    bool hours = false;
+    bool emission = false;
+    bool fees = false;
+    bool diff = false;
+  };
+
+  StatsVisitor(cryptonote::BlockchainDB &db, const options &opts);
+
+  std::unique_ptr<ScanVisitor> clone() const override;
+  bool visit(const ScannedBlock &b) override;
+  void merge(ScanVisitor &next) override;
+  bool needs_prunable_sizes() const override { return true; }
+
+  void print(std::ostream &o) const;
+
+private:
+  struct day_stats
+  {
+    uint64_t blocks = 0;
+    uint64_t top_height = 0;
+    uint64_t txs = 0;
+    uint64_t bytes = 0;
+    boost::multiprecision::uint128_t emission = 0;
+    boost::multiprecision::uint128_t fees = 0;
+    cryptonote::difficulty_type min_diff = 0, max_diff = 0, tot_diff = 0;
+    uint32_t min_ins = std::numeric_limits<uint32_t>::max(), max_ins = 0;
+    uint32_t min_outs = std::numeric_limits<uint32_t>::max(), max_outs = 0;
+    uint32_t min_rings = std::numeric_limits<uint32_t>::max(), max_rings = 0;
+    uint64_t tot_ins = 0, tot_outs = 0, tot_rings = 0;
+    uint32_t tx_hours[24] = {0};
+
+    void add(const day_stats &other);
+  };
+
+  // consecutive blocks stamped with the same date, tm being the first one's time
+  struct day_run
+  {
+    struct tm tm;
+    day_stats stats;
+  };
+
+  void add_run(const day_run &run);
+
+  cryptonote::BlockchainDB &m_db;
+  options m_opts;
+  std::vector<day_run> m_runs; // visited, not yet merged
+  std::vector<day_run> m_days;
+};
+
+// How many times each output is referenced by rings, as printed by
+// blockchain_usage. Aborts on a tx which fails to parse.
+class UsageVisitor: public ScanVisitor
+{
+public:
+  UsageVisitor(bool rct_only);
+
+  std::unique_ptr<ScanVisitor> clone() const override;
+  bool visit(const ScannedBlock &b) override;
+  void merge(ScanVisitor &next) override;
+
+  void print() const;
+
+private:
+  void add_outputs(const cryptonote::transaction &tx);
+  void add_inputs(const cryptonote::transaction &tx);
+
+  bool m_rct_only;
+  uint64_t m_created;
+  std::unordered_map<uint64_t, std::unordered_map<uint64_t, uint64_t>> m_refs; // amount -> index -> refs
+};
+
+// Consistency checks on tx versions and asset types, as printed by blockchain_scanner
+class AssetAuditVisitor: public ScanVisitor
+{
+public:
+  AssetAuditVisitor(const std::string &delimiter);
+
+  std::unique_ptr<ScanVisitor> clone() const override;
+  bool visit(const ScannedBlock &b) override;
+  void merge(ScanVisitor &next) override;
+
+  void print(std::ostream &o) const;
+
+private:
+  std::string m_delimiter;
+  std::ostringstream m_out;
+};
@@ -35,6 +35,7 @@
 #include "blockchain_db/blockchain_db.h"
 #include "time_helper.h"
 #include "version.h"
+#include "blockchain_scan_visitors.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
@@ -43,78 +44,7 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
-static bool stop_requested = false;
-
-static bool do_inputs, do_outputs, do_ringsize, do_hours, do_emission, do_fees, do_diff;
-
-static struct tm prevtm, currtm;
-static uint64_t prevsz, currsz;
-static uint64_t prevtxs, currtxs;
-static uint64_t currblks;
-static uint64_t h;
-static uint64_t totins, totouts, totrings;
-static boost::multiprecision::uint128_t prevemission, prevfees;
-static boost::multiprecision::uint128_t emission, fees;
-static boost::multiprecision::uint128_t totdiff, mindiff, maxdiff;
-
-#define MAX_INOUT	0xffffffff
-#define MAX_RINGS	0xffffffff
-
-static uint32_t minins = MAX_INOUT, maxins;
-static uint32_t minouts = MAX_INOUT, maxouts;
-static uint32_t minrings = MAX_RINGS, maxrings;
-static uint32_t io, tottxs;
-static uint32_t txhr[24];
-
-static void doprint()
-{
-  char timebuf[64];
-
-  strftime(timebuf, sizeof(timebuf), "%Y-%m-%d", &prevtm);
-  prevtm = currtm;
-  std::cout << timebuf << "\t" << currblks << "\t" << h << "\t" << currtxs << "\t" << prevtxs + currtxs << "\t" << currsz << "\t" << prevsz + currsz;
-  prevsz += currsz;
-  currsz = 0;
-  prevtxs += currtxs;
-  currtxs = 0;
-  if (!tottxs)
-    tottxs = 1;
-  if (do_emission) {
-    std::cout << "\t" << print_money(emission) << "\t" << print_money(prevemission + emission);
-    prevemission += emission;
-    emission = 0;
-  }
-  if (do_fees) {
-    std::cout << "\t" << print_money(fees) << "\t" << print_money(prevfees + fees);
-    prevfees += fees;
-    fees = 0;
-  }
-  if (do_diff) {
-    std::cout << "\t" << (maxdiff ? mindiff : 0) << "\t" << maxdiff << "\t" << totdiff / currblks;
-    mindiff = 0; maxdiff = 0; totdiff = 0;
-  }
-  if (do_inputs) {
-    std::cout << "\t" << (maxins ? minins : 0) << "\t" << maxins << "\t" << totins * 1.0 / tottxs;
-    minins = MAX_INOUT; maxins = 0; totins = 0;
-  }
-  if (do_outputs) {
-    std::cout << "\t" << (maxouts ? minouts : 0) << "\t" << maxouts << "\t" << totouts * 1.0 / tottxs;
-    minouts = MAX_INOUT; maxouts = 0; totouts = 0;
-  }
-  if (do_ringsize) {
-    std::cout << "\t" << (maxrings ? minrings : 0) << "\t" << maxrings << "\t" << totrings * 1.0 / tottxs;
-    minrings = MAX_RINGS; maxrings = 0; totrings = 0;
-  }
-  if (do_hours) {
-    for (int i=0; i<24; i++) {
-      std::cout << "\t" << txhr[i];
-      txhr[i] = 0;
-    }
-  }
-  currblks = 0;
-  tottxs = 0;
-  std::cout << ENDL;
-}
+static std::atomic<bool> stop_requested(false);
 
 int main(int argc, char* argv[])
 {
@@ -193,13 +123,14 @@ int main(int argc, char* argv[])
   network_type net_type = opt_testnet ? TESTNET : opt_stagenet ? STAGENET : MAINNET;
   block_start = command_line::get_arg(vm, arg_block_start);
   block_stop = command_line::get_arg(vm, arg_block_stop);
-  do_inputs = command_line::get_arg(vm, arg_inputs);
-  do_outputs = command_line::get_arg(vm, arg_outputs);
-  do_ringsize = command_line::get_arg(vm, arg_ringsize);
-  do_hours = command_line::get_arg(vm, arg_hours);
-  do_emission = command_line::get_arg(vm, arg_emission);
-  do_fees = command_line::get_arg(vm, arg_fees);
-  do_diff = command_line::get_arg(vm, arg_diff);
+  StatsVisitor::options opts;
+  opts.inputs = command_line::get_arg(vm, arg_inputs);
+  opts.outputs = command_line::get_arg(vm, arg_outputs);
+  opts.ringsize = command_line::get_arg(vm, arg_ringsize);
+  opts.hours = command_line::get_arg(vm, arg_hours);
+  opts.emission = command_line::get_arg(vm, arg_emission);
+  opts.fees = command_line::get_arg(vm, arg_fees);
+  opts.diff = command_line::get_arg(vm, arg_diff);
 
   LOG_PRINT_L0("Initializing source blockchain (BlockchainDB)");
   std::unique_ptr<BlockchainAndPool> core_storage = std::make_unique<BlockchainAndPool>();
@@ -233,7 +164,8 @@ int main(int argc, char* argv[])
   });
 
   const uint64_t db_height = db->height();
-  if (!block_stop)
+  // a stop past the top would read blocks the database does not have
+  if (!block_stop || block_stop > db_height)
       block_stop = db_height;
   MINFO("Starting from height " << block_start << ", stopping at height " << block_stop);
 
@@ -253,131 +185,12 @@ set y2tics nomirror
 plot 'stats.csv' index "DATA" using (timecolumn(1,"%Y-%m-%d")):4 with lines, '' using (timecolumn(1,"%Y-%m-%d")):7 axes x1y2 with lines
  */
 
-  // spit out a comment that GnuPlot can use as an index
-  std::cout << ENDL << "# DATA" << ENDL;
-  std::cout << "Date\tBlocks/day\tBlocks\tTxs/Day\tTxs\tBytes/Day\tBytes";
-  if (do_emission)
-    std::cout << "\tEmission/day\tEmission";
-  if (do_fees)
-    std::cout << "\tFees/day\tFees";
-  if (do_diff)
-    std::cout << "\tDiffMin\tDiffMax\tDiffAvg";
-  if (do_inputs)
-    std::cout << "\tInMin\tInMax\tInAvg";
-  if (do_outputs)
-    std::cout << "\tOutMin\tOutMax\tOutAvg";
-  if (do_ringsize)
-    std::cout << "\tRingMin\tRingMax\tRingAvg";
-  if (do_inputs || do_outputs || do_ringsize)
-    std::cout << std::setprecision(2) << std::fixed;
-  if (do_hours) {
-    char buf[8];
-    unsigned int i;
-    for (i=0; i<24; i++) {
-      sprintf(buf, "\t%02u:00", i);
-      std::cout << buf;
-    }
-  }
-  std::cout << ENDL;
-
-  for (h = block_start; h < block_stop; ++h)
-  {
-    cryptonote::blobdata bd = db->get_block_blob_from_height(h);
-    cryptonote::block blk;
-    if (!cryptonote::parse_and_validate_block_from_blob(bd, blk))
-    {
-      LOG_PRINT_L0("Bad block from db");
-      return 1;
-    }
-    time_t tt = blk.timestamp;
-    epee::misc_utils::get_gmt_time(tt, currtm);
-    if (!prevtm.tm_year)
-      prevtm = currtm;
-    // catch change of day
-    if (currtm.tm_mday > prevtm.tm_mday || (currtm.tm_mday == 1 && prevtm.tm_mday > 27))
-    {
-      // check for timestamp fudging around month ends
-      if (!(prevtm.tm_mday == 1 && currtm.tm_mday > 27))
-        doprint();
-    }
-    currsz += bd.size();
-    uint64_t coinbase_amount;
-    uint64_t tx_fee_amount = 0;
-    for (const auto& tx_id : blk.tx_hashes)
-    {
-      if (tx_id == crypto::null_hash)
-      {
-        throw std::runtime_error("Aborting: tx == null_hash");
-      }
-      if (!db->get_pruned_tx_blob(tx_id, bd))
-      {
-        throw std::runtime_error("Aborting: tx not found");
-      }
-      transaction tx;
-      if (!parse_and_validate_tx_base_from_blob(bd, tx))
-      {
-        LOG_PRINT_L0("Bad txn from db");
-        return 1;
-      }
-      currsz += bd.size();
-      if (db->get_prunable_tx_blob(tx_id, bd))
-        currsz += bd.size();
-      currtxs++;
-      if (do_fees || do_emission) {
-        tx_fee_amount += get_tx_fee(tx);
-      }
-      if (do_hours)
-        txhr[currtm.tm_hour]++;
-      if (do_inputs) {
-        io = tx.vin.size();
-        if (io < minins)
-          minins = io;
-        else if (io > maxins)
-          maxins = io;
-        totins += io;
-      }
-      if (do_ringsize) {
-        const cryptonote::txin_to_key& tx_in_to_key
-                       = boost::get<cryptonote::txin_to_key>(tx.vin[0]);
-        io = tx_in_to_key.key_offsets.size();
-        if (io < minrings)
-          minrings = io;
-        else if (io > maxrings)
-          maxrings = io;
-        totrings += io;
-      }
-      if (do_outputs) {
-        io = tx.vout.size();
-        if (io < minouts)
-          minouts = io;
-        else if (io > maxouts)
-          maxouts = io;
-        totouts += io;
-      }
-      tottxs++;
-    }
-    if (do_diff) {
-      difficulty_type diff = db->get_block_difficulty(h);
-      if (!mindiff || diff < mindiff)
-        mindiff = diff;
-      if (diff > maxdiff)
-        maxdiff = diff;
-      totdiff += diff;
-    }
-    if (do_emission) {
-      coinbase_amount = get_outs_money_amount(blk.miner_tx);
-      emission += coinbase_amount - tx_fee_amount;
-    }
-    if (do_fees) {
-      fees += tx_fee_amount;
-    }
-    currblks++;
-
-    if (stop_requested)
-      break;
-  }
-  if (currblks)
-    doprint();
+  StatsVisitor stats(*db, opts);
+  BlockchainScanner scanner(*db);
+  scanner.add_visitor(stats);
+  if (!scanner.scan(block_start, block_stop, &stop_requested))
+    return 1;
+  stats.print(std::cout);
 
   core_storage->blockchain.deinit();
   return 0;
@@ -36,6 +36,7 @@
 #include "cryptonote_core/blockchain.h"
 #include "blockchain_db/blockchain_db.h"
 #include "version.h"
+#include "blockchain_scan_visitors.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
@@ -44,37 +45,7 @@ namespace po = boost::program_options;
 using namespace epee;
 using namespace cryptonote;
 
-struct output_data
-{
-  uint64_t amount;
-  uint64_t index;
-  mutable bool coinbase;
-  mutable uint64_t height;
-  output_data(uint64_t a, uint64_t i, bool cb, uint64_t h): amount(a), index(i), coinbase(cb), height(h) {}
-  bool operator==(const output_data &other) const { return other.amount == amount && other.index == index; }
-  void info(bool c, uint64_t h) const { coinbase = c; height =h; }
-};
-namespace std
-{
-  template<> struct hash<output_data>
-  {
-    size_t operator()(const output_data &od) const
-    {
-      const uint64_t data[2] = {od.amount, od.index};
-      crypto::hash h;
-      crypto::cn_fast_hash(data, 2 * sizeof(uint64_t), h);
-      return reinterpret_cast<const std::size_t &>(h);
-    }
-  };
-}
-
-struct reference
-{
-  uint64_t height;
-  uint64_t ring_size;
-  uint64_t position;
-  reference(uint64_t h, uint64_t rs, uint64_t p): height(h), ring_size(rs), position(p) {}
-};
+static std::atomic<bool> stop_requested(false);
 
 int main(int argc, char* argv[])
 {
@@ -180,63 +151,17 @@ int main(int argc, char* argv[])
 
   LOG_PRINT_L0("Building usage patterns...");
 
-  std::unordered_map<output_data, std::list<reference>> outputs;
-  std::unordered_map<uint64_t,uint64_t> indices;
+  tools::signal_handler::install([](int type) {
+    stop_requested = true;
+  });
 
   LOG_PRINT_L0("Reading blockchain from " << input);
-  core_storage->blockchain.for_all_transactions([&](const crypto::hash &hash, const cryptonote::transaction &tx)->bool
-  {
-    const bool coinbase = tx.vin.size() == 1 && tx.vin[0].type() == typeid(txin_gen);
-    const uint64_t height = core_storage->blockchain.get_db().get_tx_block_height(hash);
-
-    // create new outputs
-    for (const auto &out: tx.vout)
-    {
-      if (opt_rct_only && out.amount)
-        continue;
-      indices[out.amount]++;
-      output_data od(out.amount, indices[out.amount], coinbase, height);
-      auto itb = outputs.emplace(od, std::list<reference>());
-      itb.first->first.info(coinbase, height);
-    }
-
-    for (const auto &in: tx.vin)
-    {
-      if (in.type() != typeid(txin_to_key))
-        continue;
-      const auto &txin = boost::get<txin_to_key>(in);
-      if (opt_rct_only && txin.amount != 0)
-        continue;
-
-      const std::vector<uint64_t> absolute = cryptonote::relative_output_offsets_to_absolute(txin.key_offsets);
-      for (size_t n = 0; n < txin.key_offsets.size(); ++n)
-      {
-        output_data od(txin.amount, absolute[n], coinbase, height);
-        outputs[od].push_back(reference(height, txin.key_offsets.size(), n));
-      }
-    }
-    return true;
-  }, true);
-
-  std::unordered_map<uint64_t, uint64_t> counts;
-  size_t total = 0;
-  for (const auto &out: outputs)
-  {
-    counts[out.second.size()]++;
-    total++;
-  }
-  if (total > 0)
-  {
-    for (const auto &c: counts)
-    {
-      float percent = 100.f * c.second / total;
-      MINFO(std::to_string(c.second) << " outputs used " << c.first << " times (" << percent << "%)");
-    }
-  }
-  else
-  {
-    MINFO("No outputs to process");
-  }
+  UsageVisitor usage(opt_rct_only);
+  BlockchainScanner scanner(*db);
+  scanner.add_visitor(usage);
+  if (!scanner.scan(0, db->height(), &stop_requested))
+    return 1;
+  usage.print();
 
   LOG_PRINT_L0("Blockchain usage exported OK");
   return 0;
@@ -31,6 +31,8 @@
 #include "serialization/json_utils.h" // dump_json()
 
 #include "bootstrap_file.h"
+#include "common/threadpool.h"
+#include "crypto/hash.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "bcutil"
@@ -47,7 +49,162 @@ namespace
   const uint32_t blockchain_raw_magic = 0x28721586;
   const uint32_t header_size = 1024;
 
+  // leading 4 bytes of: echo Monero bootstrap index | sha1sum
+  const uint32_t bootstrap_index_magic = 0xa60eeb98;
+  const uint8_t bootstrap_index_version = 1;
+  // magic, version, 3 bytes padding, block_first
+  const size_t index_header_size = 16;
+  // offset, size, checksum
+  const size_t index_entry_size = 20;
+
+  // blocks each thread packages per round when exporting
+  const uint64_t export_blocks_per_thread = 256;
+
   std::string refresh_string = "\r                                    \r";
+
+  void write_le(char *dst, uint64_t value, size_t bytes)
+  {
+    for (size_t i = 0; i < bytes; ++i)
+      dst[i] = (char)((value >> (8 * i)) & 0xff);
+  }
+
+  uint64_t read_le(const char *src, size_t bytes)
+  {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+      value |= ((uint64_t)(uint8_t)src[i]) << (8 * i);
+    return value;
+  }
+}
+
+
+std::string BootstrapIndex::get_path(const std::string& bootstrap_path)
+{
+  return bootstrap_path + ".index";
+}
+
+uint64_t BootstrapIndex::get_checksum(const char* data, size_t size)
+{
+  crypto::hash hash;
+  crypto::cn_fast_hash(data, size, hash);
+  return read_le(hash.data, 8);
+}
+
+bool BootstrapIndex::open(const std::string& bootstrap_path, bool writable)
+{
+  close();
+
+  const std::string path = get_path(bootstrap_path);
+  boost::system::error_code ec;
+  if (!boost::filesystem::exists(path, ec))
+    return false;
+  const uint64_t index_size = boost::filesystem::file_size(path, ec);
+  if (ec || index_size < index_header_size || (index_size - index_header_size) % index_entry_size)
+  {
+    MWARNING("Ignoring malformed bootstrap index " << path);
+    return false;
+  }
+
+  m_file.open(path, std::ios_base::binary | std::ios_base::in | (writable ? std::ios_base::out : std::ios_base::in));
+  if (m_file.fail())
+    return false;
+  m_writable = writable;
+  char header[index_header_size];
+  m_file.read(header, sizeof(header));
+  if (!m_file || read_le(header, 4) != bootstrap_index_magic || (uint8_t)header[4] != bootstrap_index_version)
+  {
+    MWARNING("Ignoring unrecognized bootstrap index " << path);
+    close();
+    return false;
+  }
+  m_block_first = read_le(header + 8, 8);
+  m_size = (index_size - index_header_size) / index_entry_size;
+
+  // an index not covering the whole file is stale, eg the export was interrupted
+  // between writing a chunk and its record, or the file was appended to without it
+  uint64_t expected_file_size = sizeof(blockchain_raw_magic) + header_size;
+  if (m_size)
+  {
+    entry last;
+    if (!get(m_block_first + m_size - 1, last))
+    {
+      close();
+      return false;
+    }
+    expected_file_size = last.offset + sizeof(uint32_t) + last.size;
+  }
+  const uint64_t file_size = boost::filesystem::file_size(bootstrap_path, ec);
+  if (ec || file_size != expected_file_size)
+  {
+    MWARNING("Ignoring stale bootstrap index " << path);
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool BootstrapIndex::create(const std::string& bootstrap_path, uint64_t block_first)
+{
+  close();
+
+  m_file.open(get_path(bootstrap_path), std::ios_base::binary | std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
+  if (m_file.fail())
+    return false;
+  char header[index_header_size] = {0};
+  write_le(header, bootstrap_index_magic, 4);
+  header[4] = bootstrap_index_version;
+  write_le(header + 8, block_first, 8);
+  m_file.write(header, sizeof(header));
+  m_file.flush();
+  m_block_first = block_first;
+  m_size = 0;
+  m_writable = true;
+  return !m_file.fail();
+}
+
+bool BootstrapIndex::get(uint64_t height, entry& e)
+{
+  if (!m_file.is_open() || height < m_block_first || height - m_block_first >= m_size)
+    return false;
+  char record[index_entry_size];
+  m_file.seekg(index_header_size + (height - m_block_first) * index_entry_size);
+  m_file.read(record, sizeof(record));
+  if (!m_file)
+  {
+    m_file.clear();
+    return false;
+  }
+  e.offset = read_le(record, 8);
+  e.size = read_le(record + 8, 4);
+  e.checksum = read_le(record + 12, 8);
+  return true;
+}
+
+bool BootstrapIndex::add(const entry& e)
+{
+  if (!m_file.is_open() || !m_writable)
+    return false;
+  char record[index_entry_size];
+  write_le(record, e.offset, 8);
+  write_le(record + 8, e.size, 4);
+  write_le(record + 12, e.checksum, 8);
+  m_file.seekp(index_header_size + m_size * index_entry_size);
+  m_file.write(record, sizeof(record));
+  m_file.flush();
+  if (m_file.fail())
+    return false;
+  ++m_size;
+  return true;
+}
+
+void BootstrapIndex::close()
+{
+  if (m_file.is_open())
+    m_file.close();
+  m_file.clear();
+  m_block_first = 0;
+  m_size = 0;
+  m_writable = false;
 }
 
 
@@ -88,9 +245,14 @@ bool BootstrapFile::open_writer(const boost::filesystem::path& file_path, uint64
   }
   else
   {
-    std::streampos dummy_pos;
-    uint64_t dummy_height = 0;
-    num_blocks = count_blocks(file_path.string(), dummy_pos, dummy_height, block_first);
+    if (m_index.open(file_path.string(), true))
+      num_blocks = m_index.size();
+    else
+    {
+      MINFO("Indexing existing bootstrap file " << file_path);
+      num_blocks = build_index(file_path.string());
+    }
+    block_first = m_index.block_first();
     MDEBUG("appending to existing file with height: " << num_blocks+block_first-1 << "  total blocks: " << num_blocks);
   }
   m_height = num_blocks+block_first;
@@ -108,7 +270,14 @@ bool BootstrapFile::open_writer(const boost::filesystem::path& file_path, uint64
     return false;
 
   if (do_initialize_file)
+  {
     initialize_file(start_block, stop_block);
+    if (!m_index.create(file_path.string(), start_block))
+    {
+      MFATAL("Failed to create bootstrap index for " << file_path);
+      return false;
+    }
+  }
 
   return true;
 }
@@ -185,6 +354,7 @@ void BootstrapFile::flush_chunk()
   {
     throw std::runtime_error("Error in serialization of chunk size");
   }
+  const uint64_t chunk_offset = m_raw_data_file->tellp();
   *m_raw_data_file << blob;
 
   if (m_max_chunk < chunk_size)
@@ -201,6 +371,10 @@ void BootstrapFile::flush_chunk()
     MFATAL("Error writing chunk:  height: " << m_cur_height << "  chunk_size: " << chunk_size << "  num chars written: " << num_chars_written);
     throw std::runtime_error("Error writing chunk");
   }
+  if (!m_index.add({chunk_offset, chunk_size, BootstrapIndex::get_checksum(m_buffer.data(), m_buffer.size())}))
+  {
+    throw std::runtime_error("Error writing bootstrap index");
+  }
 
   m_buffer.clear();
   delete m_output_stream;
@@ -208,7 +382,7 @@ void BootstrapFile::flush_chunk()
   MDEBUG("flushed chunk:  chunk_size: " << chunk_size);
 }
 
-void BootstrapFile::write_block(block& block)
+blobdata BootstrapFile::package_block(const block& block) const
 {
   bootstrap::block_package bp;
   bp.block = block;
@@ -246,8 +420,7 @@ void BootstrapFile::write_block(block& block)
     bp.coins_generated = coins_generated;
   }
 
-  blobdata bd = t_serializable_object_to_blob(bp);
-  m_output_stream->write((const char*)bd.data(), bd.size());
+  return t_serializable_object_to_blob(bp);
 }
 
 bool BootstrapFile::close()
@@ -256,6 +429,7 @@ bool BootstrapFile::close()
     return false;
 
   m_raw_data_file->flush();
+  m_index.close();
   delete m_output_stream;
   delete m_raw_data_file;
   return true;
@@ -270,7 +444,6 @@ bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
   m_tx_pool = _tx_pool;
   uint64_t progress_interval = 100;
   MINFO("Storing blocks raw data...");
-  block b;
 
   // block_start, block_stop use 0-based height. m_height uses 1-based height. So to resume export
   // from last exported block, block_start doesn't need to add 1 here, as it's already at the next
@@ -294,19 +467,50 @@ bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
   }
   uint64_t block_start = m_height ? m_height : start_block;
   MINFO("Starting block height: " << block_start);
-  for (m_cur_height = block_start; m_cur_height <= block_stop; ++m_cur_height)
-  {
-    // this method's height refers to 0-based height (genesis block = height 0)
-    crypto::hash hash = m_blockchain_storage->get_block_id_by_height(m_cur_height);
-    m_blockchain_storage->get_block_by_hash(hash, b);
-    write_block(b);
-    if (m_cur_height % NUM_BLOCKS_PER_CHUNK == 0) {
-      flush_chunk();
-      num_blocks_written += NUM_BLOCKS_PER_CHUNK;
+
+  // blocks are read and packaged in parallel, a round of consecutive height
+  // ranges at a time, then written out in order
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  const uint64_t threads = std::max<uint64_t>(tpool.get_max_concurrency(), 1);
+  std::vector<blobdata> packages;
+  m_cur_height = block_start;
+  while (m_cur_height <= block_stop)
+  {
+    const uint64_t round_start = m_cur_height;
+    const uint64_t round_size = std::min<uint64_t>(block_stop - round_start + 1, threads * export_blocks_per_thread);
+    packages.clear();
+    packages.resize(round_size);
+
+    tools::threadpool::waiter waiter(tpool);
+    for (uint64_t range_start = 0; range_start < round_size; range_start += export_blocks_per_thread)
+    {
+      const uint64_t range_end = std::min<uint64_t>(range_start + export_blocks_per_thread, round_size) - 1;
+      tpool.submit(&waiter, [&, range_start, range_end](){
+        m_blockchain_storage->get_db().for_blocks_range(round_start + range_start, round_start + range_end,
+            [&](uint64_t height, const crypto::hash&, const block& bl){
+          packages[height - round_start] = package_block(bl);
+          return true;
+        });
+      }, true);
     }
-    if (m_cur_height % progress_interval == 0) {
-      std::cout << refresh_string;
-      std::cout << "block " << m_cur_height << "/" << block_stop << "\r" << std::flush;
+    if (!waiter.wait())
+      throw std::runtime_error("Error reading blocks from the database");
+
+    for (const blobdata& bd: packages)
+    {
+      // this method's height refers to 0-based height (genesis block = height 0)
+      if (bd.empty())
+        throw std::runtime_error("Block missing from the database at height " + std::to_string(m_cur_height));
+      m_output_stream->write((const char*)bd.data(), bd.size());
+      if (m_cur_height % NUM_BLOCKS_PER_CHUNK == 0) {
+        flush_chunk();
+        num_blocks_written += NUM_BLOCKS_PER_CHUNK;
+      }
+      if (m_cur_height % progress_interval == 0) {
+        std::cout << refresh_string;
+        std::cout << "block " << m_cur_height << "/" << block_stop << "\r" << std::flush;
+      }
+      ++m_cur_height;
     }
   }
   // NOTE: use of NUM_BLOCKS_PER_CHUNK is a placeholder in case multi-block chunks are later supported.
@@ -459,6 +663,51 @@ uint64_t BootstrapFile::count_bytes(std::ifstream& import_file, uint64_t blocks,
   return bytes_read;
 }
 
+uint64_t BootstrapFile::build_index(const std::string& import_file_path)
+{
+  std::ifstream import_file;
+  import_file.open(import_file_path, std::ios_base::binary | std::ifstream::in);
+  if (import_file.fail())
+  {
+    MFATAL("import_file.open() fail");
+    throw std::runtime_error("Aborting");
+  }
+
+  uint8_t major_version, minor_version;
+  uint64_t block_first, block_last;
+  uint64_t offset = seek_to_first_chunk(import_file, major_version, minor_version, block_first, block_last);
+  if (!m_index.create(import_file_path, block_first))
+    throw std::runtime_error("Failed to create bootstrap index");
+
+  std::vector<char> chunk;
+  while (true)
+  {
+    uint32_t chunk_size;
+    char buf1[sizeof(chunk_size)];
+    import_file.read(buf1, sizeof(chunk_size));
+    if (!import_file)
+      break;
+    if (! ::serialization::parse_binary(std::string(buf1, sizeof(chunk_size)), chunk_size))
+      throw std::runtime_error("Error in deserialization of chunk_size");
+    if (chunk_size > BUFFER_SIZE || chunk_size == 0)
+      throw std::runtime_error("Aborting: invalid chunk size " + std::to_string(chunk_size) + " at offset " + std::to_string(offset));
+    chunk.resize(chunk_size);
+    import_file.read(chunk.data(), chunk_size);
+    if (!import_file)
+    {
+      MWARNING("Bootstrap file truncated at offset " << offset);
+      break;
+    }
+    if (!m_index.add({offset, chunk_size, BootstrapIndex::get_checksum(chunk.data(), chunk_size)}))
+      throw std::runtime_error("Error writing bootstrap index");
+    offset += sizeof(chunk_size) + chunk_size;
+    if (m_index.size() % 1000 == 0)
+      std::cout << "\r" << "block height: " << block_first + m_index.size() - 1 << "    \r" << std::flush;
+  }
+  std::cout << ENDL;
+  return m_index.size();
+}
+
 uint64_t BootstrapFile::count_blocks(const std::string& import_file_path)
 {
   std::streampos dummy_pos;
@@ -479,6 +728,30 @@ uint64_t BootstrapFile::count_blocks(const std::string& import_file_path, std::s
     MFATAL("bootstrap file not found: " << raw_file_path);
     throw std::runtime_error("Aborting");
   }
+
+  // with an up to date index, the block count and start position are read off it
+  BootstrapIndex index;
+  if (index.open(import_file_path))
+  {
+    block_first = index.block_first();
+    const uint64_t blocks = index.size();
+    if (seek_height)
+    {
+      BootstrapIndex::entry e;
+      seek_height = std::max(seek_height, block_first);
+      if (index.get(seek_height, e))
+        start_pos = e.offset;
+      else
+      {
+        // past the last block: position at end of file
+        seek_height = block_first + blocks;
+        start_pos = boost::filesystem::file_size(raw_file_path, ec);
+      }
+    }
+    MINFO("Bootstrap file index: first block " << block_first << ", " << blocks << " blocks");
+    return blocks;
+  }
+
   std::ifstream import_file;
   import_file.open(import_file_path, std::ios_base::binary | std::ifstream::in);
 
@@ -52,6 +52,44 @@
 using namespace cryptonote;
 
 
+// Index kept next to a bootstrap file, as <bootstrap file>.index: a short
+// header, then one fixed size record per chunk giving its file offset, size
+// and checksum, so the chunk for any height is found without scanning.
+class BootstrapIndex
+{
+public:
+
+  struct entry
+  {
+    uint64_t offset; // file offset of the chunk's size prefix
+    uint32_t size; // chunk size, not counting the size prefix
+    uint64_t checksum; // leading 8 bytes of the chunk's Keccak hash
+  };
+
+  BootstrapIndex(): m_block_first(0), m_size(0), m_writable(false) {}
+
+  static std::string get_path(const std::string& bootstrap_path);
+  static uint64_t get_checksum(const char* data, size_t size);
+
+  // opens an existing index, failing if it is missing, corrupt or does not cover the whole bootstrap file.
+  // The index is only opened for writing, so it can be appended to, when writable is set
+  bool open(const std::string& bootstrap_path, bool writable = false);
+  // creates a new, empty index
+  bool create(const std::string& bootstrap_path, uint64_t block_first);
+  bool get(uint64_t height, entry& e);
+  bool add(const entry& e);
+  void close();
+
+  uint64_t block_first() const { return m_block_first; }
+  uint64_t size() const { return m_size; }
+
+private:
+  std::fstream m_file;
+  uint64_t m_block_first;
+  uint64_t m_size;
+  bool m_writable;
+};
+
 class BootstrapFile
 {
 public:
@@ -60,6 +98,7 @@ public:
   uint64_t count_blocks(const std::string& dir_path, std::streampos& start_pos, uint64_t& seek_height, uint64_t& block_first);
   uint64_t count_blocks(const std::string& dir_path);
   uint64_t seek_to_first_chunk(std::ifstream& import_file, uint8_t &major_version, uint8_t &minor_version, uint64_t &block_first, uint64_t &block_last);
+  uint64_t build_index(const std::string& import_file_path);
 
   bool store_blockchain_raw(cryptonote::Blockchain* cs, cryptonote::tx_memory_pool* txp,
       boost::filesystem::path& output_file, uint64_t start_block=0, uint64_t stop_block=0);
@@ -71,6 +110,7 @@ protected:
   tx_memory_pool* m_tx_pool;
   typedef std::vector<char> buffer_type;
   std::ofstream * m_raw_data_file;
+  BootstrapIndex m_index;
   buffer_type m_buffer;
   boost::iostreams::stream<boost::iostreams::back_insert_device<buffer_type>>* m_output_stream;
 
@@ -78,7 +118,7 @@ protected:
   bool open_writer(const boost::filesystem::path& file_path, uint64_t start_block, uint64_t stop_block);
   bool initialize_file(uint64_t start_block, uint64_t stop_block);
   bool close();
-  void write_block(block& block);
+  blobdata package_block(const block& block) const;
   void flush_chunk();
 
 private:
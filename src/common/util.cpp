@@ -652,6 +652,11 @@ namespace tools
       MWARNING("Failed to determine whether address '" << address << "' is local, assuming not");
       return false;
     }
+    if (u_c.schema == "unix")
+    {
+      MDEBUG("Address '" << address << "' is a local socket");
+      return true;
+    }
     if (u_c.host.empty())
     {
       MWARNING("Failed to determine whether address '" << address << "' is local, assuming not");
@@ -38,7 +38,6 @@ DISABLE_VS_WARNINGS(4146 4244)
 
 /* Predeclarations */
 
-static void fe_mul(fe, const fe, const fe);
 static void fe_sq(fe, const fe);
 static void ge_madd(ge_p1p1 *, const ge_p3 *, const ge_precomp *);
 static void ge_msub(ge_p1p1 *, const ge_p3 *, const ge_precomp *);
@@ -72,7 +71,7 @@ uint64_t load_4(const unsigned char *in)
 h = 0
 */
 
-static void fe_0(fe h) {
+void fe_0(fe h) {
   h[0] = 0;
   h[1] = 0;
   h[2] = 0;
@@ -375,7 +374,7 @@ Can get away with 11 carries, but then data flow is much deeper.
 With tighter constraints on inputs can squeeze carries into int32.
 */
 
-static void fe_mul(fe h, const fe f, const fe g) {
+void fe_mul(fe h, const fe f, const fe g) {
   int32_t f0 = f[0];
   int32_t f1 = f[1];
   int32_t f2 = f[2];
@@ -1607,20 +1606,20 @@ static void ge_precomp_cmov(ge_precomp *t, const ge_precomp *u, unsigned char b)
   fe_cmov(t->xy2d, u->xy2d, b);
 }
 
-static void select(ge_precomp *t, int pos, signed char b) {
+static void select(ge_precomp *t, const ge_fixed_base_table table, int pos, signed char b) {
   ge_precomp minust;
   unsigned char bnegative = negative(b);
   unsigned char babs = b - (((-bnegative) & b) << 1);
 
   ge_precomp_0(t);
-  ge_precomp_cmov(t, &ge_base[pos][0], equal(babs, 1));
-  ge_precomp_cmov(t, &ge_base[pos][1], equal(babs, 2));
-  ge_precomp_cmov(t, &ge_base[pos][2], equal(babs, 3));
-  ge_precomp_cmov(t, &ge_base[pos][3], equal(babs, 4));
-  ge_precomp_cmov(t, &ge_base[pos][4], equal(babs, 5));
-  ge_precomp_cmov(t, &ge_base[pos][5], equal(babs, 6));
-  ge_precomp_cmov(t, &ge_base[pos][6], equal(babs, 7));
-  ge_precomp_cmov(t, &ge_base[pos][7], equal(babs, 8));
+  ge_precomp_cmov(t, &table[pos][0], equal(babs, 1));
+  ge_precomp_cmov(t, &table[pos][1], equal(babs, 2));
+  ge_precomp_cmov(t, &table[pos][2], equal(babs, 3));
+  ge_precomp_cmov(t, &table[pos][3], equal(babs, 4));
+  ge_precomp_cmov(t, &table[pos][4], equal(babs, 5));
+  ge_precomp_cmov(t, &table[pos][5], equal(babs, 6));
+  ge_precomp_cmov(t, &table[pos][6], equal(babs, 7));
+  ge_precomp_cmov(t, &table[pos][7], equal(babs, 8));
   fe_copy(minust.yplusx, t->yminusx);
   fe_copy(minust.yminusx, t->yplusx);
   fe_neg(minust.xy2d, t->xy2d);
@@ -1637,6 +1636,18 @@ Preconditions:
 */
 
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
+  ge_scalarmult_fixed_base(h, a, ge_base);
+}
+
+/*
+h = a * B
+where B is the point table was built from, see ge_fixed_base_table_init
+
+Preconditions:
+  a[31] <= 127
+*/
+
+void ge_scalarmult_fixed_base(ge_p3 *h, const unsigned char *a, const ge_fixed_base_table table) {
   signed char e[64];
   signed char carry;
   ge_p1p1 r;
@@ -1663,7 +1674,7 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
 
   ge_p3_0(h);
   for (i = 1; i < 64; i += 2) {
-    select(&t, i / 2, e[i]);
+    select(&t, table, i / 2, e[i]);
     ge_madd(&r, h, &t); ge_p1p1_to_p3(h, &r);
   }
 
@@ -1673,7 +1684,7 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
   ge_p2_dbl(&r, &s); ge_p1p1_to_p3(h, &r);
 
   for (i = 0; i < 64; i += 2) {
-    select(&t, i / 2, e[i]);
+    select(&t, table, i / 2, e[i]);
     ge_madd(&r, h, &t); ge_p1p1_to_p3(h, &r);
   }
 }
@@ -2159,6 +2170,48 @@ void ge_scalarmult_p3(ge_p3 *r3, const unsigned char *a, const ge_p3 *A) {
   }
 }
 
+/*
+Builds the table ge_scalarmult_fixed_base uses for the fixed point B:
+t[i][j] = (j + 1) * 256^i * B, in affine (y+x, y-x, 2dxy) form like ge_base.
+This costs 256 inversions, so it is meant to be run once per generator.
+*/
+void ge_fixed_base_table_init(ge_fixed_base_table t, const ge_p3 *B) {
+  ge_p3 base = *B;
+  ge_p3 cur;
+  ge_cached base_cached;
+  ge_p1p1 r;
+  ge_p2 s;
+  fe recip, x, y;
+  int i, j, k;
+
+  for (i = 0; i < 32; ++i) {
+    ge_p3_to_cached(&base_cached, &base);
+    cur = base;
+    for (j = 0; j < 8; ++j) {
+      if (j > 0) {
+        ge_add(&r, &cur, &base_cached);
+        ge_p1p1_to_p3(&cur, &r);
+      }
+      fe_invert(recip, cur.Z);
+      fe_mul(x, cur.X, recip);
+      fe_mul(y, cur.Y, recip);
+      fe_add(t[i][j].yplusx, y, x);
+      fe_sub(t[i][j].yminusx, y, x);
+      fe_mul(t[i][j].xy2d, x, y);
+      fe_mul(t[i][j].xy2d, t[i][j].xy2d, fe_d2);
+    }
+
+    /* base *= 256 */
+    ge_p3_to_p2(&s, &base);
+    for (k = 0; k < 7; ++k) {
+      ge_p2_dbl(&r, &s);
+      ge_p1p1_to_p2(&s, &r);
+    }
+    ge_p2_dbl(&r, &s);
+    ge_p1p1_to_p3(&base, &r);
+  }
+}
+
 void ge_double_scalarmult_precomp_vartime2(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b, const ge_dsmp Bi) {
   signed char aslide[256];
   signed char bslide[256];
@@ -2307,6 +2360,39 @@ void ge_mul8(ge_p1p1 *r, const ge_p2 *t) {
   ge_p2_dbl(r, &u);
 }
 
+/* Same as calling ge_tobytes on each of the n points, but with a single field
+ * inversion for the whole batch (Montgomery's trick). scratch must hold n
+ * elements; s receives n consecutive 32 byte encodings. */
+void ge_p2_batch_tobytes(unsigned char *s, const ge_p2 *h, fe *scratch, size_t n) {
+  fe inv, recip, x, y;
+  size_t i;
+
+  if (n == 0) {
+    return;
+  }
+
+  /* scratch[i] = Z_0 * ... * Z_i */
+  fe_copy(scratch[0], h[0].Z);
+  for (i = 1; i < n; i++) {
+    fe_mul(scratch[i], scratch[i - 1], h[i].Z);
+  }
+  fe_invert(inv, scratch[n - 1]);
+
+  for (i = n - 1; i > 0; i--) {
+    /* inv = 1 / (Z_0 * ... * Z_i) */
+    fe_mul(recip, inv, scratch[i - 1]);
+    fe_mul(inv, inv, h[i].Z);
+    fe_mul(x, h[i].X, recip);
+    fe_mul(y, h[i].Y, recip);
+    fe_tobytes(s + 32 * i, y);
+    s[32 * i + 31] ^= fe_isnegative(x) << 7;
+  }
+  fe_mul(x, h[0].X, inv);
+  fe_mul(y, h[0].Y, inv);
+  fe_tobytes(s, y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
+
 void ge_fromfe_frombytes_vartime(ge_p2 *r, const unsigned char *s) {
   fe u, v, w, x, y, z;
   unsigned char sign;
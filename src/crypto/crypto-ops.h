@@ -30,6 +30,9 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* From fe.h */
 
 typedef int32_t fe[10];
@@ -118,6 +121,12 @@ void ge_p3_tobytes(unsigned char *, const ge_p3 *);
 extern const ge_precomp ge_base[32][8];
 void ge_scalarmult_base(ge_p3 *, const unsigned char *);
 
+/* Same comb as ge_scalarmult_base, over a table built for any fixed point */
+
+typedef ge_precomp ge_fixed_base_table[32][8];
+void ge_fixed_base_table_init(ge_fixed_base_table, const ge_p3 *);
+void ge_scalarmult_fixed_base(ge_p3 *, const unsigned char *, const ge_fixed_base_table);
+
 /* From ge_tobytes.c */
 
 void ge_tobytes(unsigned char *, const ge_p2 *);
@@ -135,6 +144,7 @@ void ge_triple_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const
 void ge_double_scalarmult_precomp_vartime2(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_double_scalarmult_precomp_vartime2_p3(ge_p3 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_mul8(ge_p1p1 *, const ge_p2 *);
+void ge_p2_batch_tobytes(unsigned char *, const ge_p2 *, fe *, size_t);
 extern const fe fe_ma2;
 extern const fe fe_ma;
 extern const fe fe_fffb1;
@@ -161,5 +171,7 @@ void ge_sub(ge_p1p1 *r, const ge_p3 *p, const ge_cached *q);
 void fe_add(fe h, const fe f, const fe g);
 void fe_tobytes(unsigned char *, const fe);
 void fe_invert(fe out, const fe z);
+void fe_mul(fe out, const fe, const fe);
+void fe_0(fe h);
 
 int ge_p3_is_point_at_infinity_vartime(const ge_p3 *p);
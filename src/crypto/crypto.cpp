@@ -34,6 +34,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <boost/shared_ptr.hpp>
@@ -202,6 +203,41 @@ namespace crypto {
     return true;
   }
 
+  bool crypto_ops::generate_key_derivations(const std::vector<public_key> &keys, const secret_key &key, std::vector<key_derivation> &derivations, std::vector<bool> &valid) {
+    assert(sc_check(&key) == 0);
+    derivations.resize(keys.size());
+    valid.assign(keys.size(), false);
+    std::vector<ge_p2> points;
+    std::vector<size_t> indices;
+    points.reserve(keys.size());
+    indices.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      ge_p3 point;
+      ge_p2 point2;
+      ge_p1p1 point3;
+      if (ge_frombytes_vartime(&point, &keys[i]) != 0) {
+        continue;
+      }
+      ge_scalarmult(&point2, &unwrap(key), &point);
+      ge_mul8(&point3, &point2);
+      points.emplace_back();
+      ge_p1p1_to_p2(&points.back(), &point3);
+      indices.push_back(i);
+    }
+    if (points.empty()) {
+      return keys.empty();
+    }
+    // the per point inversion in ge_tobytes costs about a tenth of the scalarmult, share it
+    std::unique_ptr<fe[]> scratch(new fe[points.size()]);
+    std::vector<key_derivation> encoded(points.size());
+    ge_p2_batch_tobytes(reinterpret_cast<unsigned char*>(encoded.data()), points.data(), scratch.get(), points.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+      derivations[indices[i]] = encoded[i];
+      valid[indices[i]] = true;
+    }
+    return indices.size() == keys.size();
+  }
+
   void crypto_ops::derivation_to_scalar(const key_derivation &derivation, size_t output_index, ec_scalar &res) {
     struct {
       key_derivation derivation;
@@ -72,6 +72,7 @@ static ge_p3 G_p3;
 static ge_p3 H_p3;
 static ge_cached G_cached;
 static ge_cached H_cached;
+static ge_fixed_base_table H_fixed_base_table;
 
 // misc
 static std::once_flag init_gens_once_flag;
@@ -142,6 +143,9 @@ static void init_gens()
         ge_p3_to_cached(&G_cached, &G_p3);
         ge_p3_to_cached(&H_cached, &H_p3);
 
+        // fixed-base table for H (G's is the compiled-in ge_base)
+        ge_fixed_base_table_init(H_fixed_base_table, &H_p3);
+
         // in debug mode, check that generators are reproducible
         (void)reproduce_generator_G; assert(reproduce_generator_G() == G);
         (void)reproduce_generator_H; assert(reproduce_generator_H() == H);
@@ -183,4 +187,15 @@ ge_cached get_H_cached()
     return H_cached;
 }
 //-------------------------------------------------------------------------------------------------------------------
+const ge_fixed_base_table& get_G_fixed_base_table()
+{
+    return ge_base;
+}
+//-------------------------------------------------------------------------------------------------------------------
+const ge_fixed_base_table& get_H_fixed_base_table()
+{
+    init_gens();
+    return H_fixed_base_table;
+}
+//-------------------------------------------------------------------------------------------------------------------
 } //namespace crypto
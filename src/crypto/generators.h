@@ -43,5 +43,8 @@ ge_p3 get_G_p3();
 ge_p3 get_H_p3();
 ge_cached get_G_cached();
 ge_cached get_H_cached();
+/// precomputed tables for constant-time fixed-base multiplication with ge_scalarmult_fixed_base()
+const ge_fixed_base_table& get_G_fixed_base_table();
+const ge_fixed_base_table& get_H_fixed_base_table();
 
 } //namespace crypto
@@ -55,3 +55,12 @@ void cn_fast_hash(const void *data, size_t length, char *hash) {
   hash_process(&state, data, length);
   memcpy(hash, &state, HASH_SIZE);
 }
+
+// hashes[i] may overlap data[j] for any j <= i (see keccak_batch)
+void cn_fast_hash_batch(const void *const *data, const size_t *length, size_t count, char (*hashes)[HASH_SIZE]) {
+  keccak_batch((const uint8_t *const *)data, length, count, (uint8_t (*)[HASH_SIZE])hashes, SIZE_MAX);
+}
+
+size_t cn_fast_hash_batch_lanes(void) {
+  return keccak_batch_lanes();
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Keccak-f[1600] over several independent states at once, one state per vector lane.
+//
+// This file is a template: the including translation unit defines
+//   km_vec                 the vector type, one 64 bit word per lane
+//   km_load(p), km_store(p, v)
+//   km_xor(a, b), km_andnot(a, b) (~a & b), km_rotl(v, n), km_set1(x)
+//   KECCAK_MULTI_LANES     the number of lanes in km_vec
+//   KECCAK_MULTI_FUNC      the name of the function to generate
+// and then includes this file once. km_rotl is only ever given constant counts,
+// so it may be a macro over an immediate-only intrinsic.
+//
+// The state is interleaved: word i of lane l lives at st[i * KECCAK_MULTI_LANES + l].
+
+#include <stdint.h>
+
+extern const uint64_t keccakf_rndc[24];
+
+void KECCAK_MULTI_FUNC(uint64_t *st, int rounds)
+{
+    km_vec s[25], bc[5], t;
+    int i, round;
+
+    for (i = 0; i < 25; ++i)
+        s[i] = km_load(st + i * KECCAK_MULTI_LANES);
+
+    for (round = 0; round < rounds; ++round) {
+        // Theta
+        for (i = 0; i < 5; ++i)
+            bc[i] = km_xor(km_xor(km_xor(s[i], s[i + 5]), km_xor(s[i + 10], s[i + 15])), s[i + 20]);
+
+        for (i = 0; i < 5; ++i) {
+            t = km_xor(bc[(i + 4) % 5], km_rotl(bc[(i + 1) % 5], 1));
+            s[i     ] = km_xor(s[i     ], t);
+            s[i +  5] = km_xor(s[i +  5], t);
+            s[i + 10] = km_xor(s[i + 10], t);
+            s[i + 15] = km_xor(s[i + 15], t);
+            s[i + 20] = km_xor(s[i + 20], t);
+        }
+
+        // Rho Pi
+        t = s[1];
+        s[ 1] = km_rotl(s[ 6], 44);
+        s[ 6] = km_rotl(s[ 9], 20);
+        s[ 9] = km_rotl(s[22], 61);
+        s[22] = km_rotl(s[14], 39);
+        s[14] = km_rotl(s[20], 18);
+        s[20] = km_rotl(s[ 2], 62);
+        s[ 2] = km_rotl(s[12], 43);
+        s[12] = km_rotl(s[13], 25);
+        s[13] = km_rotl(s[19],  8);
+        s[19] = km_rotl(s[23], 56);
+        s[23] = km_rotl(s[15], 41);
+        s[15] = km_rotl(s[ 4], 27);
+        s[ 4] = km_rotl(s[24], 14);
+        s[24] = km_rotl(s[21],  2);
+        s[21] = km_rotl(s[ 8], 55);
+        s[ 8] = km_rotl(s[16], 45);
+        s[16] = km_rotl(s[ 5], 36);
+        s[ 5] = km_rotl(s[ 3], 28);
+        s[ 3] = km_rotl(s[18], 21);
+        s[18] = km_rotl(s[17], 15);
+        s[17] = km_rotl(s[11], 10);
+        s[11] = km_rotl(s[ 7],  6);
+        s[ 7] = km_rotl(s[10],  3);
+        s[10] = km_rotl(t, 1);
+
+        // Chi
+        for (i = 0; i < 25; i += 5) {
+            const km_vec s0 = s[i    ];
+            const km_vec s1 = s[i + 1];
+            const km_vec s2 = s[i + 2];
+            const km_vec s3 = s[i + 3];
+            const km_vec s4 = s[i + 4];
+            s[i    ] = km_xor(s0, km_andnot(s1, s2));
+            s[i + 1] = km_xor(s1, km_andnot(s2, s3));
+            s[i + 2] = km_xor(s2, km_andnot(s3, s4));
+            s[i + 3] = km_xor(s3, km_andnot(s4, s0));
+            s[i + 4] = km_xor(s4, km_andnot(s0, s1));
+        }
+
+        // Iota
+        s[0] = km_xor(s[0], km_set1(keccakf_rndc[round]));
+    }
+
+    for (i = 0; i < 25; ++i)
+        km_store(st + i * KECCAK_MULTI_LANES, s[i]);
+}
@@ -171,6 +171,113 @@ void keccak1600(const uint8_t *in, size_t inlen, uint8_t *md)
     keccak(in, inlen, md, sizeof(state_t));
 }
 
+#define KECCAK_BATCH_MAX_LANES 8
+
+typedef void (*keccakf_multi_t)(uint64_t *st, int rounds);
+
+#if defined(HAVE_KECCAK_AVX2)
+void keccakf_x4_avx2(uint64_t *st, int rounds);
+#endif
+#if defined(HAVE_KECCAK_AVX512)
+void keccakf_x8_avx512(uint64_t *st, int rounds);
+#endif
+
+static size_t keccak_batch_select(size_t max_lanes, keccakf_multi_t *f)
+{
+#if defined(HAVE_KECCAK_AVX512)
+    if (max_lanes >= 8 && __builtin_cpu_supports("avx512f")) {
+        *f = keccakf_x8_avx512;
+        return 8;
+    }
+#endif
+#if defined(HAVE_KECCAK_AVX2)
+    if (max_lanes >= 4 && __builtin_cpu_supports("avx2")) {
+        *f = keccakf_x4_avx2;
+        return 4;
+    }
+#endif
+    *f = NULL;
+    return 1;
+}
+
+size_t keccak_batch_lanes(void)
+{
+    keccakf_multi_t f;
+    return keccak_batch_select(KECCAK_BATCH_MAX_LANES, &f);
+}
+
+// hash up to "lanes" messages in lockstep; a message that needs fewer blocks than
+// the longest one in the group has its digest taken after its own last block
+static void keccak_multi(keccakf_multi_t f, size_t lanes, const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t (*md)[32])
+{
+    uint64_t st[25 * KECCAK_BATCH_MAX_LANES];
+    uint8_t out[KECCAK_BATCH_MAX_LANES][32];
+    uint8_t temp[HASH_DATA_AREA];
+    const size_t rsizw = HASH_DATA_AREA / 8;
+    size_t l, i, b, nblocks[KECCAK_BATCH_MAX_LANES], maxblocks = 0;
+
+    memset(st, 0, 25 * lanes * sizeof(uint64_t));
+    for (l = 0; l < count; ++l) {
+        nblocks[l] = inlen[l] / HASH_DATA_AREA + 1;
+        if (nblocks[l] > maxblocks)
+            maxblocks = nblocks[l];
+    }
+
+    for (b = 0; b < maxblocks; ++b) {
+        for (l = 0; l < count; ++l) {
+            const uint8_t *block;
+            if (b >= nblocks[l])
+                continue;
+            block = in[l] + b * HASH_DATA_AREA;
+            if (b + 1 == nblocks[l]) {
+                // last block and padding
+                const size_t rest = inlen[l] - b * HASH_DATA_AREA;
+                if (rest > 0)
+                    memcpy(temp, block, rest);
+                temp[rest] = 1;
+                memset(temp + rest + 1, 0, HASH_DATA_AREA - rest - 1);
+                temp[HASH_DATA_AREA - 1] |= 0x80;
+                block = temp;
+            }
+            for (i = 0; i < rsizw; ++i) {
+                uint64_t ina;
+                memcpy(&ina, block + i * 8, 8);
+                st[i * lanes + l] ^= swap64le(ina);
+            }
+        }
+
+        f(st, KECCAK_ROUNDS);
+
+        for (l = 0; l < count; ++l) {
+            if (b + 1 != nblocks[l])
+                continue;
+            for (i = 0; i < 4; ++i)
+                memcpy_swap64le(out[l] + i * 8, &st[i * lanes + l], 1);
+        }
+    }
+
+    for (l = 0; l < count; ++l)
+        memcpy(md[l], out[l], 32);
+}
+
+void keccak_batch(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t (*md)[32], size_t max_lanes)
+{
+    keccakf_multi_t f;
+    const size_t lanes = keccak_batch_select(max_lanes, &f);
+
+    // a group of one would waste the other lanes, so stragglers go through keccak()
+    while (lanes > 1 && count > 1) {
+        const size_t n = count < lanes ? count : lanes;
+        keccak_multi(f, lanes, in, inlen, n, md);
+        in += n;
+        inlen += n;
+        md += n;
+        count -= n;
+    }
+    for ( ; count > 0; --count, ++in, ++inlen, ++md)
+        keccak(*in, *inlen, *md, 32);
+}
+
 #define KECCAK_FINALIZED 0x80000000
 #define KECCAK_BLOCKLEN 136
 #define KECCAK_WORDS 17
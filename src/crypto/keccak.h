@@ -34,6 +34,15 @@ void keccakf(uint64_t st[25], int norounds);
 
 void keccak1600(const uint8_t *in, size_t inlen, uint8_t *md);
 
+// compute count independent 256-bit keccak hashes (rate 136, as cn_fast_hash), running
+// up to max_lanes of them side by side with the widest SIMD permutation the CPU has.
+// md[i] is written only once in[i] and every in[j], j < i, have been consumed, so md[i]
+// may overlap the input of any message j <= i.
+void keccak_batch(const uint8_t *const *in, const size_t *inlen, size_t count, uint8_t (*md)[32], size_t max_lanes);
+
+// the number of messages keccak_batch hashes at once on this CPU (1, 4 or 8)
+size_t keccak_batch_lanes(void);
+
 void keccak_init(KECCAK_CTX * ctx);
 void keccak_update(KECCAK_CTX * ctx, const uint8_t *in, size_t inlen);
 void keccak_finish(KECCAK_CTX * ctx, uint8_t *md);
@@ -59,6 +59,30 @@ size_t tree_hash_cnt(size_t count) {
 	return pow >> 1;
 }
 
+/***
+* Hash count consecutive pairs of hashes from in into count hashes at out, several pairs at
+* a time. out may be the same buffer as in: each output lands at or before the pair it is
+* made from, and cn_fast_hash_batch only writes an output once its input has been consumed.
+*/
+#define TREE_HASH_BATCH 64
+static void hash_pairs(const char *in, size_t count, char *out) {
+  const void *data[TREE_HASH_BATCH];
+  size_t length[TREE_HASH_BATCH];
+  size_t i, n;
+
+  for (i = 0; i < TREE_HASH_BATCH; ++i)
+    length[i] = 2 * HASH_SIZE;
+  while (count > 0) {
+    n = count < TREE_HASH_BATCH ? count : TREE_HASH_BATCH;
+    for (i = 0; i < n; ++i)
+      data[i] = in + i * 2 * HASH_SIZE;
+    cn_fast_hash_batch(data, length, n, (char (*)[HASH_SIZE])out);
+    in += n * 2 * HASH_SIZE;
+    out += n * HASH_SIZE;
+    count -= n;
+  }
+}
+
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
 // The blockchain block at height 202612 https://moneroblocks.info/block/202612
 // contained 514 transactions, that triggered bad calculation of variable "cnt" in the original version of this function
@@ -79,25 +103,20 @@ void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash) {
   } else if (count == 2) {
     cn_fast_hash(hashes, 2 * HASH_SIZE, root_hash);
   } else {
-    size_t i, j;
-
     size_t cnt = tree_hash_cnt( count );
+    const size_t j = 2 * cnt - count;
 
     char *ints = calloc(cnt, HASH_SIZE);  // zero out as extra protection for using uninitialized mem
     assert(ints);
 
-    memcpy(ints, hashes, (2 * cnt - count) * HASH_SIZE);
+    memcpy(ints, hashes, j * HASH_SIZE);
 
-    for (i = 2 * cnt - count, j = 2 * cnt - count; j < cnt; i += 2, ++j) {
-      cn_fast_hash(hashes[i], 64, ints + j * HASH_SIZE);
-    }
-    assert(i == count);
+    // the last count - j hashes pair up into ints[j..cnt)
+    hash_pairs(hashes[j], cnt - j, ints + j * HASH_SIZE);
 
     while (cnt > 2) {
       cnt >>= 1;
-      for (i = 0, j = 0; j < cnt; i += 2, ++j) {
-        cn_fast_hash(ints + i * HASH_SIZE, 64, ints + j * HASH_SIZE);
-      }
+      hash_pairs(ints, cnt, ints);
     }
 
     cn_fast_hash(ints, 64, root_hash);
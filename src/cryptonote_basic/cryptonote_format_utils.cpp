@@ -42,6 +42,7 @@
 #include "crypto/crypto.h"
 #include "crypto/hash.h"
 #include "ringct/rctSigs.h"
+#include "device/device_default.hpp"
 #include "oracle/asset_types.h"
 
 using namespace epee;
@@ -290,6 +291,72 @@ namespace cryptonote
     return is_v1_tx(blobdata_ref{tx_blob.data(), tx_blob.size()});
   }
   //---------------------------------------------------------------
+  bool strip_ring_members_from_tx_blob(blobdata& tx_blob)
+  {
+    // walks the inputs of the prefix without parsing the rest of the tx: every
+    // byte is copied but the key offsets, which are written as an empty list
+    const char* it = tx_blob.data();
+    const char* end = it + tx_blob.size();
+    blobdata stripped;
+    stripped.reserve(tx_blob.size());
+    auto copy_varint = [&](uint64_t& value) {
+      const char* const start = it;
+      const int read = tools::read_varint(it, end, value);
+      if (read <= 0 || (static_cast<uint8_t>(*(it - 1)) & 0x80))
+        return false;
+      stripped.append(start, it);
+      return true;
+    };
+    auto skip_varint = [&](uint64_t& value) {
+      const int read = tools::read_varint(it, end, value);
+      return read > 0 && !(static_cast<uint8_t>(*(it - 1)) & 0x80);
+    };
+    auto copy_bytes = [&](uint64_t n) {
+      if (n > static_cast<uint64_t>(end - it))
+        return false;
+      stripped.append(it, it + n);
+      it += n;
+      return true;
+    };
+
+    uint64_t version, unlock_time, n_inputs;
+    if (!copy_varint(version) || !copy_varint(unlock_time) || !copy_varint(n_inputs))
+      return false;
+    for (uint64_t i = 0; i < n_inputs; ++i)
+    {
+      if (it == end)
+        return false;
+      const uint8_t tag = static_cast<uint8_t>(*it);
+      if (!copy_bytes(1))
+        return false;
+      if (tag == 0xff) // txin_gen
+      {
+        uint64_t height;
+        if (!copy_varint(height))
+          return false;
+      }
+      else if (tag == 0x2) // txin_to_key
+      {
+        uint64_t amount, asset_type_size, n_offsets, offset;
+        if (!copy_varint(amount) || !copy_varint(asset_type_size) || !copy_bytes(asset_type_size) || !skip_varint(n_offsets))
+          return false;
+        for (uint64_t k = 0; k < n_offsets; ++k)
+          if (!skip_varint(offset))
+            return false;
+        stripped.push_back(0);
+        if (!copy_bytes(sizeof(crypto::key_image)))
+          return false;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    stripped.append(it, end);
+    tx_blob = std::move(stripped);
+    return true;
+  }
+  //---------------------------------------------------------------
   bool generate_key_image_helper(const account_keys& ack, const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses, const crypto::public_key& out_key, const crypto::public_key& tx_public_key, const std::vector<crypto::public_key>& additional_tx_public_keys, size_t real_output_index, keypair& in_ephemeral, crypto::key_image& ki, hw::device &hwdev, const bool use_origin_data, const origin_data& od)
   {
     crypto::key_derivation recv_derivation = AUTO_VAL_INIT(recv_derivation);
@@ -513,6 +580,19 @@ namespace cryptonote
     return blob_size + bp_clawback;
   }
   //---------------------------------------------------------------
+  uint64_t get_transaction_weight_for_fee(const transaction &tx, size_t blob_size, uint64_t fee, uint64_t amount_burnt)
+  {
+    // For every user tx type, the fee and the burnt amount are varints that no other field's size
+    // depends on: amounts are hidden and the proofs are sized by the input and output counts only.
+    // So the same tx with another fee and burnt amount differs in weight by those varints alone.
+    CHECK_AND_ASSERT_THROW_MES(tx.version >= 2, "get_transaction_weight_for_fee does not support v1 txes");
+    CHECK_AND_ASSERT_THROW_MES(tx.type != transaction_type::MINER && tx.type != transaction_type::PROTOCOL, "get_transaction_weight_for_fee does not support miner or protocol txes");
+    const uint64_t weight = get_transaction_weight(tx, blob_size);
+    const size_t old_size = tools::get_varint_data(tx.rct_signatures.txnFee).size() + tools::get_varint_data(tx.amount_burnt).size();
+    const size_t new_size = tools::get_varint_data(fee).size() + tools::get_varint_data(amount_burnt).size();
+    return weight - old_size + new_size;
+  }
+  //---------------------------------------------------------------
   uint64_t get_pruned_transaction_weight(const transaction &tx)
   {
     CHECK_AND_ASSERT_MES(tx.pruned, std::numeric_limits<uint64_t>::max(), "get_pruned_transaction_weight does not support non pruned txes");
@@ -1278,7 +1358,7 @@ namespace cryptonote
     // Therefore can fail out early to avoid expensive crypto ops needlessly deriving output public key to
     // determine if output belongs to the account.
     crypto::view_tag derived_view_tag;
-    if (hwdev != nullptr)
+    if (hwdev != nullptr && !hw::core::is_software(*hwdev))
     {
       bool r = hwdev->derive_view_tag(derivation, output_index, derived_view_tag);
       CHECK_AND_ASSERT_MES(r, false, "Failed to derive view tag");
@@ -1320,11 +1400,14 @@ namespace cryptonote
     return false;
   }
   //---------------------------------------------------------------
-  boost::optional<subaddress_receive_info> is_out_to_acc_precomp(const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses, const crypto::public_key& out_key, const crypto::key_derivation& derivation, const std::vector<crypto::key_derivation>& additional_derivations, size_t output_index, hw::device &hwdev, const boost::optional<crypto::view_tag>& view_tag_opt)
+  // Device is either hw::device or hw::core::software_device; the latter resolves the per output
+  // derivations at compile time instead of through the device vtable
+  template<typename Device>
+  static boost::optional<subaddress_receive_info> is_out_to_acc_precomp_impl(const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses, const crypto::public_key& out_key, const crypto::key_derivation& derivation, const std::vector<crypto::key_derivation>& additional_derivations, size_t output_index, Device &hwdev, const boost::optional<crypto::view_tag>& view_tag_opt, hw::device *view_tag_dev)
   {
     // try the shared tx pubkey
     crypto::public_key subaddress_spendkey;
-    if (out_can_be_to_acc(view_tag_opt, derivation, output_index, &hwdev))
+    if (out_can_be_to_acc(view_tag_opt, derivation, output_index, view_tag_dev))
     {
       CHECK_AND_ASSERT_MES(hwdev.derive_subaddress_public_key(out_key, derivation, output_index, subaddress_spendkey), boost::none, "Failed to derive subaddress public key");
       auto found = subaddresses.find(subaddress_spendkey);
@@ -1336,7 +1419,7 @@ namespace cryptonote
     if (!additional_derivations.empty())
     {
       CHECK_AND_ASSERT_MES(output_index < additional_derivations.size(), boost::none, "wrong number of additional derivations");
-      if (out_can_be_to_acc(view_tag_opt, additional_derivations[output_index], output_index, &hwdev))
+      if (out_can_be_to_acc(view_tag_opt, additional_derivations[output_index], output_index, view_tag_dev))
       {
         // HERE BE DRAGONS!!!
         // SRCG: This is NOT going to work for PROTOCOL_TX except where there is only a single output
@@ -1359,6 +1442,16 @@ namespace cryptonote
     return boost::none;
   }
   //---------------------------------------------------------------
+  boost::optional<subaddress_receive_info> is_out_to_acc_precomp(const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses, const crypto::public_key& out_key, const crypto::key_derivation& derivation, const std::vector<crypto::key_derivation>& additional_derivations, size_t output_index, hw::device &hwdev, const boost::optional<crypto::view_tag>& view_tag_opt)
+  {
+    if (hw::core::is_software(hwdev))
+    {
+      hw::core::software_device swdev;
+      return is_out_to_acc_precomp_impl(subaddresses, out_key, derivation, additional_derivations, output_index, swdev, view_tag_opt, nullptr);
+    }
+    return is_out_to_acc_precomp_impl(subaddresses, out_key, derivation, additional_derivations, output_index, hwdev, view_tag_opt, &hwdev);
+  }
+  //---------------------------------------------------------------
   bool lookup_acc_outs(const account_keys& acc, const transaction& tx, std::vector<size_t>& outs, uint64_t& money_transfered)
   {
     crypto::public_key tx_pub_key = get_tx_pub_key_from_extra(tx);
@@ -1645,26 +1738,22 @@ namespace cryptonote
     // v2 transactions hash different parts together, than hash the set of those hashes
     crypto::hash hashes[3];
 
-    // prefix
-    get_transaction_prefix_hash(t, hashes[0]);
-
     const blobdata blob = tx_to_blob(t);
     const unsigned int unprunable_size = t.unprunable_size;
     const unsigned int prefix_size = t.prefix_size;
-
-    // base rct
     CHECK_AND_ASSERT_MES(prefix_size <= unprunable_size && unprunable_size <= blob.size(), false, "Inconsistent transaction prefix, unprunable and blob sizes");
-    cryptonote::get_blob_hash(blobdata_ref(blob.data() + prefix_size, unprunable_size - prefix_size), hashes[1]);
 
-    // prunable rct
+    // prefix, base rct and prunable rct are consecutive slices of the blob, hash them side by side
+    const void *parts[3] = {blob.data(), blob.data() + prefix_size, blob.data() + unprunable_size};
+    const size_t lengths[3] = {prefix_size, unprunable_size - prefix_size, blob.size() - unprunable_size};
     if (t.rct_signatures.type == rct::RCTTypeNull)
     {
+      crypto::cn_fast_hash_batch(parts, lengths, 2, hashes);
       hashes[2] = crypto::null_hash;
     }
     else
     {
-      cryptonote::blobdata_ref blobref(blob);
-      CHECK_AND_ASSERT_MES(calculate_transaction_prunable_hash(t, &blobref, hashes[2]), false, "Failed to get tx prunable hash");
+      crypto::cn_fast_hash_batch(parts, lengths, 3, hashes);
     }
 
     // the tx hash is the hash of the 3 hashes
@@ -1768,6 +1857,48 @@ namespace cryptonote
     return p;
   }
   //---------------------------------------------------------------
+  bool get_block_hashes(const std::vector<block>& blocks, std::vector<crypto::hash>& hashes)
+  {
+    // the hashing blobs need each block's tx tree hash and are built one at a time,
+    // the block hashes themselves are then taken in a single batch
+    hashes.resize(blocks.size());
+    std::vector<blobdata> blobs;
+    std::vector<size_t> pending;
+    blobs.reserve(blocks.size());
+    pending.reserve(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+      const block &b = blocks[i];
+      if (b.is_hash_valid())
+      {
+        hashes[i] = b.hash;
+        ++block_hashes_cached_count;
+        continue;
+      }
+      blobs.push_back(t_serializable_object_to_blob(get_block_hashing_blob(b)));
+      pending.push_back(i);
+    }
+    if (pending.empty())
+      return true;
+
+    std::vector<const void*> data(blobs.size());
+    std::vector<size_t> lengths(blobs.size());
+    for (size_t i = 0; i < blobs.size(); ++i)
+    {
+      data[i] = blobs[i].data();
+      lengths[i] = blobs[i].size();
+    }
+    std::vector<crypto::hash> res(blobs.size());
+    crypto::cn_fast_hash_batch(data.data(), lengths.data(), res.size(), res.data());
+    for (size_t i = 0; i < pending.size(); ++i)
+    {
+      hashes[pending[i]] = res[i];
+      blocks[pending[i]].set_hash(res[i]);
+    }
+    block_hashes_calculated_count += pending.size();
+    return true;
+  }
+  //---------------------------------------------------------------
   std::vector<uint64_t> relative_output_offsets_to_absolute(const std::vector<uint64_t>& off)
   {
     std::vector<uint64_t> res = off;
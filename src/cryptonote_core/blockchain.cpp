@@ -92,6 +92,57 @@ DISABLE_VS_WARNINGS(4267)
 // used to overestimate the block reward when estimating a per kB to use
 #define BLOCK_REWARD_OVERESTIMATE (10 * 1000000000000)
 
+// grace blocks the fee estimate in the tip snapshot is computed for, matching what wallets ask for
+#define TIP_SNAPSHOT_FEE_GRACE_BLOCKS 10
+
+// number of alternative chain tips whose difficulty and timestamp windows are kept
+#define ALT_CHAIN_STATES_CACHE_SIZE 32
+
+namespace
+{
+  // the long term block weights cache, as saved across restarts
+  struct block_weights_cache_data
+  {
+    uint64_t window;
+    uint64_t tip_height;
+    crypto::hash tip_hash;
+    std::vector<uint64_t> weights; // oldest first, ending at tip_height
+
+    template <class t_archive>
+    void serialize(t_archive &a, const unsigned int ver)
+    {
+      a & window;
+      a & tip_height;
+      a & tip_hash;
+      a & weights;
+    }
+  };
+
+  // the cache lives in the data dir, next to the db's own directory
+  std::string get_block_weights_cache_filename(const BlockchainDB *db)
+  {
+    const std::vector<std::string> filenames = db->get_filenames();
+    if (filenames.empty())
+      return std::string();
+    return (boost::filesystem::path(filenames.front()).parent_path().parent_path() / BLOCK_WEIGHTS_DATA_FILENAME).string();
+  }
+
+  // moves a window of per block weights ending at tip_height down to target_height,
+  // taking back the weights of the blocks which reenter it at the bottom
+  template<typename t_get_weight>
+  void rewind_weights_window(epee::misc_utils::window_median_t<uint64_t> &window, uint64_t &tip_height, uint64_t target_height, const t_get_weight &get_weight)
+  {
+    while (tip_height > target_height && !window.empty())
+    {
+      const uint64_t front_height = tip_height + 1 - window.size();
+      window.pop_back();
+      --tip_height;
+      if (front_height > 0)
+        window.push_front(get_weight(front_height - 1));
+    }
+  }
+}
+
 //------------------------------------------------------------------
 Blockchain::Blockchain(tx_memory_pool& tx_pool) :
   m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_reset_timestamps_and_difficulties_height(true), m_current_block_cumul_weight_limit(0), m_current_block_cumul_weight_median(0),
@@ -99,7 +150,11 @@ Blockchain::Blockchain(tx_memory_pool& tx_pool) :
   m_long_term_block_weights_window(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
   m_long_term_effective_median_block_weight(0),
   m_long_term_block_weights_cache_tip_hash(crypto::null_hash),
-  m_long_term_block_weights_cache_rolling_median(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
+  m_long_term_block_weights_cache_tip_height(0),
+  m_long_term_block_weights_cache_median(CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE),
+  m_block_weights_cache_tip_hash(crypto::null_hash),
+  m_block_weights_cache_tip_height(0),
+  m_block_weights_cache_median(CRYPTONOTE_REWARD_BLOCKS_WINDOW),
   m_difficulty_for_next_block_top_hash(crypto::null_hash),
   m_difficulty_for_next_block(1),
   m_btc_valid(false),
@@ -442,7 +497,7 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
   if (test_options && test_options->long_term_block_weight_window)
   {
     m_long_term_block_weights_window = test_options->long_term_block_weight_window;
-    m_long_term_block_weights_cache_rolling_median = epee::misc_utils::rolling_median_t<uint64_t>(m_long_term_block_weights_window);
+    m_long_term_block_weights_cache_median = epee::misc_utils::window_median_t<uint64_t>(m_long_term_block_weights_window);
   }
 
   bool difficulty_ok;
@@ -456,6 +511,7 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
 
   {
     db_txn_guard txn_guard(m_db, m_db->is_read_only());
+    load_block_weights_cache();
     if (!update_next_cumulative_weight_limit())
       return false;
   }
@@ -466,7 +522,9 @@ bool Blockchain::init(BlockchainDB* db, const network_type nettype, bool offline
 
   // Preload the yield_block_info cache
   rebuild_ybi_cache();
-  
+
+  update_tip_snapshot();
+
   return true;
 }
 //------------------------------------------------------------------
@@ -528,6 +586,7 @@ bool Blockchain::deinit()
   {
     if (m_db)
     {
+      store_block_weights_cache();
       m_db->close();
       MTRACE("Local blockchain read/write activity stopped successfully");
     }
@@ -582,6 +641,8 @@ void Blockchain::pop_blocks(uint64_t nblocks)
   if (stop_batch)
     m_db->batch_stop();
 
+  update_tip_snapshot();
+
   const crypto::hash seedhash = get_block_id_by_height(crypto::rx_seedheight(m_db->height()));
   rx_set_main_seedhash(seedhash.data, tools::get_max_concurrency());
 }
@@ -620,6 +681,8 @@ block Blockchain::pop_block_from_blockchain()
     throw;
   }
 
+  rewind_block_weights_caches(popped_block);
+
   // Rebuild the YBI cache
   rebuild_ybi_cache();
 
@@ -687,13 +750,17 @@ bool Blockchain::reset_and_set_genesis_block(const block& b)
   invalidate_block_template_cache();
   m_db->reset();
   m_db->drop_alt_blocks();
+  reset_block_weights_caches();
   m_hardfork->init();
 
-  db_wtxn_guard wtxn_guard(m_db);
   block_verification_context bvc = {};
-  add_new_block(b, bvc);
-  if (!update_next_cumulative_weight_limit())
-    return false;
+  {
+    db_wtxn_guard wtxn_guard(m_db);
+    add_new_block(b, bvc);
+    if (!update_next_cumulative_weight_limit())
+      return false;
+  }
+  update_tip_snapshot();
   return bvc.m_added_to_main_chain && !bvc.m_verifivation_failed;
 }
 //------------------------------------------------------------------
@@ -1405,6 +1472,140 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
   }
 }
 //------------------------------------------------------------------
+// Same as above, from the window cached for the alternative chain's tip
+difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const alt_chain_state &state) const
+{
+  if (m_fixed_difficulty)
+  {
+    return m_db->height() ? m_fixed_difficulty : 1;
+  }
+
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  uint8_t version = get_current_hard_fork_version();
+  size_t difficulty_blocks_count;
+  if (version == 1) {
+    difficulty_blocks_count = DIFFICULTY_BLOCKS_COUNT;
+  } else {
+    difficulty_blocks_count = DIFFICULTY_BLOCKS_COUNT_V2;
+  }
+
+  // the state holds the main chain blocks below the split (without the
+  // genesis block) followed by the alternative chain, so the window is its tail
+  const size_t count = std::min(difficulty_blocks_count, state.cumulative_difficulties.size());
+  std::vector<uint64_t> timestamps(state.timestamps.end() - count, state.timestamps.end());
+  std::vector<difficulty_type> cumulative_difficulties(state.cumulative_difficulties.end() - count, state.cumulative_difficulties.end());
+
+  // FIXME: This will fail if fork activation heights are subject to voting
+  size_t target = DIFFICULTY_TARGET_V2;
+
+  // calculate the difficulty target for the block and return it
+  if (version == 1) {
+    return next_difficulty(timestamps, cumulative_difficulties, target);
+  } else {
+    return next_difficulty_v2(timestamps, cumulative_difficulties, target);
+  }
+}
+//------------------------------------------------------------------
+void Blockchain::alt_chain_state::push_block(uint64_t timestamp, const difficulty_type &cumulative_difficulty)
+{
+  timestamps.push_back(timestamp);
+  cumulative_difficulties.push_back(cumulative_difficulty);
+  ++height;
+
+  // the timestamp check looks at the whole alternative chain once it is
+  // longer than BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW, so only main chain
+  // blocks are ever dropped from timestamps
+  const size_t alt_blocks = height + 1 - split_height;
+  if (timestamps.size() > std::max(window, alt_blocks))
+    timestamps.erase(timestamps.begin());
+  if (cumulative_difficulties.size() > window)
+    cumulative_difficulties.erase(cumulative_difficulties.begin());
+}
+//------------------------------------------------------------------
+bool Blockchain::get_alt_chain_state(const crypto::hash &prev_id, bool parent_in_alt, alt_chain_state &state, std::list<block_extended_info> &alt_chain, block_verification_context& bvc) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  // blocks needed below the tip for both the difficulty and the timestamp checks
+  const size_t difficulty_blocks_count = get_current_hard_fork_version() == 1 ? DIFFICULTY_BLOCKS_COUNT : DIFFICULTY_BLOCKS_COUNT_V2;
+  const size_t window = std::max<size_t>(difficulty_blocks_count, BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW);
+
+  if (parent_in_alt)
+  {
+    const auto i = m_alt_chain_states.find(prev_id);
+    if (i != m_alt_chain_states.end())
+    {
+      // a reorg since the state was cached may have moved the split point,
+      // in which case the state no longer describes this chain; the main
+      // chain must also still reach past the split, as build_alt_chain requires
+      const alt_chain_state &cached = i->second;
+      const uint64_t db_height = m_db->height();
+      if (cached.window >= window && db_height > cached.split_height && m_db->get_block_hash_from_height(cached.split_height - 1) == cached.split_prev_id
+          && m_db->get_block_hash_from_height(cached.split_height) != cached.first_id)
+      {
+        state = cached;
+        return true;
+      }
+    }
+
+    std::vector<uint64_t> timestamps;
+    if (!build_alt_chain(prev_id, alt_chain, timestamps, bvc))
+      return false;
+    state.split_prev_id = alt_chain.front().bl.prev_id;
+    state.first_id = get_block_hash(alt_chain.front().bl);
+    state.split_height = alt_chain.front().height;
+  }
+  else
+  {
+    state.split_prev_id = prev_id;
+    state.first_id = crypto::null_hash;
+    state.split_height = m_db->get_block_height(prev_id) + 1;
+  }
+  state.height = state.split_height - 1;
+  state.window = window;
+
+  // main chain blocks below the split, skipping the genesis block
+  state.timestamps.clear();
+  state.cumulative_difficulties.clear();
+  uint64_t height = state.split_height > window ? state.split_height - window : 1;
+  state.timestamps.reserve(state.split_height - height + alt_chain.size());
+  state.cumulative_difficulties.reserve(state.split_height - height + alt_chain.size());
+  for (; height < state.split_height; ++height)
+  {
+    state.timestamps.push_back(m_db->get_block_timestamp(height));
+    state.cumulative_difficulties.push_back(m_db->get_block_cumulative_difficulty(height));
+  }
+
+  for (const block_extended_info &bei: alt_chain)
+    state.push_block(bei.bl.timestamp, bei.cumulative_difficulty);
+
+  return true;
+}
+//------------------------------------------------------------------
+void Blockchain::cache_alt_chain_state(const crypto::hash &id, alt_chain_state &&state)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  const auto i = m_alt_chain_states.find(id);
+  if (i == m_alt_chain_states.end())
+  {
+    m_alt_chain_states.emplace(id, std::move(state));
+    m_alt_chain_states_order.push_back(id);
+  }
+  else
+  {
+    i->second = std::move(state);
+  }
+
+  while (m_alt_chain_states_order.size() > ALT_CHAIN_STATES_CACHE_SIZE)
+  {
+    m_alt_chain_states.erase(m_alt_chain_states_order.front());
+    m_alt_chain_states_order.pop_front();
+  }
+}
+//------------------------------------------------------------------
 // This function does a sanity check on basic things that all miner
 // transactions have in common, such as:
 //   one input, of type txin_gen, with height set to the block's height
@@ -1736,7 +1937,7 @@ uint64_t Blockchain::get_long_term_block_weight_median(uint64_t start_height, si
   uint64_t blockchain_height = m_db->height();
   uint64_t tip_height = start_height + count - 1;
   crypto::hash tip_hash = crypto::null_hash;
-  if (tip_height < blockchain_height && count == (size_t)m_long_term_block_weights_cache_rolling_median.size())
+  if (tip_height < blockchain_height && count == m_long_term_block_weights_cache_median.size())
   {
     tip_hash = m_db->get_block_hash_from_height(tip_height);
     cached = tip_hash == m_long_term_block_weights_cache_tip_hash;
@@ -1745,30 +1946,144 @@ uint64_t Blockchain::get_long_term_block_weight_median(uint64_t start_height, si
   if (cached)
   {
     MTRACE("requesting " << count << " from " << start_height << ", cached");
-    return m_long_term_block_weights_cache_rolling_median.median();
+    return m_long_term_block_weights_cache_median.median();
   }
 
   // in the vast majority of uncached cases, most is still cached,
   // as we just move the window one block up:
-  if (tip_height > 0 && count == (size_t)m_long_term_block_weights_cache_rolling_median.size() && tip_height < blockchain_height)
+  if (tip_height > 0 && count == m_long_term_block_weights_cache_median.size() && tip_height < blockchain_height)
   {
     crypto::hash old_tip_hash = m_db->get_block_hash_from_height(tip_height - 1);
     if (old_tip_hash == m_long_term_block_weights_cache_tip_hash)
     {
       MTRACE("requesting " << count << " from " << start_height << ", incremental");
       m_long_term_block_weights_cache_tip_hash = tip_hash;
-      m_long_term_block_weights_cache_rolling_median.insert(m_db->get_block_long_term_weight(tip_height));
-      return m_long_term_block_weights_cache_rolling_median.median();
+      m_long_term_block_weights_cache_tip_height = tip_height;
+      m_long_term_block_weights_cache_median.push_back(m_db->get_block_long_term_weight(tip_height));
+      return m_long_term_block_weights_cache_median.median();
     }
   }
 
   MTRACE("requesting " << count << " from " << start_height << ", uncached");
   std::vector<uint64_t> weights = m_db->get_long_term_block_weights(start_height, count);
   m_long_term_block_weights_cache_tip_hash = tip_hash;
-  m_long_term_block_weights_cache_rolling_median.clear();
+  m_long_term_block_weights_cache_tip_height = tip_height;
+  m_long_term_block_weights_cache_median.clear();
   for (uint64_t w: weights)
-    m_long_term_block_weights_cache_rolling_median.insert(w);
-  return m_long_term_block_weights_cache_rolling_median.median();
+    m_long_term_block_weights_cache_median.push_back(w);
+  return m_long_term_block_weights_cache_median.median();
+}
+//------------------------------------------------------------------
+void Blockchain::rewind_block_weights_caches(const block &popped_block)
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
+  // the popped block was at this height
+  const uint64_t height = m_db->height();
+  const crypto::hash popped_hash = get_block_hash(popped_block);
+  const auto on_popped_chain = [&](uint64_t tip_height, const crypto::hash &tip_hash) {
+    return (tip_height == height && tip_hash == popped_hash) || (tip_height + 1 == height && tip_hash == popped_block.prev_id);
+  };
+
+  // the short term window ends at the top block
+  if (on_popped_chain(m_block_weights_cache_tip_height, m_block_weights_cache_tip_hash))
+  {
+    rewind_weights_window(m_block_weights_cache_median, m_block_weights_cache_tip_height, height - 1,
+        [this](uint64_t h) { return m_db->get_block_weight(h); });
+    m_block_weights_cache_tip_hash = popped_block.prev_id;
+  }
+  else
+  {
+    m_block_weights_cache_tip_hash = crypto::null_hash;
+    m_block_weights_cache_median.clear();
+  }
+
+  // the long term window ends one below, update_next_cumulative_weight_limit adds the top block
+  if (height >= 2 && on_popped_chain(m_long_term_block_weights_cache_tip_height, m_long_term_block_weights_cache_tip_hash))
+  {
+    rewind_weights_window(m_long_term_block_weights_cache_median, m_long_term_block_weights_cache_tip_height, height - 2,
+        [this](uint64_t h) { return m_db->get_block_long_term_weight(h); });
+    m_long_term_block_weights_cache_tip_hash = m_db->get_block_hash_from_height(height - 2);
+  }
+  else
+  {
+    m_long_term_block_weights_cache_tip_hash = crypto::null_hash;
+    m_long_term_block_weights_cache_median.clear();
+  }
+}
+//------------------------------------------------------------------
+void Blockchain::reset_block_weights_caches()
+{
+  m_block_weights_cache_tip_hash = crypto::null_hash;
+  m_block_weights_cache_median.clear();
+  m_long_term_block_weights_cache_tip_hash = crypto::null_hash;
+  m_long_term_block_weights_cache_median.clear();
+}
+//------------------------------------------------------------------
+void Blockchain::load_block_weights_cache()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
+  const std::string filename = get_block_weights_cache_filename(m_db);
+  if (filename.empty())
+    return;
+
+  block_weights_cache_data data;
+  if (!tools::unserialize_obj_from_file(data, filename))
+    return;
+
+  const uint64_t db_height = m_db->height();
+  if (data.window != m_long_term_block_weights_window || data.tip_height >= db_height ||
+      data.weights.size() != std::min<uint64_t>(data.window, data.tip_height + 1) ||
+      m_db->get_block_hash_from_height(data.tip_height) != data.tip_hash)
+  {
+    MINFO("Saved block weights do not match the chain, ignoring them");
+    return;
+  }
+
+  m_long_term_block_weights_cache_median.clear();
+  for (uint64_t w: data.weights)
+    m_long_term_block_weights_cache_median.push_back(w);
+  m_long_term_block_weights_cache_tip_height = data.tip_height;
+  m_long_term_block_weights_cache_tip_hash = data.tip_hash;
+
+  // saved after the top block was added, step back so it gets added again
+  if (db_height >= 2 && data.tip_height == db_height - 1)
+  {
+    rewind_weights_window(m_long_term_block_weights_cache_median, m_long_term_block_weights_cache_tip_height, db_height - 2,
+        [this](uint64_t h) { return m_db->get_block_long_term_weight(h); });
+    m_long_term_block_weights_cache_tip_hash = m_db->get_block_hash_from_height(db_height - 2);
+  }
+  MINFO("Loaded " << data.weights.size() << " saved long term block weights up to height " << data.tip_height);
+}
+//------------------------------------------------------------------
+void Blockchain::store_block_weights_cache() const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+
+  // a read only db may well be in use by a daemon, which owns the file
+  if (m_db->is_read_only() || m_long_term_block_weights_cache_tip_hash == crypto::null_hash)
+    return;
+  const std::string filename = get_block_weights_cache_filename(m_db);
+  if (filename.empty())
+    return;
+
+  block_weights_cache_data data;
+  data.window = m_long_term_block_weights_window;
+  data.tip_height = m_long_term_block_weights_cache_tip_height;
+  data.tip_hash = m_long_term_block_weights_cache_tip_hash;
+  const auto &weights = m_long_term_block_weights_cache_median.items();
+  data.weights.assign(weights.begin(), weights.end());
+  // write aside and rename, so a reader never sees a partial file
+  const std::string tmp_filename = filename + ".tmp";
+  if (!tools::serialize_obj_to_file(data, tmp_filename))
+  {
+    MWARNING("Failed to save block weights to " << tmp_filename);
+    return;
+  }
+  const std::error_code e = tools::replace_file(tmp_filename, filename);
+  if (e)
+    MWARNING("Failed to move block weights to " << filename << ": " << e.message());
 }
 //------------------------------------------------------------------
 uint64_t Blockchain::get_current_cumulative_block_weight_limit() const
@@ -2302,22 +2617,32 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
   if (parent_in_alt || parent_in_main)
   {
     //we have new block in alternative chain
+    // the alternative chain itself is only walked when it is needed (a
+    // reorg, or a seed block on it), the windows come from its tip's state
     std::list<block_extended_info> alt_chain;
-    std::vector<uint64_t> timestamps;
-    if (!build_alt_chain(b.prev_id, alt_chain, timestamps, bvc))
+    alt_chain_state alt_state;
+    if (!get_alt_chain_state(b.prev_id, parent_in_alt, alt_state, alt_chain, bvc))
       return false;
+    const auto load_alt_chain = [&]() {
+      std::vector<uint64_t> alt_timestamps;
+      return !parent_in_alt || !alt_chain.empty() || build_alt_chain(b.prev_id, alt_chain, alt_timestamps, bvc);
+    };
 
     // FIXME: consider moving away from block_extended_info at some point
     block_extended_info bei = {};
     bei.bl = b;
-    const uint64_t prev_height = alt_chain.size() ? prev_data.height : m_db->get_block_height(b.prev_id);
+    const uint64_t prev_height = parent_in_alt ? prev_data.height : m_db->get_block_height(b.prev_id);
     bei.height = prev_height + 1;
     uint64_t block_reward = get_outs_money_amount(b.miner_tx);
-    const uint64_t prev_generated_coins = alt_chain.size() ? prev_data.already_generated_coins : m_db->get_block_already_generated_coins(prev_height);
+    const uint64_t prev_generated_coins = parent_in_alt ? prev_data.already_generated_coins : m_db->get_block_already_generated_coins(prev_height);
     bei.already_generated_coins = (block_reward < (MONEY_SUPPLY - prev_generated_coins)) ? prev_generated_coins + block_reward : MONEY_SUPPLY;
 
     // verify that the block's timestamp is within the acceptable range
-    // (not earlier than the median of the last X blocks)
+    // (not earlier than the median of the last X blocks, or of the whole
+    // alternative chain once it is longer than that)
+    const size_t alt_blocks = alt_state.height + 1 - alt_state.split_height;
+    const size_t timestamps_count = std::min<size_t>(alt_state.timestamps.size(), std::max<size_t>(alt_blocks, BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW));
+    std::vector<uint64_t> timestamps(alt_state.timestamps.end() - timestamps_count, alt_state.timestamps.end());
     if(!check_block_timestamp(timestamps, b))
     {
       MERROR_VER("Block with id: " << id << std::endl << " for alternative chain, has invalid timestamp: " << b.timestamp);
@@ -2334,7 +2659,7 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     }
 
     // Check the block's hash against the difficulty target for its alt chain
-    difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_chain, bei);
+    difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_state);
     CHECK_AND_ASSERT_MES(current_diff, false, "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!");
     crypto::hash proof_of_work;
     memset(proof_of_work.data, 0xff, sizeof(proof_of_work.data));
@@ -2342,8 +2667,10 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     crypto::hash seedhash = null_hash;
     uint64_t seedheight = rx_seedheight(bei.height);
     // seedblock is on the alt chain somewhere
-    if (alt_chain.size() && alt_chain.front().height <= seedheight)
+    if (parent_in_alt && alt_state.split_height <= seedheight)
     {
+      if (!load_alt_chain())
+        return false;
       for (auto it=alt_chain.begin(); it != alt_chain.end(); it++)
       {
         if (it->height == seedheight+1)
@@ -2383,7 +2710,7 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     // this brings up an interesting point: consider allowing to get block
     // difficulty both by height OR by hash, not just height.
     difficulty_type main_chain_cumulative_difficulty = m_db->get_block_cumulative_difficulty(m_db->height() - 1);
-    if (alt_chain.size())
+    if (parent_in_alt)
     {
       bei.cumulative_difficulty = prev_data.cumulative_difficulty_high;
       bei.cumulative_difficulty = (bei.cumulative_difficulty << 64) + prev_data.cumulative_difficulty_low;
@@ -2442,7 +2769,19 @@ bool Blockchain::handle_alternative_block(const block& b, const crypto::hash& id
     data.cumulative_difficulty_high = ((bei.cumulative_difficulty >> 64) & 0xffffffffffffffff).convert_to<uint64_t>();
     data.already_generated_coins = bei.already_generated_coins;
     m_db->add_alt_block(id, data, cryptonote::block_to_blob(bei.bl));
-    alt_chain.push_back(bei);
+
+    if (!parent_in_alt)
+      alt_state.first_id = id;
+    alt_state.push_block(b.timestamp, bei.cumulative_difficulty);
+    cache_alt_chain_state(id, std::move(alt_state));
+
+    const bool reorganize = is_a_checkpoint || main_chain_cumulative_difficulty < bei.cumulative_difficulty;
+    if (reorganize)
+    {
+      if (!load_alt_chain())
+        return false;
+      alt_chain.push_back(bei);
+    }
 
     // FIXME: is it even possible for a checkpoint to show up not on the main chain?
     if(is_a_checkpoint)
@@ -3799,7 +4138,7 @@ bool Blockchain::expand_transaction_2(transaction &tx, const crypto::hash &tx_pr
 //        check_tx_input() rather than here, and use this function simply
 //        to iterate the inputs as necessary (splitting the task
 //        using threads, etc.)
-bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height) const
+bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height, rct::clsag_batch *clsag_batch, size_t clsag_tag) const
 {
   PERF_TIMER(check_tx_inputs);
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -4076,7 +4415,7 @@ bool Blockchain::check_tx_inputs(transaction& tx, tx_verification_context &tvc,
     case rct::RCTTypeBulletproofPlus:
     case rct::RCTTypeFullProofs:
     {
-      if (!ver_rct_non_semantics_simple_cached(tx, pubkeys, m_rct_ver_cache, RCT_CACHE_TYPE, hf_version))
+      if (!ver_rct_non_semantics_simple_cached(tx, pubkeys, m_rct_ver_cache, RCT_CACHE_TYPE, hf_version, clsag_batch, clsag_tag))
       {
         MERROR_VER("Failed to check ringct signatures!");
         return false;
@@ -4283,12 +4622,32 @@ void Blockchain::get_dynamic_base_fee_estimate_2021_scaling(uint64_t grace_block
   // Ml: penalty free zone (dynamic), aka long_term_median, aka median of max((min(Mb, 1.7 * Ml), Zm), Ml / 1.7)
   // Zm: 300000 (minimum penalty free zone)
   //
-  // So we copy the current rolling median state, add 10 (grace_blocks) zeroes to it, and get back Mlw
+  // So we add 10 (grace_blocks) zeroes to the current long term window, get back Mlw, and take them out again
 
-  epee::misc_utils::rolling_median_t<uint64_t> rm = m_long_term_block_weights_cache_rolling_median;
-  for (size_t i = 0; i < grace_blocks; ++i)
-    rm.insert(0);
-  const uint64_t Mlw_penalty_free_zone_for_wallet = std::max<uint64_t>(rm.median(), CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE_V5);
+  uint64_t Mlw_penalty_free_zone_for_wallet;
+  {
+    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    epee::misc_utils::window_median_t<uint64_t> &rm = m_long_term_block_weights_cache_median;
+    // more zeroes than fit in the window would not change the median
+    const size_t zeroes = std::min<size_t>(grace_blocks, rm.capacity());
+    size_t pushed = 0;
+    std::vector<uint64_t> dropped;
+    dropped.reserve(zeroes);
+    // whatever was pushed is taken out again however this scope is left
+    const auto restore = epee::misc_utils::create_scope_leave_handler([&rm, &pushed, &dropped]() {
+      for (; pushed > 0; --pushed)
+        rm.pop_back();
+      for (auto i = dropped.rbegin(); i != dropped.rend(); ++i)
+        rm.push_front(*i);
+    });
+    for (; pushed < zeroes; ++pushed)
+    {
+      if (rm.full())
+        dropped.push_back(rm.front());
+      rm.push_back(0);
+    }
+    Mlw_penalty_free_zone_for_wallet = std::max<uint64_t>(rm.median(), CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE_V5);
+  }
 
   // Msw: median over [100 - grace blocks] past + [grace blocks] future blocks
   CHECK_AND_ASSERT_THROW_MES(grace_blocks <= 100, "Grace blocks invalid In 2021 fee scaling estimate.");
@@ -4883,6 +5242,7 @@ leave:
 
   std::vector<std::pair<transaction, blobdata>> txs;
   key_images_container keys;
+  rct::clsag_batch clsag_batch;
 
   uint64_t fee_summary = 0;
   uint64_t t_checktx = 0;
@@ -4963,8 +5323,9 @@ leave:
 #endif
     {
       // validate that transaction inputs and the keys spending them are correct.
+      // ring signatures are only queued here and checked for the whole block below
       tx_verification_context tvc;
-      if(!check_tx_inputs(tx, tvc))
+      if(!check_tx_inputs(tx, tvc, NULL, &clsag_batch, txs.size() - 1))
       {
         MERROR_VER("Block with id: " << id  << " has at least one transaction (id: " << tx_id << ") with wrong inputs.");
 
@@ -5001,6 +5362,25 @@ leave:
     cumulative_block_weight += tx_weight;
   }
 
+  if (!clsag_batch.empty())
+  {
+    TIME_MEASURE_START(cl);
+    std::vector<size_t> failed_txs;
+    if (!clsag_batch.verify(&failed_txs))
+    {
+      for (size_t idx: failed_txs)
+        MERROR_VER("Block with id: " << id  << " has at least one transaction (id: " << bl.tx_hashes[idx] << ") with wrong inputs.");
+
+      add_block_as_invalid(bl, id);
+      MERROR_VER("Block with id " << id << " added as invalid because of wrong ring signatures in transactions");
+      bvc.m_verifivation_failed = true;
+      return_tx_to_pool(txs);
+      goto leave;
+    }
+    TIME_MEASURE_FINISH(cl);
+    t_checktx += cl;
+  }
+
   // if we were syncing pruned blocks
   if (n_pruned > 0)
   {
@@ -5219,6 +5599,7 @@ bool Blockchain::update_next_cumulative_weight_limit(uint64_t *long_term_effecti
   uint64_t full_reward_zone = get_min_block_weight(hf_version);
 
   const uint64_t block_weight = m_db->get_block_weight(db_height - 1);
+  const crypto::hash top_hash = m_db->get_block_hash_from_height(db_height - 1);
 
   uint64_t long_term_median;
   if (db_height == 1)
@@ -5245,16 +5626,33 @@ bool Blockchain::update_next_cumulative_weight_limit(uint64_t *long_term_effecti
   }
   else
   {
-    m_long_term_block_weights_cache_tip_hash = m_db->get_block_hash_from_height(db_height - 1);
-    m_long_term_block_weights_cache_rolling_median.insert(long_term_block_weight);
-    long_term_median = m_long_term_block_weights_cache_rolling_median.median();
+    m_long_term_block_weights_cache_tip_hash = top_hash;
+    m_long_term_block_weights_cache_tip_height = db_height - 1;
+    m_long_term_block_weights_cache_median.push_back(long_term_block_weight);
+    long_term_median = m_long_term_block_weights_cache_median.median();
   }
   m_long_term_effective_median_block_weight = std::max<uint64_t>(CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE_V5, long_term_median);
-  
-  std::vector<uint64_t> weights;
-  get_last_n_blocks_weights(weights, CRYPTONOTE_REWARD_BLOCKS_WINDOW);
-  
-  uint64_t short_term_median = epee::misc_utils::median(weights);
+
+  // the short term window normally just moves up by the top block
+  if (m_block_weights_cache_tip_hash != top_hash)
+  {
+    if (db_height >= 2 && m_block_weights_cache_tip_height == db_height - 2 && m_block_weights_cache_tip_hash == m_db->get_block_hash_from_height(db_height - 2))
+    {
+      m_block_weights_cache_median.push_back(block_weight);
+    }
+    else
+    {
+      std::vector<uint64_t> weights;
+      get_last_n_blocks_weights(weights, CRYPTONOTE_REWARD_BLOCKS_WINDOW);
+      m_block_weights_cache_median.clear();
+      for (uint64_t w: weights)
+        m_block_weights_cache_median.push_back(w);
+    }
+    m_block_weights_cache_tip_hash = top_hash;
+    m_block_weights_cache_tip_height = db_height - 1;
+  }
+
+  uint64_t short_term_median = m_block_weights_cache_median.median();
   uint64_t effective_median_block_weight;
   // effective median = short_term_median bounded to range [long_term_median, 50*long_term_median], but it can't be smaller than the
   // minimum penalty free zone (a.k.a. 'full reward zone')
@@ -5276,6 +5674,48 @@ bool Blockchain::update_next_cumulative_weight_limit(uint64_t *long_term_effecti
   return true;
 }
 //------------------------------------------------------------------
+void Blockchain::update_tip_snapshot()
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  try
+  {
+    db_rtxn_guard rtxn_guard(m_db);
+    if (m_db->height() == 0)
+      return;
+
+    std::shared_ptr<tip_snapshot> snapshot = std::make_shared<tip_snapshot>();
+    uint64_t top_height;
+    snapshot->top_hash = m_db->top_block_hash(&top_height);
+    snapshot->height = top_height + 1;
+    snapshot->top_block = m_db->get_top_block();
+    snapshot->top_difficulty = block_difficulty(top_height);
+    snapshot->top_cumulative_difficulty = m_db->get_block_cumulative_difficulty(top_height);
+    snapshot->top_weight = m_db->get_block_weight(top_height);
+    snapshot->top_long_term_weight = m_db->get_block_long_term_weight(top_height);
+    snapshot->next_difficulty = get_difficulty_for_next_block();
+    snapshot->total_transactions = m_db->get_tx_count();
+    snapshot->alt_blocks_count = m_db->get_alt_block_count();
+    snapshot->block_weight_limit = m_current_block_cumul_weight_limit;
+    snapshot->block_weight_median = m_current_block_cumul_weight_median;
+    snapshot->adjusted_time = get_adjusted_time(snapshot->height);
+    snapshot->fee_grace_blocks = TIP_SNAPSHOT_FEE_GRACE_BLOCKS;
+    get_dynamic_base_fee_estimate_2021_scaling(snapshot->fee_grace_blocks, snapshot->fees);
+
+    std::atomic_store(&m_tip_snapshot, std::shared_ptr<const tip_snapshot>(std::move(snapshot)));
+  }
+  catch (const std::exception &e)
+  {
+    MERROR("Failed to update chain tip snapshot: " << e.what());
+  }
+}
+//------------------------------------------------------------------
+std::shared_ptr<const Blockchain::tip_snapshot> Blockchain::get_tip_snapshot() const
+{
+  return std::atomic_load(&m_tip_snapshot);
+}
+//------------------------------------------------------------------
 bool Blockchain::add_new_block(const block& bl, block_verification_context& bvc)
 {
   try
@@ -5446,6 +5886,9 @@ bool Blockchain::cleanup_handle_incoming_blocks(bool force_sync)
     MERROR("Exception in cleanup_handle_incoming_blocks: " << e.what());
   }
 
+  if (success)
+    update_tip_snapshot();
+
   if (success && m_sync_counter > 0)
   {
     if (force_sync)
@@ -5718,49 +6161,33 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::vector<block_complete
     unsigned int extra = blocks_entry.size() % threads;
     MDEBUG("block_batches: " << batches);
     std::vector<std::unordered_map<crypto::hash, crypto::hash>> maps(threads);
-    auto it = blocks_entry.begin();
-    unsigned blockidx = 0;
 
-    const crypto::hash tophash = m_db->top_block_hash();
-    for (unsigned i = 0; i < threads; i++)
+    // parse the whole span first, so the block hashes can be taken in one batch
+    for (size_t blockidx = 0; blockidx < blocks_entry.size(); ++blockidx)
     {
-      for (unsigned int j = 0; j < batches; j++, ++blockidx)
-      {
-        block &block = blocks[blockidx];
-        crypto::hash block_hash;
-
-        if (!parse_and_validate_block_from_blob(it->block, block, block_hash))
-          return false;
-
-        // check first block and skip all blocks if its not chained properly
-        if (blockidx == 0)
-        {
-          if (block.prev_id != tophash)
-          {
-            MDEBUG("Skipping prepare blocks. New blocks don't belong to chain.");
-            blocks.clear();
-            return true;
-          }
-        }
-        if (have_block(block_hash))
-          blocks_exist = true;
-
-        std::advance(it, 1);
-      }
+      if (!parse_and_validate_block_from_blob(blocks_entry[blockidx].block, blocks[blockidx]))
+        return false;
     }
+    std::vector<crypto::hash> block_hashes;
+    if (!get_block_hashes(blocks, block_hashes))
+      return false;
 
-    for (unsigned i = 0; i < extra && !blocks_exist; i++, blockidx++)
+    // check first block and skip all blocks if its not chained properly
+    const crypto::hash tophash = m_db->top_block_hash();
+    if (batches > 0 && blocks[0].prev_id != tophash)
     {
-      block &block = blocks[blockidx];
-      crypto::hash block_hash;
-
-      if (!parse_and_validate_block_from_blob(it->block, block, block_hash))
-        return false;
+      MDEBUG("Skipping prepare blocks. New blocks don't belong to chain.");
+      blocks.clear();
+      return true;
+    }
 
+    for (const crypto::hash &block_hash: block_hashes)
+    {
       if (have_block(block_hash))
+      {
         blocks_exist = true;
-
-      std::advance(it, 1);
+        break;
+      }
     }
 
     if (!blocks_exist)
@@ -42,14 +42,16 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <atomic>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "span.h"
 #include "syncobj.h"
 #include "string_tools.h"
-#include "rolling_median.h"
+#include "window_median.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "common/powerof.h"
 #include "common/util.h"
@@ -112,6 +114,32 @@ namespace cryptonote
       uint64_t already_generated_coins; //!< the total coins minted after that block
     };
 
+    /**
+     * @brief immutable summary of the chain tip
+     *
+     * A new one is published every time the tip changes, and readers get it
+     * through get_tip_snapshot() without taking the blockchain lock or
+     * opening a database transaction.
+     */
+    struct tip_snapshot
+    {
+      uint64_t height; //!< the blockchain height, ie top block height + 1
+      crypto::hash top_hash; //!< the hash of the top block
+      block top_block; //!< the top block
+      difficulty_type top_difficulty; //!< the difficulty of the top block
+      difficulty_type top_cumulative_difficulty; //!< the accumulated difficulty after the top block
+      uint64_t top_weight; //!< the weight of the top block
+      uint64_t top_long_term_weight; //!< the long term weight of the top block
+      difficulty_type next_difficulty; //!< the difficulty the next block must meet
+      uint64_t total_transactions; //!< the number of transactions in the chain, coinbase included
+      uint64_t alt_blocks_count; //!< the number of alternative blocks stored
+      uint64_t block_weight_limit; //!< the cumulative block weight limit for the next block
+      uint64_t block_weight_median; //!< the cumulative block weight median for the next block
+      uint64_t adjusted_time; //!< the adjusted time for the next block
+      uint64_t fee_grace_blocks; //!< the number of grace blocks fees was estimated for
+      std::vector<uint64_t> fees; //!< the 2021 scaling fee estimate for fee_grace_blocks
+    };
+
     /**
      * @brief Blockchain constructor
      *
@@ -340,6 +368,16 @@ namespace cryptonote
      */
     difficulty_type get_difficulty_for_next_block();
 
+    /**
+     * @brief get the most recently published chain tip snapshot
+     *
+     * This does not take m_blockchain_lock nor touch the database, so it
+     * will not block behind block processing.
+     *
+     * @return the snapshot, or an empty pointer before the blockchain is initialized
+     */
+    std::shared_ptr<const tip_snapshot> get_tip_snapshot() const;
+
     /**
      * @brief check currently stored difficulties against difficulty checkpoints
      *
@@ -1220,6 +1258,26 @@ namespace cryptonote
 
     typedef std::unordered_map<crypto::hash, block_extended_info> blocks_ext_by_hash;
 
+    /**
+     * @brief the timestamp and difficulty window ending at an alternative block
+     *
+     * Kept for recent alternative chain tips, so that a block extending one
+     * of them does not need to walk the alternative chain back to the main
+     * chain and reload the main chain blocks below the split.
+     */
+    struct alt_chain_state
+    {
+      crypto::hash split_prev_id; //!< the main chain block the alternative chain branches off
+      crypto::hash first_id; //!< the first block of the alternative chain, null if it has none yet
+      uint64_t split_height; //!< the height of the first block of the alternative chain
+      uint64_t height; //!< the height of the tip, split_height - 1 if the chain has no blocks yet
+      size_t window; //!< the number of blocks kept below the tip for the difficulty and timestamp checks
+      std::vector<uint64_t> timestamps; //!< up to window main chain blocks below the split, then all of the alternative chain
+      std::vector<difficulty_type> cumulative_difficulties; //!< the last window blocks
+
+      void push_block(uint64_t timestamp, const difficulty_type &cumulative_difficulty);
+    };
+
 
     BlockchainDB* m_db;
 
@@ -1257,13 +1315,27 @@ namespace cryptonote
     bool m_reset_timestamps_and_difficulties_height;
     uint64_t m_long_term_block_weights_window;
     uint64_t m_long_term_effective_median_block_weight;
+    // long term weights of the blocks up to the cache tip, as used for the
+    // long term median; rewound rather than rebuilt when blocks are popped
     mutable crypto::hash m_long_term_block_weights_cache_tip_hash;
-    mutable epee::misc_utils::rolling_median_t<uint64_t> m_long_term_block_weights_cache_rolling_median;
+    mutable uint64_t m_long_term_block_weights_cache_tip_height;
+    mutable epee::misc_utils::window_median_t<uint64_t> m_long_term_block_weights_cache_median;
+    // weights of the last CRYPTONOTE_REWARD_BLOCKS_WINDOW blocks up to the cache tip
+    crypto::hash m_block_weights_cache_tip_hash;
+    uint64_t m_block_weights_cache_tip_height;
+    epee::misc_utils::window_median_t<uint64_t> m_block_weights_cache_median;
 
     epee::critical_section m_difficulty_lock;
     crypto::hash m_difficulty_for_next_block_top_hash;
     difficulty_type m_difficulty_for_next_block;
 
+    // recent alternative chain tips, oldest first in m_alt_chain_states_order
+    std::unordered_map<crypto::hash, alt_chain_state> m_alt_chain_states;
+    std::deque<crypto::hash> m_alt_chain_states_order;
+
+    // only ever accessed through std::atomic_load/std::atomic_store
+    std::shared_ptr<const tip_snapshot> m_tip_snapshot;
+
     boost::asio::io_service m_async_service;
     boost::thread_group m_async_pool;
     std::unique_ptr<boost::asio::io_service::work> m_async_work_idle;
@@ -1378,13 +1450,18 @@ namespace cryptonote
      * Currently this function calls ring signature validation for each
      * transaction.
      *
+     * If clsag_batch is not NULL, CLSAG ring signatures are queued on it under
+     * clsag_tag instead, and only count as checked once the batch verifies.
+     *
      * @param tx the transaction to validate
      * @param tvc returned information about tx verification
      * @param pmax_related_block_height return-by-pointer the height of the most recent block in the input set
+     * @param clsag_batch optional batch to defer CLSAG verification to
+     * @param clsag_tag tag for this transaction's entries in clsag_batch
      *
      * @return false if any validation step fails, otherwise true
      */
-    bool check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height = NULL) const;
+    bool check_tx_inputs(transaction& tx, tx_verification_context &tvc, uint64_t* pmax_used_block_height = NULL, rct::clsag_batch *clsag_batch = NULL, size_t clsag_tag = 0) const;
 
     /**
      * @brief performs a blockchain reorganization according to the longest chain rule
@@ -1475,6 +1552,42 @@ namespace cryptonote
      */
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<block_extended_info>& alt_chain, block_extended_info& bei) const;
 
+    /**
+     * @brief gets the difficulty requirement for a new block on an alternate chain
+     *
+     * Same as the above, from the window cached for the chain's tip.
+     *
+     * @param state the state of the chain to be added to
+     *
+     * @return the difficulty requirement
+     */
+    difficulty_type get_next_difficulty_for_alternative_chain(const alt_chain_state &state) const;
+
+    /**
+     * @brief gets the timestamp and difficulty window ending at a block
+     *
+     * Uses the cached state when prev_id is a recent alternative chain tip
+     * whose split from the main chain is still valid, and builds it from
+     * the database otherwise.
+     *
+     * @param prev_id the hash of the block the next block will be added to
+     * @param parent_in_alt whether prev_id is an alternative block
+     * @param state return-by-reference the window ending at prev_id
+     * @param alt_chain return-by-reference the alternative chain, if it had to be built
+     * @param bvc the block verification context for error return
+     *
+     * @return true on success, false otherwise
+     */
+    bool get_alt_chain_state(const crypto::hash &prev_id, bool parent_in_alt, alt_chain_state &state, std::list<block_extended_info> &alt_chain, block_verification_context& bvc) const;
+
+    /**
+     * @brief remembers the window ending at a new alternative block
+     *
+     * @param id the hash of the new alternative block
+     * @param state the window ending at it
+     */
+    void cache_alt_chain_state(const crypto::hash &id, alt_chain_state &&state);
+
     /**
      * @brief sanity checks a miner transaction before validating an entire block
      *
@@ -1572,6 +1685,35 @@ namespace cryptonote
      */
     uint64_t get_long_term_block_weight_median(uint64_t start_height, size_t count) const;
 
+    /**
+     * @brief rewinds the block weight caches past a block that was just popped
+     *
+     * Each cache drops its newest entry and takes back the weight of the block
+     * which reenters its window at the bottom, so that it is left where it was
+     * before the popped block was added. Caches which are not on the popped
+     * block's chain are dropped, to be reloaded from the db on next use.
+     *
+     * @param popped_block the block just popped from the top of the chain
+     */
+    void rewind_block_weights_caches(const block &popped_block);
+
+    /**
+     * @brief drops the block weight caches, to be reloaded from the db on next use
+     */
+    void reset_block_weights_caches();
+
+    /**
+     * @brief loads the long term block weights cache saved by store_block_weights_cache
+     *
+     * The saved cache is only used if its tip is still on the main chain.
+     */
+    void load_block_weights_cache();
+
+    /**
+     * @brief saves the long term block weights cache next to the db, so restarts do not reload it
+     */
+    void store_block_weights_cache() const;
+
     /**
      * @brief checks if a transaction is unlocked (its outputs spendable)
      *
@@ -1665,6 +1807,14 @@ namespace cryptonote
      * @return true
      */
     bool update_next_cumulative_weight_limit(uint64_t *long_term_effective_median_block_weight = NULL);
+
+    /**
+     * @brief build a snapshot of the current chain tip and publish it
+     *
+     * Called with the tip committed to the database, after blocks are added
+     * or popped. Failures are logged and leave the previous snapshot in place.
+     */
+    void update_tip_snapshot();
     void return_tx_to_pool(std::vector<std::pair<transaction, blobdata>> &txs);
 
     /**
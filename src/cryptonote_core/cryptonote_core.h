@@ -70,6 +70,8 @@ namespace cryptonote
   extern const command_line::arg_descriptor<bool> arg_offline;
   extern const command_line::arg_descriptor<size_t> arg_block_download_max_size;
   extern const command_line::arg_descriptor<bool> arg_sync_pruned_blocks;
+  extern const command_line::arg_descriptor<unsigned> arg_sync_span_target_seconds;
+  extern const command_line::arg_descriptor<size_t> arg_block_sync_size;
 
   /************************************************************************/
   /*                                                                      */
@@ -647,6 +647,24 @@ namespace cryptonote
     return addr.m_view_public_key;
   }
   //---------------------------------------------------------------
+  bool is_burnt_destination(const tx_destination_entry& dst, const cryptonote::transaction_type& tx_type, const std::string& dest_asset)
+  {
+    if (tx_type == cryptonote::transaction_type::BURN || tx_type == cryptonote::transaction_type::CONVERT)
+      return dst.asset_type == dest_asset;
+    if (tx_type == cryptonote::transaction_type::STAKE)
+      return !dst.is_change;
+    return false;
+  }
+  //---------------------------------------------------------------
+  uint64_t get_burnt_amount(const std::vector<tx_destination_entry>& destinations, const cryptonote::transaction_type& tx_type, const std::string& dest_asset)
+  {
+    uint64_t amount_burnt = 0;
+    for (const auto &dst: destinations)
+      if (is_burnt_destination(dst, tx_type, dest_asset))
+        amount_burnt += dst.amount;
+    return amount_burnt;
+  }
+  //---------------------------------------------------------------
   bool construct_tx_with_tx_key(const account_keys& sender_account_keys, const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses, std::vector<tx_source_entry>& sources, std::vector<tx_destination_entry>& destinations, const uint8_t hf_version, const std::string& source_asset, const std::string& dest_asset, const cryptonote::transaction_type& tx_type, const boost::optional<cryptonote::account_public_address>& change_addr, const std::vector<uint8_t> &extra, transaction& tx, uint64_t unlock_time, const crypto::secret_key &tx_key, const std::vector<crypto::secret_key> &additional_tx_keys, bool rct, const rct::RCTConfig &rct_config, bool shuffle_outs, bool use_view_tags)
   {
     hw::device &hwdev = sender_account_keys.get_device();
@@ -867,20 +885,13 @@ namespace cryptonote
       crypto::public_key out_eph_public_key;
       crypto::view_tag view_tag;
 
-      // Is this a BURN or CONVERT TX?
-      if (tx_type == cryptonote::transaction_type::BURN || tx_type == cryptonote::transaction_type::CONVERT) {
-        // Do not create outputs that are for the destination asset type - discard them as unused
-        if (dst_entr.asset_type == dest_asset) {
-          tx.amount_burnt += dst_entr.amount;
+      // Do not create outputs for the destination asset type of a BURN or CONVERT TX, or for
+      // the amounts staked for yield by a STAKE TX - discard them as unused
+      if (is_burnt_destination(dst_entr, tx_type, dest_asset)) {
+        tx.amount_burnt += dst_entr.amount;
+        if (tx_type != cryptonote::transaction_type::STAKE)
           tx.amount_slippage_limit = dst_entr.slippage_limit;
-          continue;
-        }
-      } else if (tx_type == cryptonote::transaction_type::STAKE) {
-        // Do not create outputs that are staked for yield - discard them as unused
-        if (!dst_entr.is_change) {
-          tx.amount_burnt += dst_entr.amount;
-          continue;
-        }
+        continue;
       }
 
       // Check to see if this is the change output
@@ -168,6 +168,9 @@ namespace cryptonote
   };
 
   //---------------------------------------------------------------
+  // BURN and CONVERT txes burn their destination asset entries, STAKE txes burn every entry but the change
+  bool is_burnt_destination(const tx_destination_entry& dst, const cryptonote::transaction_type& tx_type, const std::string& dest_asset);
+  uint64_t get_burnt_amount(const std::vector<tx_destination_entry>& destinations, const cryptonote::transaction_type& tx_type, const std::string& dest_asset);
   crypto::public_key get_destination_view_key_pub(const std::vector<tx_destination_entry> &destinations, const boost::optional<cryptonote::account_public_address>& change_addr);
   bool construct_tx(const account_keys& sender_account_keys, std::vector<tx_source_entry> &sources, const std::vector<tx_destination_entry>& destinations, const uint8_t hf_version, const std::string& asset_type, const cryptonote::transaction_type& tx_type, const boost::optional<cryptonote::account_public_address>& change_addr, const std::vector<uint8_t> &extra, transaction& tx, uint64_t unlock_time);
 
@@ -38,7 +38,7 @@
 using namespace cryptonote;
 
 // Do RCT expansion, then do post-expansion sanity checks, then do full non-semantics verification.
-static bool expand_tx_and_ver_rct_non_sem(transaction& tx, const rct::ctkeyM& mix_ring, uint8_t hf_version)
+static bool expand_tx_and_ver_rct_non_sem(transaction& tx, const rct::ctkeyM& mix_ring, uint8_t hf_version, rct::clsag_batch *clsag_batch, size_t clsag_tag)
 {
     // Pruned transactions can not be expanded and verified because they are missing RCT data
     VER_ASSERT(!tx.pruned, "Pruned transaction will not pass verRctNonSemanticsSimple");
@@ -79,6 +79,8 @@ static bool expand_tx_and_ver_rct_non_sem(transaction& tx, const rct::ctkeyM& mi
     }
 
     // Mix ring data is now known to be correctly incorporated into the RCT sig inside tx.
+    if (clsag_batch)
+        return rct::verRctNonSemanticsSimpleBatched(rv, *clsag_batch, clsag_tag);
     return rct::verRctNonSemanticsSimple(rv);
 }
 
@@ -116,7 +118,9 @@ bool ver_rct_non_semantics_simple_cached
     const rct::ctkeyM& mix_ring,
     rct_ver_cache_t& cache,
     const std::uint8_t rct_type_to_cache,
-    uint8_t hf_version
+    uint8_t hf_version,
+    rct::clsag_batch *clsag_batch,
+    size_t clsag_tag
 )
 {
     // Hello future Monero dev! If you got this assert, read the following carefully:
@@ -139,7 +143,7 @@ bool ver_rct_non_semantics_simple_cached
     if (tx.rct_signatures.type != rct_type_to_cache)
     {
         MDEBUG("RCT cache: tx " << get_transaction_hash(tx) << " skipped");
-        return expand_tx_and_ver_rct_non_sem(tx, mix_ring, hf_version);
+        return expand_tx_and_ver_rct_non_sem(tx, mix_ring, hf_version, clsag_batch, clsag_tag);
     }
 
     // Generate unique hash for tx+mix_ring pair
@@ -154,11 +158,17 @@ bool ver_rct_non_semantics_simple_cached
 
     // We had a cache miss, so now we must expand the mix ring and do full verification
     MDEBUG("RCT cache: tx " << get_transaction_hash(tx) << " missed");
-    if (!expand_tx_and_ver_rct_non_sem(tx, mix_ring, hf_version))
+    if (!expand_tx_and_ver_rct_non_sem(tx, mix_ring, hf_version, clsag_batch, clsag_tag))
     {
         return false;
     }
 
+    // Deferred signatures are not verified yet, so they must not be cached
+    if (clsag_batch)
+    {
+        return true;
+    }
+
     // At this point, the TX RCT verified successfully, so add it to the cache and return true
     cache.add(tx_mixring_hash);
 
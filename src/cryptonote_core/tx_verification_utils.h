@@ -30,6 +30,7 @@
 
 #include "common/data_cache.h"
 #include "cryptonote_basic/cryptonote_basic.h"
+#include "ringct/rctSigs.h"
 
 namespace cryptonote
 {
@@ -60,11 +61,17 @@ using rct_ver_cache_t = ::tools::data_cache<::crypto::hash, RCT_VER_CACHE_SIZE>;
  * this RCT version, but for most applications, it doesn't make sense to not make this version
  * the "current" RCT version (i.e. the version that transactions in the mempool are).
  *
+ * If clsag_batch is given, a CLSAG transaction that misses the cache has its ring signatures
+ * queued on it under clsag_tag rather than checked, and is not added to the cache. The caller
+ * must then run clsag_batch->verify() before relying on the result.
+ *
  * @param tx transaction which contains RCT signature to verify
  * @param mix_ring mixring referenced by this tx. THIS DATA MUST BE PREVIOUSLY VALIDATED
  * @param cache saves tx+mixring hashes used to cache calls
  * @param rct_type_to_cache Only RCT sigs with version (e.g. RCTTypeBulletproofPlus) will be cached
  * @param hf_version the hard fork version currently in use on the chain
+ * @param clsag_batch optional batch to defer CLSAG verification to
+ * @param clsag_tag tag for this tx's entries in clsag_batch
  * @return true when verRctNonSemanticsSimple() w/ expanded tx.rct_signatures would return true
  * @return false when verRctNonSemanticsSimple() w/ expanded tx.rct_signatures would return false
  */
@@ -74,7 +81,9 @@ bool ver_rct_non_semantics_simple_cached
     const rct::ctkeyM& mix_ring,
     rct_ver_cache_t& cache,
     std::uint8_t rct_type_to_cache,
-    uint8_t hf_version
+    uint8_t hf_version,
+    rct::clsag_batch *clsag_batch = NULL,
+    size_t clsag_tag = 0
 );
 
 } // namespace cryptonote
@@ -40,6 +40,12 @@
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "cn.block_queue"
 
+#define PEER_STATS_DECAY 0.3 // weight of the latest span in the moving averages
+#define PEER_STATS_MIN_SPANS 2 // spans needed before the model is trusted
+#define SPAN_MAX_GROWTH 2 // a peer's next span is at most this many times its last one
+#define SPAN_OVERDUE_FACTOR 3 // a span is overdue after this many times its expected time
+#define SPAN_OVERDUE_MIN_SECONDS 2
+
 namespace std {
   static_assert(sizeof(size_t) <= sizeof(boost::uuids::uuid), "boost::uuids::uuid too small");
   template<> struct hash<boost::uuids::uuid> {
@@ -540,4 +546,95 @@ bool block_queue::foreach(std::function<bool(const span&)> f) const
   return true;
 }
 
+void block_queue::record_span_download(const boost::uuids::uuid &connection_id, uint64_t nblocks, size_t size, double seconds)
+{
+  if (nblocks == 0 || size == 0 || seconds <= 0)
+    return;
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  peer_stats &ps = peers[connection_id];
+  const double a = ps.spans ? PEER_STATS_DECAY : 1.0;
+  const double s = size;
+  ps.mean_size = (1 - a) * ps.mean_size + a * s;
+  ps.mean_time = (1 - a) * ps.mean_time + a * seconds;
+  ps.mean_size2 = (1 - a) * ps.mean_size2 + a * s * s;
+  ps.mean_size_time = (1 - a) * ps.mean_size_time + a * s * seconds;
+  ps.block_size = (1 - a) * ps.block_size + a * s / nblocks;
+  ps.last_nblocks = nblocks;
+  ++ps.spans;
+
+  // least squares fit of time = latency + size / bandwidth; while spans are
+  // all about the same size, the latency can't be told apart, so it's 0
+  const double var_size = ps.mean_size2 - ps.mean_size * ps.mean_size;
+  const double cov = ps.mean_size_time - ps.mean_size * ps.mean_time;
+  double seconds_per_byte = ps.mean_time / ps.mean_size;
+  double latency = 0;
+  if (var_size > 1e-3 * ps.mean_size * ps.mean_size && cov > 0)
+  {
+    seconds_per_byte = cov / var_size;
+    latency = ps.mean_time - seconds_per_byte * ps.mean_size;
+    if (latency < 0)
+    {
+      latency = 0;
+      seconds_per_byte = ps.mean_time / ps.mean_size;
+    }
+  }
+  ps.bandwidth = 1.0 / seconds_per_byte;
+  ps.latency = latency;
+  MDEBUG("Peer " << connection_id << ": " << ps.bandwidth / 1024 << " kB/s, " << ps.latency * 1000 << " ms latency, " << ps.block_size << " bytes/block after " << ps.spans << " spans");
+}
+
+void block_queue::forget_peer(const boost::uuids::uuid &connection_id)
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  peers.erase(connection_id);
+}
+
+bool block_queue::get_peer_stats(const boost::uuids::uuid &connection_id, peer_stats &stats) const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  const auto i = peers.find(connection_id);
+  if (i == peers.end())
+    return false;
+  stats = i->second;
+  return true;
+}
+
+uint64_t block_queue::get_adaptive_span_size(const boost::uuids::uuid &connection_id, uint64_t default_blocks, uint64_t max_blocks, double target_seconds) const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  default_blocks = std::min(default_blocks, max_blocks);
+  const auto i = peers.find(connection_id);
+  if (i == peers.end() || i->second.spans < PEER_STATS_MIN_SPANS || target_seconds <= 0)
+    return default_blocks;
+  const peer_stats &ps = i->second;
+  const double transfer_seconds = std::max(target_seconds - ps.latency, 0.0);
+  uint64_t nblocks = transfer_seconds * ps.bandwidth / ps.block_size;
+  nblocks = std::min<uint64_t>(nblocks, ps.last_nblocks * SPAN_MAX_GROWTH);
+  nblocks = std::max<uint64_t>(1, std::min(max_blocks, nblocks));
+  MTRACE("Adaptive span size for " << connection_id << ": " << nblocks);
+  return nblocks;
+}
+
+bool block_queue::is_next_span_overdue(const boost::uuids::uuid &connection_id, const boost::posix_time::ptime &request_time, boost::posix_time::ptime now) const
+{
+  boost::unique_lock<boost::recursive_mutex> lock(mutex);
+  if (request_time == boost::date_time::min_date_time)
+    return false;
+  // the span may have been filled or dropped since it was looked up
+  block_map::const_iterator i = blocks.begin();
+  while (i != blocks.end() && (i->connection_id != connection_id || i->time != request_time))
+    ++i;
+  if (i == blocks.end() || !i->blocks.empty())
+    return false;
+  const auto p = peers.find(connection_id);
+  if (p == peers.end() || p->second.spans < PEER_STATS_MIN_SPANS)
+    return false;
+  const double expected = p->second.expected_seconds(i->nblocks);
+  const double elapsed = (now - request_time).total_microseconds() / 1e6;
+  if (elapsed < std::max<double>(SPAN_OVERDUE_MIN_SECONDS, SPAN_OVERDUE_FACTOR * expected))
+    return false;
+  MDEBUG("Span " << i->start_block_height << " from " << connection_id << " overdue: " << elapsed << " seconds, expected " << expected);
+  return true;
+}
+
 }
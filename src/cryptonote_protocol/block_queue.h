@@ -34,6 +34,8 @@
 #include <vector>
 #include <set>
 #include <unordered_set>
+#include <unordered_map>
+#include <boost/functional/hash.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/uuid/uuid.hpp>
 #include "net/net_utils_base.h"
@@ -69,6 +71,23 @@ namespace cryptonote
     };
     typedef std::set<span> block_map;
 
+    // Per connection download model: the time to get a span of S bytes is
+    // fitted as latency + S / bandwidth over the spans the peer delivered
+    struct peer_stats
+    {
+      uint64_t spans;
+      double bandwidth; // bytes per second
+      double latency; // seconds
+      double block_size; // average bytes per block
+      uint64_t last_nblocks;
+
+      // moving averages the fit is derived from
+      double mean_size, mean_time, mean_size2, mean_size_time;
+
+      peer_stats(): spans(0), bandwidth(0), latency(0), block_size(0), last_nblocks(0), mean_size(0), mean_time(0), mean_size2(0), mean_size_time(0) {}
+      double expected_seconds(uint64_t nblocks) const { return latency + nblocks * block_size / bandwidth; }
+    };
+
   public:
     void add_blocks(uint64_t height, std::vector<cryptonote::block_complete_entry> bcel, const boost::uuids::uuid &connection_id, const epee::net_utils::network_address &addr, float rate, size_t size);
     void add_blocks(uint64_t height, uint64_t nblocks, const boost::uuids::uuid &connection_id, const epee::net_utils::network_address &addr, boost::posix_time::ptime time = boost::date_time::min_date_time);
@@ -96,6 +115,11 @@ namespace cryptonote
     float get_speed(const boost::uuids::uuid &connection_id) const;
     float get_download_rate(const boost::uuids::uuid &connection_id) const;
     bool foreach(std::function<bool(const span&)> f) const;
+    void record_span_download(const boost::uuids::uuid &connection_id, uint64_t nblocks, size_t size, double seconds);
+    void forget_peer(const boost::uuids::uuid &connection_id);
+    bool get_peer_stats(const boost::uuids::uuid &connection_id, peer_stats &stats) const;
+    uint64_t get_adaptive_span_size(const boost::uuids::uuid &connection_id, uint64_t default_blocks, uint64_t max_blocks, double target_seconds) const;
+    bool is_next_span_overdue(const boost::uuids::uuid &connection_id, const boost::posix_time::ptime &request_time, boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time()) const;
     bool requested(const crypto::hash &hash) const;
     bool have(const crypto::hash &hash) const;
 
@@ -108,5 +132,6 @@ namespace cryptonote
     mutable boost::recursive_mutex mutex;
     std::unordered_set<crypto::hash> requested_hashes;
     std::unordered_set<crypto::hash> have_blocks;
+    std::unordered_map<boost::uuids::uuid, peer_stats, boost::hash<boost::uuids::uuid>> peers;
   };
 }
@@ -110,6 +110,12 @@ namespace cryptonote
 
     m_block_download_max_size = command_line::get_arg(vm, cryptonote::arg_block_download_max_size);
     m_sync_pruned_blocks = command_line::get_arg(vm, cryptonote::arg_sync_pruned_blocks);
+    m_sync_span_target_seconds = command_line::get_arg(vm, cryptonote::arg_sync_span_target_seconds);
+    if (m_sync_span_target_seconds && command_line::get_arg(vm, cryptonote::arg_block_sync_size))
+    {
+      MINFO("--block-sync-size is set, not sizing block download spans from peer throughput");
+      m_sync_span_target_seconds = 0;
+    }
 
     return true;
   }
@@ -1323,6 +1329,7 @@ namespace cryptonote
       const float rate = size * 1e6 / (dt.total_microseconds() + 1);
       MDEBUG(context << " adding span: " << arg.blocks.size() << " at height " << start_height << ", " << dt.total_microseconds()/1e6 << " seconds, " << (rate/1024) << " kB/s, size now " << (m_block_queue.get_data_size() + blocks_size) / 1048576.f << " MB");
       m_block_queue.add_blocks(start_height, arg.blocks, context.m_connection_id, context.m_remote_address, rate, blocks_size);
+      m_block_queue.record_span_download(context.m_connection_id, arg.blocks.size(), blocks_size, dt.total_microseconds() / 1e6);
 
       const crypto::hash last_block_hash = cryptonote::get_block_hash(b);
       context.m_last_known_hash = last_block_hash;
@@ -1890,6 +1897,15 @@ skip:
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core>
+  uint64_t t_cryptonote_protocol_handler<t_core>::get_next_span_size(const boost::uuids::uuid &connection_id) const
+  {
+    const size_t count_limit = m_core.get_block_sync_size(m_core.get_current_blockchain_height());
+    if (!m_sync_span_target_seconds)
+      return count_limit;
+    return m_block_queue.get_adaptive_span_size(connection_id, count_limit, CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT, m_sync_span_target_seconds);
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
   bool t_cryptonote_protocol_handler<t_core>::should_download_next_span(cryptonote_connection_context& context, bool standby)
   {
     std::vector<crypto::hash> hashes;
@@ -1918,6 +1934,13 @@ skip:
           return true;
         }
 
+        // the peer it was given to is well past the time its measured throughput predicts
+        if (connection_id != context.m_connection_id && m_block_queue.is_next_span_overdue(connection_id, request_time, now))
+        {
+          MDEBUG(context << " we should download it as it's overdue from " << connection_id << " after " << dt/1e6);
+          return true;
+        }
+
         // in standby, be ready to double download early since we're idling anyway
         // let the fastest peer trigger first
         const double dl_speed = context.m_max_speed_down;
@@ -2224,7 +2247,7 @@ skip:
       NOTIFY_REQUEST_GET_OBJECTS::request req;
       bool is_next = false;
       size_t count = 0;
-      const size_t count_limit = m_core.get_block_sync_size(m_core.get_current_blockchain_height());
+      const size_t count_limit = get_next_span_size(context.m_connection_id);
       std::pair<uint64_t, uint64_t> span = std::make_pair(0, 0);
       if (force_next_span)
       {
@@ -2952,6 +2975,7 @@ skip:
     }
 
     m_block_queue.flush_spans(context.m_connection_id, false);
+    m_block_queue.forget_peer(context.m_connection_id);
     MLOG_PEER_STATE("closed");
   }
 
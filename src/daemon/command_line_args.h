@@ -135,6 +135,11 @@ namespace daemon_args
     "zmq-pub"
   , "Address for ZMQ pub - tcp://ip:port or ipc://path"
   };
+  const command_line::arg_descriptor<uint32_t> arg_zmq_pub_txpool_batch = {
+    "zmq-pub-txpool-batch"
+  , "Publish txpool events arriving within this many milliseconds as one ZMQ pub message, 0 to publish each one"
+  , 0
+  };
 
   const command_line::arg_descriptor<bool> arg_print_genesis_tx = {
     "print-genesis-tx"
@@ -119,6 +119,7 @@ public:
 
       if (shared)
       {
+        shared->set_txpool_batch(std::chrono::milliseconds{command_line::get_arg(vm, daemon_args::arg_zmq_pub_txpool_batch)});
         core.get().get_blockchain_storage().add_block_notify(cryptonote::listener::zmq_pub::chain_main{shared});
         core.get().get_blockchain_storage().add_miner_notify(cryptonote::listener::zmq_pub::miner_data{shared});
         core.get().set_txpool_listener(cryptonote::listener::zmq_pub::txpool_add{shared});
@@ -2287,6 +2287,9 @@ bool t_rpc_command_executor::sync_info()
           epee::string_tools::pad_string(p.info.state, 16) << "  " <<
           epee::string_tools::pad_string(epee::string_tools::to_string_hex(p.info.pruning_seed), 8) << "  " << p.info.height << "  "  <<
           p.info.current_download << " kB/s, " << nblocks << " blocks / " << size/1e6 << " MB queued";
+      if (p.spans_measured)
+        tools::success_msg_writer() << "    measured over " << p.spans_measured << " spans: " << p.bandwidth/1e3 << " kB/s, " <<
+            p.latency_ms << " ms latency, next span " << p.next_span_blocks << " blocks";
     }
 
     uint64_t total_size = 0;
@@ -240,6 +240,10 @@ namespace hw {
             return crypto::wallet::generate_key_derivation(key1, key2, derivation);
         }
 
+        bool device_default::generate_key_derivations(const std::vector<crypto::public_key> &pubs, const crypto::secret_key &sec, std::vector<crypto::key_derivation> &derivations, std::vector<bool> &valid) {
+            return crypto::wallet::generate_key_derivations(pubs, sec, derivations, valid);
+        }
+
         bool device_default::derivation_to_scalar(const crypto::key_derivation &derivation, const size_t output_index, crypto::ec_scalar &res){
             crypto::derivation_to_scalar(derivation,output_index, res);
             return true;
@@ -443,6 +447,31 @@ namespace hw {
             return true;
         }
 
+        /* ======================================================================= */
+        /*                              SOFTWARE DEVICE                            */
+        /* ======================================================================= */
+        bool software_device::generate_key_derivation(const crypto::public_key &key1, const crypto::secret_key &key2, crypto::key_derivation &derivation) {
+            return crypto::wallet::generate_key_derivation(key1, key2, derivation);
+        }
+
+        bool software_device::derive_subaddress_public_key(const crypto::public_key &out_key, const crypto::key_derivation &derivation, const std::size_t output_index, crypto::public_key &derived_key) {
+            return crypto::wallet::derive_subaddress_public_key(out_key, derivation, output_index, derived_key);
+        }
+
+        bool software_device::derivation_to_scalar(const crypto::key_derivation &derivation, const size_t output_index, crypto::ec_scalar &res) {
+            crypto::derivation_to_scalar(derivation, output_index, res);
+            return true;
+        }
+
+        bool software_device::derive_public_key(const crypto::key_derivation &derivation, const std::size_t output_index, const crypto::public_key &base, crypto::public_key &derived_key) {
+            return crypto::derive_public_key(derivation, output_index, base, derived_key);
+        }
+
+        bool software_device::derive_view_tag(const crypto::key_derivation &derivation, const std::size_t output_index, crypto::view_tag &view_tag) {
+            crypto::derive_view_tag(derivation, output_index, view_tag);
+            return true;
+        }
+
 
         /* ---------------------------------------------------------- */
         static device_default *default_core_device = NULL;
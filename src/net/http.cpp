@@ -62,6 +62,75 @@ bool client::set_proxy(const std::string &address)
   return true;
 }
 
+bool client::set_local_server(std::string path, boost::optional<epee::net_utils::http::login> user)
+{
+  epee::net_utils::http::http_simple_client::disconnect();
+  m_local.reset(new epee::net_utils::http::http_local_client());
+  m_local->set_auto_connect(m_auto_connect);
+  m_local->set_server(std::move(path), {}, std::move(user), epee::net_utils::ssl_support_t::e_ssl_support_disabled);
+  return true;
+}
+
+void client::set_server(std::string host, std::string port, boost::optional<epee::net_utils::http::login> user, epee::net_utils::ssl_options_t ssl_options)
+{
+  m_local.reset();
+  epee::net_utils::http::http_simple_client::set_server(std::move(host), std::move(port), std::move(user), std::move(ssl_options));
+}
+
+void client::set_auto_connect(bool auto_connect)
+{
+  m_auto_connect = auto_connect;
+  if (m_local)
+    m_local->set_auto_connect(auto_connect);
+  epee::net_utils::http::http_simple_client::set_auto_connect(auto_connect);
+}
+
+bool client::connect(std::chrono::milliseconds timeout)
+{
+  return m_local ? m_local->connect(timeout) : epee::net_utils::http::http_simple_client::connect(timeout);
+}
+
+bool client::disconnect()
+{
+  return m_local ? m_local->disconnect() : epee::net_utils::http::http_simple_client::disconnect();
+}
+
+bool client::is_connected(bool *ssl)
+{
+  return m_local ? m_local->is_connected(ssl) : epee::net_utils::http::http_simple_client::is_connected(ssl);
+}
+
+bool client::invoke(const boost::string_ref uri, const boost::string_ref method, const boost::string_ref body, std::chrono::milliseconds timeout, const epee::net_utils::http::http_response_info** ppresponse_info, const epee::net_utils::http::fields_list& additional_params)
+{
+  if (m_local)
+    return m_local->invoke(uri, method, body, timeout, ppresponse_info, additional_params);
+  return epee::net_utils::http::http_simple_client::invoke(uri, method, body, timeout, ppresponse_info, additional_params);
+}
+
+bool client::invoke_get(const boost::string_ref uri, std::chrono::milliseconds timeout, const std::string& body, const epee::net_utils::http::http_response_info** ppresponse_info, const epee::net_utils::http::fields_list& additional_params)
+{
+  if (m_local)
+    return m_local->invoke_get(uri, timeout, body, ppresponse_info, additional_params);
+  return epee::net_utils::http::http_simple_client::invoke_get(uri, timeout, body, ppresponse_info, additional_params);
+}
+
+bool client::invoke_post(const boost::string_ref uri, const std::string& body, std::chrono::milliseconds timeout, const epee::net_utils::http::http_response_info** ppresponse_info, const epee::net_utils::http::fields_list& additional_params)
+{
+  if (m_local)
+    return m_local->invoke_post(uri, body, timeout, ppresponse_info, additional_params);
+  return epee::net_utils::http::http_simple_client::invoke_post(uri, body, timeout, ppresponse_info, additional_params);
+}
+
+uint64_t client::get_bytes_sent() const
+{
+  return m_local ? m_local->get_bytes_sent() : epee::net_utils::http::http_simple_client::get_bytes_sent();
+}
+
+uint64_t client::get_bytes_received() const
+{
+  return m_local ? m_local->get_bytes_received() : epee::net_utils::http::http_simple_client::get_bytes_received();
+}
+
 std::unique_ptr<epee::net_utils::http::abstract_http_client> client_factory::create()
 {
   return std::unique_ptr<epee::net_utils::http::abstract_http_client>(new client());
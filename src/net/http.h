@@ -29,6 +29,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include "net/http_client.h"
 
 namespace net
@@ -36,10 +38,28 @@ namespace net
 namespace http
 {
 
+//! Talks to the daemon over TCP, or over a local socket for `unix://` addresses
 class client : public epee::net_utils::http::http_simple_client
 {
 public:
+  using epee::net_utils::http::http_simple_client::set_server;
+
   bool set_proxy(const std::string &address) override;
+  bool set_local_server(std::string path, boost::optional<epee::net_utils::http::login> user) override;
+  void set_server(std::string host, std::string port, boost::optional<epee::net_utils::http::login> user, epee::net_utils::ssl_options_t ssl_options = epee::net_utils::ssl_support_t::e_ssl_support_autodetect) override;
+  void set_auto_connect(bool auto_connect) override;
+  bool connect(std::chrono::milliseconds timeout) override;
+  bool disconnect() override;
+  bool is_connected(bool *ssl = NULL) override;
+  bool invoke(const boost::string_ref uri, const boost::string_ref method, const boost::string_ref body, std::chrono::milliseconds timeout, const epee::net_utils::http::http_response_info** ppresponse_info = NULL, const epee::net_utils::http::fields_list& additional_params = epee::net_utils::http::fields_list()) override;
+  bool invoke_get(const boost::string_ref uri, std::chrono::milliseconds timeout, const std::string& body = std::string(), const epee::net_utils::http::http_response_info** ppresponse_info = NULL, const epee::net_utils::http::fields_list& additional_params = epee::net_utils::http::fields_list()) override;
+  bool invoke_post(const boost::string_ref uri, const std::string& body, std::chrono::milliseconds timeout, const epee::net_utils::http::http_response_info** ppresponse_info = NULL, const epee::net_utils::http::fields_list& additional_params = epee::net_utils::http::fields_list()) override;
+  uint64_t get_bytes_sent() const override;
+  uint64_t get_bytes_received() const override;
+
+private:
+  bool m_auto_connect = true;
+  std::unique_ptr<epee::net_utils::http::http_local_client> m_local;
 };
 
 class client_factory : public epee::net_utils::http::http_client_factory
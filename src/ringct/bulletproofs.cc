@@ -30,6 +30,7 @@
 // Paper references are to https://eprint.iacr.org/2017/1066 (revision 1 July 2018)
 
 #include <stdlib.h>
+#include <atomic>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include "misc_log_ex.h"
@@ -110,10 +111,11 @@ static rct::key get_exponent(const rct::key &base, size_t idx)
 
 static void init_exponents()
 {
+  static std::atomic<bool> init_done(false);
+  if (init_done.load(std::memory_order_acquire))
+    return;
   boost::lock_guard<boost::mutex> lock(init_mutex);
-
-  static bool init_done = false;
-  if (init_done)
+  if (init_done.load(std::memory_order_relaxed))
     return;
   std::vector<MultiexpData> data;
   data.reserve(maxN*maxM*2);
@@ -136,7 +138,7 @@ static void init_exponents()
   MINFO("Pippenger cache size: " << pippenger_get_cache_size(pippenger_HiGi_cache)/1024 << " kB");
   size_t cache_size = straus_get_cache_size(straus_HiGi_cache) + pippenger_get_cache_size(pippenger_HiGi_cache);
   MINFO("Total cache size: " << cache_size/1024 << "kB");
-  init_done = true;
+  init_done.store(true, std::memory_order_release);
 }
 
 /* Given two scalar arrays, construct a vector commitment */
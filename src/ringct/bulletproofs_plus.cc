@@ -38,6 +38,8 @@
 //      in this code, taking on the roles of `H` and `G`, respectively. Read carefully!
 
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include "misc_log_ex.h"
@@ -47,6 +49,8 @@ extern "C"
 {
 #include "crypto/crypto-ops.h"
 }
+#include "crypto/generators.h"
+#include "common/threadpool.h"
 #include "rctOps.h"
 #include "multiexp.h"
 #include "bulletproofs_plus.h"
@@ -59,10 +63,6 @@ extern "C"
 
 namespace rct
 {
-    // Vector functions
-    static rct::key vector_exponent(const rct::keyV &a, const rct::keyV &b);
-    static rct::keyV vector_of_scalar_powers(const rct::key &x, size_t n);
-
     // Proof bounds
     static constexpr size_t maxN = 64; // maximum number of bits in range
     static constexpr size_t maxM = BULLETPROOF_PLUS_MAX_OUTPUTS; // maximum number of outputs to aggregate into a single proof
@@ -71,6 +71,13 @@ namespace rct
     static ge_p3 Hi_p3[maxN*maxM], Gi_p3[maxN*maxM];
     static std::shared_ptr<straus_cached_data> straus_HiGi_cache;
     static std::shared_ptr<pippenger_cached_data> pippenger_HiGi_cache;
+    static ge_cached GiHi_cached[maxN*maxM]; // Gi + Hi
+    static ge_cached Hi_sum_cached[maxM]; // [logM]: sum of the first maxN * 2**logM Hi
+
+    // Prover work splitting: minimum number of terms per threadpool job
+    static constexpr size_t LR_CHUNK_MIN = 64;
+    static constexpr size_t LR_PARALLEL_MIN = 16;
+    static constexpr size_t FOLD_CHUNK_MIN = 32;
 
     // Useful scalar constants
     static const constexpr rct::key ZERO = { {0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00  } }; // 0
@@ -99,6 +106,32 @@ namespace rct
         }
     }
 
+    // Constant-time selection of p if bit is 1, or of the identity if bit is 0
+    static void select_cached(ge_cached &r, const ge_cached &p, unsigned int bit)
+    {
+        const int32_t mask = -(int32_t)(bit & 1);
+        for (size_t k = 0; k < 10; ++k)
+        {
+            const int32_t one = k == 0 ? 1 : 0;
+            r.YplusX[k] = (p.YplusX[k] & mask) | (one & ~mask);
+            r.YminusX[k] = (p.YminusX[k] & mask) | (one & ~mask);
+            r.Z[k] = (p.Z[k] & mask) | (one & ~mask);
+            r.T2d[k] = p.T2d[k] & mask;
+        }
+    }
+
+    // Sets aL to the bit and aR to the bit minus one, without branching on the bit
+    static void select_bit_scalars(rct::key &aL, rct::key &aR, unsigned int bit)
+    {
+        const unsigned char mask = (unsigned char)((bit & 1) - 1);
+        for (size_t k = 0; k < 32; ++k)
+        {
+            aL.bytes[k] = 0;
+            aR.bytes[k] = MINUS_ONE.bytes[k] & mask;
+        }
+        aL.bytes[0] = (unsigned char)(bit & 1);
+    }
+
     // Confirm that a scalar is properly reduced
     static inline bool is_reduced(const rct::key &scalar)
     {
@@ -120,15 +153,18 @@ namespace rct
     // Construct public generators
     static void init_exponents()
     {
+        // Only needs to be done once; the tables are read only afterwards, so the
+        // verification threads need not take the mutex once they are built
+        static std::atomic<bool> init_done(false);
+        if (init_done.load(std::memory_order_acquire))
+            return;
         boost::lock_guard<boost::mutex> lock(init_mutex);
-
-        // Only needs to be done once
-        static bool init_done = false;
-        if (init_done)
+        if (init_done.load(std::memory_order_relaxed))
             return;
 
         std::vector<MultiexpData> data;
         data.reserve(maxN*maxM*2);
+        ge_p3 Hi_sum = ge_p3_identity;
         for (size_t i = 0; i < maxN*maxM; ++i)
         {
             Hi_p3[i] = get_exponent(rct::H, i * 2);
@@ -136,6 +172,25 @@ namespace rct
 
             data.push_back({rct::zero(), Gi_p3[i]});
             data.push_back({rct::zero(), Hi_p3[i]});
+
+            // Used by the prover to commit to the aL/aR bit vectors
+            ge_cached Hi_cached;
+            ge_p1p1 p1;
+            ge_p3 p3;
+            ge_p3_to_cached(&Hi_cached, &Hi_p3[i]);
+            ge_add(&p1, &Gi_p3[i], &Hi_cached);
+            ge_p1p1_to_p3(&p3, &p1);
+            ge_p3_to_cached(&GiHi_cached[i], &p3);
+            ge_add(&p1, &Hi_sum, &Hi_cached);
+            ge_p1p1_to_p3(&Hi_sum, &p1);
+            const size_t count = (i + 1) / maxN;
+            if ((i + 1) % maxN == 0 && (count & (count - 1)) == 0)
+            {
+                size_t logM = 0;
+                while ((size_t(1) << logM) < count)
+                    ++logM;
+                ge_p3_to_cached(&Hi_sum_cached[logM], &Hi_sum);
+            }
         }
 
         straus_HiGi_cache = straus_init_cache(data, STRAUS_SIZE_LIMIT);
@@ -155,83 +210,46 @@ namespace rct
         rct::hash_to_p3(initial_transcript_p3, rct::hash2rct(crypto::cn_fast_hash(domain_separator.data(), domain_separator.size())));
         ge_p3_tobytes(initial_transcript.bytes, &initial_transcript_p3);
 
-        init_done = true;
-    }
-
-    // Given two scalar arrays, construct a vector pre-commitment:
-    //
-    // a = (a_0, ..., a_{n-1})
-    // b = (b_0, ..., b_{n-1})
-    //
-    // Outputs a_0*Gi_0 + ... + a_{n-1}*Gi_{n-1} +
-    //         b_0*Hi_0 + ... + b_{n-1}*Hi_{n-1}
-    static rct::key vector_exponent(const rct::keyV &a, const rct::keyV &b)
-    {
-        CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
-        CHECK_AND_ASSERT_THROW_MES(a.size() <= maxN*maxM, "Incompatible sizes of a and maxN");
-
-        std::vector<MultiexpData> multiexp_data;
-        multiexp_data.reserve(a.size()*2);
-        for (size_t i = 0; i < a.size(); ++i)
-        {
-            multiexp_data.emplace_back(a[i], Gi_p3[i]);
-            multiexp_data.emplace_back(b[i], Hi_p3[i]);
-        }
-        return multiexp(multiexp_data, 2 * a.size());
+        init_done.store(true, std::memory_order_release);
     }
 
     // Helper function used to compute the L and R terms used in the inner-product round function
-    static rct::key compute_LR(size_t size, const rct::key &y, const std::vector<ge_p3> &G, size_t G0, const std::vector<ge_p3> &H, size_t H0, const rct::keyV &a, size_t a0, const rct::keyV &b, size_t b0, const rct::key &c, const rct::key &d)
+    //
+    // This computes the terms with indices [begin, end) of the size nprime term, the c and d terms are only
+    //  added by the chunk starting at 0. multiexp_data is scratch space.
+    static ge_p3 compute_LR(std::vector<MultiexpData> &multiexp_data, size_t begin, size_t end, const rct::key &y, const std::vector<ge_p3> &G, size_t G0, const std::vector<ge_p3> &H, size_t H0, const rct::keyV &a, size_t a0, const rct::keyV &b, size_t b0, const rct::key &c, const rct::key &d)
     {
-        CHECK_AND_ASSERT_THROW_MES(size + G0 <= G.size(), "Incompatible size for G");
-        CHECK_AND_ASSERT_THROW_MES(size + H0 <= H.size(), "Incompatible size for H");
-        CHECK_AND_ASSERT_THROW_MES(size + a0 <= a.size(), "Incompatible size for a");
-        CHECK_AND_ASSERT_THROW_MES(size + b0 <= b.size(), "Incompatible size for b");
-        CHECK_AND_ASSERT_THROW_MES(size <= maxN*maxM, "size is too large");
-
-        std::vector<MultiexpData> multiexp_data;
-        multiexp_data.resize(size*2 + 2);
+        CHECK_AND_ASSERT_THROW_MES(begin < end, "Invalid chunk");
+        CHECK_AND_ASSERT_THROW_MES(end + G0 <= G.size(), "Incompatible size for G");
+        CHECK_AND_ASSERT_THROW_MES(end + H0 <= H.size(), "Incompatible size for H");
+        CHECK_AND_ASSERT_THROW_MES(end + a0 <= a.size(), "Incompatible size for a");
+        CHECK_AND_ASSERT_THROW_MES(end + b0 <= b.size(), "Incompatible size for b");
+        CHECK_AND_ASSERT_THROW_MES(end <= maxN*maxM, "size is too large");
+
+        const size_t size = end - begin;
+        const bool with_cd = begin == 0;
+        multiexp_data.resize(size*2 + (with_cd ? 2 : 0));
         rct::key temp;
         for (size_t i = 0; i < size; ++i)
         {
-            sc_mul(temp.bytes, a[a0+i].bytes, y.bytes);
+            sc_mul(temp.bytes, a[a0+begin+i].bytes, y.bytes);
             sc_mul(multiexp_data[i*2].scalar.bytes, temp.bytes, INV_EIGHT.bytes);
-            multiexp_data[i*2].point = G[G0+i];
+            multiexp_data[i*2].point = G[G0+begin+i];
 
-            sc_mul(multiexp_data[i*2+1].scalar.bytes, b[b0+i].bytes, INV_EIGHT.bytes);
-            multiexp_data[i*2+1].point = H[H0+i];
+            sc_mul(multiexp_data[i*2+1].scalar.bytes, b[b0+begin+i].bytes, INV_EIGHT.bytes);
+            multiexp_data[i*2+1].point = H[H0+begin+i];
         }
 
-        sc_mul(multiexp_data[2*size].scalar.bytes, c.bytes, INV_EIGHT.bytes);
-        ge_p3 H_p3;
-        ge_frombytes_vartime(&H_p3, rct::H.bytes);
-        multiexp_data[2*size].point = H_p3;
-
-        sc_mul(multiexp_data[2*size+1].scalar.bytes, d.bytes, INV_EIGHT.bytes);
-        ge_p3 G_p3;
-        ge_frombytes_vartime(&G_p3, rct::G.bytes);
-        multiexp_data[2*size+1].point = G_p3;
-
-        return multiexp(multiexp_data, 0);
-    }
-
-    // Given a scalar, construct a vector of its powers:
-    //
-    // Output (1,x,x**2,...,x**{n-1})
-    static rct::keyV vector_of_scalar_powers(const rct::key &x, size_t n)
-    {
-        CHECK_AND_ASSERT_THROW_MES(n != 0, "Need n > 0");
-
-        rct::keyV res(n);
-        res[0] = rct::identity();
-        if (n == 1)
-            return res;
-        res[1] = x;
-        for (size_t i = 2; i < n; ++i)
+        if (with_cd)
         {
-            sc_mul(res[i].bytes, res[i-1].bytes, x.bytes);
+            sc_mul(multiexp_data[2*size].scalar.bytes, c.bytes, INV_EIGHT.bytes);
+            multiexp_data[2*size].point = crypto::get_H_p3();
+
+            sc_mul(multiexp_data[2*size+1].scalar.bytes, d.bytes, INV_EIGHT.bytes);
+            multiexp_data[2*size+1].point = crypto::get_G_p3();
         }
-        return res;
+
+        return multiexp_data.size() <= 95 ? straus_p3(multiexp_data, NULL, 0) : pippenger_p3(multiexp_data, NULL, 0, get_pippenger_c(multiexp_data.size()));
     }
 
     // Given a scalar, construct the sum of its powers from 2 to n (where n is a power of 2):
@@ -314,70 +332,17 @@ namespace rct
         return res;
     }
 
-    static rct::key weighted_inner_product(const rct::keyV &a, const epee::span<const rct::key> &b, const rct::key &y)
+    // Fold inner-product point vectors: v[n] = a*v[n] + b*v[sz+n] for n in [begin, end), with sz half the size of v
+    static void hadamard_fold(std::vector<ge_p3> &v, const rct::key &a, const rct::key &b, size_t begin, size_t end)
     {
-        CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
-        return weighted_inner_product(epee::to_span(a), b, y);
-    }
-
-    // Fold inner-product point vectors
-    static void hadamard_fold(std::vector<ge_p3> &v, const rct::key &a, const rct::key &b)
-    {
-        CHECK_AND_ASSERT_THROW_MES((v.size() & 1) == 0, "Vector size should be even");
         const size_t sz = v.size() / 2;
-        for (size_t n = 0; n < sz; ++n)
+        for (size_t n = begin; n < end; ++n)
         {
             ge_dsmp c[2];
             ge_dsm_precomp(c[0], &v[n]);
             ge_dsm_precomp(c[1], &v[sz + n]);
             ge_double_scalarmult_precomp_vartime2_p3(&v[n], a.bytes, c[0], b.bytes, c[1]);
         }
-        v.resize(sz);
-    }
-
-    // Add vectors componentwise
-    static rct::keyV vector_add(const rct::keyV &a, const rct::keyV &b)
-    {
-        CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
-        rct::keyV res(a.size());
-        for (size_t i = 0; i < a.size(); ++i)
-        {
-            sc_add(res[i].bytes, a[i].bytes, b[i].bytes);
-        }
-        return res;
-    }
-
-    // Add a scalar to all elements of a vector
-    static rct::keyV vector_add(const rct::keyV &a, const rct::key &b)
-    {
-        rct::keyV res(a.size());
-        for (size_t i = 0; i < a.size(); ++i)
-        {
-            sc_add(res[i].bytes, a[i].bytes, b.bytes);
-        }
-        return res;
-    }
-
-    // Subtract a scalar from all elements of a vector
-    static rct::keyV vector_subtract(const rct::keyV &a, const rct::key &b)
-    {
-        rct::keyV res(a.size());
-        for (size_t i = 0; i < a.size(); ++i)
-        {
-            sc_sub(res[i].bytes, a[i].bytes, b.bytes);
-        }
-        return res;
-    }
-
-    // Multiply a scalar by all elements of a vector
-    static rct::keyV vector_scalar(const epee::span<const rct::key> &a, const rct::key &x)
-    {
-        rct::keyV res(a.size());
-        for (size_t i = 0; i < a.size(); ++i)
-        {
-            sc_mul(res[i].bytes, a[i].bytes, x.bytes);
-        }
-        return res;
     }
 
     // Inversion helper function
@@ -509,8 +474,114 @@ namespace rct
         return bulletproof_plus_PROVE(std::vector<uint64_t>(1, v), rct::keyV(1, gamma));
     }
 
+    // Scratch space of a bulletproof_plus_prover, sized for the largest proof it has built so far
+    struct bulletproof_plus_workspace
+    {
+        rct::keyV aL, aR;
+        rct::keyV d, y_powers, yinvpow;
+        rct::keyV aprime, bprime;
+        std::vector<ge_p3> Gprime, Hprime;
+        std::vector<std::vector<MultiexpData>> LR_data;
+        std::vector<ge_p3> LR_partial;
+    };
+
+    bulletproof_plus_prover::bulletproof_plus_prover(): m_workspace(new bulletproof_plus_workspace())
+    {
+    }
+
+    bulletproof_plus_prover::~bulletproof_plus_prover()
+    {
+    }
+
+    // Compute the L and R terms of an inner-product round
+    //
+    // Each term is split into chunks of its point vectors, which are evaluated on the threadpool and then summed.
+    static void compute_LR(bulletproof_plus_workspace &ws, size_t nprime, const rct::key &cL, const rct::key &dL, const rct::key &cR, const rct::key &dR, rct::key &L, rct::key &R)
+    {
+        tools::threadpool &tpool = tools::threadpool::getInstanceForCompute();
+        const size_t chunks = std::max<size_t>(1, std::min<size_t>(nprime / LR_CHUNK_MIN, (tpool.get_max_concurrency() + 1) / 2));
+        if (ws.LR_data.size() < 2 * chunks)
+            ws.LR_data.resize(2 * chunks);
+        ws.LR_partial.resize(2 * chunks);
+
+        auto run = [&ws, nprime, chunks, &cL, &dL, &cR, &dR](size_t task)
+        {
+            const size_t side = task / chunks, chunk = task % chunks;
+            const size_t begin = nprime * chunk / chunks, end = nprime * (chunk + 1) / chunks;
+            if (side == 0)
+                ws.LR_partial[task] = compute_LR(ws.LR_data[task], begin, end, ws.yinvpow[nprime], ws.Gprime, nprime, ws.Hprime, 0, ws.aprime, 0, ws.bprime, nprime, cL, dL);
+            else
+                ws.LR_partial[task] = compute_LR(ws.LR_data[task], begin, end, ws.y_powers[nprime], ws.Gprime, 0, ws.Hprime, nprime, ws.aprime, nprime, ws.bprime, 0, cR, dR);
+        };
+
+        if (nprime < LR_PARALLEL_MIN)
+        {
+            for (size_t task = 0; task < 2 * chunks; ++task)
+                run(task);
+        }
+        else
+        {
+            tools::threadpool::waiter waiter(tpool);
+            for (size_t task = 0; task < 2 * chunks; ++task)
+                tpool.submit(&waiter, [&run, task](){ run(task); });
+            CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to compute inner-product round terms");
+        }
+
+        ge_p3 sum[2];
+        ge_cached cached;
+        ge_p1p1 p1;
+        for (size_t side = 0; side < 2; ++side)
+        {
+            sum[side] = ws.LR_partial[side * chunks];
+            for (size_t chunk = 1; chunk < chunks; ++chunk)
+            {
+                ge_p3_to_cached(&cached, &ws.LR_partial[side * chunks + chunk]);
+                ge_add(&p1, &sum[side], &cached);
+                ge_p1p1_to_p3(&sum[side], &p1);
+            }
+        }
+        ge_p3_tobytes(L.bytes, &sum[0]);
+        ge_p3_tobytes(R.bytes, &sum[1]);
+    }
+
+    // Fold both inner-product point vectors, in chunks on the threadpool
+    static void hadamard_fold(std::vector<ge_p3> &G, const rct::key &aG, const rct::key &bG, std::vector<ge_p3> &H, const rct::key &aH, const rct::key &bH)
+    {
+        CHECK_AND_ASSERT_THROW_MES(G.size() == H.size(), "Incompatible sizes of G and H");
+        CHECK_AND_ASSERT_THROW_MES((G.size() & 1) == 0, "Vector size should be even");
+        const size_t sz = G.size() / 2;
+
+        tools::threadpool &tpool = tools::threadpool::getInstanceForCompute();
+        const size_t chunks = std::max<size_t>(1, std::min<size_t>(sz / FOLD_CHUNK_MIN, tpool.get_max_concurrency()));
+        if (chunks == 1)
+        {
+            hadamard_fold(G, aG, bG, 0, sz);
+            hadamard_fold(H, aH, bH, 0, sz);
+        }
+        else
+        {
+            tools::threadpool::waiter waiter(tpool);
+            for (size_t chunk = 0; chunk < chunks; ++chunk)
+            {
+                const size_t begin = sz * chunk / chunks, end = sz * (chunk + 1) / chunks;
+                tpool.submit(&waiter, [&G, &aG, &bG, begin, end](){ hadamard_fold(G, aG, bG, begin, end); });
+                tpool.submit(&waiter, [&H, &aH, &bH, begin, end](){ hadamard_fold(H, aH, bH, begin, end); });
+            }
+            CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to fold inner-product generators");
+        }
+        G.resize(sz);
+        H.resize(sz);
+    }
+
     // Given a set of values v [0..2**N) and masks gamma, construct a range proof
     BulletproofPlus bulletproof_plus_PROVE(const rct::keyV &sv, const rct::keyV &gamma)
+    {
+        // Reuse the scratch space of the previous proof built on this thread
+        static thread_local bulletproof_plus_prover prover;
+        return prover.prove(sv, gamma);
+    }
+
+    BulletproofPlus bulletproof_plus_prover::prove(const rct::keyV &sv, const rct::keyV &gamma)
     {
         // Sanity check on inputs
         CHECK_AND_ASSERT_THROW_MES(sv.size() == gamma.size(), "Incompatible sizes of sv and gamma");
@@ -522,6 +593,8 @@ namespace rct
 
         init_exponents();
 
+        bulletproof_plus_workspace &ws = *m_workspace;
+
         // Useful proof bounds
         //
         // N: number of bits in each range (here, 64)
@@ -537,8 +610,9 @@ namespace rct
         const size_t MN = M * N;
 
         rct::keyV V(sv.size());
-        rct::keyV aL(MN), aR(MN);
-        rct::keyV aL8(MN), aR8(MN);
+        rct::keyV &aL = ws.aL, &aR = ws.aR;
+        aL.resize(MN);
+        aR.resize(MN);
         rct::key temp;
         rct::key temp2;
 
@@ -553,30 +627,35 @@ namespace rct
             rct::key gamma8, sv8;
             sc_mul(gamma8.bytes, gamma[i].bytes, INV_EIGHT.bytes);
             sc_mul(sv8.bytes, sv[i].bytes, INV_EIGHT.bytes);
-            rct::addKeys2(V[i], gamma8, sv8, rct::H);
+            rct::addKeys_aGbH(V[i], gamma8, sv8);
         }
 
         // Decompose values
         //
         // Note that this effectively pads the set to a power of 2, which is required for the inner-product argument later.
+        //
+        // The vector commitment to aL and aR (offset by 8**(-1)) is sum(aL_i*Gi + aR_i*Hi). As aL_i is a bit
+        //  and aR_i = aL_i - 1, this equals sum(aL_i*(Gi + Hi)) - sum(Hi), which we accumulate here
+        //  with one constant-time point addition per bit instead of a multiexp.
+        ge_p3 pre_A_p3 = ge_p3_identity;
+        ge_cached selected;
+        ge_p1p1 p1;
         for (size_t j = 0; j < M; ++j)
         {
             for (size_t i = N; i-- > 0; )
             {
-                if (j < sv.size() && (sv[j][i/8] & (((uint64_t)1)<<(i%8))))
-                {
-                    aL[j*N+i] = rct::identity();
-                    aL8[j*N+i] = INV_EIGHT;
-                    aR[j*N+i] = aR8[j*N+i] = rct::zero();
-                }
-                else
-                {
-                    aL[j*N+i] = aL8[j*N+i] = rct::zero();
-                    aR[j*N+i] = MINUS_ONE;
-                    aR8[j*N+i] = MINUS_INV_EIGHT;
-                }
+                const unsigned int bit = j < sv.size() ? (sv[j][i/8] >> (i%8)) & 1 : 0;
+                select_bit_scalars(aL[j*N+i], aR[j*N+i], bit);
+                select_cached(selected, GiHi_cached[j*N+i], bit);
+                ge_add(&p1, &pre_A_p3, &selected);
+                ge_p1p1_to_p3(&pre_A_p3, &p1);
             }
         }
+        ge_sub(&p1, &pre_A_p3, &Hi_sum_cached[logM]);
+        ge_p1p1_to_p3(&pre_A_p3, &p1);
+        rct::key pre_A;
+        ge_p3_tobytes(pre_A.bytes, &pre_A_p3);
+        pre_A = rct::scalarmultKey(pre_A, INV_EIGHT);
 
 try_again:
         // This is a Fiat-Shamir transcript
@@ -585,7 +664,6 @@ try_again:
 
         // A
         rct::key alpha = rct::skGen();
-        rct::key pre_A = vector_exponent(aL8, aR8);
         rct::key A;
         sc_mul(temp.bytes, alpha.bytes, INV_EIGHT.bytes);
         rct::addKeys(A, pre_A, rct::scalarmultBase(temp));
@@ -610,7 +688,8 @@ try_again:
         // d[j*N+i] = z**(2*(j+1)) * 2**i
         //
         // We compute this iteratively in order to reduce scalar operations.
-        rct::keyV d(MN, rct::zero());
+        rct::keyV &d = ws.d;
+        d.assign(MN, rct::zero());
         d[0] = z_squared;
         for (size_t i = 1; i < N; i++)
         {
@@ -625,18 +704,30 @@ try_again:
             }
         }
 
-        rct::keyV y_powers = vector_of_scalar_powers(y, MN+2);
-
-        // Prepare inner product terms
-        rct::keyV aL1 = vector_subtract(aL, z);
+        rct::keyV &y_powers = ws.y_powers;
+        y_powers.resize(MN+2);
+        y_powers[0] = rct::identity();
+        y_powers[1] = y;
+        for (size_t i = 2; i < MN+2; ++i)
+        {
+            sc_mul(y_powers[i].bytes, y_powers[i-1].bytes, y.bytes);
+        }
 
-        rct::keyV aR1 = vector_add(aR, z);
-        rct::keyV d_y(MN);
+        // Prepare inner product terms, these are used in the inner product rounds
+        //
+        // aprime = aL - z
+        // bprime = aR + z + d_y, where d_y[i] = d[i] * y**(MN-i)
+        size_t nprime = MN;
+        rct::keyV &aprime = ws.aprime, &bprime = ws.bprime;
+        aprime.resize(MN);
+        bprime.resize(MN);
         for (size_t i = 0; i < MN; i++)
         {
-            sc_mul(d_y[i].bytes, d[i].bytes, y_powers[MN-i].bytes);
+            sc_sub(aprime[i].bytes, aL[i].bytes, z.bytes);
+            sc_add(bprime[i].bytes, aR[i].bytes, z.bytes);
+            sc_mul(temp.bytes, d[i].bytes, y_powers[MN-i].bytes);
+            sc_add(bprime[i].bytes, bprime[i].bytes, temp.bytes);
         }
-        aR1 = vector_add(aR1, d_y);
 
         rct::key alpha1 = alpha;
         temp = ONE;
@@ -647,26 +738,17 @@ try_again:
             sc_muladd(alpha1.bytes, temp2.bytes, gamma[j].bytes, alpha1.bytes);
         }
 
-        // These are used in the inner product rounds
-        size_t nprime = MN;
-        std::vector<ge_p3> Gprime(MN);
-        std::vector<ge_p3> Hprime(MN);
-        rct::keyV aprime(MN);
-        rct::keyV bprime(MN);
+        std::vector<ge_p3> &Gprime = ws.Gprime, &Hprime = ws.Hprime;
+        Gprime.assign(Gi_p3, Gi_p3 + MN);
+        Hprime.assign(Hi_p3, Hi_p3 + MN);
 
         const rct::key yinv = invert(y);
-        rct::keyV yinvpow(MN);
+        rct::keyV &yinvpow = ws.yinvpow;
+        yinvpow.resize(MN);
         yinvpow[0] = ONE;
-        for (size_t i = 0; i < MN; ++i)
+        for (size_t i = 1; i < MN; ++i)
         {
-            Gprime[i] = Gi_p3[i];
-            Hprime[i] = Hi_p3[i];
-            if (i > 0)
-            {
-                sc_mul(yinvpow[i].bytes, yinvpow[i-1].bytes, yinv.bytes);
-            }
-            aprime[i] = aL1[i];
-            bprime[i] = aR1[i];
+            sc_mul(yinvpow[i].bytes, yinvpow[i-1].bytes, yinv.bytes);
         }
         rct::keyV L(logMN);
         rct::keyV R(logMN);
@@ -678,13 +760,13 @@ try_again:
             nprime /= 2;
 
             rct::key cL = weighted_inner_product(slice(aprime, 0, nprime), slice(bprime, nprime, bprime.size()), y);
-            rct::key cR = weighted_inner_product(vector_scalar(slice(aprime, nprime, aprime.size()), y_powers[nprime]), slice(bprime, 0, nprime), y);
+            rct::key cR = weighted_inner_product(slice(aprime, nprime, aprime.size()), slice(bprime, 0, nprime), y);
+            sc_mul(cR.bytes, cR.bytes, y_powers[nprime].bytes);
 
             rct::key dL = rct::skGen();
             rct::key dR = rct::skGen();
 
-            L[round] = compute_LR(nprime, yinvpow[nprime], Gprime, nprime, Hprime, 0, aprime, 0, bprime, nprime, cL, dL);
-            R[round] = compute_LR(nprime, y_powers[nprime], Gprime, 0, Hprime, nprime, aprime, nprime, bprime, 0, cR, dR);
+            compute_LR(ws, nprime, cL, dL, cR, dR, L[round], R[round]);
 
             const rct::key challenge = transcript_update(transcript, L[round], R[round]);
             if (challenge == rct::zero())
@@ -696,12 +778,19 @@ try_again:
             const rct::key challenge_inv = invert(challenge);
 
             sc_mul(temp.bytes, yinvpow[nprime].bytes, challenge.bytes);
-            hadamard_fold(Gprime, challenge_inv, temp);
-            hadamard_fold(Hprime, challenge, challenge_inv);
+            hadamard_fold(Gprime, challenge_inv, temp, Hprime, challenge, challenge_inv);
 
+            // Fold the scalar vectors in place, the first half only depends on indices it overwrites
             sc_mul(temp.bytes, challenge_inv.bytes, y_powers[nprime].bytes);
-            aprime = vector_add(vector_scalar(slice(aprime, 0, nprime), challenge), vector_scalar(slice(aprime, nprime, aprime.size()), temp));
-            bprime = vector_add(vector_scalar(slice(bprime, 0, nprime), challenge_inv), vector_scalar(slice(bprime, nprime, bprime.size()), challenge));
+            for (size_t i = 0; i < nprime; ++i)
+            {
+                sc_mul(temp2.bytes, aprime[nprime+i].bytes, temp.bytes);
+                sc_muladd(aprime[i].bytes, aprime[i].bytes, challenge.bytes, temp2.bytes);
+                sc_mul(temp2.bytes, bprime[nprime+i].bytes, challenge.bytes);
+                sc_muladd(bprime[i].bytes, bprime[i].bytes, challenge_inv.bytes, temp2.bytes);
+            }
+            aprime.resize(nprime);
+            bprime.resize(nprime);
 
             rct::key challenge_squared;
             sc_mul(challenge_squared.bytes, challenge.bytes, challenge.bytes);
@@ -788,6 +877,18 @@ try_again:
         return bulletproof_plus_PROVE(sv, gamma);
     }
 
+    BulletproofPlus bulletproof_plus_prover::prove(const std::vector<uint64_t> &v, const rct::keyV &gamma)
+    {
+        CHECK_AND_ASSERT_THROW_MES(v.size() == gamma.size(), "Incompatible sizes of v and gamma");
+
+        rct::keyV sv(v.size());
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            sv[i] = rct::d2h(v[i]);
+        }
+        return prove(sv, gamma);
+    }
+
     struct bp_plus_proof_data_t
     {
         rct::key y, z, e;
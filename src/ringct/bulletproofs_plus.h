@@ -31,11 +31,30 @@
 #ifndef BULLETPROOFS_PLUS_H
 #define BULLETPROOFS_PLUS_H
 
+#include <memory>
 #include "rctTypes.h"
 
 namespace rct
 {
 
+struct bulletproof_plus_workspace;
+
+// Builds Bulletproof+ range proofs, keeping the per-proof vectors between calls so that
+// building several proofs (eg for candidate transactions) does not reallocate them.
+// The inner-product rounds run on the compute threadpool. Not safe for concurrent use.
+class bulletproof_plus_prover
+{
+public:
+  bulletproof_plus_prover();
+  ~bulletproof_plus_prover();
+
+  BulletproofPlus prove(const rct::keyV &v, const rct::keyV &gamma);
+  BulletproofPlus prove(const std::vector<uint64_t> &v, const rct::keyV &gamma);
+
+private:
+  std::unique_ptr<bulletproof_plus_workspace> m_workspace;
+};
+
 BulletproofPlus bulletproof_plus_PROVE(const rct::key &v, const rct::key &gamma);
 BulletproofPlus bulletproof_plus_PROVE(uint64_t v, const rct::key &gamma);
 BulletproofPlus bulletproof_plus_PROVE(const rct::keyV &v, const rct::keyV &gamma);
@@ -346,9 +346,12 @@ struct straus_cached_data
 {
 #ifdef RAW_MEMORY_BLOCK
   size_t size;
+  size_t capacity;
   ge_cached *multiples;
-  straus_cached_data(): size(0), multiples(NULL) {}
+  straus_cached_data(): size(0), capacity(0), multiples(NULL) {}
   ~straus_cached_data() { aligned_free(multiples); }
+  straus_cached_data(const straus_cached_data&) = delete;
+  straus_cached_data &operator=(const straus_cached_data&) = delete;
 #else
   std::vector<std::vector<ge_cached>> multiples;
 #endif
@@ -367,20 +370,22 @@ struct straus_cached_data
 #endif
 #endif
 
-std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<MultiexpData> &data, size_t N)
+// (re)fills the cache with the multiples of the first N points, reusing its memory when large enough
+static void straus_fill_cache(straus_cached_data *cache, const std::vector<MultiexpData> &data, size_t N)
 {
-  MULTIEXP_PERF(PERF_TIMER_START_UNIT(multiples, 1000000));
-  if (N == 0)
-    N = data.size();
-  CHECK_AND_ASSERT_THROW_MES(N <= data.size(), "Bad cache base data");
   ge_p1p1 p1;
   ge_p3 p3;
-  std::shared_ptr<straus_cached_data> cache(new straus_cached_data());
 
 #ifdef RAW_MEMORY_BLOCK
-  const size_t offset = cache->size;
-  cache->multiples = (ge_cached*)aligned_realloc(cache->multiples, sizeof(ge_cached) * ((1<<STRAUS_C)-1) * std::max(offset, N), 4096);
-  CHECK_AND_ASSERT_THROW_MES(cache->multiples, "Out of memory");
+  const size_t offset = 0;
+  if (cache->capacity < N)
+  {
+    aligned_free(cache->multiples);
+    cache->capacity = 0;
+    cache->multiples = (ge_cached*)aligned_malloc(sizeof(ge_cached) * ((1<<STRAUS_C)-1) * N, 4096);
+    CHECK_AND_ASSERT_THROW_MES(cache->multiples, "Out of memory");
+    cache->capacity = N;
+  }
   cache->size = N;
   for (size_t j=offset;j<N;++j)
   {
@@ -394,8 +399,8 @@ std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<Multiexp
   }
 #else
 #ifdef ALTERNATE_LAYOUT
-  const size_t offset = cache->multiples.size();
-  cache->multiples.resize(std::max(offset, N));
+  const size_t offset = 0;
+  cache->multiples.resize(N);
   for (size_t i = offset; i < N; ++i)
   {
     cache->multiples[i].resize((1<<STRAUS_C)-1);
@@ -409,12 +414,12 @@ std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<Multiexp
   }
 #else
   cache->multiples.resize(1<<STRAUS_C);
-  size_t offset = cache->multiples[1].size();
-  cache->multiples[1].resize(std::max(offset, N));
+  const size_t offset = 0;
+  cache->multiples[1].resize(N);
   for (size_t i = offset; i < N; ++i)
     ge_p3_to_cached(&cache->multiples[1][i], &data[i].point);
   for (size_t i=2;i<1<<STRAUS_C;++i)
-    cache->multiples[i].resize(std::max(offset, N));
+    cache->multiples[i].resize(N);
   for (size_t j=offset;j<N;++j)
   {
     for (size_t i=2;i<1<<STRAUS_C;++i)
@@ -426,6 +431,16 @@ std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<Multiexp
   }
 #endif
 #endif
+}
+
+std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<MultiexpData> &data, size_t N)
+{
+  MULTIEXP_PERF(PERF_TIMER_START_UNIT(multiples, 1000000));
+  if (N == 0)
+    N = data.size();
+  CHECK_AND_ASSERT_THROW_MES(N <= data.size(), "Bad cache base data");
+  std::shared_ptr<straus_cached_data> cache(new straus_cached_data());
+  straus_fill_cache(cache.get(), data, N);
   MULTIEXP_PERF(PERF_TIMER_STOP(multiples));
 
   return cache;
@@ -443,6 +458,83 @@ size_t straus_get_cache_size(const std::shared_ptr<straus_cached_data> &cache)
   return sz;
 }
 
+// Per thread workspace for the uncached and temporary parts of a multiexp. Every buffer is
+// completely rewritten before it is read, so reusing it across calls only saves the allocations.
+// Buffers grown past MULTIEXP_SCRATCH_KEEP_BYTES by an unusually large multiexp are released
+// when it returns, so an idle thread does not keep its largest ever workspace.
+#define MULTIEXP_SCRATCH_KEEP_BYTES (1024 * 1024)
+
+struct straus_scratch
+{
+  straus_cached_data cache;
+  std::vector<uint8_t> digits;
+#ifdef TRACK_STRAUS_ZERO_IDENTITY
+  std::vector<uint8_t> skip;
+#endif
+
+  size_t bytes() const
+  {
+    size_t sz = digits.capacity();
+#ifdef TRACK_STRAUS_ZERO_IDENTITY
+    sz += skip.capacity();
+#endif
+#ifdef RAW_MEMORY_BLOCK
+    sz += cache.capacity * sizeof(ge_cached) * ((1<<STRAUS_C)-1);
+#else
+    for (const auto &e0: cache.multiples)
+      sz += e0.capacity() * sizeof(ge_cached);
+#endif
+    return sz;
+  }
+
+  void trim()
+  {
+    if (bytes() <= MULTIEXP_SCRATCH_KEEP_BYTES)
+      return;
+#ifdef RAW_MEMORY_BLOCK
+    aligned_free(cache.multiples);
+    cache.multiples = NULL;
+    cache.size = 0;
+    cache.capacity = 0;
+#else
+    std::vector<std::vector<ge_cached>>().swap(cache.multiples);
+#endif
+    std::vector<uint8_t>().swap(digits);
+#ifdef TRACK_STRAUS_ZERO_IDENTITY
+    std::vector<uint8_t>().swap(skip);
+#endif
+  }
+};
+static thread_local straus_scratch straus_scratch_space;
+
+struct pippenger_scratch
+{
+  pippenger_cached_data cache;
+  std::vector<ge_p3> buckets;
+
+  size_t bytes() const
+  {
+    return cache.capacity() * sizeof(ge_cached) + buckets.capacity() * sizeof(ge_p3);
+  }
+
+  void trim()
+  {
+    if (bytes() <= MULTIEXP_SCRATCH_KEEP_BYTES)
+      return;
+    pippenger_cached_data().swap(cache);
+    std::vector<ge_p3>().swap(buckets);
+  }
+};
+static thread_local pippenger_scratch pippenger_scratch_space;
+
+// trims a scratch workspace however the multiexp using it returns
+template<typename T>
+struct scratch_trimmer
+{
+  T &scratch;
+  ~scratch_trimmer() { scratch.trim(); }
+};
+
 ge_p3 straus_p3(const std::vector<MultiexpData> &data, const std::shared_ptr<straus_cached_data> &cache, size_t STEP)
 {
   CHECK_AND_ASSERT_THROW_MES(cache == NULL || cache->size >= data.size(), "Cache is too small");
@@ -450,23 +542,32 @@ ge_p3 straus_p3(const std::vector<MultiexpData> &data, const std::shared_ptr<str
   STEP = STEP ? STEP : 192;
 
   MULTIEXP_PERF(PERF_TIMER_START_UNIT(setup, 1000000));
-  std::shared_ptr<straus_cached_data> local_cache = cache == NULL ? straus_init_cache(data) : cache;
+  straus_scratch &scratch = straus_scratch_space;
+  const scratch_trimmer<straus_scratch> trimmer{scratch};
+  const straus_cached_data *local_cache = cache.get();
+  if (local_cache == NULL)
+  {
+    straus_fill_cache(&scratch.cache, data, data.size());
+    local_cache = &scratch.cache;
+  }
   ge_cached cached;
   ge_p1p1 p1;
 
 #ifdef TRACK_STRAUS_ZERO_IDENTITY
   MULTIEXP_PERF(PERF_TIMER_START_UNIT(skip, 1000000));
-  std::vector<uint8_t> skip(data.size());
+  std::vector<uint8_t> &skip = scratch.skip;
+  skip.resize(data.size());
   for (size_t i = 0; i < data.size(); ++i)
     skip[i] = data[i].scalar == rct::zero() || ge_p3_is_point_at_infinity_vartime(&data[i].point);
   MULTIEXP_PERF(PERF_TIMER_STOP(skip));
 #endif
 
   MULTIEXP_PERF(PERF_TIMER_START_UNIT(digits, 1000000));
+  std::vector<uint8_t> &digits = scratch.digits;
 #if STRAUS_C==4
-  std::unique_ptr<uint8_t[]> digits{new uint8_t[64 * data.size()]};
+  digits.resize(64 * data.size());
 #else
-  std::unique_ptr<uint8_t[]> digits{new uint8_t[256 * data.size()]};
+  digits.resize(256 * data.size());
 #endif
   for (size_t j = 0; j < data.size(); ++j)
   {
@@ -577,6 +678,13 @@ size_t get_pippenger_c(size_t N)
   return 9;
 }
 
+static void pippenger_fill_cache(pippenger_cached_data &cache, const std::vector<MultiexpData> &data, size_t start_offset, size_t N)
+{
+  cache.resize(N);
+  for (size_t i = 0; i < N; ++i)
+    ge_p3_to_cached(&cache[i], &data[i+start_offset].point);
+}
+
 std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<MultiexpData> &data, size_t start_offset, size_t N)
 {
   MULTIEXP_PERF(PERF_TIMER_START_UNIT(pippenger_init_cache, 1000000));
@@ -585,10 +693,7 @@ std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<Mu
     N = data.size() - start_offset;
   CHECK_AND_ASSERT_THROW_MES(N <= data.size() - start_offset, "Bad cache base data");
   std::shared_ptr<pippenger_cached_data> cache = std::make_shared<pippenger_cached_data>();
-
-  cache->resize(N);
-  for (size_t i = 0; i < N; ++i)
-    ge_p3_to_cached(&(*cache)[i], &data[i+start_offset].point);
+  pippenger_fill_cache(*cache, data, start_offset, N);
 
   MULTIEXP_PERF(PERF_TIMER_STOP(pippenger_init_cache));
   return cache;
@@ -601,6 +706,7 @@ size_t pippenger_get_cache_size(const std::shared_ptr<pippenger_cached_data> &ca
 
 ge_p3 pippenger_p3(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache, size_t cache_size, size_t c)
 {
+  CHECK_AND_ASSERT_THROW_MES(cache != NULL || cache_size == 0, "Cache size given without a cache");
   if (cache != NULL && cache_size == 0)
     cache_size = cache->size();
   CHECK_AND_ASSERT_THROW_MES(cache == NULL || cache_size <= cache->size(), "Cache is too small");
@@ -610,10 +716,19 @@ ge_p3 pippenger_p3(const std::vector<MultiexpData> &data, const std::shared_ptr<
 
   ge_p3 result = ge_p3_identity;
   bool result_init = false;
-  std::unique_ptr<ge_p3[]> buckets{new ge_p3[1<<c]};
+  pippenger_scratch &scratch = pippenger_scratch_space;
+  const scratch_trimmer<pippenger_scratch> trimmer{scratch};
+  scratch.buckets.resize(1<<c);
+  ge_p3 *buckets = scratch.buckets.data();
   bool buckets_init[1<<9];
-  std::shared_ptr<pippenger_cached_data> local_cache = cache == NULL ? pippenger_init_cache(data) : cache;
-  std::shared_ptr<pippenger_cached_data> local_cache_2 = data.size() > cache_size ? pippenger_init_cache(data, cache_size) : NULL;
+  // without a cache, cache_size is 0 and every point comes from the temporary cache
+  const pippenger_cached_data *local_cache = cache.get();
+  const pippenger_cached_data *local_cache_2 = NULL;
+  if (data.size() > cache_size)
+  {
+    pippenger_fill_cache(scratch.cache, data, cache_size, data.size() - cache_size);
+    local_cache_2 = &scratch.cache;
+  }
 
   rct::key maxscalar = rct::zero();
   for (size_t i = 0; i < data.size(); ++i)
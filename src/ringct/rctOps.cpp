@@ -31,6 +31,7 @@
 #include <boost/lexical_cast.hpp>
 #include "misc_log_ex.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
+#include "crypto/generators.h"
 #include "rctOps.h"
 using namespace crypto;
 using namespace std;
@@ -295,7 +296,7 @@ namespace rct {
 
     //generates C =aG + bH from b, a is given..
     void genC(key & C, const key & a, xmr_amount amount) {
-        addKeys2(C, a, d2h(amount), rct::H);
+        addKeys_aGbH(C, a, d2h(amount));
     }
 
     //generates a <secret , public> / Pedersen commitment to the amount
@@ -387,10 +388,12 @@ namespace rct {
 
     //Computes aH where H= toPoint(cn_fast_hash(G)), G the basepoint
     key scalarmultH(const key & a) {
-        ge_p2 R;
-        ge_scalarmult(&R, a.bytes, &ge_p3_H);
+        ge_p3 R;
+        key a_reduced;
+        sc_reduce32copy(a_reduced.bytes, a.bytes); // the table lookup needs a[31] <= 127
+        ge_scalarmult_fixed_base(&R, a_reduced.bytes, get_H_fixed_base_table());
         key aP;
-        ge_tobytes(aP.bytes, &R);
+        ge_p3_tobytes(aP.bytes, &R);
         return aP;
     }
 
@@ -483,6 +486,25 @@ namespace rct {
         ge_tobytes(aGbB.bytes, &rv);
     }
 
+    //aGbH = aG + bH where a, b are scalars, G is the basepoint and H is the commitment generator
+    //both products use the precomputed fixed-base tables, so this is constant time in a and b
+    void addKeys_aGbH(key &aGbH, const key &a, const key &b) {
+        ge_p3 aG, bH;
+        ge_cached bH_cached;
+        ge_p1p1 sum;
+        ge_p2 rv;
+        key a_reduced, b_reduced;
+        // the table lookups need a[31] <= 127, reducing keeps any 256 bit scalar valid as with addKeys2
+        sc_reduce32copy(a_reduced.bytes, a.bytes);
+        sc_reduce32copy(b_reduced.bytes, b.bytes);
+        ge_scalarmult_base(&aG, a_reduced.bytes);
+        ge_scalarmult_fixed_base(&bH, b_reduced.bytes, get_H_fixed_base_table());
+        ge_p3_to_cached(&bH_cached, &bH);
+        ge_add(&sum, &aG, &bH_cached);
+        ge_p1p1_to_p2(&rv, &sum);
+        ge_tobytes(aGbH.bytes, &rv);
+    }
+
     //Does some precomputation to make addKeys3 more efficient
     // input B a curve point and output a ge_dsmp which has precomputation applied
     void precomp(ge_dsmp rv, const key & B) {
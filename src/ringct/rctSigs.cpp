@@ -29,6 +29,9 @@
 // STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include <deque>
+#include <unordered_map>
+
 #include "misc_log_ex.h"
 #include "misc_language.h"
 #include "common/perf_timer.h"
@@ -75,7 +78,7 @@ namespace
             sv.bytes[6] = (outamounts[i] >> 48) & 255;
             sv.bytes[7] = (outamounts[i] >> 56) & 255;
             sc_mul(sv8.bytes, sv.bytes, rct::INV_EIGHT.bytes);
-            rct::addKeys2(C[i], rct::INV_EIGHT, sv8, rct::H);
+            rct::addKeys_aGbH(C[i], rct::INV_EIGHT, sv8);
         }
 
         return rct::Bulletproof{rct::keyV(n_outs, I), I, I, I, I, I, I, rct::keyV(nrl, I), rct::keyV(nrl, I), I, I, I};
@@ -106,7 +109,7 @@ namespace
             sv.bytes[6] = (outamounts[i] >> 48) & 255;
             sv.bytes[7] = (outamounts[i] >> 56) & 255;
             sc_mul(sv8.bytes, sv.bytes, rct::INV_EIGHT.bytes);
-            rct::addKeys2(C[i], rct::INV_EIGHT, sv8, rct::H);
+            rct::addKeys_aGbH(C[i], rct::INV_EIGHT, sv8);
         }
 
         return rct::BulletproofPlus{rct::keyV(n_outs, I), I, I, I, I, I, I, rct::keyV(nrl, I), rct::keyV(nrl, I)};
@@ -531,9 +534,8 @@ namespace rct {
         // Compute R = r * G
         proof.R = rct::scalarmultBase(r);
         
-        // Compute the commitment to the difference
-        rct::key comm_diff;
-        genC(comm_diff, difference, 0);
+        // Compute the commitment to the difference (a zero amount, so just difference * G)
+        rct::key comm_diff = rct::scalarmultBase(difference);
         
         // Calculate challenge c = H_p(R)
         std::vector<rct::key> keys{proof.R, comm_diff};
@@ -908,7 +910,17 @@ namespace rct {
         catch (...) { return false; }
     }
 
-    bool verRctCLSAGSimple(const key &message, const clsag &sig, const ctkeyV & pubs, const key & C_offset) {
+    // Ring member precomputation that does not depend on the signature, shared by every
+    // signature of a clsag_batch that has the member in its ring
+    namespace {
+    struct clsag_ring_precomp {
+        geDsmp P; // the member's public key
+        geDsmp H; // its hash to point
+    };
+    typedef std::unordered_map<key, clsag_ring_precomp> clsag_ring_cache;
+    }
+
+    static bool verRctCLSAGSimple(const key &message, const clsag &sig, const ctkeyV & pubs, const key & C_offset, const clsag_ring_cache *ring_cache) {
         try
         {
             PERF_TIMER(verRctCLSAGSimple);
@@ -992,7 +1004,15 @@ namespace rct {
                 sc_mul(c_c.bytes,mu_C.bytes,c.bytes);
 
                 // Precompute points for L/R
-                precomp(P_precomp.k,pubs[i].dest);
+                const clsag_ring_precomp *member = NULL;
+                if (ring_cache)
+                {
+                    const auto it = ring_cache->find(pubs[i].dest);
+                    if (it != ring_cache->end())
+                        member = &it->second;
+                }
+                if (!member)
+                    precomp(P_precomp.k,pubs[i].dest);
 
                 CHECK_AND_ASSERT_MES(ge_frombytes_vartime(&temp_p3, pubs[i].mask.bytes) == 0, false, "point conv failed");
                 ge_sub(&temp_p1,&temp_p3,&C_offset_cached);
@@ -1000,12 +1020,15 @@ namespace rct {
                 ge_dsm_precomp(C_precomp.k,&temp_p3);
 
                 // Compute L
-                addKeys_aGbBcC(L,sig.s[i],c_p,P_precomp.k,c_c,C_precomp.k);
+                addKeys_aGbBcC(L,sig.s[i],c_p,member ? member->P.k : P_precomp.k,c_c,C_precomp.k);
 
                 // Compute R
-                hash_to_p3(hash8_p3,pubs[i].dest);
-                ge_dsm_precomp(hash_precomp.k, &hash8_p3);
-                addKeys_aAbBcC(R,sig.s[i],hash_precomp.k,c_p,I_precomp.k,c_c,D_precomp.k);
+                if (!member)
+                {
+                    hash_to_p3(hash8_p3,pubs[i].dest);
+                    ge_dsm_precomp(hash_precomp.k, &hash8_p3);
+                }
+                addKeys_aAbBcC(R,sig.s[i],member ? member->H.k : hash_precomp.k,c_p,I_precomp.k,c_c,D_precomp.k);
 
                 c_to_hash[2*n+3] = L;
                 c_to_hash[2*n+4] = R;
@@ -1021,6 +1044,97 @@ namespace rct {
         catch (...) { return false; }
     }
 
+    bool verRctCLSAGSimple(const key &message, const clsag &sig, const ctkeyV & pubs, const key & C_offset) {
+        return verRctCLSAGSimple(message, sig, pubs, C_offset, NULL);
+    }
+
+    void clsag_batch::add(const key &message, const clsag &sig, const ctkeyV &pubs, const key &C_offset, size_t tag)
+    {
+        m_entries.push_back({message, sig, pubs, C_offset, tag});
+    }
+
+    bool clsag_batch::verify(std::vector<size_t> *failed_tags) const
+    {
+        PERF_TIMER(verRctCLSAGBatch);
+        if (m_entries.empty())
+            return true;
+
+        tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+
+        // Ring members seen in more than one signature are only decompressed and hashed
+        // to a point once; the rest are left to the signature that uses them
+        std::unordered_map<key, size_t> uses;
+        for (const entry &e: m_entries)
+            for (const ctkey &member: e.pubs)
+                ++uses[member.dest];
+        clsag_ring_cache ring_cache;
+        for (const auto &u: uses)
+            if (u.second > 1)
+                ring_cache[u.first];
+        if (!ring_cache.empty())
+        {
+            std::vector<clsag_ring_cache::iterator> members;
+            members.reserve(ring_cache.size());
+            for (auto it = ring_cache.begin(); it != ring_cache.end(); ++it)
+                members.push_back(it);
+            std::deque<bool> valid(members.size());
+            tools::threadpool::waiter waiter(tpool);
+            const size_t chunk = std::max<size_t>(1, members.size() / (tpool.get_max_concurrency() * 4));
+            for (size_t start = 0; start < members.size(); start += chunk)
+            {
+                const size_t end = std::min(members.size(), start + chunk);
+                tpool.submit(&waiter, [&, start, end] {
+                    for (size_t i = start; i < end; ++i)
+                    {
+                        clsag_ring_precomp &pc = members[i]->second;
+                        try
+                        {
+                            ge_p3 hash8_p3;
+                            precomp(pc.P.k, members[i]->first);
+                            hash_to_p3(hash8_p3, members[i]->first);
+                            ge_dsm_precomp(pc.H.k, &hash8_p3);
+                            valid[i] = true;
+                        }
+                        catch (...) { valid[i] = false; }
+                    }
+                });
+            }
+            if (!waiter.wait())
+                return false;
+            // invalid points are dropped, so the signatures using them fail on their own
+            for (size_t i = 0; i < members.size(); ++i)
+                if (!valid[i])
+                    ring_cache.erase(members[i]);
+        }
+
+        std::deque<bool> results(m_entries.size());
+        tools::threadpool::waiter waiter(tpool);
+        for (size_t i = 0; i < m_entries.size(); ++i)
+        {
+            tpool.submit(&waiter, [&, i] {
+                const entry &e = m_entries[i];
+                results[i] = verRctCLSAGSimple(e.message, e.sig, e.pubs, e.C_offset, &ring_cache);
+            });
+        }
+        if (!waiter.wait())
+            return false;
+
+        bool ok = true;
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            if (!results[i])
+            {
+                LOG_PRINT_L1("verRctCLSAGSimple failed for batch entry " << i << " (tag " << m_entries[i].tag << ")");
+                ok = false;
+                if (!failed_tags)
+                    break;
+                if (failed_tags->empty() || failed_tags->back() != m_entries[i].tag)
+                    failed_tags->push_back(m_entries[i].tag);
+            }
+        }
+        return ok;
+    }
+
 
     //These functions get keys from blockchain
     //replace these when connecting blockchain
@@ -1395,6 +1509,22 @@ namespace rct {
         
         key full_message = get_pre_mlsag_hash(rv,hwdev);
 
+        // the software device keeps no signing state, so its inputs can be signed concurrently;
+        // hardware devices have to see the inputs one at a time, in order
+        if (is_rct_clsag(rv.type) && inamounts.size() > 1 &&
+            hwdev.get_mode() != hw::device::TRANSACTION_CREATE_FAKE &&
+            hwdev.get_type() == hw::device::device_type::SOFTWARE)
+        {
+            tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+            tools::threadpool::waiter waiter(tpool);
+            for (i = 0 ; i < inamounts.size(); i++)
+                tpool.submit(&waiter, [&, i] {
+                    rv.p.CLSAGs[i] = proveRctCLSAGSimple(full_message, rv.mixRing[i], inSk[i], a[i], pseudoOuts[i], index[i], hwdev);
+                });
+            CHECK_AND_ASSERT_THROW_MES(waiter.wait(), "Failed to sign inputs");
+            return rv;
+        }
+
         for (i = 0 ; i < inamounts.size(); i++)
         {
             if (is_rct_clsag(rv.type))
@@ -1711,6 +1841,33 @@ namespace rct {
       }
     }
 
+    bool verRctNonSemanticsSimpleBatched(const rctSig & rv, clsag_batch &batch, size_t tag) {
+      if (!is_rct_clsag(rv.type))
+        return verRctNonSemanticsSimple(rv);
+      try
+      {
+        PERF_TIMER(verRctNonSemanticsSimpleBatched);
+
+        CHECK_AND_ASSERT_MES(rv.p.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.p.pseudoOuts and mixRing");
+        CHECK_AND_ASSERT_MES(rv.p.CLSAGs.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.p.CLSAGs and mixRing");
+
+        const key message = get_pre_mlsag_hash(rv, hw::get_device("default"));
+        for (size_t i = 0; i < rv.mixRing.size(); ++i)
+          batch.add(message, rv.p.CLSAGs[i], rv.mixRing[i], rv.p.pseudoOuts[i], tag);
+        return true;
+      }
+      catch (const std::exception &e)
+      {
+        LOG_PRINT_L1("Error in verRctNonSemanticsSimpleBatched: " << e.what());
+        return false;
+      }
+      catch (...)
+      {
+        LOG_PRINT_L1("Error in verRctNonSemanticsSimpleBatched, but not an actual exception");
+        return false;
+      }
+    }
+
     //RingCT protocol
     //genRct: 
     //   creates an rctSig with all data necessary to verify the rangeProofs and that the signer owns one of the
@@ -1737,7 +1894,7 @@ namespace rct {
         key Ctmp;
         CHECK_AND_ASSERT_THROW_MES(sc_check(mask.bytes) == 0, "warning, bad ECDH mask");
         CHECK_AND_ASSERT_THROW_MES(sc_check(amount.bytes) == 0, "warning, bad ECDH amount");
-        addKeys2(Ctmp, mask, amount, H);
+        addKeys_aGbH(Ctmp, mask, amount);
         DP("Ctmp");
         DP(Ctmp);
         if (equalKeys(C, Ctmp) == false) {
@@ -1768,7 +1925,7 @@ namespace rct {
         key Ctmp;
         CHECK_AND_ASSERT_THROW_MES(sc_check(mask.bytes) == 0, "warning, bad ECDH mask");
         CHECK_AND_ASSERT_THROW_MES(sc_check(amount.bytes) == 0, "warning, bad ECDH amount");
-        addKeys2(Ctmp, mask, amount, H);
+        addKeys_aGbH(Ctmp, mask, amount);
         DP("Ctmp");
         DP(Ctmp);
         if (equalKeys(C, Ctmp) == false) {
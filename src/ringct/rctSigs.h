@@ -85,6 +85,31 @@ namespace rct {
     clsag proveRctCLSAGSimple(const key &, const ctkeyV &, const ctkey &, const key &, const key &, unsigned int, hw::device &);
     bool verRctCLSAGSimple(const key &, const clsag &, const ctkeyV &, const key &);
 
+    // CLSAGs from any number of transactions, verified together by verify(): ring members
+    // shared between signatures are precomputed once, and the signatures are checked in
+    // parallel on the compute threadpool. Each entry carries a caller chosen tag (e.g. the
+    // index of its transaction) so that failures can be traced back to their source.
+    class clsag_batch
+    {
+    public:
+        void add(const key &message, const clsag &sig, const ctkeyV &pubs, const key &C_offset, size_t tag);
+        // on failure, failed_tags (if given) gets the tags of all failing entries
+        bool verify(std::vector<size_t> *failed_tags = NULL) const;
+        size_t size() const { return m_entries.size(); }
+        bool empty() const { return m_entries.empty(); }
+        void clear() { m_entries.clear(); }
+
+    private:
+        struct entry {
+            key message;
+            clsag sig;
+            ctkeyV pubs;
+            key C_offset;
+            size_t tag;
+        };
+        std::vector<entry> m_entries;
+    };
+
     zk_proof PRProof_Gen(const rct::key &difference);
     bool PRProof_Ver(const rct::key &C, const zk_proof &proof);
   
@@ -177,6 +202,8 @@ namespace rct {
     static inline bool verRct(const rctSig & rv) { return verRct(rv, true) && verRct(rv, false); }
     bool verRctSemanticsSimple(const rctSig & rv, const uint64_t amount_burnt=0);
     bool verRctNonSemanticsSimple(const rctSig & rv);
+    // as verRctNonSemanticsSimple, but CLSAGs are queued on batch under tag instead of being checked
+    bool verRctNonSemanticsSimpleBatched(const rctSig & rv, clsag_batch &batch, size_t tag);
   static inline bool verRctSimple(const rctSig & rv, const uint64_t amount_burnt=0) { return verRctSemanticsSimple(rv, amount_burnt) && verRctNonSemanticsSimple(rv); }
     xmr_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, key & mask, hw::device &hwdev);
     xmr_amount decodeRct(const rctSig & rv, const key & sk, unsigned int i, hw::device &hwdev);
@@ -76,6 +76,12 @@ using namespace epee;
 #define RESTRICTED_SPENT_KEY_IMAGES_COUNT 5000
 #define RESTRICTED_BLOCK_COUNT 1000
 
+#define MAX_CACHED_GET_BLOCKS_SIZE (100*1024*1024) // same cap as Blockchain::find_blockchain_supplement
+
+#define DEFAULT_RPC_BLOCK_CACHE_MIN_DEPTH 720
+
+#define DEFAULT_RPC_THREADS 2
+
 #define RPC_TRACKER(rpc) \
   PERF_TIMER(rpc); \
   RPCTracker tracker(#rpc, PERF_TIMER_NAME(rpc))
@@ -163,6 +169,11 @@ namespace cryptonote
     command_line::add_arg(desc, arg_rpc_payment_difficulty);
     command_line::add_arg(desc, arg_rpc_payment_credits);
     command_line::add_arg(desc, arg_rpc_payment_allow_free_loopback);
+    command_line::add_arg(desc, arg_rpc_block_cache_size);
+    command_line::add_arg(desc, arg_rpc_block_cache_min_depth);
+    command_line::add_arg(desc, arg_rpc_threads);
+    command_line::add_arg(desc, arg_rpc_reactor_per_thread);
+    command_line::add_arg(desc, arg_rpc_local_socket);
   }
   //------------------------------------------------------------------------------------------------------------------------------
   core_rpc_server::core_rpc_server(
@@ -174,6 +185,7 @@ namespace cryptonote
     , m_was_bootstrap_ever_used(false)
     , disable_rpc_ban(false)
     , m_rpc_payment_allow_free_loopback(false)
+    , m_threads_count(DEFAULT_RPC_THREADS)
   {}
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::set_bootstrap_daemon(
@@ -279,6 +291,7 @@ namespace cryptonote
 
     std::string bind_ip_str = rpc_config->bind_ip;
     std::string bind_ipv6_str = rpc_config->bind_ipv6_address;
+    bool restricted_port_server = false;
     if (restricted)
     {
       const auto restricted_rpc_port_arg = cryptonote::core_rpc_server::arg_rpc_restricted_bind_port;
@@ -287,6 +300,7 @@ namespace cryptonote
       {
         bind_ip_str = rpc_config->restricted_bind_ip;
         bind_ipv6_str = rpc_config->restricted_bind_ipv6_address;
+        restricted_port_server = true;
       }
     }
     disable_rpc_ban = rpc_config->disable_rpc_ban;
@@ -348,6 +362,13 @@ namespace cryptonote
     if (m_rpc_payment)
       m_net_server.add_idle_handler([this](){ return m_rpc_payment->on_idle(); }, 60 * 1000);
 
+    m_threads_count = std::max<size_t>(command_line::get_arg(vm, arg_rpc_threads), 1);
+    m_net_server.set_reactor_per_thread(command_line::get_arg(vm, arg_rpc_reactor_per_thread));
+
+    const uint64_t block_cache_size = command_line::get_arg(vm, arg_rpc_block_cache_size);
+    if (block_cache_size > 0)
+      m_block_cache.reset(new rpc_block_cache(block_cache_size * 1024 * 1024, command_line::get_arg(vm, arg_rpc_block_cache_min_depth)));
+
     bool store_ssl_key = !restricted && rpc_config->ssl_options && rpc_config->ssl_options.auth.certificate_path.empty();
     const auto ssl_base_path = (boost::filesystem::path{data_dir} / "rpc_ssl").string();
     const bool ssl_cert_file_exists = boost::filesystem::exists(ssl_base_path + ".crt");
@@ -378,6 +399,14 @@ namespace cryptonote
 
     m_net_server.get_config_object().m_max_content_length = MAX_RPC_CONTENT_LENGTH;
 
+    // the local socket mirrors the main RPC server, never the extra restricted one
+    const std::string local_socket = command_line::get_arg(vm, arg_rpc_local_socket);
+    if (inited && !restricted_port_server && !local_socket.empty() && !init_local(local_socket))
+    {
+      MFATAL("Failed to bind RPC local socket " << local_socket);
+      return false;
+    }
+
     if (store_ssl_key && inited)
     {
       // new keys were generated, store for next run
@@ -463,10 +492,19 @@ namespace cryptonote
     if (use_bootstrap_daemon_if_necessary<COMMAND_RPC_GET_HEIGHT>(invoke_http_mode::JON, "/getheight", req, res, r))
       return r;
 
-    crypto::hash hash;
-    m_core.get_blockchain_top(res.height, hash);
-    ++res.height; // block height to chain height
-    res.hash = string_tools::pod_to_hex(hash);
+    const std::shared_ptr<const Blockchain::tip_snapshot> tip = m_core.get_blockchain_storage().get_tip_snapshot();
+    if (tip)
+    {
+      res.height = tip->height;
+      res.hash = string_tools::pod_to_hex(tip->top_hash);
+    }
+    else
+    {
+      crypto::hash hash;
+      m_core.get_blockchain_top(res.height, hash);
+      ++res.height; // block height to chain height
+      res.hash = string_tools::pod_to_hex(hash);
+    }
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -495,16 +533,45 @@ namespace cryptonote
 
     const bool restricted = m_restricted && ctx;
 
+    // chain tip data comes from the published snapshot, so polling this does
+    // not wait on the blockchain lock while blocks are being added; until the
+    // first snapshot is published, it is read under the lock instead
+    Blockchain &blockchain = m_core.get_blockchain_storage();
+    const std::shared_ptr<const Blockchain::tip_snapshot> tip = blockchain.get_tip_snapshot();
     crypto::hash top_hash;
-    m_core.get_blockchain_top(res.height, top_hash);
-    ++res.height; // turn top block height into blockchain height
+    difficulty_type next_difficulty, cumulative_difficulty;
+    uint64_t total_transactions, alt_blocks_count, adjusted_time;
+    if (tip)
+    {
+      res.height = tip->height;
+      top_hash = tip->top_hash;
+      next_difficulty = tip->next_difficulty;
+      cumulative_difficulty = tip->top_cumulative_difficulty;
+      total_transactions = tip->total_transactions;
+      alt_blocks_count = tip->alt_blocks_count;
+      res.block_size_limit = res.block_weight_limit = tip->block_weight_limit;
+      res.block_size_median = res.block_weight_median = tip->block_weight_median;
+      adjusted_time = tip->adjusted_time;
+    }
+    else
+    {
+      m_core.get_blockchain_top(res.height, top_hash);
+      ++res.height; // turn top block height into blockchain height
+      next_difficulty = blockchain.get_difficulty_for_next_block();
+      cumulative_difficulty = blockchain.get_db().get_block_cumulative_difficulty(res.height - 1);
+      total_transactions = blockchain.get_total_transactions();
+      alt_blocks_count = blockchain.get_alternative_blocks_count();
+      res.block_size_limit = res.block_weight_limit = blockchain.get_current_cumulative_block_weight_limit();
+      res.block_size_median = res.block_weight_median = blockchain.get_current_cumulative_block_weight_median();
+      adjusted_time = blockchain.get_adjusted_time(res.height);
+    }
     res.top_block_hash = string_tools::pod_to_hex(top_hash);
     res.target_height = m_p2p.get_payload_object().is_synchronized() ? 0 : m_core.get_target_blockchain_height();
-    store_difficulty(m_core.get_blockchain_storage().get_difficulty_for_next_block(), res.difficulty, res.wide_difficulty, res.difficulty_top64);
-    res.target = m_core.get_blockchain_storage().get_difficulty_target();
-    res.tx_count = m_core.get_blockchain_storage().get_total_transactions() - res.height; //without coinbase
+    store_difficulty(next_difficulty, res.difficulty, res.wide_difficulty, res.difficulty_top64);
+    res.target = blockchain.get_difficulty_target();
+    res.tx_count = total_transactions - res.height; //without coinbase
     res.tx_pool_size = m_core.get_pool_transactions_count(!restricted);
-    res.alt_blocks_count = restricted ? 0 : m_core.get_blockchain_storage().get_alternative_blocks_count();
+    res.alt_blocks_count = restricted ? 0 : alt_blocks_count;
     uint64_t total_conn = restricted ? 0 : m_p2p.get_public_connections_count();
     res.outgoing_connections_count = restricted ? 0 : m_p2p.get_public_outgoing_connections_count();
     res.incoming_connections_count = restricted ? 0 : (total_conn - res.outgoing_connections_count);
@@ -517,11 +584,11 @@ namespace cryptonote
     res.testnet = net_type == TESTNET;
     res.stagenet = net_type == STAGENET;
     res.nettype = net_type == MAINNET ? "mainnet" : net_type == TESTNET ? "testnet" : net_type == STAGENET ? "stagenet" : "fakechain";
-    store_difficulty(m_core.get_blockchain_storage().get_db().get_block_cumulative_difficulty(res.height - 1),
-        res.cumulative_difficulty, res.wide_cumulative_difficulty, res.cumulative_difficulty_top64);
-    res.block_size_limit = res.block_weight_limit = m_core.get_blockchain_storage().get_current_cumulative_block_weight_limit();
-    res.block_size_median = res.block_weight_median = m_core.get_blockchain_storage().get_current_cumulative_block_weight_median();
-    res.adjusted_time = m_core.get_blockchain_storage().get_adjusted_time(res.height);
+    store_difficulty(cumulative_difficulty, res.cumulative_difficulty, res.wide_cumulative_difficulty, res.cumulative_difficulty_top64);
+    // with too few blocks for a median, the adjusted time is the current time;
+    // otherwise the projection was taken when the tip was, and must not run ahead of the clock
+    const uint64_t now = time(NULL);
+    res.adjusted_time = res.height < BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW ? now : std::min(adjusted_time, now);
 
     res.start_time = restricted ? 0 : (uint64_t)m_core.get_start_time();
     res.free_space = restricted ? std::numeric_limits<uint64_t>::max() : m_core.get_free_space();
@@ -549,6 +616,12 @@ namespace cryptonote
     res.synchronized = check_core_ready();
     res.busy_syncing = m_p2p.get_payload_object().is_busy_syncing();
     res.restricted = restricted;
+    if (m_block_cache && !restricted)
+    {
+      res.block_cache_hits = m_block_cache->get_hits();
+      res.block_cache_misses = m_block_cache->get_misses();
+      res.block_cache_size = m_block_cache->get_bytes();
+    }
 
     res.status = CORE_RPC_STATUS_OK;
     return true;
@@ -702,6 +775,18 @@ namespace cryptonote
         }
       }
 
+      uint8_t cache_flags = 0;
+      if (req.prune)
+        cache_flags |= rpc_block_cache::pruned | (req.no_ring_members ? rpc_block_cache::no_ring_members : 0);
+      if (req.no_miner_tx)
+        cache_flags |= rpc_block_cache::no_miner_tx;
+      if (m_block_cache && get_blocks_from_cache(req, cache_flags, max_blocks, res))
+      {
+        CHECK_PAYMENT_SAME_TS(req, res, res.blocks.size() * COST_PER_BLOCK);
+        res.status = CORE_RPC_STATUS_OK;
+        return true;
+      }
+
       std::vector<std::pair<std::pair<cryptonote::blobdata, crypto::hash>, std::vector<std::pair<crypto::hash, cryptonote::blobdata> > > > bs;
       if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, req.prune, !req.no_miner_tx, max_blocks, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT))
       {
@@ -735,6 +820,14 @@ namespace cryptonote
         res.blocks.back().txs.reserve(bd.second.size());
         for (std::vector<std::pair<crypto::hash, cryptonote::blobdata>>::iterator i = bd.second.begin(); i != bd.second.end(); ++i)
         {
+          // scanning wallets only need the key images of a tx's inputs to
+          // spot their spends, the ring member offsets make up most of what is
+          // left of a pruned tx
+          if (req.prune && req.no_ring_members && !cryptonote::strip_ring_members_from_tx_blob(i->second))
+          {
+            res.status = "Failed to strip ring members";
+            return true;
+          }
           res.blocks.back().txs.push_back({std::move(i->second), crypto::null_hash});
           i->second.clear();
           i->second.shrink_to_fit();
@@ -773,10 +866,66 @@ namespace cryptonote
         }
       }
       MDEBUG("on_get_blocks: " << bs.size() << " blocks, " << ntxes << " txes, size " << size);
+
+      if (m_block_cache)
+        add_blocks_to_cache(res, cache_flags);
     }
 
     res.status = CORE_RPC_STATUS_OK;
     return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::get_blocks_from_cache(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, uint8_t cache_flags, size_t max_blocks, COMMAND_RPC_GET_BLOCKS_FAST::response& res)
+  {
+    const uint64_t current_height = m_core.get_current_blockchain_height();
+    if (current_height <= m_block_cache->min_depth())
+      return false;
+    const uint64_t cache_height = current_height - m_block_cache->min_depth();
+
+    uint64_t start_height;
+    if (req.start_height > 0)
+      start_height = req.start_height;
+    else if (!m_core.get_blockchain_storage().find_blockchain_supplement(req.block_ids, start_height))
+      return false;
+
+    // only serve from the cache when it holds a full response, a hole or the
+    // end of the cacheable range is left to the database, which refills it
+    std::vector<std::shared_ptr<const rpc_block_cache::entry>> entries;
+    // min_blocks is the 3 find_blockchain_supplement asks the database for
+    if (!m_block_cache->get_run(start_height, cache_height, cache_flags, 3, max_blocks, MAX_CACHED_GET_BLOCKS_SIZE, COMMAND_RPC_GET_BLOCKS_FAST_MAX_TX_COUNT,
+        [this](uint64_t height) { return m_core.get_block_id_by_height(height); }, entries))
+      return false;
+
+    size_t size = 0, ntxes = 0;
+    res.blocks.reserve(entries.size());
+    res.output_indices.reserve(entries.size());
+    res.asset_type_output_indices.reserve(entries.size());
+    for (const auto &e: entries)
+    {
+      size += e->blob_bytes;
+      ntxes += e->block.txs.size();
+      res.blocks.push_back(e->block);
+      res.output_indices.push_back(e->output_indices);
+      res.asset_type_output_indices.push_back(e->asset_type_output_indices);
+    }
+
+    res.start_height = start_height;
+    res.current_height = current_height;
+    MDEBUG("on_get_blocks: " << res.blocks.size() << " blocks from cache, " << ntxes << " txes, size " << size);
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::add_blocks_to_cache(const COMMAND_RPC_GET_BLOCKS_FAST::response& res, uint8_t cache_flags)
+  {
+    if (res.current_height <= m_block_cache->min_depth())
+      return;
+    const uint64_t cache_height = res.current_height - m_block_cache->min_depth();
+    for (size_t i = 0; i < res.blocks.size() && res.start_height + i < cache_height; ++i)
+    {
+      const uint64_t height = res.start_height + i;
+      m_block_cache->add(height, cache_flags, std::make_shared<const rpc_block_cache::entry>(m_core.get_block_id_by_height(height),
+          res.blocks[i], res.output_indices[i], res.asset_type_output_indices[i]));
+    }
   }
     bool core_rpc_server::on_get_alt_blocks_hashes(const COMMAND_RPC_GET_ALT_BLOCKS_HASHES::request& req, COMMAND_RPC_GET_ALT_BLOCKS_HASHES::response& res, const connection_context *ctx)
     {
@@ -823,8 +972,18 @@ namespace cryptonote
     res.blocks.clear();
     res.blocks.reserve(req.heights.size());
     CHECK_PAYMENT_MIN1(req, res, req.heights.size() * COST_PER_BLOCK, false);
+    const uint64_t cache_height = m_block_cache && m_core.get_current_blockchain_height() > m_block_cache->min_depth() ? m_core.get_current_blockchain_height() - m_block_cache->min_depth() : 0;
     for (uint64_t height : req.heights)
     {
+      if (height < cache_height)
+      {
+        const std::shared_ptr<const rpc_block_cache::entry> e = m_block_cache->get(height, rpc_block_cache::by_height);
+        if (e && e->hash == m_core.get_block_id_by_height(height))
+        {
+          res.blocks.push_back(e->block);
+          continue;
+        }
+      }
       block blk;
       try
       {
@@ -842,6 +1001,8 @@ namespace cryptonote
       res.blocks.back().block = block_to_blob(blk);
       for (auto& tx : txs)
         res.blocks.back().txs.push_back({tx_to_blob(tx), crypto::null_hash});
+      if (height < cache_height && missed_txs.empty())
+        m_block_cache->add(height, rpc_block_cache::by_height, std::make_shared<const rpc_block_cache::entry>(get_block_hash(blk), res.blocks.back()));
     }
     res.status = CORE_RPC_STATUS_OK;
     return true;
@@ -2344,6 +2505,31 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::fill_block_header_response(const Blockchain::tip_snapshot& tip, block_header_response& response)
+  {
+    PERF_TIMER(fill_block_header_response);
+    const block &blk = tip.top_block;
+    response.major_version = blk.major_version;
+    response.minor_version = blk.minor_version;
+    response.timestamp = blk.timestamp;
+    response.prev_hash = string_tools::pod_to_hex(blk.prev_id);
+    response.nonce = blk.nonce;
+    response.pricing_record = blk.pricing_record;
+    response.orphan_status = false;
+    response.height = tip.height - 1;
+    response.depth = 0;
+    response.hash = string_tools::pod_to_hex(tip.top_hash);
+    store_difficulty(tip.top_difficulty, response.difficulty, response.wide_difficulty, response.difficulty_top64);
+    store_difficulty(tip.top_cumulative_difficulty, response.cumulative_difficulty, response.wide_cumulative_difficulty, response.cumulative_difficulty_top64);
+    response.reward = get_block_reward(blk);
+    response.block_size = response.block_weight = tip.top_weight;
+    response.num_txes = blk.tx_hashes.size();
+    response.pow_hash = "";
+    response.long_term_weight = tip.top_long_term_weight;
+    response.miner_tx_hash = string_tools::pod_to_hex(cryptonote::get_transaction_hash(blk.miner_tx));
+    response.protocol_tx_hash = string_tools::pod_to_hex(cryptonote::get_transaction_hash(blk.protocol_tx));
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   template <typename COMMAND_TYPE>
   bool core_rpc_server::use_bootstrap_daemon_if_necessary(const invoke_http_mode &mode, const std::string &command_name, const typename COMMAND_TYPE::request& req, typename COMMAND_TYPE::response& res, bool &r)
   {
@@ -2443,6 +2629,18 @@ namespace cryptonote
 
     CHECK_CORE_READY();
     CHECK_PAYMENT_MIN1(req, res, COST_PER_BLOCK_HEADER, false);
+    const bool restricted = m_restricted && ctx;
+    const bool fill_pow_hash = req.fill_pow_hash && !restricted;
+    if (!fill_pow_hash)
+    {
+      const std::shared_ptr<const Blockchain::tip_snapshot> tip = m_core.get_blockchain_storage().get_tip_snapshot();
+      if (tip)
+      {
+        fill_block_header_response(*tip, res.block_header);
+        res.status = CORE_RPC_STATUS_OK;
+        return true;
+      }
+    }
     uint64_t last_block_height;
     crypto::hash last_block_hash;
     m_core.get_blockchain_top(last_block_height, last_block_hash);
@@ -2454,8 +2652,7 @@ namespace cryptonote
       error_resp.message = "Internal error: can't get last block.";
       return false;
     }
-    const bool restricted = m_restricted && ctx;
-    bool response_filled = fill_block_header_response(last_block, false, last_block_height, last_block_hash, res.block_header, req.fill_pow_hash && !restricted);
+    bool response_filled = fill_block_header_response(last_block, false, last_block_height, last_block_hash, res.block_header, fill_pow_hash);
     if (!response_filled)
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
@@ -3059,8 +3256,11 @@ namespace cryptonote
 
     CHECK_PAYMENT(req, res, COST_PER_FEE_ESTIMATE);
 
-    const uint8_t version = m_core.get_blockchain_storage().get_current_hard_fork_version();
-    m_core.get_blockchain_storage().get_dynamic_base_fee_estimate_2021_scaling(req.grace_blocks, res.fees);
+    const std::shared_ptr<const Blockchain::tip_snapshot> tip = m_core.get_blockchain_storage().get_tip_snapshot();
+    if (tip && tip->fee_grace_blocks == req.grace_blocks && !tip->fees.empty())
+      res.fees = tip->fees;
+    else
+      m_core.get_blockchain_storage().get_dynamic_base_fee_estimate_2021_scaling(req.grace_blocks, res.fees);
     res.fee = res.fees[0];
     res.quantization_mask = Blockchain::get_fee_quantization_mask();
     res.status = CORE_RPC_STATUS_OK;
@@ -3351,9 +3551,24 @@ namespace cryptonote
     res.target_height = m_p2p.get_payload_object().is_synchronized() ? 0 : m_core.get_target_blockchain_height();
     res.next_needed_pruning_seed = m_p2p.get_payload_object().get_next_needed_pruning_stripe().second;
 
-    for (const auto &c: m_p2p.get_payload_object().get_connections())
-      res.peers.push_back({c});
     const cryptonote::block_queue &block_queue = m_p2p.get_payload_object().get_block_queue();
+    for (const auto &c: m_p2p.get_payload_object().get_connections())
+    {
+      COMMAND_RPC_SYNC_INFO::peer peer{c, 0, 0, 0, 0};
+      boost::uuids::uuid connection_id;
+      if (epee::string_tools::hex_to_pod(c.connection_id, connection_id))
+      {
+        cryptonote::block_queue::peer_stats stats;
+        if (block_queue.get_peer_stats(connection_id, stats))
+        {
+          peer.spans_measured = stats.spans;
+          peer.bandwidth = stats.bandwidth;
+          peer.latency_ms = stats.latency * 1000;
+        }
+        peer.next_span_blocks = m_p2p.get_payload_object().get_next_span_size(connection_id);
+      }
+      res.peers.push_back(peer);
+    }
     block_queue.foreach([&](const cryptonote::block_queue::span &span) {
       const std::string span_connection_id = epee::string_tools::pod_to_hex(span.connection_id);
       uint32_t speed = (uint32_t)(100.0f * block_queue.get_speed(span.connection_id) + 0.5f);
@@ -3829,4 +4044,34 @@ namespace cryptonote
     , "Allow free access from the loopback address (ie, the local host)"
     , false
     };
+
+  const command_line::arg_descriptor<uint64_t> core_rpc_server::arg_rpc_block_cache_size = {
+      "rpc-block-cache-size"
+    , "Cache up to that many MB of encoded blocks served to syncing wallets, 0 to disable"
+    , 0
+    };
+
+  const command_line::arg_descriptor<uint64_t> core_rpc_server::arg_rpc_block_cache_min_depth = {
+      "rpc-block-cache-min-depth"
+    , "Only cache blocks at least that deep in the chain"
+    , DEFAULT_RPC_BLOCK_CACHE_MIN_DEPTH
+    };
+
+  const command_line::arg_descriptor<size_t> core_rpc_server::arg_rpc_threads = {
+      "rpc-threads"
+    , "Number of threads serving RPC connections"
+    , DEFAULT_RPC_THREADS
+    };
+
+  const command_line::arg_descriptor<bool> core_rpc_server::arg_rpc_reactor_per_thread = {
+      "rpc-reactor-per-thread"
+    , "Give each RPC thread its own event loop and spread connections over them, instead of sharing one"
+    , false
+    };
+
+  const command_line::arg_descriptor<std::string> core_rpc_server::arg_rpc_local_socket = {
+      "rpc-local-socket"
+    , "Also serve RPC on this local (Unix domain) socket, wallets on the same host can connect with --daemon-address unix://<path>"
+    , ""
+    };
 }  // namespace cryptonote
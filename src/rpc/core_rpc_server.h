@@ -43,6 +43,7 @@
 #include "p2p/net_node.h"
 #include "cryptonote_protocol/cryptonote_protocol_handler.h"
 #include "rpc_payment.h"
+#include "rpc_block_cache.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "daemon.rpc"
@@ -77,6 +78,11 @@ namespace cryptonote
     static const command_line::arg_descriptor<uint64_t> arg_rpc_payment_difficulty;
     static const command_line::arg_descriptor<uint64_t> arg_rpc_payment_credits;
     static const command_line::arg_descriptor<bool> arg_rpc_payment_allow_free_loopback;
+    static const command_line::arg_descriptor<uint64_t> arg_rpc_block_cache_size;
+    static const command_line::arg_descriptor<uint64_t> arg_rpc_block_cache_min_depth;
+    static const command_line::arg_descriptor<size_t> arg_rpc_threads;
+    static const command_line::arg_descriptor<bool> arg_rpc_reactor_per_thread;
+    static const command_line::arg_descriptor<std::string> arg_rpc_local_socket;
 
     typedef epee::net_utils::connection_context_base connection_context;
 
@@ -95,6 +101,7 @@ namespace cryptonote
         const std::string& proxy = {}
       );
     network_type nettype() const { return m_core.get_nettype(); }
+    size_t get_threads_count() const { return m_threads_count; }
 
     CHAIN_HTTP_TO_MAP2(connection_context); //forward http requests to uri map
 
@@ -279,6 +286,7 @@ private:
     //utils
     uint64_t get_block_reward(const block& blk);
     bool fill_block_header_response(const block& blk, bool orphan_status, uint64_t height, const crypto::hash& hash, block_header_response& response, bool fill_pow_hash);
+    void fill_block_header_response(const Blockchain::tip_snapshot& tip, block_header_response& response);
     std::map<std::string, bool> get_public_nodes(uint32_t credits_per_hash_threshold = 0);
     bool set_bootstrap_daemon(
       const std::string &address,
@@ -293,6 +301,8 @@ private:
     bool use_bootstrap_daemon_if_necessary(const invoke_http_mode &mode, const std::string &command_name, const typename COMMAND_TYPE::request& req, typename COMMAND_TYPE::response& res, bool &r);
     bool get_block_template(const account_public_address &address, const crypto::hash *prev_block, const cryptonote::blobdata &extra_nonce, size_t &reserved_offset, cryptonote::difficulty_type &difficulty, uint64_t &height, uint64_t &expected_reward, block &b, uint64_t &seed_height, crypto::hash &seed_hash, crypto::hash &next_seed_hash, epee::json_rpc::error &error_resp);
     bool check_payment(const std::string &client, uint64_t payment, const std::string &rpc, bool same_ts, std::string &message, uint64_t &credits, std::string &top_hash);
+    bool get_blocks_from_cache(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, uint8_t cache_flags, size_t max_blocks, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
+    void add_blocks_to_cache(const COMMAND_RPC_GET_BLOCKS_FAST::response& res, uint8_t cache_flags);
     
     core& m_core;
     nodetool::node_server<cryptonote::t_cryptonote_protocol_handler<cryptonote::core> >& m_p2p;
@@ -308,6 +318,8 @@ private:
     std::unique_ptr<rpc_payment> m_rpc_payment;
     bool disable_rpc_ban;
     bool m_rpc_payment_allow_free_loopback;
+    std::unique_ptr<rpc_block_cache> m_block_cache;
+    size_t m_threads_count;
   };
 }
 
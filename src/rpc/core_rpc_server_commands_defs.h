@@ -91,7 +91,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 3
-#define CORE_RPC_VERSION_MINOR 13
+#define CORE_RPC_VERSION_MINOR 15
 #define MAKE_CORE_RPC_VERSION(major,minor) (((major)<<16)|(minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -180,6 +180,7 @@ namespace cryptonote
       bool        prune;
       bool        no_miner_tx;
       uint64_t    pool_info_since;
+      bool        no_ring_members; // with prune, drop ring member offsets from tx inputs, key images are kept
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_request_base)
         KV_SERIALIZE_OPT(requested_info, (uint8_t)0)
@@ -188,6 +189,7 @@ namespace cryptonote
         KV_SERIALIZE(prune)
         KV_SERIALIZE_OPT(no_miner_tx, false)
         KV_SERIALIZE_OPT(pool_info_since, (uint64_t)0)
+        KV_SERIALIZE_OPT(no_ring_members, false)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<request_t> request;
@@ -778,6 +780,9 @@ namespace cryptonote
       std::string version;
       bool synchronized;
       bool restricted;
+      uint64_t block_cache_hits;
+      uint64_t block_cache_misses;
+      uint64_t block_cache_size;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE_PARENT(rpc_access_response_base)
@@ -820,6 +825,9 @@ namespace cryptonote
         KV_SERIALIZE(version)
         KV_SERIALIZE(synchronized)
         KV_SERIALIZE(restricted)
+        KV_SERIALIZE_OPT(block_cache_hits, (uint64_t)0)
+        KV_SERIALIZE_OPT(block_cache_misses, (uint64_t)0)
+        KV_SERIALIZE_OPT(block_cache_size, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
     typedef epee::misc_utils::struct_init<response_t> response;
@@ -2549,9 +2557,17 @@ namespace cryptonote
     struct peer
     {
       connection_info info;
+      uint64_t spans_measured;
+      uint64_t bandwidth;
+      uint32_t latency_ms;
+      uint64_t next_span_blocks;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(info)
+        KV_SERIALIZE_OPT(spans_measured, (uint64_t)0)
+        KV_SERIALIZE_OPT(bandwidth, (uint64_t)0)
+        KV_SERIALIZE_OPT(latency_ms, (uint32_t)0)
+        KV_SERIALIZE_OPT(next_span_blocks, (uint64_t)0)
       END_KV_SERIALIZE_MAP()
     };
 
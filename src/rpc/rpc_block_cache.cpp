@@ -0,0 +1,189 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rpc_block_cache.h"
+
+namespace cryptonote
+{
+  rpc_block_cache::entry::entry(const crypto::hash &hash, block_complete_entry block,
+    COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices output_indices,
+    COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices asset_type_output_indices):
+    hash(hash), block(std::move(block)), output_indices(std::move(output_indices)),
+    asset_type_output_indices(std::move(asset_type_output_indices))
+  {
+    blob_bytes = this->block.block.size();
+    for (const auto &tx: this->block.txs)
+      blob_bytes += tx.blob.size();
+    bytes = sizeof(*this) + blob_bytes + this->block.txs.size() * sizeof(tx_blob_entry);
+    for (const auto &i: this->output_indices.indices)
+      bytes += sizeof(i) + i.indices.size() * sizeof(uint64_t);
+    for (const auto &i: this->asset_type_output_indices.indices)
+      bytes += sizeof(i) + i.indices.size() * sizeof(uint64_t);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  rpc_block_cache::rpc_block_cache(size_t max_bytes, uint64_t min_depth):
+    m_max_shard_bytes(max_bytes / NUM_SHARDS),
+    m_min_depth(min_depth)
+  {
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::shared_ptr<const rpc_block_cache::entry> rpc_block_cache::get(uint64_t height, uint8_t flags)
+  {
+    shard &s = get_shard(height);
+    boost::lock_guard<boost::mutex> lock(s.lock);
+    const auto it = s.entries.find({height, flags});
+    if (it == s.entries.end())
+    {
+      ++s.misses;
+      return nullptr;
+    }
+    ++s.hits;
+    s.lru.splice(s.lru.begin(), s.lru, it->second.second);
+    return it->second.first;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void rpc_block_cache::add(uint64_t height, uint8_t flags, std::shared_ptr<const entry> e)
+  {
+    if (!e || e->bytes > m_max_shard_bytes)
+      return;
+    shard &s = get_shard(height);
+    boost::lock_guard<boost::mutex> lock(s.lock);
+    const key_t key{height, flags};
+    auto it = s.entries.find(key);
+    if (it != s.entries.end())
+    {
+      s.bytes -= it->second.first->bytes;
+      s.lru.erase(it->second.second);
+      s.entries.erase(it);
+    }
+    while (!s.lru.empty() && s.bytes + e->bytes > m_max_shard_bytes)
+    {
+      it = s.entries.find(s.lru.back());
+      s.bytes -= it->second.first->bytes;
+      s.entries.erase(it);
+      s.lru.pop_back();
+    }
+    s.lru.push_front(key);
+    s.bytes += e->bytes;
+    s.entries.emplace(key, std::make_pair(std::move(e), s.lru.begin()));
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool rpc_block_cache::get_run(uint64_t start_height, uint64_t end_height, uint8_t flags, size_t min_blocks, size_t max_blocks, size_t max_bytes, size_t max_txes,
+    const std::function<crypto::hash(uint64_t)> &get_hash, std::vector<std::shared_ptr<const entry>> &entries)
+  {
+    entries.clear();
+    size_t bytes = 0, txes = 0;
+    const auto full = [&]() {
+      return entries.size() >= max_blocks || (entries.size() >= min_blocks && (bytes >= max_bytes || txes >= max_txes));
+    };
+    uint64_t height = start_height;
+    for (; height < end_height && !full(); ++height)
+    {
+      std::shared_ptr<const entry> e = find(height, flags);
+      if (!e || e->hash != get_hash(height))
+        break;
+      bytes += e->blob_bytes;
+      txes += e->block.txs.size();
+      entries.push_back(std::move(e));
+    }
+    if (entries.empty() || !full())
+    {
+      entries.clear();
+      shard &s = get_shard(height);
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      ++s.misses;
+      return false;
+    }
+    for (uint64_t i = 0; i < entries.size(); ++i)
+      touch(start_height + i, flags);
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::shared_ptr<const rpc_block_cache::entry> rpc_block_cache::find(uint64_t height, uint8_t flags)
+  {
+    shard &s = get_shard(height);
+    boost::lock_guard<boost::mutex> lock(s.lock);
+    const auto it = s.entries.find({height, flags});
+    return it == s.entries.end() ? nullptr : it->second.first;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void rpc_block_cache::touch(uint64_t height, uint8_t flags)
+  {
+    shard &s = get_shard(height);
+    boost::lock_guard<boost::mutex> lock(s.lock);
+    ++s.hits;
+    const auto it = s.entries.find({height, flags});
+    if (it != s.entries.end())
+      s.lru.splice(s.lru.begin(), s.lru, it->second.second);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void rpc_block_cache::clear()
+  {
+    for (shard &s: m_shards)
+    {
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      s.entries.clear();
+      s.lru.clear();
+      s.bytes = 0;
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  uint64_t rpc_block_cache::get_hits() const
+  {
+    uint64_t hits = 0;
+    for (const shard &s: m_shards)
+    {
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      hits += s.hits;
+    }
+    return hits;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  uint64_t rpc_block_cache::get_misses() const
+  {
+    uint64_t misses = 0;
+    for (const shard &s: m_shards)
+    {
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      misses += s.misses;
+    }
+    return misses;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  size_t rpc_block_cache::get_bytes() const
+  {
+    size_t bytes = 0;
+    for (const shard &s: m_shards)
+    {
+      boost::lock_guard<boost::mutex> lock(s.lock);
+      bytes += s.bytes;
+    }
+    return bytes;
+  }
+}
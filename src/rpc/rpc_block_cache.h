@@ -0,0 +1,130 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include "crypto/hash.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief Size bounded cache of the per block data served by the block RPCs
+   *
+   * Only blocks buried deeper than min_depth are meant to be added, so entries
+   * are effectively immutable. Callers should still check the cached hash
+   * against the chain before using an entry, to cope with very deep reorgs.
+   * Entries are sharded by height and evicted least recently used first.
+   */
+  class rpc_block_cache
+  {
+  public:
+    enum flags: uint8_t
+    {
+      pruned = 1,
+      no_ring_members = 2,
+      no_miner_tx = 4,
+      by_height = 8,
+    };
+
+    struct entry
+    {
+      crypto::hash hash;
+      block_complete_entry block;
+      COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices output_indices;
+      COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices asset_type_output_indices;
+      size_t bytes; //!< memory held by the entry, charged against the cache size
+      size_t blob_bytes; //!< block and tx blob bytes, charged against a response size
+
+      entry(const crypto::hash &hash, block_complete_entry block,
+        COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices output_indices = {},
+        COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices asset_type_output_indices = {});
+    };
+
+    rpc_block_cache(size_t max_bytes, uint64_t min_depth);
+
+    uint64_t min_depth() const { return m_min_depth; }
+
+    std::shared_ptr<const entry> get(uint64_t height, uint8_t flags);
+    void add(uint64_t height, uint8_t flags, std::shared_ptr<const entry> e);
+
+    /**
+     * @brief Gets the cached entries for the heights from start_height, below end_height
+     *
+     * The run is cut with the same rules as BlockchainDB::get_blocks_from:
+     * it stops at max_blocks, or once it holds min_blocks and its blob bytes
+     * reach max_bytes or its txes reach max_txes. If an entry is missing, or
+     * its hash does not match get_hash, before the run is cut, entries is left
+     * empty and false is returned, so the caller can serve a full response from
+     * the database rather than a short one from the cache. Only a run which is
+     * returned counts as hits.
+     */
+    bool get_run(uint64_t start_height, uint64_t end_height, uint8_t flags, size_t min_blocks, size_t max_blocks, size_t max_bytes, size_t max_txes,
+      const std::function<crypto::hash(uint64_t)> &get_hash, std::vector<std::shared_ptr<const entry>> &entries);
+    void clear();
+
+    uint64_t get_hits() const;
+    uint64_t get_misses() const;
+    size_t get_bytes() const;
+
+  private:
+    typedef std::pair<uint64_t, uint8_t> key_t;
+    struct key_hash
+    {
+      size_t operator()(const key_t &k) const { return std::hash<uint64_t>()(k.first * 16 + k.second); }
+    };
+    struct shard
+    {
+      mutable boost::mutex lock;
+      std::list<key_t> lru;
+      std::unordered_map<key_t, std::pair<std::shared_ptr<const entry>, std::list<key_t>::iterator>, key_hash> entries;
+      size_t bytes = 0;
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+    };
+
+    static constexpr size_t NUM_SHARDS = 16;
+
+    shard &get_shard(uint64_t height) { return m_shards[height % NUM_SHARDS]; }
+    std::shared_ptr<const entry> find(uint64_t height, uint8_t flags);
+    void touch(uint64_t height, uint8_t flags);
+
+    const size_t m_max_shard_bytes;
+    const uint64_t m_min_depth;
+    shard m_shards[NUM_SHARDS];
+  };
+}
@@ -34,16 +34,19 @@
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/thread/locks.hpp>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <stdexcept>
+#include <iterator>
 #include <string>
 #include <utility>
 
 #include "common/expect.h"
+#include "common/varint.h"
 #include "crypto/crypto.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "cryptonote_basic/events.h"
@@ -58,6 +61,7 @@
 namespace
 {
   constexpr const char txpool_signal[] = "tx_signal";
+  constexpr const char chain_signal[] = "chain_signal";
 
   using chain_writer =  void(epee::byte_stream&, std::uint64_t, epee::span<const cryptonote::block>);
   using miner_writer =  void(epee::byte_stream&, uint8_t, uint64_t, const crypto::hash&, const crypto::hash&, cryptonote::difficulty_type, uint64_t, uint64_t, const std::vector<cryptonote::tx_block_template_backlog_entry>&);
@@ -68,6 +72,8 @@ namespace
   {
     char const* const name;
     F* generate_pub;
+    //! Topic is only published when an event has this tx type, `UNSET` matches everything
+    cryptonote::transaction_type tx_type;
   };
 
   template<typename T>
@@ -90,6 +96,15 @@ namespace
     }
   };
 
+  template<cryptonote::transaction_type T>
+  struct is_valid_of
+  {
+    bool operator()(const cryptonote::txpool_event& event) const noexcept
+    {
+      return event.res && event.tx.type == T;
+    }
+  };
+
   template<typename T, std::size_t N>
   void verify_sorted(const std::array<context<T>, N>& elems, const char* name)
   {
@@ -226,8 +241,116 @@ namespace
     json_pub(buf, (txes | adapt::filtered(is_valid{}) | adapt::transformed(to_minimal_tx)));
   }
 
-  constexpr const std::array<context<chain_writer>, 2> chain_contexts =
+  template<cryptonote::transaction_type T>
+  void json_minimal_txpool_of(epee::byte_stream& buf, epee::span<const cryptonote::txpool_event> txes)
+  {
+    namespace adapt = boost::adaptors;
+    const auto to_minimal_tx = [](const cryptonote::txpool_event& event)
+    {
+      return minimal_txpool{event.tx, event.hash, event.blob_size, event.weight, cryptonote::get_tx_fee(event.tx)};
+    };
+    json_pub(buf, (txes | adapt::filtered(is_valid_of<T>{}) | adapt::transformed(to_minimal_tx)));
+  }
+
+  /* The `bin-*` topics use a fixed layout of varints and raw 32-byte hashes,
+     documented per writer below. Tx and block blobs are the consensus
+     serialization, so clients parse them with the same code as P2P data. */
+
+  void bin_varint(epee::byte_stream& buf, const std::uint64_t value)
+  {
+    char bytes[(sizeof(value) * 8 + 6) / 7];
+    char* end = bytes;
+    tools::write_varint(end, value);
+    buf.write(bytes, end - bytes);
+  }
+
+  void bin_hash(epee::byte_stream& buf, const crypto::hash& value)
+  {
+    buf.write(reinterpret_cast<const std::uint8_t*>(value.data), sizeof(value.data));
+  }
+
+  void bin_blob(epee::byte_stream& buf, const cryptonote::blobdata& blob)
+  {
+    bin_varint(buf, blob.size());
+    buf.write(blob.data(), blob.size());
+  }
+
+  //! varint count, then per block: varint size, block blob
+  void bin_full_chain(epee::byte_stream& buf, const std::uint64_t height, const epee::span<const cryptonote::block> blocks)
+  {
+    bin_varint(buf, blocks.size());
+    for (const cryptonote::block& bl : blocks)
+      bin_blob(buf, cryptonote::block_to_blob(bl));
+  }
+
+  //! varint first_height, first_prev_id, varint count, then count block ids
+  void bin_minimal_chain(epee::byte_stream& buf, const std::uint64_t height, const epee::span<const cryptonote::block> blocks)
+  {
+    assert(!blocks.empty()); // checked in zmq_pub::send_chain_main
+
+    bin_varint(buf, height);
+    bin_hash(buf, blocks[0].prev_id);
+    bin_varint(buf, blocks.size());
+    for (const cryptonote::block& bl : blocks)
+    {
+      crypto::hash id;
+      if (!get_block_hash(bl, id))
+        MERROR("ZMQ/Pub failure: get_block_hash");
+      bin_hash(buf, id);
+    }
+  }
+
+  //! varint count, then per tx: varint size, tx blob
+  template<typename Filter>
+  void bin_full_txpool_filtered(epee::byte_stream& buf, epee::span<const cryptonote::txpool_event> txes)
+  {
+    const Filter filter{};
+    bin_varint(buf, std::count_if(txes.begin(), txes.end(), filter));
+    for (const cryptonote::txpool_event& event : txes)
+    {
+      if (filter(event))
+        bin_blob(buf, cryptonote::tx_to_blob(event.tx));
+    }
+  }
+
+  //! varint count, then per tx: id, varint blob_size, varint weight, varint fee, varint type
+  template<typename Filter>
+  void bin_minimal_txpool_filtered(epee::byte_stream& buf, epee::span<const cryptonote::txpool_event> txes)
+  {
+    const Filter filter{};
+    bin_varint(buf, std::count_if(txes.begin(), txes.end(), filter));
+    for (const cryptonote::txpool_event& event : txes)
+    {
+      if (!filter(event))
+        continue;
+      bin_hash(buf, event.hash);
+      bin_varint(buf, event.blob_size);
+      bin_varint(buf, event.weight);
+      bin_varint(buf, cryptonote::get_tx_fee(event.tx));
+      bin_varint(buf, std::uint64_t(event.tx.type));
+    }
+  }
+
+  void bin_full_txpool(epee::byte_stream& buf, epee::span<const cryptonote::txpool_event> txes)
+  {
+    bin_full_txpool_filtered<is_valid>(buf, txes);
+  }
+
+  void bin_minimal_txpool(epee::byte_stream& buf, epee::span<const cryptonote::txpool_event> txes)
+  {
+    bin_minimal_txpool_filtered<is_valid>(buf, txes);
+  }
+
+  template<cryptonote::transaction_type T>
+  void bin_minimal_txpool_of(epee::byte_stream& buf, epee::span<const cryptonote::txpool_event> txes)
+  {
+    bin_minimal_txpool_filtered<is_valid_of<T>>(buf, txes);
+  }
+
+  constexpr const std::array<context<chain_writer>, 4> chain_contexts =
   {{
+    {u8"bin-full-chain_main", bin_full_chain},
+    {u8"bin-minimal-chain_main", bin_minimal_chain},
     {u8"json-full-chain_main", json_full_chain},
     {u8"json-minimal-chain_main", json_minimal_chain}
   }};
@@ -237,10 +360,25 @@ namespace
     {u8"json-full-miner_data", json_miner_data},
   }};
 
-  constexpr const std::array<context<txpool_writer>, 2> txpool_contexts =
+  /* `txtype_*` topics only carry txes of one type, and are not published when
+     an event has none. They use their own prefix, so subscribers to `json-` or
+     `bin-` do not receive the same tx twice. */
+  constexpr const std::array<context<txpool_writer>, 14> txpool_contexts =
   {{
+    {u8"bin-full-txpool_add", bin_full_txpool},
+    {u8"bin-minimal-txpool_add", bin_minimal_txpool},
     {u8"json-full-txpool_add", json_full_txpool},
-    {u8"json-minimal-txpool_add", json_minimal_txpool}
+    {u8"json-minimal-txpool_add", json_minimal_txpool},
+    {u8"txtype_burn-bin-minimal-txpool_add", bin_minimal_txpool_of<cryptonote::transaction_type::BURN>, cryptonote::transaction_type::BURN},
+    {u8"txtype_burn-json-minimal-txpool_add", json_minimal_txpool_of<cryptonote::transaction_type::BURN>, cryptonote::transaction_type::BURN},
+    {u8"txtype_convert-bin-minimal-txpool_add", bin_minimal_txpool_of<cryptonote::transaction_type::CONVERT>, cryptonote::transaction_type::CONVERT},
+    {u8"txtype_convert-json-minimal-txpool_add", json_minimal_txpool_of<cryptonote::transaction_type::CONVERT>, cryptonote::transaction_type::CONVERT},
+    {u8"txtype_return-bin-minimal-txpool_add", bin_minimal_txpool_of<cryptonote::transaction_type::RETURN>, cryptonote::transaction_type::RETURN},
+    {u8"txtype_return-json-minimal-txpool_add", json_minimal_txpool_of<cryptonote::transaction_type::RETURN>, cryptonote::transaction_type::RETURN},
+    {u8"txtype_stake-bin-minimal-txpool_add", bin_minimal_txpool_of<cryptonote::transaction_type::STAKE>, cryptonote::transaction_type::STAKE},
+    {u8"txtype_stake-json-minimal-txpool_add", json_minimal_txpool_of<cryptonote::transaction_type::STAKE>, cryptonote::transaction_type::STAKE},
+    {u8"txtype_transfer-bin-minimal-txpool_add", bin_minimal_txpool_of<cryptonote::transaction_type::TRANSFER>, cryptonote::transaction_type::TRANSFER},
+    {u8"txtype_transfer-json-minimal-txpool_add", json_minimal_txpool_of<cryptonote::transaction_type::TRANSFER>, cryptonote::transaction_type::TRANSFER}
   }};
 
   template<typename T, std::size_t N>
@@ -282,6 +420,24 @@ namespace
     }
   }
 
+  //! Drop subscriptions to `txtype_*` topics without a matching tx in `events`
+  template<std::size_t N>
+  void filter_tx_types(std::array<std::size_t, N>& subs, const std::array<context<txpool_writer>, N>& contexts, const epee::span<const cryptonote::txpool_event> events)
+  {
+    std::array<bool, cryptonote::transaction_type::MAX + 1> present{{}};
+    for (const cryptonote::txpool_event& event : events)
+    {
+      if (event.res && std::size_t(event.tx.type) < present.size())
+        present[event.tx.type] = true;
+    }
+
+    for (std::size_t i = 0; i < N; ++i)
+    {
+      if (contexts[i].tx_type != cryptonote::transaction_type::UNSET && !present[contexts[i].tx_type])
+        subs[i] = 0;
+    }
+  }
+
   template<std::size_t N, typename T, typename... U>
   std::array<epee::byte_slice, N> make_pubs(const std::array<std::size_t, N>& subs, const std::array<context<T>, N>& contexts, U&&... args)
   {
@@ -326,7 +482,15 @@ namespace
     return count;
   }
 
-  expect<bool> relay_block_pub(void* const relay, void* const pub) noexcept
+  //! What `relay_block_pub` found on the relay socket
+  enum class relayed
+  {
+    message, //!< A serialized message, already forwarded to pub
+    txpool,  //!< `txpool_signal`, the events are in `zmq_pub::txes_`
+    chain    //!< `chain_signal`, the blocks are in `zmq_pub::chains_`
+  };
+
+  expect<relayed> relay_block_pub(void* const relay, void* const pub) noexcept
   {
     zmq_msg_t msg;
     zmq_msg_init(std::addressof(msg));
@@ -337,20 +501,21 @@ namespace
       zmq_msg_size(std::addressof(msg))
     };
 
-    if (payload == txpool_signal)
+    if (payload == txpool_signal || payload == chain_signal)
     {
+      const relayed kind = payload == txpool_signal ? relayed::txpool : relayed::chain;
       zmq_msg_close(std::addressof(msg));
-      return false;
+      return kind;
     }
 
-    // forward block messages (serialized on P2P thread for now)
+    // forward miner data messages (serialized on the notifying thread)
     const expect<void> sent = net::zmq::retry_op(zmq_msg_send, std::addressof(msg), pub, ZMQ_DONTWAIT);
     if (!sent)
     {
       zmq_msg_close(std::addressof(msg));
       return sent.error();
     }
-    return true;
+    return relayed::message;
   }
 } // anonymous
 
@@ -359,9 +524,15 @@ namespace cryptonote { namespace listener
 
 zmq_pub::zmq_pub(void* context)
   : relay_(),
+    txes_(),
+    chains_(),
     chain_subs_{{0}},
     miner_subs_{{0}},
     txpool_subs_{{0}},
+    txpool_batch_(0),
+    batch_due_(),
+    batch_open_(false),
+    batch_deferred_(false),
     sync_()
 {
   if (!context)
@@ -419,35 +590,112 @@ bool zmq_pub::sub_request(boost::string_ref message)
   return false;
 }
 
+void zmq_pub::set_txpool_batch(const std::chrono::milliseconds interval)
+{
+  const boost::lock_guard<boost::mutex> lock{sync_};
+  txpool_batch_ = std::max(std::chrono::milliseconds{0}, interval);
+  batch_open_ = false;
+}
+
+void zmq_pub::publish_txpool(boost::unique_lock<boost::mutex>& lock, void* const pub)
+{
+  assert(lock.owns_lock());
+  assert(!txes_.empty());
+
+  auto subs = txpool_subs_;
+  std::vector<cryptonote::txpool_event> events = std::move(txes_.front());
+  txes_.pop_front();
+  if (txes_.empty())
+    batch_open_ = false;
+  batch_deferred_ = false;
+  lock.unlock();
+
+  filter_tx_types(subs, txpool_contexts, epee::to_span(events));
+  auto messages = make_pubs(subs, txpool_contexts, epee::to_span(events));
+  send_messages(pub, messages);
+  lock.lock();
+}
+
 bool zmq_pub::relay_to_pub(void* const relay, void* const pub)
 {
-  const expect<bool> relayed = relay_block_pub(relay, pub);
-  if (!relayed)
+  const expect<relayed> kind = relay_block_pub(relay, pub);
+  if (!kind)
   {
-    MERROR("Error relaying ZMQ/Pub: " << relayed.error().message());
+    MERROR("Error relaying ZMQ/Pub: " << kind.error().message());
     return false;
   }
 
-  if (!*relayed)
+  switch (*kind)
   {
-    std::array<std::size_t, 2> subs;
-    std::vector<cryptonote::txpool_event> events;
-    {
-      const boost::lock_guard<boost::mutex> lock{sync_};
-      if (txes_.empty())
-        return false;
+  case relayed::txpool:
+  {
+    boost::unique_lock<boost::mutex> lock{sync_};
+
+    // a newer batch being relayed means the deferred one is complete
+    if (batch_deferred_)
+      publish_txpool(lock, pub);
+    if (txes_.empty())
+      return false;
 
-      subs = txpool_subs_;
-      events = std::move(txes_.front());
-      txes_.pop_front();
+    if (batch_open_ && txes_.size() == 1 && std::chrono::steady_clock::now() < batch_due_)
+    {
+      batch_deferred_ = true;
+      MDEBUG("Deferred txpool ZMQ/Pub until batch is due");
+      return true;
     }
-    auto messages = make_pubs(subs, txpool_contexts, epee::to_span(events));
-    send_messages(pub, messages);
+    publish_txpool(lock, pub);
     MDEBUG("Sent txpool ZMQ/Pub");
+    break;
   }
-  else
+  case relayed::chain:
+  {
+    boost::unique_lock<boost::mutex> lock{sync_};
+
+    // txes must be published before the blocks containing them
+    if (batch_deferred_)
+      publish_txpool(lock, pub);
+    if (chains_.empty())
+      return false;
+
+    const auto subs = chain_subs_;
+    const chain_event event = std::move(chains_.front());
+    chains_.pop_front();
+    lock.unlock();
+
+    auto messages = make_pubs(subs, chain_contexts, event.height, epee::to_span(event.blocks));
+    send_messages(pub, messages);
     MDEBUG("Sent chain_main ZMQ/Pub");
+    break;
+  }
+  default:
+    MDEBUG("Sent miner_data ZMQ/Pub");
+    break;
+  }
+
+  return true;
+}
+
+long zmq_pub::txpool_flush_timeout()
+{
+  const boost::lock_guard<boost::mutex> lock{sync_};
+  if (!batch_deferred_)
+    return -1;
+
+  const auto now = std::chrono::steady_clock::now();
+  if (batch_due_ <= now)
+    return 0;
+  // round up, waking early would only poll again
+  return std::chrono::duration_cast<std::chrono::milliseconds>(batch_due_ - now).count() + 1;
+}
+
+bool zmq_pub::flush_txpool(void* const pub)
+{
+  boost::unique_lock<boost::mutex> lock{sync_};
+  if (!batch_deferred_ || std::chrono::steady_clock::now() < batch_due_)
+    return false;
 
+  publish_txpool(lock, pub);
+  MDEBUG("Sent txpool ZMQ/Pub batch");
   return true;
 }
 
@@ -456,9 +704,6 @@ std::size_t zmq_pub::send_chain_main(const std::uint64_t height, const epee::spa
   if (blocks.empty())
     return 0;
 
-  /* Block format only sends one block at a time - multiple block notifications
-     are less common and only occur on rollbacks. */
-
   boost::unique_lock<boost::mutex> guard{sync_};
 
   const auto subs_copy = chain_subs_;
@@ -469,12 +714,20 @@ std::size_t zmq_pub::send_chain_main(const std::uint64_t height, const epee::spa
     if (sub)
     {
       /* cryptonote_core/blockchain.cpp cannot "give" us the block like core
-         does for txpool events. Since copying the block is expensive anyway,
-         serialization is done right here on the p2p thread (for now). */
+         does for txpool events. Copying is still much cheaper than
+         serializing, which is done by the relay thread. */
 
-        auto messages = make_pubs(subs_copy, chain_contexts, height, blocks);
-        guard.lock();
-        return send_messages(relay_.get(), messages);
+      chain_event event{height, {blocks.begin(), blocks.end()}};
+      guard.lock();
+      const expect<void> sent = net::zmq::retry_op(zmq_send_const, relay_.get(), chain_signal, sizeof(chain_signal) - 1, ZMQ_DONTWAIT);
+      if (sent)
+      {
+        chains_.push_back(std::move(event));
+        batch_open_ = false; // later txes must not be published before these blocks
+      }
+      else
+        MERROR("ZMQ/Pub failure, relay queue error: " << sent.error().message());
+      return bool(sent);
     }
   }
   return 0;
@@ -509,9 +762,22 @@ std::size_t zmq_pub::send_txpool_add(std::vector<txpool_event> txes)
   {
     if (sub)
     {
+      const auto now = std::chrono::steady_clock::now();
+      if (batch_open_ && now < batch_due_)
+      {
+        assert(!txes_.empty());
+        std::vector<txpool_event>& batch = txes_.back();
+        batch.insert(batch.end(), std::make_move_iterator(txes.begin()), std::make_move_iterator(txes.end()));
+        return 0;
+      }
+
       const expect<void> sent = net::zmq::retry_op(zmq_send_const, relay_.get(), txpool_signal, sizeof(txpool_signal) - 1, ZMQ_DONTWAIT);
       if (sent)
+      {
         txes_.emplace_back(std::move(txes));
+        batch_open_ = txpool_batch_.count() != 0;
+        batch_due_ = now + txpool_batch_;
+      }
       else
         MERROR("ZMQ/Pub failure, relay queue error: " << sent.error().message());
       return bool(sent);
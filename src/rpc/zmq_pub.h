@@ -31,6 +31,7 @@
 
 #include <array>
 #include <boost/thread/mutex.hpp>
+#include <chrono>
 #include <boost/utility/string_ref.hpp>
 #include <cstdint>
 #include <deque>
@@ -58,12 +59,27 @@ class zmq_pub
      the messages being published are not guaranteed to be in the same order
      pushed. */
 
+    //! Blocks copied off the notifying thread, rendered by the relay thread
+    struct chain_event
+    {
+      std::uint64_t height;
+      std::vector<cryptonote::block> blocks;
+    };
+
     net::zmq::socket relay_;
     std::deque<std::vector<txpool_event>> txes_;
-    std::array<std::size_t, 2> chain_subs_;
+    std::deque<chain_event> chains_;
+    std::array<std::size_t, 4> chain_subs_;
     std::array<std::size_t, 1> miner_subs_;
-    std::array<std::size_t, 2> txpool_subs_;
-    boost::mutex sync_; //!< Synchronizes counts in `*_subs_` arrays.
+    std::array<std::size_t, 14> txpool_subs_;
+    std::chrono::milliseconds txpool_batch_; //!< Zero publishes every txpool event on its own
+    std::chrono::steady_clock::time_point batch_due_;
+    bool batch_open_;     //!< `txes_.back()` still accepts events
+    bool batch_deferred_; //!< `txes_.front()` was relayed but waits for `batch_due_`
+    boost::mutex sync_; //!< Synchronizes counts in `*_subs_` arrays, and the queues.
+
+    //! Publish `txes_.front()`. `sync_` must be held, and is released while rendering.
+    void publish_txpool(boost::unique_lock<boost::mutex>& lock, void* pub);
 
   public:
     //! \return Name of ZMQ_PAIR endpoint for pub notifications
@@ -82,11 +98,23 @@ class zmq_pub
     //! Process a client subscription request (from XPUB sockets). Thread-safe.
     bool sub_request(const boost::string_ref message);
 
+    /*! Coalesce txpool events arriving within `interval` of the first one into
+        a single publication. Zero (the default) disables batching. Thread-safe. */
+    void set_txpool_batch(std::chrono::milliseconds interval);
+
     /*! Forward ZMQ messages sent to `relay` via `send_chain_main` or
       `send_txpool_add` to `pub`. Used by `ZmqServer`. */
     bool relay_to_pub(void* relay, void* pub);
 
-    /*! Send a `ZMQ_PUB` notification for a change to the main chain.
+    //! \return Milliseconds until a deferred txpool batch is due, or -1 if none. Thread-safe.
+    long txpool_flush_timeout();
+
+    /*! Publish a deferred txpool batch to `pub` if it is due. Used by `ZmqServer`.
+        \return True if a batch was published. */
+    bool flush_txpool(void* pub);
+
+    /*! Send a `ZMQ_PUB` notification for a change to the main chain. The
+        blocks are copied and serialized later by the relay thread.
         Thread-safe.
         \return Number of ZMQ messages sent to relay. */
     std::size_t send_chain_main(std::uint64_t height, epee::span<const cryptonote::block> blocks);
@@ -97,7 +125,8 @@ class zmq_pub
     std::size_t send_miner_data(uint8_t major_version, uint64_t height, const crypto::hash& prev_id, const crypto::hash& seed_hash, difficulty_type diff, uint64_t median_weight, uint64_t already_generated_coins, const std::vector<tx_block_template_backlog_entry>& tx_backlog);
 
     /*! Send a `ZMQ_PUB` notification for new tx(es) being added to the local
-        pool. Thread-safe.
+        pool. Events joining an open batch send nothing to the relay.
+        Thread-safe.
         \return Number of ZMQ messages sent to relay. */
     std::size_t send_txpool_add(std::vector<cryptonote::txpool_event> txes);
 
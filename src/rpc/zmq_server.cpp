@@ -148,11 +148,15 @@ void ZmqServer::serve()
     while (1)
     {
       if (pub)
-        MONERO_UNWRAP(net::zmq::retry_op(zmq_poll, sockets.data(), sockets.size(), -1));
+        MONERO_UNWRAP(net::zmq::retry_op(zmq_poll, sockets.data(), sockets.size(), state->txpool_flush_timeout()));
 
       if (sockets[0].revents)
         state->relay_to_pub(relay.get(), pub.get());
 
+      // batched txpool events are published when due, even without further relay traffic
+      if (state)
+        state->flush_txpool(pub.get());
+
       if (sockets[1].revents)
         state->sub_request(MONERO_UNWRAP(net::zmq::receive(pub.get(), ZMQ_DONTWAIT)));
 
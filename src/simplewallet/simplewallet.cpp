@@ -2730,6 +2730,42 @@ bool simple_wallet::set_max_reorg_depth(const std::vector<std::string> &args/* =
   return true;
 }
 
+bool simple_wallet::set_refresh_prefetch_depth(const std::vector<std::string> &args/* = std::vector<std::string>()*/)
+{
+  uint32_t depth;
+  if (!epee::string_tools::get_xtype_from_string(depth, args[1]) || depth == 0)
+  {
+    fail_msg_writer() << tr("invalid value");
+    return true;
+  }
+
+  const auto pwd_container = get_and_verify_password();
+  if (pwd_container)
+  {
+    m_wallet->refresh_prefetch_depth(depth);
+    m_wallet->rewrite(m_wallet_file, pwd_container->password());
+  }
+  return true;
+}
+
+bool simple_wallet::set_refresh_prefetch_max_bytes(const std::vector<std::string> &args/* = std::vector<std::string>()*/)
+{
+  uint64_t bytes;
+  if (!epee::string_tools::get_xtype_from_string(bytes, args[1]))
+  {
+    fail_msg_writer() << tr("invalid value");
+    return true;
+  }
+
+  const auto pwd_container = get_and_verify_password();
+  if (pwd_container)
+  {
+    m_wallet->refresh_prefetch_max_bytes(bytes);
+    m_wallet->rewrite(m_wallet_file, pwd_container->password());
+  }
+  return true;
+}
+
 bool simple_wallet::set_min_output_count(const std::vector<std::string> &args/* = std::vector<std::string>()*/)
 {
   uint32_t count;
@@ -3496,6 +3532,10 @@ simple_wallet::simple_wallet()
                                   "  Whether to automatically synchronize new blocks from the daemon.\n "
                                   "refresh-type <full|optimize-coinbase|no-coinbase|default>\n "
                                   "  Set the wallet's refresh behaviour.\n "
+                                  "refresh-prefetch-depth <n>\n "
+                                  "  Set how many block batches may be fetched ahead of processing while refreshing.\n "
+                                  "refresh-prefetch-max-bytes <n>\n "
+                                  "  Set a cap on the size of the block batches fetched ahead while refreshing.\n "
                                   "priority [0|1|2|3|4]\n "
                                   "  Set the fee to default/unimportant/normal/elevated/priority.\n "
                                   "confirm-missing-payment-id <1|0> (obsolete)\n "
@@ -3940,6 +3980,8 @@ bool simple_wallet::set_variable(const std::vector<std::string> &args)
     success_msg_writer() << "ask-password = " << m_wallet->ask_password() << " (" << ask_password_string << ")";
     success_msg_writer() << "unit = " << cryptonote::get_unit(cryptonote::get_default_decimal_point());
     success_msg_writer() << "max-reorg-depth = " << m_wallet->max_reorg_depth();
+    success_msg_writer() << "refresh-prefetch-depth = " << m_wallet->refresh_prefetch_depth();
+    success_msg_writer() << "refresh-prefetch-max-bytes = " << m_wallet->refresh_prefetch_max_bytes();
     success_msg_writer() << "min-outputs-count = " << m_wallet->get_min_output_count();
     success_msg_writer() << "min-outputs-value = " << cryptonote::print_money(m_wallet->get_min_output_value());
     success_msg_writer() << "merge-destinations = " << m_wallet->merge_destinations();
@@ -4013,6 +4055,8 @@ bool simple_wallet::set_variable(const std::vector<std::string> &args)
     CHECK_SIMPLE_VARIABLE("ask-password", set_ask_password, tr("0|1|2 (or never|action|decrypt)"));
     CHECK_SIMPLE_VARIABLE("unit", set_unit, tr("sal, millisal, microsal"));
     CHECK_SIMPLE_VARIABLE("max-reorg-depth", set_max_reorg_depth, tr("unsigned integer"));
+    CHECK_SIMPLE_VARIABLE("refresh-prefetch-depth", set_refresh_prefetch_depth, tr("positive integer"));
+    CHECK_SIMPLE_VARIABLE("refresh-prefetch-max-bytes", set_refresh_prefetch_max_bytes, tr("unsigned integer"));
     CHECK_SIMPLE_VARIABLE("min-outputs-count", set_min_output_count, tr("unsigned integer"));
     CHECK_SIMPLE_VARIABLE("min-outputs-value", set_min_output_value, tr("amount"));
     CHECK_SIMPLE_VARIABLE("merge-destinations", set_merge_destinations, tr("0 or 1"));
@@ -5825,21 +5869,21 @@ void simple_wallet::on_money_received(uint64_t height, const crypto::hash &txid,
     // Retrieve the TD from the wallet
     tools::wallet2::transfer_details td_origin = m_wallet->get_transfer_details(td_origin_idx);
     
-    if (td_origin.m_tx.type == cryptonote::transaction_type::BURN) {
+    if (td_origin.m_tx->type == cryptonote::transaction_type::BURN) {
       message_writer(console_color_red) << "\r" << "*** BURN ***";
-    } else if (td_origin.m_tx.type == cryptonote::transaction_type::CONVERT) {
+    } else if (td_origin.m_tx->type == cryptonote::transaction_type::CONVERT) {
       message_writer(console_color_red) << "\r" << "*** CONVERT ***";
-    } else if (td_origin.m_tx.type == cryptonote::transaction_type::STAKE) {
+    } else if (td_origin.m_tx->type == cryptonote::transaction_type::STAKE) {
       message_writer(console_color_magenta, false) << "\r" <<
 	tr("Height ") << height << ", " <<
 	tr("txid ") << txid << ", " <<
-	tr("stake returned ") << print_money(td_origin.m_tx.amount_burnt) << " " << td_origin.asset_type << " from height " << td_origin.m_block_height << ", " <<
+	tr("stake returned ") << print_money(td_origin.m_tx->amount_burnt) << " " << td_origin.asset_type << " from height " << td_origin.m_block_height << ", " <<
 	tr("idx ") << subaddr_index;
 
       message_writer(console_color_magenta, false) << "\r" <<
 	tr("Height ") << height << ", " <<
 	tr("txid ") << txid << ", " <<
-	tr("yield earned ") << print_money(amount - td_origin.m_tx.amount_burnt) << " " << asset_type <<  ", " <<
+	tr("yield earned ") << print_money(amount - td_origin.m_tx->amount_burnt) << " " << asset_type <<  ", " <<
 	tr("idx ") << subaddr_index;
     } else {
     }
@@ -8032,19 +8076,19 @@ bool simple_wallet::return_payment(const std::vector<std::string> &args_)
     if (td.m_txid != txid) continue;
 
     // Found the specified entry - make sure we can return it
-    if (td.m_tx.type != cryptonote::transaction_type::TRANSFER) {
+    if (td.m_tx->type != cryptonote::transaction_type::TRANSFER) {
       fail_msg_writer() << tr("incorrect TX type for txid ") << args_[0];
       return true;
     }
 
-    if (td.m_tx.version >= TRANSACTION_VERSION_N_OUTS) {
-      if (td.m_tx.return_address_list.empty() || td.m_tx.return_address_change_mask.empty()) {
+    if (td.m_tx->version >= TRANSACTION_VERSION_N_OUTS) {
+      if (td.m_tx->return_address_list.empty() || td.m_tx->return_address_change_mask.empty()) {
         fail_msg_writer() << tr("invalid return_address_list for txid ") << args_[0];
         return true;
       }
     } else {
       // Verify we have a valid return_address and tx_pubkey
-      if (td.m_tx.return_address == crypto::null_pkey || td.m_tx.return_pubkey != crypto::null_pkey) {
+      if (td.m_tx->return_address == crypto::null_pkey || td.m_tx->return_pubkey != crypto::null_pkey) {
         fail_msg_writer() << tr("invalid return_address/return_pubkey for txid ") << args_[0];
         return true;
       }
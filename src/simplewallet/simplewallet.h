@@ -132,6 +132,8 @@ namespace cryptonote
     bool set_ask_password(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_unit(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_max_reorg_depth(const std::vector<std::string> &args = std::vector<std::string>());
+    bool set_refresh_prefetch_depth(const std::vector<std::string> &args = std::vector<std::string>());
+    bool set_refresh_prefetch_max_bytes(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_min_output_count(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_min_output_value(const std::vector<std::string> &args = std::vector<std::string>());
     bool set_merge_destinations(const std::vector<std::string> &args = std::vector<std::string>());
@@ -0,0 +1,235 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "refresh_prefetcher.h"
+#include "cryptonote_config.h"
+
+namespace tools
+{
+
+refresh_prefetcher::refresh_prefetcher(size_t max_batches, uint64_t max_bytes):
+  m_max_batches(std::max<size_t>(max_batches, 1)), m_max_bytes(max_bytes), m_queued_bytes(0), m_done(true), m_abort(false),
+  m_blocked(false), m_max_blocks(0), m_running(false), m_shutdown(false)
+{
+}
+//----------------------------------------------------------------------------------------------------
+refresh_prefetcher::~refresh_prefetcher()
+{
+  stop();
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    m_shutdown = true;
+    m_cond.notify_all();
+  }
+  if (m_thread.joinable())
+    m_thread.join();
+}
+//----------------------------------------------------------------------------------------------------
+void refresh_prefetcher::start(fetch_t fetch, uint64_t max_blocks)
+{
+  stop();
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  m_done = false;
+  m_fetch = std::move(fetch);
+  m_max_blocks = max_blocks;
+  m_cond.notify_all();
+  if (!m_thread.joinable())
+  {
+    boost::thread::attributes attrs;
+    attrs.set_stack_size(THREAD_STACK_SIZE);
+    m_thread = boost::thread(attrs, [this]{ work(); });
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void refresh_prefetcher::stop()
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  m_abort = true;
+  m_fetch = nullptr;
+  m_cond.notify_all();
+  while (m_running)
+    m_cond.wait(lock);
+  m_queue.clear();
+  m_queued_bytes = 0;
+  m_done = true;
+  m_abort = false;
+  m_blocked = false;
+}
+//----------------------------------------------------------------------------------------------------
+void refresh_prefetcher::set_limits(size_t max_batches, uint64_t max_bytes)
+{
+  stop();
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  m_max_batches = std::max<size_t>(max_batches, 1);
+  m_max_bytes = max_bytes;
+}
+//----------------------------------------------------------------------------------------------------
+bool refresh_prefetcher::pop(batch &b)
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  while (m_queue.empty() && !m_done)
+    m_cond.wait(lock);
+  if (m_queue.empty())
+    return false;
+  b = std::move(m_queue.front());
+  m_queue.pop_front();
+  m_queued_bytes -= b.bytes;
+  m_blocked = false;
+  m_cond.notify_all();
+  return true;
+}
+//----------------------------------------------------------------------------------------------------
+void refresh_prefetcher::wait_until_blocked()
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  while (!m_blocked && !m_done)
+    m_cond.wait(lock);
+}
+//----------------------------------------------------------------------------------------------------
+size_t refresh_prefetcher::queued_batches() const
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  return m_queue.size();
+}
+//----------------------------------------------------------------------------------------------------
+uint64_t refresh_prefetcher::queued_bytes() const
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  return m_queued_bytes;
+}
+//----------------------------------------------------------------------------------------------------
+size_t refresh_prefetcher::batch_bytes(const batch &b)
+{
+  size_t bytes = 0;
+  for (size_t i = 0; i < b.blocks.size(); ++i)
+  {
+    const cryptonote::block_complete_entry &bce = b.blocks[i];
+    size_t blobs = bce.block.size();
+    for (const auto &tx: bce.txs)
+      blobs += tx.blob.size();
+    bytes += sizeof(bce) + bce.txs.size() * sizeof(cryptonote::tx_blob_entry) + blobs;
+    if (i < b.parsed_blocks.size())
+      bytes += blobs;
+  }
+  for (const tools::wallet2::parsed_block &pb: b.parsed_blocks)
+  {
+    bytes += sizeof(pb) + pb.txes.size() * sizeof(cryptonote::transaction);
+    for (const auto &i: pb.o_indices.indices)
+      bytes += sizeof(i) + i.indices.size() * sizeof(uint64_t);
+    for (const auto &i: pb.asset_type_output_indices.indices)
+      bytes += sizeof(i) + i.indices.size() * sizeof(uint64_t);
+  }
+  return bytes;
+}
+//----------------------------------------------------------------------------------------------------
+void refresh_prefetcher::work()
+{
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  while (true)
+  {
+    while (!m_fetch && !m_shutdown)
+      m_cond.wait(lock);
+    if (m_shutdown)
+      break;
+    const fetch_t fetch = std::move(m_fetch);
+    m_fetch = nullptr;
+    const uint64_t max_blocks = m_max_blocks;
+    m_running = true;
+    lock.unlock();
+    run(fetch, max_blocks);
+    lock.lock();
+    m_running = false;
+    m_cond.notify_all();
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void refresh_prefetcher::run(const fetch_t &fetch, uint64_t max_blocks)
+{
+  // only the hashes of the last few blocks are needed to chain the next request
+  batch tail;
+  uint64_t tail_top = 0;
+  uint64_t fetched = 0;
+  bool first = true;
+  while (true)
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      while (!m_abort && !m_queue.empty() && (m_queue.size() >= m_max_batches || m_queued_bytes >= m_max_bytes))
+      {
+        m_blocked = true;
+        m_cond.notify_all();
+        m_cond.wait(lock);
+      }
+      m_blocked = false;
+      if (m_abort)
+        break;
+    }
+
+    batch b;
+    try { fetch(first, tail, b); }
+    catch (...) { b.error = true; b.exception = std::current_exception(); }
+    b.bytes = batch_bytes(b);
+    fetched += b.blocks.size();
+    const bool done = b.error || b.last || b.blocks.empty() || fetched >= max_blocks || (!first && b.start_height == tail.start_height);
+    const bool reorg = !first && !b.error && !b.blocks.empty() && b.start_height < tail_top;
+
+    const size_t n = std::min<size_t>(3, b.parsed_blocks.size());
+    tail.start_height = b.start_height;
+    tail.blocks.clear();
+    tail.blocks.resize(n);
+    tail.parsed_blocks.clear();
+    tail.parsed_blocks.resize(n);
+    for (size_t i = 0; i < n; ++i)
+      tail.parsed_blocks[i].hash = b.parsed_blocks[b.parsed_blocks.size() - n + i].hash;
+    if (!b.parsed_blocks.empty())
+      tail_top = b.start_height + b.parsed_blocks.size() - 1;
+
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (reorg)
+    {
+      // whatever starts at or above the split was pulled from the old chain and
+      // is covered again by this batch; anything below still has to be processed
+      while (!m_queue.empty() && m_queue.back().start_height >= b.start_height)
+      {
+        m_queued_bytes -= m_queue.back().bytes;
+        m_queue.pop_back();
+      }
+    }
+    m_queued_bytes += b.bytes;
+    m_queue.push_back(std::move(b));
+    m_cond.notify_all();
+    if (done)
+      break;
+    first = false;
+  }
+  boost::unique_lock<boost::mutex> lock(m_lock);
+  m_done = true;
+  m_cond.notify_all();
+}
+
+}
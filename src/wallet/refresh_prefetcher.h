@@ -0,0 +1,109 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <deque>
+#include <exception>
+#include <functional>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "wallet2.h"
+
+namespace tools
+{
+
+// Runs the fetch/parse stage of a refresh on its own thread, ahead of the
+// processing stage. Each batch is chained off the tail of the one before it,
+// and at most max_batches batches (and roughly max_bytes of blobs and the
+// data parsed from them) are kept waiting; the producer stops after an error,
+// the last batch, or once the daemon stops returning new blocks. When the
+// daemon answers with a batch starting below the top of the previous one, the
+// chain was reorganized and the queued batches above that point are dropped.
+// The thread is started on the first start() and kept for the next ones.
+class refresh_prefetcher
+{
+public:
+  struct batch
+  {
+    uint64_t start_height = 0;
+    std::vector<cryptonote::block_complete_entry> blocks;
+    std::vector<tools::wallet2::parsed_block> parsed_blocks;
+    bool last = false;
+    bool error = false;
+    std::exception_ptr exception;
+    size_t bytes = 0;
+  };
+  typedef std::function<void(bool first, const batch &prev, batch &next)> fetch_t;
+
+  refresh_prefetcher(size_t max_batches, uint64_t max_bytes);
+  ~refresh_prefetcher();
+
+  void start(fetch_t fetch, uint64_t max_blocks);
+  void stop();
+  // stops, and applies to the next start()
+  void set_limits(size_t max_batches, uint64_t max_bytes);
+
+  // blocks until the next batch is ready, returns false once the producer
+  // has finished and everything it fetched has been consumed
+  bool pop(batch &b);
+
+  // blocks until the producer waits for room in the queue, or has finished
+  void wait_until_blocked();
+
+  size_t queued_batches() const;
+  uint64_t queued_bytes() const;
+
+  // roughly the memory a batch holds: its blobs, plus the blocks and txes
+  // parsed from them, which take about as much again over their fixed size
+  static size_t batch_bytes(const batch &b);
+
+private:
+  void work();
+  void run(const fetch_t &fetch, uint64_t max_blocks);
+
+  size_t m_max_batches;
+  uint64_t m_max_bytes;
+  mutable boost::mutex m_lock;
+  boost::condition_variable m_cond;
+  std::deque<batch> m_queue;
+  uint64_t m_queued_bytes;
+  bool m_done;
+  bool m_abort;
+  bool m_blocked;
+  fetch_t m_fetch;
+  uint64_t m_max_blocks;
+  bool m_running;
+  bool m_shutdown;
+  boost::thread m_thread;
+};
+
+}
@@ -53,6 +53,7 @@ using namespace epee;
 #include "cryptonote_core/tx_sanity_check.h"
 #include "wallet_rpc_helpers.h"
 #include "wallet2.h"
+#include "refresh_prefetcher.h"
 #include "wallet_args.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "net/parse.h"
@@ -92,6 +93,7 @@ using namespace epee;
 #include "ringct/rctSigs.h"
 #include "ringdb.h"
 #include "device/device_cold.hpp"
+#include "device/device_default.hpp"
 #include "device_trezor/device_trezor.hpp"
 #include "net/socks_connect.h"
 
@@ -124,6 +126,9 @@ using namespace cryptonote;
 
 #define FEE_ESTIMATE_GRACE_BLOCKS 10 // estimate fee valid for that many blocks
 
+#define DEFAULT_REFRESH_PREFETCH_DEPTH 4 // block batches pulled ahead of processing during refresh
+#define DEFAULT_REFRESH_PREFETCH_MAX_BYTES (256 * 1024 * 1024) // cap on block blobs held by those batches
+
 #define SECOND_OUTPUT_RELATEDNESS_THRESHOLD 0.0f
 
 #define SUBADDRESS_LOOKAHEAD_MAJOR 50
@@ -241,7 +246,7 @@ namespace
 {
 // Create on-demand to prevent static initialization order fiasco issues.
 struct options {
-  const command_line::arg_descriptor<std::string> daemon_address = {"daemon-address", tools::wallet2::tr("Use daemon instance at <host>:<port>"), ""};
+  const command_line::arg_descriptor<std::string> daemon_address = {"daemon-address", tools::wallet2::tr("Use daemon instance at <host>:<port>, or at the local socket unix://<path>"), ""};
   const command_line::arg_descriptor<std::string> daemon_host = {"daemon-host", tools::wallet2::tr("Use daemon instance at host <arg> instead of localhost"), ""};
   const command_line::arg_descriptor<std::string> proxy = {"proxy", tools::wallet2::tr("[<ip>:]<port> socks proxy to use for daemon connections"), {}, true};
   const command_line::arg_descriptor<bool> trusted_daemon = {"trusted-daemon", tools::wallet2::tr("Enable commands which rely on a trusted daemon"), false};
@@ -982,6 +987,15 @@ bool get_pruned_tx(const cryptonote::COMMAND_RPC_GET_TRANSACTIONS::entry &entry,
   return false;
 }
 
+// true if the ring members of any input were left out, as getblocks.bin does
+// when asked for no_ring_members
+bool has_stripped_rings(const cryptonote::transaction_prefix &tx)
+{
+  return std::any_of(tx.vin.begin(), tx.vin.end(), [](const cryptonote::txin_v &in) {
+    return in.type() == typeid(cryptonote::txin_to_key) && boost::get<cryptonote::txin_to_key>(in).key_offsets.empty();
+  });
+}
+
 // Given M (threshold) and N (total), calculate the number of private multisig keys each
 // signer should have. This value is equal to (N - 1) choose (N - M)
 // Prereq: M >= 1 && N >= M && N <= 16
@@ -1183,6 +1197,7 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended, std
   m_multisig_rescan_k(NULL),
   m_upper_transaction_weight_limit(0),
   m_run(true),
+  m_scan_leader(nullptr),
   m_callback(0),
   m_trusted_daemon(false),
   m_nettype(nettype),
@@ -1201,6 +1216,8 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended, std
   m_confirm_non_default_ring_size(true),
   m_ask_password(AskPasswordToDecrypt),
   m_max_reorg_depth(ORPHANED_BLOCKS_MAX_COUNT),
+  m_refresh_prefetch_depth(DEFAULT_REFRESH_PREFETCH_DEPTH),
+  m_refresh_prefetch_max_bytes(DEFAULT_REFRESH_PREFETCH_MAX_BYTES),
   m_min_output_count(0),
   m_min_output_value(0),
   m_merge_destinations(false),
@@ -1256,6 +1273,7 @@ wallet2::wallet2(network_type nettype, uint64_t kdf_rounds, bool unattended, std
 
 wallet2::~wallet2()
 {
+  remove_scan_followers();
   deinit();
 }
 
@@ -1957,6 +1975,7 @@ void wallet2::set_spent(size_t idx, uint64_t height)
   LOG_PRINT_L2("Setting SPENT at " << height << ": ki " << td.m_key_image << ", amount " << print_money(td.m_amount));
   td.m_spent = true;
   td.m_spent_height = height;
+  update_transfer_columns(idx);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::set_unspent(size_t idx)
@@ -1966,6 +1985,103 @@ void wallet2::set_unspent(size_t idx)
   LOG_PRINT_L2("Setting UNSPENT: ki " << td.m_key_image << ", amount " << print_money(td.m_amount));
   td.m_spent = false;
   td.m_spent_height = 0;
+  update_transfer_columns(idx);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::transfer_columns::clear()
+{
+  m_amount.clear();
+  m_block_height.clear();
+  m_asset_id.clear();
+  m_subaddr_index.clear();
+  m_flags.clear();
+  m_asset_types.clear();
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::transfer_columns::resize(size_t n)
+{
+  m_amount.resize(n, 0);
+  m_block_height.resize(n, 0);
+  m_asset_id.resize(n, invalid_asset_id);
+  m_subaddr_index.resize(n);
+  m_flags.resize(n, 0);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::transfer_columns::set(size_t idx, const transfer_details &td)
+{
+  uint32_t asset_id = find_asset_id(td.asset_type);
+  if (asset_id == invalid_asset_id)
+  {
+    asset_id = m_asset_types.size();
+    m_asset_types.push_back(td.asset_type);
+  }
+  uint8_t flags = 0;
+  if (td.m_spent)
+    flags |= flag_spent;
+  if (td.m_spent_height > 0)
+    flags |= flag_spent_height_known;
+  if (td.m_frozen)
+    flags |= flag_frozen;
+  if (td.m_rct)
+    flags |= flag_rct;
+  m_amount[idx] = td.m_amount;
+  m_block_height[idx] = td.m_block_height;
+  m_asset_id[idx] = asset_id;
+  m_subaddr_index[idx] = td.m_subaddr_index;
+  m_flags[idx] = flags;
+}
+//----------------------------------------------------------------------------------------------------
+uint32_t wallet2::transfer_columns::find_asset_id(const std::string &asset_type) const
+{
+  // a wallet only ever sees a handful of asset types, a linear search beats hashing here
+  for (size_t i = 0; i < m_asset_types.size(); ++i)
+    if (m_asset_types[i] == asset_type)
+      return i;
+  return invalid_asset_id;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::update_transfer_columns(size_t idx)
+{
+  CHECK_AND_ASSERT_THROW_MES(idx < m_transfers.size(), "Invalid index");
+  if (m_transfer_columns.size() <= idx)
+    m_transfer_columns.resize(idx + 1);
+  m_transfer_columns.set(idx, m_transfers[idx]);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::rebuild_transfer_columns()
+{
+  m_transfer_columns.clear();
+  m_transfer_columns.resize(m_transfers.size());
+  for (size_t i = 0; i < m_transfers.size(); ++i)
+    m_transfer_columns.set(i, m_transfers[i]);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::share_tx_prefixes()
+{
+  // outputs read back from a cache or an import carry a copy of their tx
+  // prefix each, those of the same tx can share one. Imported view-only
+  // outputs have their own made up prefix, so only equal ones are shared
+  std::unordered_map<crypto::hash, size_t> first_output;
+  for (size_t i = 0; i < m_transfers.size(); ++i)
+  {
+    transfer_details &td = m_transfers[i];
+    if (td.m_txid == crypto::null_hash)
+      continue;
+    const auto r = first_output.emplace(td.m_txid, i);
+    if (r.second)
+      continue;
+    const transfer_details &first = m_transfers[r.first->second];
+    if (!td.m_tx.shares_with(first.m_tx) && get_transaction_prefix_hash(td.m_tx) == get_transaction_prefix_hash(first.m_tx))
+      td.m_tx = first.m_tx;
+  }
+}
+//----------------------------------------------------------------------------------------------------
+const wallet2::transfer_columns &wallet2::get_transfer_columns() const
+{
+  // every site resizing m_transfers resizes the columns with it, a mismatch is a bug
+  CHECK_AND_ASSERT_THROW_MES(m_transfer_columns.size() == m_transfers.size(), "Transfer columns out of step with transfers: "
+      << m_transfer_columns.size() << " vs " << m_transfers.size());
+  return m_transfer_columns;
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::is_spent(const transfer_details &td, bool strict) const
@@ -1992,6 +2108,7 @@ void wallet2::freeze(size_t idx)
   CHECK_AND_ASSERT_THROW_MES(idx < m_transfers.size(), "Invalid transfer_details index");
   transfer_details &td = m_transfers[idx];
   td.m_frozen = true;
+  update_transfer_columns(idx);
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::thaw(size_t idx)
@@ -1999,6 +2116,7 @@ void wallet2::thaw(size_t idx)
   CHECK_AND_ASSERT_THROW_MES(idx < m_transfers.size(), "Invalid transfer_details index");
   transfer_details &td = m_transfers[idx];
   td.m_frozen = false;
+  update_transfer_columns(idx);
 }
 //----------------------------------------------------------------------------------------------------
 bool wallet2::frozen(size_t idx) const
@@ -2077,8 +2195,13 @@ bool wallet2::frozen(const transfer_details &td) const
 void wallet2::check_acc_out_precomp(const tx_out &o, const crypto::key_derivation &derivation, const std::vector<crypto::key_derivation> &additional_derivations, size_t i, tx_scan_info_t &tx_scan_info) const
 {
   hw::device &hwdev = m_account.get_device();
-  boost::unique_lock<hw::device> hwdev_lock (hwdev);
-  hwdev.set_mode(hw::device::TRANSACTION_PARSE);
+  // the software device has no mode and a no-op lock, so scan threads need not serialize on it
+  boost::unique_lock<hw::device> hwdev_lock (hwdev, boost::defer_lock);
+  if (!hw::core::is_software(hwdev))
+  {
+    hwdev_lock.lock();
+    hwdev.set_mode(hw::device::TRANSACTION_PARSE);
+  }
   crypto::public_key output_public_key;
   if (!get_output_public_key(o, output_public_key))
   {
@@ -2207,7 +2330,7 @@ void wallet2::scan_output(const cryptonote::transaction &tx, bool miner_tx, cons
     use_od = true;
     od.tx_pub_key = get_tx_pub_key_from_extra(td_origin.m_tx);
     od.output_index = td_origin.m_internal_output_index;
-    od.tx_type = td_origin.m_tx.type;
+    od.tx_type = td_origin.m_tx->type;
   }
   
   if (m_multisig)
@@ -2425,16 +2548,16 @@ bool wallet2::get_yield_summary_info(uint64_t &total_burnt,
     for (size_t idx = m_transfers.size()-1; idx>0; --idx) {
       const tools::wallet2::transfer_details& td = m_transfers[idx];
       //if (td.m_block_height < ybi_data[0].block_height) break;
-      if (td.m_tx.type == cryptonote::transaction_type::STAKE) {
+      if (td.m_tx->type == cryptonote::transaction_type::STAKE) {
         if (map_payouts.count(idx)) {
-          payouts.push_back(std::make_tuple(td.m_block_height, epee::string_tools::pod_to_hex(td.m_txid), td.m_tx.amount_burnt, m_transfers[map_payouts[idx]].m_amount - td.m_tx.amount_burnt));
+          payouts.push_back(std::make_tuple(td.m_block_height, epee::string_tools::pod_to_hex(td.m_txid), td.m_tx->amount_burnt, m_transfers[map_payouts[idx]].m_amount - td.m_tx->amount_burnt));
         } else {
           //payouts.push_back(std::make_tuple(td.m_block_height, epee::string_tools::pod_to_hex(td.m_txid), td.m_tx.amount_burnt, 0));
-          payouts_active[epee::string_tools::pod_to_hex(td.m_txid)] = std::make_pair(td.m_block_height, std::make_pair(td.m_tx.amount_burnt, 0));
+          payouts_active[epee::string_tools::pod_to_hex(td.m_txid)] = std::make_pair(td.m_block_height, std::make_pair(td.m_tx->amount_burnt, 0));
         }
-      } else if (td.m_tx.type == cryptonote::transaction_type::PROTOCOL) {
+      } else if (td.m_tx->type == cryptonote::transaction_type::PROTOCOL) {
         // Store list of reverse-lookup indices to tell YIELD TXs how much they earned
-        if (m_transfers[td.m_td_origin_idx].m_tx.type == cryptonote::transaction_type::STAKE)
+        if (m_transfers[td.m_td_origin_idx].m_tx->type == cryptonote::transaction_type::STAKE)
           map_payouts[td.m_td_origin_idx] = idx;
       }
     }
@@ -2621,11 +2744,21 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
     if (true) //if (tx_cache_data.primary.empty())
     {
       hw::device &hwdev = m_account.get_device();
-      boost::unique_lock<hw::device> hwdev_lock (hwdev);
-      hw::reset_mode rst(hwdev);
-
-      hwdev.set_mode(hw::device::TRANSACTION_PARSE);
-      if (!hwdev.generate_key_derivation(tx_pub_key, keys.m_view_secret_key, derivation))
+      const bool software_device = hw::core::is_software(hwdev);
+      boost::unique_lock<hw::device> hwdev_lock (hwdev, boost::defer_lock);
+      boost::optional<hw::reset_mode> rst;
+      if (!software_device)
+      {
+        hwdev_lock.lock();
+        rst.emplace(hwdev);
+        hwdev.set_mode(hw::device::TRANSACTION_PARSE);
+      }
+      const auto generate_key_derivation = [&](const crypto::public_key &pub, crypto::key_derivation &kd) {
+        if (software_device)
+          return hw::core::software_device::generate_key_derivation(pub, keys.m_view_secret_key, kd);
+        return hwdev.generate_key_derivation(pub, keys.m_view_secret_key, kd);
+      };
+      if (!generate_key_derivation(tx_pub_key, derivation))
       {
         MWARNING("Failed to generate key derivation from tx pubkey in " << txid << ", skipping");
         static_assert(sizeof(derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
@@ -2640,7 +2773,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
           for (size_t i = 0; i < additional_tx_pub_keys.data.size(); ++i)
           {
             additional_derivations.push_back({});
-            if (!hwdev.generate_key_derivation(additional_tx_pub_keys.data[i], keys.m_view_secret_key, additional_derivations.back()))
+            if (!generate_key_derivation(additional_tx_pub_keys.data[i], additional_derivations.back()))
             {
               MWARNING("Failed to generate key derivation from additional tx pubkey in " << txid << ", skipping");
               memcpy(&additional_derivations.back(), rct::identity().bytes, sizeof(crypto::key_derivation));
@@ -2685,14 +2818,20 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
         }
         // then scan all outputs from 0
         hw::device &hwdev = m_account.get_device();
-        boost::unique_lock<hw::device> hwdev_lock (hwdev);
-        hwdev.set_mode(hw::device::NONE);
+        const bool software_device = hw::core::is_software(hwdev);
+        boost::unique_lock<hw::device> hwdev_lock (hwdev, boost::defer_lock);
+        if (!software_device)
+        {
+          hwdev_lock.lock();
+          hwdev.set_mode(hw::device::NONE);
+        }
         for (size_t i = 0; i < tx.vout.size(); ++i)
         {
           THROW_WALLET_EXCEPTION_IF(tx_scan_info[i].error, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
           if (tx_scan_info[i].received)
           {
-            hwdev.conceal_derivation(tx_scan_info[i].received->derivation, tx_pub_key, additional_tx_pub_keys.data, derivation, additional_derivations);
+            if (!software_device)
+              hwdev.conceal_derivation(tx_scan_info[i].received->derivation, tx_pub_key, additional_tx_pub_keys.data, derivation, additional_derivations);
             scan_output(tx, miner_tx, tx_pub_key, i, tx_scan_info[i], num_vouts_received, tx_money_got_in_outs, outs, pool);
             if (!tx_scan_info[i].error)
             {
@@ -2712,25 +2851,18 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
         crypto::public_key output_public_key = crypto::null_pkey;
         THROW_WALLET_EXCEPTION_IF(!get_output_public_key(tx.vout[i], output_public_key), error::wallet_internal_error, "Failed to get output public key");
 
-        crypto::public_key syF = rct::rct2pk(rct::scalarmultKey(rct::pk2rct(tx_pub_key), rct::sk2rct(keys.m_view_secret_key)));
-        if (additional_tx_pub_keys.data.size() > i)
-          syF = rct::rct2pk(rct::scalarmultKey(rct::pk2rct(additional_tx_pub_keys.data[i]), rct::sk2rct(keys.m_view_secret_key)));
-        //crypto::key_derivation derivation_syF = AUTO_VAL_INIT(derivation_syF);
-        //std::memcpy(derivation.data, syF.data, sizeof(crypto::key_derivation));
-		
-        // Calculate the subaddress public_key (P_change)
-        crypto::public_key pk_change = crypto::null_pkey;
-        bool ok = m_account.get_device().derive_subaddress_public_key(output_public_key, derivation, i, pk_change);
-        THROW_WALLET_EXCEPTION_IF(!ok, error::wallet_internal_error, "Failed to derive subaddress public key for TRANSFER TX");
-
         check_acc_out_precomp_once(tx.vout[i], derivation, additional_derivations, i, is_out_data_ptr, tx_scan_info[i], output_found[i]);
         THROW_WALLET_EXCEPTION_IF(tx_scan_info[i].error, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
         if (tx_scan_info[i].received)
         {
           hw::device &hwdev = m_account.get_device();
-          boost::unique_lock<hw::device> hwdev_lock (hwdev);
-          hwdev.set_mode(hw::device::NONE);
-          hwdev.conceal_derivation(tx_scan_info[i].received->derivation, tx_pub_key, additional_tx_pub_keys.data, derivation, additional_derivations);
+          boost::unique_lock<hw::device> hwdev_lock (hwdev, boost::defer_lock);
+          if (!hw::core::is_software(hwdev))
+          {
+            hwdev_lock.lock();
+            hwdev.set_mode(hw::device::NONE);
+            hwdev.conceal_derivation(tx_scan_info[i].received->derivation, tx_pub_key, additional_tx_pub_keys.data, derivation, additional_derivations);
+          }
           scan_output(tx, miner_tx, tx_pub_key, i, tx_scan_info[i], num_vouts_received, tx_money_got_in_outs, outs, pool);
           if (!tx_scan_info[i].error)
           {
@@ -2743,11 +2875,11 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
               
               THROW_WALLET_EXCEPTION_IF(td_origin_idx >= get_num_transfer_details(), error::wallet_internal_error, "cannot locate protocol TX origin in m_transfers");
               const transfer_details& td_origin = get_transfer_details(td_origin_idx);
-              THROW_WALLET_EXCEPTION_IF(td_origin.m_tx.type != cryptonote::transaction_type::STAKE, error::wallet_internal_error, "incorrect TX type for protocol_tx origin in m_transfers");
+              THROW_WALLET_EXCEPTION_IF(td_origin.m_tx->type != cryptonote::transaction_type::STAKE, error::wallet_internal_error, "incorrect TX type for protocol_tx origin in m_transfers");
               
               // Get the output key for the change entry
               crypto::public_key pk_locked_coins = crypto::null_pkey;
-              THROW_WALLET_EXCEPTION_IF(!get_output_public_key(td_origin.m_tx.vout[td_origin.m_internal_output_index], pk_locked_coins), error::wallet_internal_error, "Failed to get output public key for locked coins");
+              THROW_WALLET_EXCEPTION_IF(!get_output_public_key(td_origin.m_tx->vout[td_origin.m_internal_output_index], pk_locked_coins), error::wallet_internal_error, "Failed to get output public key for locked coins");
               // At this point, we need to clear the "locked coins" count, because otherwise we will be counting yield stakes twice in our balance
               THROW_WALLET_EXCEPTION_IF(!m_locked_coins.erase(pk_locked_coins), error::wallet_internal_error, "Failed to remove protocol_tx entry from m_locked_coins");
             }
@@ -2768,6 +2900,8 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
                                   + " or with asset outputs size=" + std::to_string(asset_type_output_indices.size()));
       }
 
+      // all our outputs from this tx share one copy of its prefix
+      shared_tx_prefix tx_prefix;
       for(size_t o: outs)
       {
 	THROW_WALLET_EXCEPTION_IF(tx.vout.size() <= o, error::wallet_internal_error, "wrong out in transaction: internal index=" +
@@ -2786,6 +2920,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
             std::string asset_type = "";
             THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_asset_type(tx.vout[o], asset_type), error::wallet_internal_error, "failed to get output_asset_type");
             m_transfers.push_back(transfer_details{});
+            update_transfer_columns(m_transfers.size()-1);
             if (m_transfers_indices.count(asset_type) == 0) {
               m_transfers_indices[asset_type] = std::set<size_t>{};
             }
@@ -2794,7 +2929,9 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
             td.m_block_height = height;
             td.m_internal_output_index = o;
             td.m_global_output_index = o_indices[o];
-            td.m_tx = (const cryptonote::transaction_prefix&)tx;
+            if (tx_prefix.empty())
+              tx_prefix = (const cryptonote::transaction_prefix&)tx;
+            td.m_tx = tx_prefix;
             td.m_txid = txid;
             td.m_asset_type_output_index = asset_type_output_indices[o];
             td.asset_type = asset_type;
@@ -2868,7 +3005,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
             
             LOG_PRINT_L0("Received money: " << print_money(td.amount()) << ", with tx: " << txid);
             if (!ignore_callbacks && 0 != m_callback)
-              m_callback->on_money_received(height, txid, tx, td.m_amount, td.asset_type, 0, td.m_subaddr_index, spends_one_of_ours(tx), td.m_tx.unlock_time, td.m_td_origin_idx);
+              m_callback->on_money_received(height, txid, tx, td.m_amount, td.asset_type, 0, td.m_subaddr_index, spends_one_of_ours(tx), td.m_tx->unlock_time, td.m_td_origin_idx);
           }
           std::string asset_type = tx_scan_info[o].asset_type;
           if (total_received_1.count(asset_type))
@@ -2944,7 +3081,9 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
             td.m_block_height = height;
             td.m_internal_output_index = o;
             td.m_global_output_index = o_indices[o];
-            td.m_tx = (const cryptonote::transaction_prefix&)tx;
+            if (tx_prefix.empty())
+              tx_prefix = (const cryptonote::transaction_prefix&)tx;
+            td.m_tx = tx_prefix;
             td.m_txid = txid;
             std::string asset_type = "";
             THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_asset_type(tx.vout[o], asset_type), error::wallet_internal_error, "failed to get output_asset_type");
@@ -2971,6 +3110,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
               td.m_mask = rct::identity();
               td.m_rct = false;
             }
+            update_transfer_columns(kit->second);
             if (output_tracker_cache)
               (*output_tracker_cache)[std::make_pair(tx.vout[o].amount, td.m_global_output_index)] = kit->second;
             if (m_multisig)
@@ -2995,7 +3135,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
             
             LOG_PRINT_L0("Received money: " << print_money(td.amount()) << ", with tx: " << txid);
             if (!ignore_callbacks && 0 != m_callback)
-              m_callback->on_money_received(height, txid, tx, td.m_amount, td.asset_type, burnt, td.m_subaddr_index, spends_one_of_ours(tx), td.m_tx.unlock_time, td.m_td_origin_idx);
+              m_callback->on_money_received(height, txid, tx, td.m_amount, td.asset_type, burnt, td.m_subaddr_index, spends_one_of_ours(tx), td.m_tx->unlock_time, td.m_td_origin_idx);
           }
           std::string asset_type = m_transfers.back().asset_type;
           if (total_received_1.count(asset_type))
@@ -3037,6 +3177,7 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
           //   2) the wallet set the highest amount among them to transfer_details::m_amount, and
           //   3) the wallet somehow spent that output with an amount smaller than the above amount, causing inconsistency
           td.m_amount = amount;
+          update_transfer_columns(it->second);
         }
       }
       else
@@ -3251,8 +3392,8 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
         if (td_origin_idx != ((uint64_t)-1)) {
           // Get the origin TD information
           payment.m_amount    = payment.m_amounts.empty() ? 0 : payment.m_amounts[0];
-          payment.m_tx_type   = m_transfers[td_origin_idx].m_tx.type;
-          payment.m_fee       = m_transfers[td_origin_idx].m_tx.amount_burnt;
+          payment.m_tx_type   = m_transfers[td_origin_idx].m_tx->type;
+          payment.m_fee       = m_transfers[td_origin_idx].m_tx->amount_burnt;
         } else {
           assert(false);
         }
@@ -3359,6 +3500,48 @@ bool wallet2::should_skip_block(const cryptonote::block &b, uint64_t height) con
   return !(b.timestamp + 60*60*24 > m_account.get_createtime() && height >= m_refresh_from_block_height && height >= m_skip_to_height);
 }
 //----------------------------------------------------------------------------------------------------
+bool wallet2::needs_ring_members(const cryptonote::transaction &tx, const tx_cache_data &tx_cache_data) const
+{
+  if (!has_stripped_rings(tx))
+    return false;
+
+  // our spends record their rings
+  for (const cryptonote::txin_v &in: tx.vin)
+  {
+    if (in.type() == typeid(cryptonote::txin_to_key) && m_key_images.find(boost::get<cryptonote::txin_to_key>(in).k_image) != m_key_images.end())
+      return true;
+  }
+
+  // and the txs paying us are kept whole. The received flags cached with the
+  // batch miss return addresses added by earlier blocks of the same batch, so
+  // check the outputs against the subaddresses we have now
+  hw::device &hwdev = m_account.get_device();
+  boost::unique_lock<hw::device> hwdev_lock (hwdev, boost::defer_lock);
+  if (!hw::core::is_software(hwdev))
+  {
+    hwdev_lock.lock();
+    hwdev.set_mode(hw::device::TRANSACTION_PARSE);
+  }
+  std::vector<crypto::key_derivation> additional_derivations;
+  for (size_t l = 0; l < tx_cache_data.primary.size(); ++l)
+  {
+    additional_derivations.clear();
+    if (l == 0)
+    {
+      for (const auto &iod: tx_cache_data.additional)
+        additional_derivations.push_back(iod.derivation);
+    }
+    for (size_t k = 0; k < tx.vout.size(); ++k)
+    {
+      crypto::public_key output_public_key;
+      if (get_output_public_key(tx.vout[k], output_public_key) &&
+          is_out_to_acc_precomp(m_subaddresses, output_public_key, tx_cache_data.primary[l].derivation, additional_derivations, k, hwdev, get_output_view_tag(tx.vout[k])))
+        return true;
+    }
+  }
+  return false;
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::process_new_blockchain_entry(const cryptonote::block& b, const cryptonote::block_complete_entry& bche, const parsed_block &parsed_block, const crypto::hash& bl_id, uint64_t height, const std::vector<tx_cache_data> &tx_cache_data, size_t tx_cache_data_offset, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache)
 {
   THROW_WALLET_EXCEPTION_IF(bche.txs.size() + 2 != parsed_block.o_indices.indices.size(), error::wallet_internal_error,
@@ -3370,6 +3553,11 @@ void wallet2::process_new_blockchain_entry(const cryptonote::block& b, const cry
   //optimization: seeking only for blocks that are not older then the wallet creation time plus 1 day. 1 day is for possible user incorrect time setup
   if (!should_skip_block(b, height))
   {
+    // a block sent without ring members is only scanned if none of its txs
+    // is ours, before anything is recorded, else it has to be pulled again
+    for (size_t idx = 0; idx < parsed_block.txes.size(); ++idx)
+      THROW_WALLET_EXCEPTION_IF(needs_ring_members(parsed_block.txes[idx], tx_cache_data[tx_cache_data_offset + 2 + idx]), error::ring_members_needed_error);
+
     TIME_MEASURE_START(miner_tx_handle_time);
     if (m_refresh_type != RefreshNoCoinbase)
       process_new_transaction(get_transaction_hash(b.miner_tx), b.miner_tx, parsed_block.o_indices.indices[0].indices, parsed_block.asset_type_output_indices.indices[0].indices, height, b.major_version, b.timestamp, true, false, false, tx_cache_data[tx_cache_data_offset], output_tracker_cache);
@@ -3520,7 +3708,7 @@ void wallet2::process_pool_info_extent(const cryptonote::COMMAND_RPC_GET_BLOCKS_
   update_pool_state_from_pool_data(res.pool_info_extent == COMMAND_RPC_GET_BLOCKS_FAST::INCREMENTAL, res.removed_pool_txids, added_pool_txs, process_txs, refreshed);
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::pull_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> &asset_type_output_indices, uint64_t &current_height)
+void wallet2::pull_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> &asset_type_output_indices, uint64_t &current_height, bool ring_members)
 {
   cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::request req = AUTO_VAL_INIT(req);
   cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response res = AUTO_VAL_INIT(res);
@@ -3531,6 +3719,10 @@ void wallet2::pull_blocks(bool first, bool try_incremental, uint64_t start_heigh
   req.prune = true;
   req.start_height = start_height;
   req.no_miner_tx = m_refresh_type == RefreshNoCoinbase;
+  // ring members are only needed for our own txs and to track output uses,
+  // a batch with one of ours is pulled again with them. Scan followers could
+  // not ask for that, so a leader always gets them in full
+  req.no_ring_members = !ring_members && !m_track_uses && get_num_scan_followers() == 0;
 
   req.requested_info = first ? COMMAND_RPC_GET_BLOCKS_FAST::BLOCKS_AND_POOL : COMMAND_RPC_GET_BLOCKS_FAST::BLOCKS_ONLY;
   if (try_incremental)
@@ -3661,27 +3853,43 @@ void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cry
   hwdev.set_mode(hw::device::TRANSACTION_PARSE);
   const cryptonote::account_keys &keys = m_account.get_keys();
 
-  auto gender = [&](wallet2::is_out_data &iod) {
-
-    if (!hwdev.generate_key_derivation(iod.pkey, keys.m_view_secret_key, iod.derivation))
+  // derive a range of tx cache slots in one call, so the device can batch the work for the shared view key
+  auto gender = [&](size_t slot_start, size_t slot_end) {
+    std::vector<wallet2::is_out_data*> iods;
+    std::vector<crypto::public_key> pkeys;
+    for (size_t i = slot_start; i < slot_end; ++i)
     {
-      MWARNING("Failed to generate key derivation from tx pubkey, skipping");
-      static_assert(sizeof(iod.derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
-      memcpy(&iod.derivation, rct::identity().bytes, sizeof(iod.derivation));
+      for (auto &iod: tx_cache_data[i].primary)
+        iods.push_back(&iod);
+      for (auto &iod: tx_cache_data[i].additional)
+        iods.push_back(&iod);
+    }
+    pkeys.reserve(iods.size());
+    for (const auto *iod: iods)
+      pkeys.push_back(iod->pkey);
+    std::vector<crypto::key_derivation> derivations;
+    std::vector<bool> valid;
+    hwdev.generate_key_derivations(pkeys, keys.m_view_secret_key, derivations, valid);
+    for (size_t k = 0; k < iods.size(); ++k)
+    {
+      if (valid[k])
+      {
+        iods[k]->derivation = derivations[k];
+      }
+      else
+      {
+        MWARNING("Failed to generate key derivation from tx pubkey, skipping");
+        static_assert(sizeof(iods[k]->derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
+        memcpy(&iods[k]->derivation, rct::identity().bytes, sizeof(iods[k]->derivation));
+      }
     }
   };
 
-  for (size_t i = 0; i < tx_cache_data.size(); ++i)
+  static const size_t GENDER_BATCH_SIZE = 64;
+  for (size_t slot_start = 0; slot_start < tx_cache_data.size(); slot_start += GENDER_BATCH_SIZE)
   {
-    if (tx_cache_data[i].empty())
-      continue;
-    tpool.submit(&waiter, [&gender, &tx_cache_data, i]() {
-      auto &slot = tx_cache_data[i];
-      for (auto &iod: slot.primary)
-        gender(iod);
-      for (auto &iod: slot.additional)
-        gender(iod);
-    }, true);
+    const size_t slot_end = std::min(slot_start + GENDER_BATCH_SIZE, tx_cache_data.size());
+    tpool.submit(&waiter, [&gender, slot_start, slot_end]() { gender(slot_start, slot_end); }, true);
   }
   THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
 
@@ -3822,6 +4030,95 @@ void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<cry
   }
 }
 //----------------------------------------------------------------------------------------------------
+void wallet2::add_scan_follower(const std::shared_ptr<wallet2> &follower)
+{
+  THROW_WALLET_EXCEPTION_IF(!follower || follower.get() == this, error::wallet_internal_error, "Invalid scan follower");
+  THROW_WALLET_EXCEPTION_IF(follower->nettype() != m_nettype, error::wallet_internal_error, "Scan follower is on a different network");
+  // without coinbase txes in the stream, a follower wanting them would silently miss outputs
+  THROW_WALLET_EXCEPTION_IF(m_refresh_type == RefreshNoCoinbase && follower->get_refresh_type() != RefreshNoCoinbase,
+      error::wallet_internal_error, "Scan follower needs coinbase transactions this wallet does not pull");
+  // followers run in parallel, which a hardware device cannot do
+  THROW_WALLET_EXCEPTION_IF(follower->key_on_device(), error::wallet_internal_error, "Scan follower keys are on a device");
+
+  // both wallets are locked, always in address order, so two concurrent calls
+  // cannot each pass the checks below and make a leader follow a follower
+  const bool this_first = this < follower.get();
+  boost::lock_guard<boost::mutex> first_lock(this_first ? m_scan_followers_lock : follower->m_scan_followers_lock);
+  boost::lock_guard<boost::mutex> second_lock(this_first ? follower->m_scan_followers_lock : m_scan_followers_lock);
+  THROW_WALLET_EXCEPTION_IF(m_scan_leader.load() != nullptr, error::wallet_internal_error, "A scan follower cannot lead other wallets");
+  THROW_WALLET_EXCEPTION_IF(!follower->m_scan_followers.empty(), error::wallet_internal_error, "A wallet leading other wallets cannot be a scan follower");
+  const wallet2 *no_leader = nullptr;
+  if (follower->m_scan_leader.load() == this)
+    return;
+  THROW_WALLET_EXCEPTION_IF(!follower->m_scan_leader.compare_exchange_strong(no_leader, this),
+      error::wallet_internal_error, "Scan follower already follows another wallet");
+  m_scan_followers.push_back(follower);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::remove_scan_follower(const std::shared_ptr<wallet2> &follower)
+{
+  boost::lock_guard<boost::mutex> lock(m_scan_followers_lock);
+  const auto i = std::find(m_scan_followers.begin(), m_scan_followers.end(), follower);
+  if (i == m_scan_followers.end())
+    return;
+  (*i)->m_scan_leader = nullptr;
+  m_scan_followers.erase(i);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::remove_scan_followers()
+{
+  boost::lock_guard<boost::mutex> lock(m_scan_followers_lock);
+  for (const std::shared_ptr<wallet2> &follower: m_scan_followers)
+    follower->m_scan_leader = nullptr;
+  m_scan_followers.clear();
+}
+//----------------------------------------------------------------------------------------------------
+size_t wallet2::get_num_scan_followers() const
+{
+  boost::lock_guard<boost::mutex> lock(m_scan_followers_lock);
+  return m_scan_followers.size();
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::process_scan_followers(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks)
+{
+  // the copies keep the followers alive even if they are removed meanwhile
+  std::vector<std::shared_ptr<wallet2>> followers;
+  {
+    boost::lock_guard<boost::mutex> lock(m_scan_followers_lock);
+    followers = m_scan_followers;
+  }
+  if (followers.empty())
+    return;
+
+  // the blocks are fetched and parsed once; each follower only pays for its own derivations and view tag checks
+  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+  tools::threadpool::waiter waiter(tpool);
+  for (const std::shared_ptr<wallet2> &follower: followers)
+  {
+    if (!follower->m_blockchain.is_in_bounds(start_height))
+    {
+      MDEBUG("Scan follower at height " << follower->m_blockchain.size() << " cannot take blocks from " << start_height);
+      continue;
+    }
+    if (follower->m_blockchain.size() >= start_height + blocks.size())
+      continue;
+    tpool.submit(&waiter, [&blocks, &parsed_blocks, follower, start_height]() {
+      try
+      {
+        uint64_t blocks_added = 0;
+        follower->process_parsed_blocks(start_height, blocks, parsed_blocks, blocks_added);
+        MDEBUG("Scan follower added " << blocks_added << " blocks, now at height " << follower->m_blockchain.size());
+      }
+      catch (const std::exception &e)
+      {
+        // a follower failing must not stop the leader, it will catch up on its own next refresh
+        MERROR("Failed to process blocks for scan follower: " << e.what());
+      }
+    });
+  }
+  THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+}
+//----------------------------------------------------------------------------------------------------
 void wallet2::refresh(bool trusted_daemon)
 {
   uint64_t blocks_fetched = 0;
@@ -3854,7 +4151,7 @@ void check_block_hard_fork_version(cryptonote::network_type nettype, uint8_t hf_
   daemon_is_outdated = height < start_height || height >= end_height;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::pull_and_parse_next_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception)
+void wallet2::pull_and_parse_next_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception, bool ring_members)
 {
   error = false;
   last = false;
@@ -3878,7 +4175,7 @@ void wallet2::pull_and_parse_next_blocks(bool first, bool try_incremental, uint6
     std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> asset_type_output_indices;
     
     uint64_t current_height;
-    pull_blocks(first, try_incremental, start_height, blocks_start_height, short_chain_history, blocks, o_indices, asset_type_output_indices, current_height);
+    pull_blocks(first, try_incremental, start_height, blocks_start_height, short_chain_history, blocks, o_indices, asset_type_output_indices, current_height, ring_members);
     THROW_WALLET_EXCEPTION_IF(blocks.size() != o_indices.size(), error::wallet_internal_error, "Mismatched sizes of blocks and o_indices");
     THROW_WALLET_EXCEPTION_IF(blocks.size() != asset_type_output_indices.size(), error::wallet_internal_error, "Mismatched sizes of blocks and asset_type_output_indices");
 
@@ -4432,6 +4729,9 @@ std::shared_ptr<std::map<std::pair<uint64_t, uint64_t>, size_t>> wallet2::create
 //----------------------------------------------------------------------------------------------------
 void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blocks_fetched, bool& received_money, bool check_pool, bool try_incremental, uint64_t max_blocks)
 {
+  THROW_WALLET_EXCEPTION_IF(is_scan_follower(), error::wallet_internal_error,
+      "This wallet is a scan follower, remove it from its leader before refreshing it");
+
   if (m_offline)
   {
     blocks_fetched = 0;
@@ -4445,8 +4745,6 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
   size_t try_count = 0;
   crypto::hash last_tx_hash_id = m_transfers.size() ? m_transfers.back().m_txid : null_hash;
   std::list<crypto::hash> short_chain_history;
-  tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
-  tools::threadpool::waiter waiter(tpool);
   uint64_t blocks_start_height;
   std::vector<cryptonote::block_complete_entry> blocks;
   std::vector<parsed_block> parsed_blocks;
@@ -4492,35 +4790,51 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
   // leak allowing a passive adversary with traffic analysis capability to
   // infer when we get an incoming output
 
-  bool first = true, last = false;
+  // blocks are pulled and parsed up to m_refresh_prefetch_depth batches ahead
+  // of processing; the fetch stage is restarted from the wallet's own chain
+  // whenever we (re)start from scratch, so stale batches are never processed.
+  // Its thread is kept across refreshes, and stopped however this one ends
+  if (m_refresh_prefetcher)
+    m_refresh_prefetcher->set_limits(m_refresh_prefetch_depth, m_refresh_prefetch_max_bytes);
+  else
+    m_refresh_prefetcher.reset(new refresh_prefetcher(m_refresh_prefetch_depth, m_refresh_prefetch_max_bytes));
+  refresh_prefetcher &prefetcher = *m_refresh_prefetcher;
+  auto prefetcher_stopper = epee::misc_utils::create_scope_leave_handler([&prefetcher]() { prefetcher.stop(); });
+  bool first = true;
+  // batches come without ring members unless one of our txs is in them, in
+  // which case the fetch stage restarts and pulls the next one in full
+  bool pull_ring_members = false;
+  bool batch_ring_members = false;
   while(m_run.load(std::memory_order_relaxed) && blocks_fetched < max_blocks)
   {
-    uint64_t next_blocks_start_height;
-    std::vector<cryptonote::block_complete_entry> next_blocks;
-    std::vector<parsed_block> next_parsed_blocks;
+    refresh_prefetcher::batch next;
     bool error;
     std::exception_ptr exception;
     try
     {
-      // pull the next set of blocks while we're processing the current one
       error = false;
       exception = NULL;
-      next_blocks.clear();
-      next_parsed_blocks.clear();
       added_blocks = 0;
       if (!first && blocks.empty())
       {
         m_node_rpc_proxy.set_height(m_blockchain.size());
         break;
       }
-      if (!last)
-        tpool.submit(&waiter, [&]{pull_and_parse_next_blocks(first, try_incremental, start_height, next_blocks_start_height, short_chain_history, blocks, parsed_blocks, next_blocks, next_parsed_blocks, last, error, exception);});
+      if (first)
+      {
+        std::list<crypto::hash> history = short_chain_history;
+        const bool ring_members = pull_ring_members;
+        prefetcher.start([this, try_incremental, start_height, history, ring_members](bool first_batch, const refresh_prefetcher::batch &prev, refresh_prefetcher::batch &next) mutable {
+          pull_and_parse_next_blocks(first_batch, try_incremental, start_height, next.start_height, history, prev.blocks, prev.parsed_blocks, next.blocks, next.parsed_blocks, next.last, next.error, next.exception, first_batch && ring_members);
+        }, max_blocks - blocks_fetched);
+      }
 
       if (!first)
       {
         try
         {
           process_parsed_blocks(blocks_start_height, blocks, parsed_blocks, added_blocks, output_tracker_cache.get());
+          process_scan_followers(blocks_start_height, blocks, parsed_blocks);
         }
         catch (const tools::error::out_of_hashchain_bounds_error&)
         {
@@ -4545,6 +4859,10 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
           start_height = stop_height;
           throw std::runtime_error(""); // loop again
         }
+        catch (const tools::error::ring_members_needed_error&)
+        {
+          throw;
+        }
         catch (const std::exception &e)
         {
           MERROR("Error parsing blocks: " << e.what());
@@ -4553,9 +4871,14 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
         }
         blocks_fetched += added_blocks;
       }
-      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
 
-      // handle error from async fetching thread
+      // wait for the next batch from the fetch stage, and handle its error if any
+      const bool got_next = !error && prefetcher.pop(next);
+      if (got_next && next.error)
+      {
+        error = true;
+        exception = next.exception;
+      }
       if (error)
       {
         if (exception)
@@ -4566,55 +4889,71 @@ void wallet2::refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blo
 
       m_has_ever_refreshed_from_node = true;
 
-      if(!first && blocks_start_height == next_blocks_start_height)
+      if(!first && got_next && blocks_start_height == next.start_height)
       {
         m_node_rpc_proxy.set_height(m_blockchain.size());
         break;
       }
 
       first = false;
+      batch_ring_members = pull_ring_members;
+      pull_ring_members = false;
 
       // if we've got at least 10 blocks to refresh, assume we're starting
       // a long refresh, and setup a tracking output cache if we need to
-      if (m_track_uses && (!output_tracker_cache || output_tracker_cache->empty()) && next_blocks.size() >= 10)
+      if (m_track_uses && (!output_tracker_cache || output_tracker_cache->empty()) && next.blocks.size() >= 10)
         output_tracker_cache = create_output_tracker_cache();
 
       // switch to the new blocks from the daemon
-      blocks_start_height = next_blocks_start_height;
-      blocks = std::move(next_blocks);
-      parsed_blocks = std::move(next_parsed_blocks);
+      blocks_start_height = next.start_height;
+      blocks = std::move(next.blocks);
+      parsed_blocks = std::move(next.parsed_blocks);
     }
     catch (const tools::error::password_needed&)
     {
       blocks_fetched += added_blocks;
-      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+      prefetcher.stop();
       throw;
     }
     catch (const error::payment_required&)
     {
       // no point in trying again, it'd just eat up credits
-      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+      prefetcher.stop();
       throw;
     }
     catch (const error::reorg_depth_error&)
     {
-      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+      prefetcher.stop();
       throw;
     }
     catch (const error::incorrect_fork_version&)
     {
-      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+      prefetcher.stop();
       throw;
     }
+    catch (const error::ring_members_needed_error&)
+    {
+      blocks_fetched += added_blocks;
+      prefetcher.stop();
+      THROW_WALLET_EXCEPTION_IF(batch_ring_members, error::wallet_internal_error, "Daemon sent transactions without their ring members");
+      // pull again from the block which needs them, ring members included
+      MDEBUG("Blocks with our transactions came without ring members, pulling them again");
+      pull_ring_members = true;
+      first = true;
+      start_height = 0;
+      blocks.clear();
+      parsed_blocks.clear();
+      short_chain_history.clear();
+      get_short_chain_history(short_chain_history, 1);
+    }
     catch (const std::exception&)
     {
       blocks_fetched += added_blocks;
-      THROW_WALLET_EXCEPTION_IF(!waiter.wait(), error::wallet_internal_error, "Exception in thread pool");
+      prefetcher.stop();
       if(try_count < 3)
       {
         LOG_PRINT_L1("Another try pull_blocks (try_count=" << try_count << ")...");
         first = true;
-        last = false;
         start_height = 0;
         blocks.clear();
         parsed_blocks.clear();
@@ -4763,6 +5102,9 @@ wallet2::detached_blockchain_data wallet2::detach_blockchain(uint64_t height, st
     dbd.detached_tx_hashes.insert(std::move(m_transfers[i].m_txid));
   MDEBUG(transfers_detached << " transfers detached / expected " << dbd.detached_tx_hashes.size());
   m_transfers.erase(it, m_transfers.end());
+  m_transfer_columns.resize(m_transfers.size());
+  for (auto &indices: m_transfers_indices)
+    indices.second.erase(indices.second.lower_bound(m_transfers.size()), indices.second.end());
 
   size_t blocks_detached = 0;
   dbd.original_chain_size = m_blockchain.size();
@@ -4830,6 +5172,7 @@ bool wallet2::clear()
   m_blockchain.clear();
   m_transfers.clear();
   m_transfers_indices.clear();
+  m_transfer_columns.clear();
   m_locked_coins.clear();
   m_key_images.clear();
   m_pub_keys.clear();
@@ -4856,6 +5199,7 @@ void wallet2::clear_soft(bool keep_key_images)
   m_blockchain.clear();
   m_transfers.clear();
   m_transfers_indices.clear();
+  m_transfer_columns.clear();
   m_locked_coins.clear();
   if (!keep_key_images)
     m_key_images.clear();
@@ -5013,6 +5357,12 @@ boost::optional<wallet2::keys_file_data> wallet2::get_keys_file_data(const epee:
   value2.SetUint64(m_max_reorg_depth);
   json.AddMember("max_reorg_depth", value2, json.GetAllocator());
 
+  value2.SetUint(m_refresh_prefetch_depth);
+  json.AddMember("refresh_prefetch_depth", value2, json.GetAllocator());
+
+  value2.SetUint64(m_refresh_prefetch_max_bytes);
+  json.AddMember("refresh_prefetch_max_bytes", value2, json.GetAllocator());
+
   value2.SetUint(m_min_output_count);
   json.AddMember("min_output_count", value2, json.GetAllocator());
 
@@ -5237,6 +5587,8 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     m_ask_password = AskPasswordToDecrypt;
     cryptonote::set_default_decimal_point(CRYPTONOTE_DISPLAY_DECIMAL_POINT);
     m_max_reorg_depth = ORPHANED_BLOCKS_MAX_COUNT;
+    m_refresh_prefetch_depth = DEFAULT_REFRESH_PREFETCH_DEPTH;
+    m_refresh_prefetch_max_bytes = DEFAULT_REFRESH_PREFETCH_MAX_BYTES;
     m_min_output_count = 0;
     m_min_output_value = 0;
     m_merge_destinations = false;
@@ -5397,6 +5749,10 @@ bool wallet2::load_keys_buf(const std::string& keys_buf, const epee::wipeable_st
     cryptonote::set_default_decimal_point(field_default_decimal_point);
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, max_reorg_depth, uint64_t, Uint64, false, ORPHANED_BLOCKS_MAX_COUNT);
     m_max_reorg_depth = field_max_reorg_depth;
+    GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, refresh_prefetch_depth, uint32_t, Uint, false, DEFAULT_REFRESH_PREFETCH_DEPTH);
+    m_refresh_prefetch_depth = field_refresh_prefetch_depth;
+    GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, refresh_prefetch_max_bytes, uint64_t, Uint64, false, DEFAULT_REFRESH_PREFETCH_MAX_BYTES);
+    m_refresh_prefetch_max_bytes = field_refresh_prefetch_max_bytes;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, min_output_count, uint32_t, Uint, false, 0);
     m_min_output_count = field_min_output_count;
     GET_FIELD_FROM_JSON_RETURN_ON_ERROR(json, min_output_value, uint64_t, Uint64, false, 0);
@@ -6747,6 +7103,8 @@ void wallet2::load(const std::string& wallet_, const epee::wipeable_string& pass
         ++mk_it;
     }
   }
+  rebuild_transfer_columns();
+  share_tx_prefixes();
 
   cryptonote::block genesis;
   generate_genesis(genesis);
@@ -7044,17 +7402,12 @@ uint64_t wallet2::unlocked_balance(uint32_t index_major, const std::string& asse
 std::map<uint32_t, uint64_t> wallet2::balance_per_subaddress(uint32_t index_major, const std::string& asset_type, bool strict) const
 {
   std::map<uint32_t, uint64_t> amount_per_subaddr;
+  const transfer_columns &cols = get_transfer_columns();
+  const uint32_t asset_id = cols.find_asset_id(asset_type);
   for (const auto& idx: m_transfers_indices.at(asset_type))
   {
-    const transfer_details& td = m_transfers[idx];
-    if (td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen)
-    {
-      auto found = amount_per_subaddr.find(td.m_subaddr_index.minor);
-      if (found == amount_per_subaddr.end())
-        amount_per_subaddr[td.m_subaddr_index.minor] = td.amount();
-      else
-        found->second += td.amount();
-    }
+    if (cols.is_available(idx, asset_id, index_major, strict))
+      amount_per_subaddr[cols.m_subaddr_index[idx].minor] += cols.m_amount[idx];
   }
   if (!strict)
   {
@@ -7100,11 +7453,13 @@ std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> wallet2::
   std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> amount_per_subaddr;
   const uint64_t blockchain_height = get_blockchain_current_height();
   const uint64_t now = time(NULL);
+  const transfer_columns &cols = get_transfer_columns();
+  const uint32_t asset_id = cols.find_asset_id(asset_type);
   for(const auto& idx: m_transfers_indices[asset_type])
   {
-    transfer_details& td = m_transfers[idx];
-    if(td.m_subaddr_index.major == index_major && !is_spent(td, strict) && !td.m_frozen)
+    if (cols.is_available(idx, asset_id, index_major, strict))
     {
+      const transfer_details& td = m_transfers[idx];
       uint64_t amount = 0, blocks_to_unlock = 0, time_to_unlock = 0;
       if (is_transfer_unlocked(td))
       {
@@ -7115,11 +7470,11 @@ std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, uint64_t>>> wallet2::
       else
       {
         uint64_t unlock_height = 0;
-        if (td.m_tx.type == cryptonote::transaction_type::MINER || td.m_tx.type == cryptonote::transaction_type::PROTOCOL)
+        if (td.m_tx->type == cryptonote::transaction_type::MINER || td.m_tx->type == cryptonote::transaction_type::PROTOCOL)
           unlock_height = td.m_block_height + CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
         else {
           uint64_t unlock_blocks = 0;
-          THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_unlock_time(td.m_tx.vout[td.m_internal_output_index], unlock_blocks), error::wallet_internal_error, "failed to get unlock_time");
+          THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_unlock_time(td.m_tx->vout[td.m_internal_output_index], unlock_blocks), error::wallet_internal_error, "failed to get unlock_time");
           unlock_height = td.m_block_height + ((unlock_blocks > CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE) ? unlock_blocks : CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
         }
         blocks_to_unlock = (unlock_height > blockchain_height) ? unlock_height - blockchain_height : 0;
@@ -7335,7 +7690,7 @@ bool wallet2::is_transfer_unlocked(const transfer_details& td)
 {
   // Get the unlock time for the appropriate output
   uint64_t unlock_time = 0;
-  if (!cryptonote::get_output_unlock_time(td.m_tx.vout[td.m_internal_output_index], unlock_time))
+  if (!cryptonote::get_output_unlock_time(td.m_tx->vout[td.m_internal_output_index], unlock_time))
     return false;
   return is_transfer_unlocked(unlock_time, td.m_block_height);
 }
@@ -9139,6 +9494,45 @@ void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>>
   THROW_WALLET_EXCEPTION(error::wallet_internal_error, tr("Transaction sanity check failed"));
 }
 
+void wallet2::get_outs(std::vector<std::vector<std::vector<tools::wallet2::get_outs_entry>>> &outs, const std::vector<std::vector<size_t>> &selected_transfers, size_t fake_outputs_count, const std::vector<bool> &rct, std::unordered_set<crypto::public_key> &valid_public_keys_cache)
+{
+  // rings are picked per input, so the inputs of all the txes can share a single set of
+  // daemon requests, and the result is split back per tx. The sanity check stays per tx.
+  THROW_WALLET_EXCEPTION_IF(rct.size() != selected_transfers.size(), error::wallet_internal_error, "Unexpected number of rct flags");
+  std::vector<size_t> all_transfers;
+  for (const std::vector<size_t> &v: selected_transfers)
+    all_transfers.insert(all_transfers.end(), v.begin(), v.end());
+
+  uint64_t num_outs_per_asset = 0;
+  uint64_t num_spendable_global_outs = 0;
+  std::vector<uint64_t> rct_offsets;
+  std::vector<std::vector<get_outs_entry>> all_outs;
+  for (size_t attempts = 3; attempts > 0; --attempts)
+  {
+    get_outs(all_outs, all_transfers, fake_outputs_count, rct_offsets, valid_public_keys_cache, num_spendable_global_outs, num_outs_per_asset);
+    THROW_WALLET_EXCEPTION_IF(all_outs.size() != all_transfers.size(), error::wallet_internal_error, "Unexpected number of rings");
+
+    outs.clear();
+    outs.resize(selected_transfers.size());
+    std::vector<crypto::key_image> key_images;
+    for (size_t n = 0, offset = 0; n < selected_transfers.size(); offset += selected_transfers[n].size(), ++n)
+    {
+      outs[n].assign(std::make_move_iterator(all_outs.begin() + offset), std::make_move_iterator(all_outs.begin() + offset + selected_transfers[n].size()));
+      if (!rct[n])
+        continue;
+      const auto unique = outs_unique(outs[n]);
+      if (!tx_sanity_check(unique.first, unique.second, rct_offsets.empty() ? 0 : rct_offsets.back()))
+        for (size_t idx: selected_transfers[n])
+          key_images.push_back(m_transfers[idx].m_key_image);
+    }
+    if (key_images.empty())
+      return;
+    unset_ring(key_images);
+  }
+
+  THROW_WALLET_EXCEPTION(error::wallet_internal_error, tr("Transaction sanity check failed"));
+}
+
 void wallet2::get_outs(std::vector<std::vector<tools::wallet2::get_outs_entry>> &outs, const std::vector<size_t> &selected_transfers, size_t fake_outputs_count, std::vector<uint64_t> &rct_offsets, std::unordered_set<crypto::public_key> &valid_public_keys_cache, uint64_t &num_spendable_global_outs, uint64_t &num_outs)
 {
   LOG_PRINT_L2("fake_outputs_count: " << fake_outputs_count);
@@ -10128,7 +10522,7 @@ void wallet2::transfer_selected_rct(std::vector<cryptonote::tx_destination_entry
     if (td.m_td_origin_idx != (uint64_t)-1) {
       THROW_WALLET_EXCEPTION_IF(td.m_td_origin_idx >= get_num_transfer_details(), error::wallet_internal_error, "cannot locate return_payment origin index in m_transfers");
       const transfer_details& td_origin = get_transfer_details(td.m_td_origin_idx);
-      src.origin_tx_data.tx_type    = td_origin.m_tx.type;
+      src.origin_tx_data.tx_type    = td_origin.m_tx->type;
       src.origin_tx_data.tx_pub_key   = get_tx_pub_key_from_extra(td_origin.m_tx);
       src.origin_tx_data.output_index = td_origin.m_internal_output_index;
     }
@@ -10383,9 +10777,14 @@ std::vector<size_t> wallet2::pick_preferred_rct_inputs(uint64_t needed_money, ui
     return picks;
   }
   
+  const transfer_columns &cols = get_transfer_columns();
+  const uint32_t asset_id = cols.find_asset_id(asset_type);
+
   // try to find a rct input of enough size
   for (size_t i: m_transfers_indices[asset_type])
   {
+    if (!cols.is_available(i, asset_id, subaddr_account, false) || cols.m_amount[i] < needed_money)
+      continue;
     const transfer_details& td = m_transfers[i];
     if (!is_spent(td, false) && !td.m_frozen && td.is_rct() && td.amount() >= needed_money && is_transfer_unlocked(td) && td.m_subaddr_index.major == subaddr_account && subaddr_indices.count(td.m_subaddr_index.minor) == 1)
     {
@@ -10407,6 +10806,8 @@ std::vector<size_t> wallet2::pick_preferred_rct_inputs(uint64_t needed_money, ui
   for (auto i=m_transfers_indices[asset_type].begin(); i!= m_transfers_indices[asset_type].end(); ++i)
   {
     size_t idx = *i;
+    if (!cols.is_available(idx, asset_id, subaddr_account, false))
+      continue;
     const transfer_details& td = m_transfers[idx];
     if (!is_spent(td, false) && !td.m_frozen && !td.m_key_image_partial && td.is_rct() && is_transfer_unlocked(td) && td.m_subaddr_index.major == subaddr_account && subaddr_indices.count(td.m_subaddr_index.minor) == 1)
     {
@@ -10422,6 +10823,8 @@ std::vector<size_t> wallet2::pick_preferred_rct_inputs(uint64_t needed_money, ui
       for (; j!=m_transfers_indices[asset_type].end(); ++j)
       {
         size_t idx2 = *j;
+        if (!cols.is_available(idx2, asset_id, subaddr_account, false) || cols.m_subaddr_index[idx2] != td.m_subaddr_index)
+          continue;
         const transfer_details& td2 = m_transfers[idx2];
         if (td2.amount() > m_ignore_outputs_above || td2.amount() < m_ignore_outputs_below)
         {
@@ -10761,8 +11164,13 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(std::vector<cryp
   // Verify that we have outputs in our wallet for the correct asset_type
   THROW_WALLET_EXCEPTION_IF(!m_transfers_indices.count(source_asset), error::wallet_internal_error, "Cannot find outputs with correct asset_type to pay for TX");
   
+  const transfer_columns &cols = get_transfer_columns();
+  const uint32_t source_asset_id = cols.find_asset_id(source_asset);
   for (size_t i: m_transfers_indices[source_asset])
   {
+    // cheap rejection of spent/frozen/foreign outputs without touching the full transfer_details
+    if (!cols.is_available(i, source_asset_id, subaddr_account, false))
+      continue;
     const transfer_details& td = m_transfers[i];
     if (m_ignore_fractional_outputs && td.amount() < fractional_threshold)
     {
@@ -11090,6 +11498,18 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(std::vector<cryp
           detail::digit_split_strategy, tx_dust_policy(::config::DEFAULT_DUST_THRESHOLD), test_tx, test_ptx, use_view_tags);
       auto txBlob = t_serializable_object_to_blob(test_ptx.tx);
       needed_fee = calculate_fee(use_per_byte_fee, test_ptx.tx, txBlob.size(), base_fee, fee_quantization_mask);
+      if (use_rct)
+      {
+        // Paying needed_fee changes the weight only through the fee and burnt amount varints, so the
+        // fee can be settled from this build: raise it until it covers the weight of a tx carrying it
+        for (uint64_t tx_fee = test_ptx.fee; needed_fee > tx_fee; )
+        {
+          tx_fee = needed_fee;
+          const uint64_t amount_burnt = cryptonote::get_burnt_amount(tx.get_adjusted_dsts(tx_fee), tx_type, dest_asset);
+          needed_fee = calculate_fee_from_weight(base_fee, get_transaction_weight_for_fee(test_tx, txBlob.size(), tx_fee, amount_burnt), fee_quantization_mask);
+          needed_fee = std::max(needed_fee, tx_fee);
+        }
+      }
 
       // Depending on the mode, we take extra fees from either our change output or the destination outputs for which subtract_fee_from_outputs is true
       uint64_t output_available_for_fee = 0;
@@ -11122,35 +11542,50 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_2(std::vector<cryp
       else
       {
         LOG_PRINT_L2("We made a tx, adjusting fee and saving it, we need " << print_money(needed_fee) << " and we have " << print_money(test_ptx.fee));
-        size_t fee_tries;
-        for (fee_tries = 0; fee_tries < 10 && needed_fee > test_ptx.fee; ++fee_tries) {
-          tx_dsts = tx.get_adjusted_dsts(needed_fee);
-
-          if (use_rct)
-            transfer_selected_rct(tx_dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra,
-              test_tx, test_ptx, rct_config, use_view_tags, source_asset, dest_asset, tx_type);
-          else
+        uint64_t tx_fee = test_ptx.fee;
+        uint64_t tx_weight = get_transaction_weight(test_tx, txBlob.size());
+        if (use_rct)
+        {
+          // needed_fee already accounts for its own weight (see above), so the tx does not need
+          // building again until the real pass
+          if (needed_fee > tx_fee)
+          {
+            tx_fee = needed_fee;
+            tx_weight = get_transaction_weight_for_fee(test_tx, txBlob.size(), tx_fee, cryptonote::get_burnt_amount(tx.get_adjusted_dsts(tx_fee), tx_type, dest_asset));
+          }
+        }
+        else
+        {
+          size_t fee_tries;
+          for (fee_tries = 0; fee_tries < 10 && needed_fee > test_ptx.fee; ++fee_tries) {
+            tx_dsts = tx.get_adjusted_dsts(needed_fee);
             transfer_selected(tx_dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra,
               detail::digit_split_strategy, tx_dust_policy(::config::DEFAULT_DUST_THRESHOLD), test_tx, test_ptx, use_view_tags);
-          txBlob = t_serializable_object_to_blob(test_ptx.tx);
-          needed_fee = calculate_fee(use_per_byte_fee, test_ptx.tx, txBlob.size(), base_fee, fee_quantization_mask);
-          LOG_PRINT_L2("Made an attempt at a  final " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(test_ptx.fee) <<
-            " fee  and " << print_money(test_ptx.change_dts.amount) << " change");
-        };
-
-        THROW_WALLET_EXCEPTION_IF(fee_tries == 10, error::wallet_internal_error,
-          "Too many attempts to raise pending tx fee to level of needed fee");
+            txBlob = t_serializable_object_to_blob(test_ptx.tx);
+            needed_fee = calculate_fee(use_per_byte_fee, test_ptx.tx, txBlob.size(), base_fee, fee_quantization_mask);
+            LOG_PRINT_L2("Made an attempt at a  final " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(test_ptx.fee) <<
+              " fee  and " << print_money(test_ptx.change_dts.amount) << " change");
+          };
+
+          THROW_WALLET_EXCEPTION_IF(fee_tries == 10, error::wallet_internal_error,
+            "Too many attempts to raise pending tx fee to level of needed fee");
+          tx_fee = test_ptx.fee;
+          tx_weight = get_transaction_weight(test_tx, txBlob.size());
+        }
+        // a fee increase comes out of the change, unless dust or a carved partial payment covered it
+        const uint64_t fee_from_change = tx_has_subtractable_output ? 0 : std::min(tx_fee - test_ptx.fee, test_ptx.change_dts.amount);
+        const uint64_t tx_change = test_ptx.change_dts.amount - fee_from_change;
 
-        LOG_PRINT_L2("Made a final " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(test_ptx.fee) <<
-          " fee  and " << print_money(test_ptx.change_dts.amount) << " change");
+        LOG_PRINT_L2("Made a final " << get_weight_string(tx_weight) << " tx, with " << print_money(tx_fee) <<
+          " fee  and " << print_money(tx_change) << " change");
 
         tx.tx = test_tx;
         tx.ptx = test_ptx;
-        tx.weight = get_transaction_weight(test_tx, txBlob.size());
+        tx.weight = tx_weight;
         tx.outs = outs;
-        tx.needed_fee = test_ptx.fee;
-        accumulated_fee += test_ptx.fee;
-        accumulated_change += test_ptx.change_dts.amount;
+        tx.needed_fee = tx_fee;
+        accumulated_fee += tx_fee;
+        accumulated_change += tx_change;
         adding_fee = false;
         if (!dsts.empty())
         {
@@ -11232,6 +11667,8 @@ skip_tx:
     tx.tx = test_tx;
     tx.ptx = test_ptx;
     tx.weight = get_transaction_weight(test_tx, txBlob.size());
+    THROW_WALLET_EXCEPTION_IF(calculate_fee(use_per_byte_fee, test_ptx.tx, txBlob.size(), base_fee, fee_quantization_mask) > tx.needed_fee,
+      error::wallet_internal_error, "Final tx needs a higher fee than the one it was built with");
   }
 
   std::vector<wallet2::pending_tx> ptx_vector;
@@ -11445,7 +11882,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_return(std::vector
   size_t idx = transfers_indices[0];
   THROW_WALLET_EXCEPTION_IF(idx >= get_num_transfer_details(), error::wallet_internal_error, tr("cannot locate return_payment origin index in m_transfers"));
   const transfer_details& td_origin = get_transfer_details(idx);
-  const std::string asset_type = td_origin.m_tx.source_asset_type;
+  const std::string asset_type = td_origin.m_tx->source_asset_type;
   bool is_subaddress = true;
   size_t outputs = 1;
   std::vector<size_t> unused_dust_indices = {};
@@ -11463,13 +11900,13 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_return(std::vector
   crypto::public_key P_change = crypto::null_pkey;
   uint8_t change_index;
   uint32_t hf_version = get_current_hard_fork();
-  if (td_origin.m_tx.version >= TRANSACTION_VERSION_N_OUTS) {
+  if (td_origin.m_tx->version >= TRANSACTION_VERSION_N_OUTS) {
     
     // Calculate z_i (the shared secret between sender and ourselves for the original TX)
     crypto::public_key txkey_pub = null_pkey; // R
     const std::vector<crypto::public_key> in_additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(td_origin.m_tx);
     if (in_additional_tx_pub_keys.size() != 0) {
-      THROW_WALLET_EXCEPTION_IF(in_additional_tx_pub_keys.size() != td_origin.m_tx.vout.size(),
+      THROW_WALLET_EXCEPTION_IF(in_additional_tx_pub_keys.size() != td_origin.m_tx->vout.size(),
                                 error::wallet_internal_error,
                                 tr("at create_transactions_return(): incorrect number of additional TX pubkeys in origin TX for return_payment"));
       txkey_pub = in_additional_tx_pub_keys[td_origin.m_internal_output_index];
@@ -11494,7 +11931,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_return(std::vector
     crypto::hash_to_scalar(&buf, sizeof(buf), y);
 
     // The change_index needs decoding too
-    uint8_t eci_data = td_origin.m_tx.return_address_change_mask[td_origin.m_internal_output_index];
+    uint8_t eci_data = td_origin.m_tx->return_address_change_mask[td_origin.m_internal_output_index];
       
     // Calculate the encrypted_change_index data for this output
     std::memset(buf.domain_separator, 0x0, sizeof(buf.domain_separator));
@@ -11503,13 +11940,13 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_return(std::vector
     keccak((uint8_t *)&buf, sizeof(buf), (uint8_t*)&eci_out, sizeof(eci_out));
     change_index = eci_data ^ eci_out.data[0];
     
-    return_address = td_origin.m_tx.return_address_list[td_origin.m_internal_output_index];
+    return_address = td_origin.m_tx->return_address_list[td_origin.m_internal_output_index];
     
     // Sanity check that we aren't attempting to return our own TX change output to ourselves
     THROW_WALLET_EXCEPTION_IF(change_index == td_origin.m_internal_output_index, error::wallet_internal_error, tr("Attempting to return change to ourself"));
 
     // Sanity check that we can obtain the change output from the origin TX
-    THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_public_key(td_origin.m_tx.vout[change_index], P_change),
+    THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_public_key(td_origin.m_tx->vout[change_index], P_change),
                               error::wallet_internal_error,
                               tr("Failed to identify change output"));
     
@@ -11519,13 +11956,13 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_return(std::vector
     change_index = (td_origin.m_internal_output_index == 0) ? 1 : 0;
 
     // Return address was provided
-    return_address = td_origin.m_tx.return_address;
+    return_address = td_origin.m_tx->return_address;
     
     // Sanity check that we aren't attempting to return our own TX change output to ourselves
     THROW_WALLET_EXCEPTION_IF(change_index == td_origin.m_internal_output_index, error::wallet_internal_error, tr("Attempting to return change to ourself"));
     
     // Sanity check that we can obtain the change output from the origin TX
-    THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_public_key(td_origin.m_tx.vout[change_index], P_change),
+    THROW_WALLET_EXCEPTION_IF(!cryptonote::get_output_public_key(td_origin.m_tx->vout[change_index], P_change),
                               error::wallet_internal_error,
                               tr("Failed to identify change output"));
   
@@ -11586,7 +12023,6 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
   std::vector<TX> txes;
   uint64_t needed_fee, available_for_fee = 0;
   uint64_t upper_transaction_weight_limit = get_upper_transaction_weight_limit();
-  std::vector<std::vector<get_outs_entry>> outs;
 
   const bool use_per_byte_fee = true;
   const bool use_rct = true;
@@ -11611,8 +12047,7 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
   accumulated_change = 0;
   needed_fee = 0;
 
-  // while we have something to send
-  hwdev.set_mode(hw::device::TRANSACTION_CREATE_FAKE);
+  // while we have something to send, split the inputs into txes
   while (!unused_dust_indices.empty() || !unused_transfers_indices.empty()) {
     TX &tx = txes.back();
 
@@ -11647,96 +12082,112 @@ std::vector<wallet2::pending_tx> wallet2::create_transactions_from(const crypton
     uint64_t available_amount = td.amount();
     accumulated_outputs += available_amount;
 
-    // clear any fake outs we'd already gathered, since we'll need a new set
-    outs.clear();
-
     // here, check if we need to sent tx and start a new one
     LOG_PRINT_L2("Considering whether to create a tx now, " << tx.selected_transfers.size() << " inputs, tx limit "
       << upper_transaction_weight_limit);
     const size_t estimated_rct_tx_weight = estimate_tx_weight(use_rct, tx.selected_transfers.size(), fake_outs_count, tx.dsts.size() + 2, extra.size(), bulletproof, clsag, bulletproof_plus, use_view_tags);
     bool try_tx = (unused_dust_indices.empty() && unused_transfers_indices.empty()) || ( estimated_rct_tx_weight >= TX_WEIGHT_TARGET(upper_transaction_weight_limit));
 
-    if (try_tx) {
-      cryptonote::transaction test_tx;
-      pending_tx test_ptx;
+    if (try_tx && (!unused_transfers_indices.empty() || !unused_dust_indices.empty()))
+    {
+      LOG_PRINT_L2("We have more to pay, starting another tx");
+      txes.push_back(TX());
+    }
+  }
 
-      const size_t num_outputs = get_num_outputs(tx.dsts, m_transfers, tx.selected_transfers);
-      needed_fee = estimate_fee(use_per_byte_fee, use_rct, tx.selected_transfers.size(), fake_outs_count, num_outputs, extra.size(), bulletproof, clsag, bulletproof_plus, use_view_tags, base_fee, fee_quantization_mask);
+  // the decoys for all the txes are fetched together, rather than with one daemon round trip per tx
+  std::vector<std::vector<size_t>> txes_selected_transfers;
+  std::vector<bool> txes_all_rct;
+  for (const TX &tx: txes)
+  {
+    txes_selected_transfers.push_back(tx.selected_transfers);
+    bool all_rct = true;
+    for (size_t idx: tx.selected_transfers)
+      all_rct &= m_transfers[idx].is_rct();
+    txes_all_rct.push_back(all_rct);
+  }
+  std::vector<std::vector<std::vector<get_outs_entry>>> txes_outs;
+  get_outs(txes_outs, txes_selected_transfers, fake_outs_count, txes_all_rct, valid_public_keys_cache); // may throw
+  for (size_t n = 0; n < txes.size(); ++n)
+    txes[n].outs = std::move(txes_outs[n]);
 
-      // SRCG: should the subaddress be forced to TRUE for _RETURN_ TXs and FALSE for all others?!?!?
-      // add N - 1 outputs for correct initial fee estimation
-      for (size_t i = 0; i < ((outputs > 1) ? outputs - 1 : outputs); ++i) {
-        tx.dsts.push_back(tx_destination_entry(1, address, tx_type == cryptonote::transaction_type::RETURN, tx_type == cryptonote::transaction_type::RETURN));
-        tx.dsts.back().asset_type = asset_type;
+  hwdev.set_mode(hw::device::TRANSACTION_CREATE_FAKE);
+  for (TX &tx: txes)
+  {
+    cryptonote::transaction test_tx;
+    pending_tx test_ptx;
+    std::vector<std::vector<get_outs_entry>> &outs = tx.outs;
+
+    const size_t num_outputs = get_num_outputs(tx.dsts, m_transfers, tx.selected_transfers);
+    needed_fee = estimate_fee(use_per_byte_fee, use_rct, tx.selected_transfers.size(), fake_outs_count, num_outputs, extra.size(), bulletproof, clsag, bulletproof_plus, use_view_tags, base_fee, fee_quantization_mask);
+
+    // SRCG: should the subaddress be forced to TRUE for _RETURN_ TXs and FALSE for all others?!?!?
+    // add N - 1 outputs for correct initial fee estimation
+    for (size_t i = 0; i < ((outputs > 1) ? outputs - 1 : outputs); ++i) {
+      tx.dsts.push_back(tx_destination_entry(1, address, tx_type == cryptonote::transaction_type::RETURN, tx_type == cryptonote::transaction_type::RETURN));
+      tx.dsts.back().asset_type = asset_type;
+    }
+    
+    LOG_PRINT_L2("Trying to create a tx now, with " << tx.dsts.size() << " destinations and " <<
+      tx.selected_transfers.size() << " outputs");
+    if (use_rct)
+      transfer_selected_rct(tx.dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra,
+                            test_tx, test_ptx, rct_config, use_view_tags, asset_type, asset_type, tx_type);
+    else
+      transfer_selected(tx.dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra,
+        detail::digit_split_strategy, tx_dust_policy(::config::DEFAULT_DUST_THRESHOLD), test_tx, test_ptx, use_view_tags);
+    auto txBlob = t_serializable_object_to_blob(test_ptx.tx);
+    needed_fee = calculate_fee(use_per_byte_fee, test_ptx.tx, txBlob.size(), base_fee, fee_quantization_mask);
+    available_for_fee = test_ptx.fee + test_ptx.change_dts.amount;
+    for (auto &dt: test_ptx.dests)
+      available_for_fee += dt.amount;
+    LOG_PRINT_L2("Made a " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(available_for_fee) << " available for fee (" <<
+      print_money(needed_fee) << " needed)");
+
+    // add last output, missed for fee estimation
+    if (outputs > 1)
+      tx.dsts.push_back(tx_destination_entry(1, address, is_subaddress));
+
+    THROW_WALLET_EXCEPTION_IF(needed_fee > available_for_fee, error::wallet_internal_error, tr("Transaction cannot pay for itself"));
+
+    do {
+      LOG_PRINT_L2("We made a tx, adjusting fee and saving it, we need " << print_money(needed_fee) << " and we have " << print_money(test_ptx.fee));
+      // distribute total transferred amount between outputs
+      uint64_t amount_transferred = available_for_fee - needed_fee;
+      uint64_t dt_amount = amount_transferred / outputs;
+      // residue is distributed as one atomic unit per output until it reaches zero
+      uint64_t residue = amount_transferred % outputs;
+      for (auto &dt: tx.dsts)
+      {
+        uint64_t dt_residue = 0;
+        if (residue > 0)
+        {
+          dt_residue = 1;
+          residue -= 1;
+        }
+        dt.amount = dt_amount + dt_residue;
       }
-      
-      LOG_PRINT_L2("Trying to create a tx now, with " << tx.dsts.size() << " destinations and " <<
-        tx.selected_transfers.size() << " outputs");
       if (use_rct)
-        transfer_selected_rct(tx.dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra,
-                              test_tx, test_ptx, rct_config, use_view_tags, asset_type, asset_type, tx_type);
+        transfer_selected_rct(tx.dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra, 
+				test_tx, test_ptx, rct_config, use_view_tags, asset_type, asset_type, tx_type);
       else
         transfer_selected(tx.dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra,
           detail::digit_split_strategy, tx_dust_policy(::config::DEFAULT_DUST_THRESHOLD), test_tx, test_ptx, use_view_tags);
-      auto txBlob = t_serializable_object_to_blob(test_ptx.tx);
+      txBlob = t_serializable_object_to_blob(test_ptx.tx);
       needed_fee = calculate_fee(use_per_byte_fee, test_ptx.tx, txBlob.size(), base_fee, fee_quantization_mask);
-      available_for_fee = test_ptx.fee + test_ptx.change_dts.amount;
-      for (auto &dt: test_ptx.dests)
-        available_for_fee += dt.amount;
-      LOG_PRINT_L2("Made a " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(available_for_fee) << " available for fee (" <<
-        print_money(needed_fee) << " needed)");
-
-      // add last output, missed for fee estimation
-      if (outputs > 1)
-        tx.dsts.push_back(tx_destination_entry(1, address, is_subaddress));
-
-      THROW_WALLET_EXCEPTION_IF(needed_fee > available_for_fee, error::wallet_internal_error, tr("Transaction cannot pay for itself"));
-
-      do {
-        LOG_PRINT_L2("We made a tx, adjusting fee and saving it, we need " << print_money(needed_fee) << " and we have " << print_money(test_ptx.fee));
-        // distribute total transferred amount between outputs
-        uint64_t amount_transferred = available_for_fee - needed_fee;
-        uint64_t dt_amount = amount_transferred / outputs;
-        // residue is distributed as one atomic unit per output until it reaches zero
-        uint64_t residue = amount_transferred % outputs;
-        for (auto &dt: tx.dsts)
-        {
-          uint64_t dt_residue = 0;
-          if (residue > 0)
-          {
-            dt_residue = 1;
-            residue -= 1;
-          }
-          dt.amount = dt_amount + dt_residue;
-        }
-        if (use_rct)
-          transfer_selected_rct(tx.dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra, 
-				test_tx, test_ptx, rct_config, use_view_tags, asset_type, asset_type, tx_type);
-        else
-          transfer_selected(tx.dsts, tx.selected_transfers, fake_outs_count, outs, valid_public_keys_cache, unlock_time, needed_fee, extra,
-            detail::digit_split_strategy, tx_dust_policy(::config::DEFAULT_DUST_THRESHOLD), test_tx, test_ptx, use_view_tags);
-        txBlob = t_serializable_object_to_blob(test_ptx.tx);
-        needed_fee = calculate_fee(use_per_byte_fee, test_ptx.tx, txBlob.size(), base_fee, fee_quantization_mask);
-        LOG_PRINT_L2("Made an attempt at a final " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(test_ptx.fee) <<
-          " fee  and " << print_money(test_ptx.change_dts.amount) << " change");
-      } while (needed_fee > test_ptx.fee);
-
-      LOG_PRINT_L2("Made a final " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(test_ptx.fee) <<
+      LOG_PRINT_L2("Made an attempt at a final " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(test_ptx.fee) <<
         " fee  and " << print_money(test_ptx.change_dts.amount) << " change");
+    } while (needed_fee > test_ptx.fee);
 
-      tx.tx = test_tx;
-      tx.ptx = test_ptx;
-      tx.weight = get_transaction_weight(test_tx, txBlob.size());
-      tx.outs = outs;
-      tx.needed_fee = test_ptx.fee;
-      accumulated_fee += test_ptx.fee;
-      accumulated_change += test_ptx.change_dts.amount;
-      if (!unused_transfers_indices.empty() || !unused_dust_indices.empty())
-      {
-        LOG_PRINT_L2("We have more to pay, starting another tx");
-        txes.push_back(TX());
-      }
-    }
+    LOG_PRINT_L2("Made a final " << get_weight_string(test_ptx.tx, txBlob.size()) << " tx, with " << print_money(test_ptx.fee) <<
+      " fee  and " << print_money(test_ptx.change_dts.amount) << " change");
+
+    tx.tx = test_tx;
+    tx.ptx = test_ptx;
+    tx.weight = get_transaction_weight(test_tx, txBlob.size());
+    tx.needed_fee = test_ptx.fee;
+    accumulated_fee += test_ptx.fee;
+    accumulated_change += test_ptx.change_dts.amount;
   }
 
   LOG_PRINT_L1("Done creating " << txes.size() << " transactions, " << print_money(accumulated_fee) <<
@@ -13556,7 +14007,7 @@ bool wallet2::verify_with_public_key(const std::string &data, const crypto::publ
 crypto::public_key wallet2::get_tx_pub_key_from_received_outs(const tools::wallet2::transfer_details &td) const
 {
   std::vector<tx_extra_field> tx_extra_fields;
-  if(!parse_tx_extra(td.m_tx.extra, tx_extra_fields))
+  if(!parse_tx_extra(td.m_tx->extra, tx_extra_fields))
   {
     // Extra may only be partially parsed, it's OK if tx_extra_fields contains public key
   }
@@ -13587,10 +14038,10 @@ crypto::public_key wallet2::get_tx_pub_key_from_received_outs(const tools::walle
     bool r = hwdev.generate_key_derivation(tx_pub_key, keys.m_view_secret_key, derivation);
     THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "Failed to generate key derivation");
 
-    for (size_t i = 0; i < td.m_tx.vout.size(); ++i)
+    for (size_t i = 0; i < td.m_tx->vout.size(); ++i)
     {
       tx_scan_info_t tx_scan_info;
-      check_acc_out_precomp(td.m_tx.vout[i], derivation, {}, i, tx_scan_info);
+      check_acc_out_precomp(td.m_tx->vout[i], derivation, {}, i, tx_scan_info);
       if (!tx_scan_info.error && tx_scan_info.received)
         return tx_pub_key;
     }
@@ -13653,7 +14104,7 @@ std::pair<uint64_t, std::vector<std::pair<crypto::key_image, crypto::signature>>
 
     // get tx pub key
     std::vector<tx_extra_field> tx_extra_fields;
-    if(!parse_tx_extra(td.m_tx.extra, tx_extra_fields))
+    if(!parse_tx_extra(td.m_tx->extra, tx_extra_fields))
     {
       // Extra may only be partially parsed, it's OK if tx_extra_fields contains public key
     }
@@ -13819,6 +14270,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
     {
       transfer_details &td = m_transfers[n + offset];
       td.m_spent = daemon_resp.spent_status[n] != COMMAND_RPC_IS_KEY_IMAGE_SPENT::UNSPENT;
+      update_transfer_columns(n + offset);
     }
   }
   spent = 0;
@@ -13831,7 +14283,7 @@ uint64_t wallet2::import_key_images(const std::vector<std::pair<crypto::key_imag
   PERF_TIMER_START(import_key_images_C);
   for (const transfer_details &td: m_transfers)
   {
-    for (const cryptonote::txin_v& in : td.m_tx.vin)
+    for (const cryptonote::txin_v& in : td.m_tx->vin)
     {
       if (in.type() == typeid(cryptonote::txin_to_key))
         spent_key_images.insert(std::make_pair(boost::get<cryptonote::txin_to_key>(in).k_image, td.m_txid));
@@ -14225,6 +14677,9 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     m_transfers.resize(offset + output_array.size());
   else if (num_outputs < m_transfers.size())
     m_transfers.resize(num_outputs);
+  m_transfer_columns.resize(m_transfers.size());
+  for (size_t i = original_size; i < m_transfers.size(); ++i)
+    update_transfer_columns(i);
 
   for (size_t i = 0; i < output_array.size(); ++i)
   {
@@ -14247,6 +14702,7 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
 
       // copy anyway, since the comparison does not include ancillary fields which may have changed
       m_transfers[i + offset] = std::move(td);
+      update_transfer_columns(i + offset);
       continue;
     }
 
@@ -14259,11 +14715,11 @@ process:
     assert(false);
     origin_data od;
     
-    THROW_WALLET_EXCEPTION_IF(td.m_tx.vout.empty(), error::wallet_internal_error, "tx with no outputs at index " + boost::lexical_cast<std::string>(i + offset));
+    THROW_WALLET_EXCEPTION_IF(td.m_tx->vout.empty(), error::wallet_internal_error, "tx with no outputs at index " + boost::lexical_cast<std::string>(i + offset));
     crypto::public_key tx_pub_key = get_tx_pub_key_from_received_outs(td);
     const std::vector<crypto::public_key> additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(td.m_tx);
 
-    THROW_WALLET_EXCEPTION_IF(td.m_internal_output_index >= td.m_tx.vout.size(),
+    THROW_WALLET_EXCEPTION_IF(td.m_internal_output_index >= td.m_tx->vout.size(),
         error::wallet_internal_error, "Internal index is out of range");
     crypto::public_key out_key = td.get_public_key();
     if (should_expand(td.m_subaddr_index))
@@ -14281,7 +14737,9 @@ process:
     m_key_images[td.m_key_image] = i + offset;
     m_pub_keys[td.get_public_key()] = i + offset;
     m_transfers[i + offset] = std::move(td);
+    update_transfer_columns(i + offset);
   }
+  share_tx_prefixes();
 
   return m_transfers.size();
 }
@@ -14309,6 +14767,9 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     m_transfers.resize(offset + output_array.size());
   else if (num_outputs < m_transfers.size())
     m_transfers.resize(num_outputs);
+  m_transfer_columns.resize(m_transfers.size());
+  for (size_t i = original_size; i < m_transfers.size(); ++i)
+    update_transfer_columns(i);
 
   for (size_t i = 0; i < output_array.size(); ++i)
   {
@@ -14330,6 +14791,7 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     td.m_key_image_partial = false;
     td.m_subaddr_index.major = etd.m_subaddr_index_major;
     td.m_subaddr_index.minor = etd.m_subaddr_index_minor;
+    update_transfer_columns(i + offset);
 
     // skip those we've already imported, or which have different data
     if (i + offset < original_size)
@@ -14347,7 +14809,7 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     }
 
     // construct a synthetix tx prefix that has the info we'll need: the output with its pubkey, the tx pubkey in extra
-    td.m_tx = {};
+    cryptonote::transaction_prefix tx_prefix;
 
     THROW_WALLET_EXCEPTION_IF(etd.m_internal_output_index >= 65536, error::wallet_internal_error, "internal output index seems outrageously high, rejecting");
     td.m_internal_output_index = etd.m_internal_output_index;
@@ -14356,13 +14818,14 @@ size_t wallet2::import_outputs(const std::tuple<uint64_t, uint64_t, std::vector<
     cryptonote::tx_out out;
     out.amount = etd.m_amount;
     out.target = tk;
-    td.m_tx.vout.resize(etd.m_internal_output_index);
-    td.m_tx.vout.push_back(out);
+    tx_prefix.vout.resize(etd.m_internal_output_index);
+    tx_prefix.vout.push_back(out);
 
     td.m_pk_index = 0;
-    add_tx_pub_key_to_extra(td.m_tx, etd.m_tx_pubkey);
+    add_tx_pub_key_to_extra(tx_prefix, etd.m_tx_pubkey);
     if (!etd.m_additional_tx_keys.empty())
-      add_additional_tx_pub_keys_to_extra(td.m_tx.extra, etd.m_additional_tx_keys);
+      add_additional_tx_pub_keys_to_extra(tx_prefix.extra, etd.m_additional_tx_keys);
+    td.m_tx = std::move(tx_prefix);
 
     // Populate this struct if you want to make use of "import_outputs" for Salvium!!!
     assert(false);
@@ -14591,7 +15054,7 @@ crypto::key_image wallet2::get_multisig_composite_key_image(size_t n) const
     const transfer_details& td_origin = get_transfer_details(td.m_td_origin_idx);
     origin_tx_data.tx_pub_key = get_tx_pub_key_from_extra(td_origin.m_tx);
     origin_tx_data.output_index = td_origin.m_internal_output_index;
-    origin_tx_data.tx_type = td_origin.m_tx.type;
+    origin_tx_data.tx_type = td_origin.m_tx->type;
     use_origin_data = true;
   }
   
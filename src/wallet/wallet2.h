@@ -41,6 +41,8 @@
 #include <boost/serialization/list.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/deque.hpp>
+#include <boost/serialization/level.hpp>
+#include <boost/serialization/tracking.hpp>
 #include <boost/thread/lock_guard.hpp>
 #include <atomic>
 #include <random>
@@ -93,6 +95,7 @@ class wallet_accessor_test;
 namespace tools
 {
   class ringdb;
+  class refresh_prefetcher;
   class wallet2;
   class Notify;
 
@@ -329,10 +332,42 @@ private:
       tx_scan_info_t(): amount(0), asset_type(""), unlock_time(0), money_transfered(0), origin_idx((uint64_t)-1), error(true) {}
     };
 
+    // The prefix of a tx we received outputs from, shared between all those
+    // outputs. It is never changed in place, only replaced, and serializes
+    // as the prefix itself so the cache format does not change.
+    class shared_tx_prefix
+    {
+    public:
+      shared_tx_prefix() {}
+      shared_tx_prefix(const cryptonote::transaction_prefix &prefix): m_prefix(std::make_shared<const cryptonote::transaction_prefix>(prefix)) {}
+      shared_tx_prefix(cryptonote::transaction_prefix &&prefix): m_prefix(std::make_shared<const cryptonote::transaction_prefix>(std::move(prefix))) {}
+
+      const cryptonote::transaction_prefix &get() const { static const cryptonote::transaction_prefix empty; return m_prefix ? *m_prefix : empty; }
+      const cryptonote::transaction_prefix *operator->() const { return &get(); }
+      operator const cryptonote::transaction_prefix&() const { return get(); }
+      bool empty() const { return !m_prefix; }
+      bool shares_with(const shared_tx_prefix &other) const { return m_prefix == other.m_prefix; }
+
+      template <bool W, template <bool> class Archive>
+      bool member_do_serialize(Archive<W> &ar)
+      {
+        if (W)
+          return do_serialize(ar, const_cast<cryptonote::transaction_prefix&>(get()));
+        cryptonote::transaction_prefix prefix;
+        if (!do_serialize(ar, prefix))
+          return false;
+        *this = std::move(prefix);
+        return true;
+      }
+
+    private:
+      std::shared_ptr<const cryptonote::transaction_prefix> m_prefix;
+    };
+
     struct transfer_details
     {
       uint64_t m_block_height;
-      cryptonote::transaction_prefix m_tx;
+      shared_tx_prefix m_tx;
       crypto::hash m_txid;
       uint64_t m_internal_output_index;
       uint64_t m_global_output_index;
@@ -359,9 +394,9 @@ private:
       uint64_t amount() const { return m_amount; }
       const crypto::public_key get_public_key() const {
         crypto::public_key output_public_key;
-        THROW_WALLET_EXCEPTION_IF(m_tx.vout.size() <= m_internal_output_index,
+        THROW_WALLET_EXCEPTION_IF(m_tx->vout.size() <= m_internal_output_index,
           error::wallet_internal_error, "Too few outputs, outputs may be corrupted");
-        THROW_WALLET_EXCEPTION_IF(!get_output_public_key(m_tx.vout[m_internal_output_index], output_public_key),
+        THROW_WALLET_EXCEPTION_IF(!get_output_public_key(m_tx->vout[m_internal_output_index], output_public_key),
           error::wallet_internal_error, "Unable to get output public key from output");
         return output_public_key;
       };
@@ -393,6 +428,51 @@ private:
       END_SERIALIZE()
     };
 
+    /*!
+     * \brief Column-wise copy of the transfer_details fields read by the balance
+     *        and coin selection loops. Row i mirrors m_transfers[i], so those
+     *        loops can filter on contiguous arrays instead of walking the full
+     *        records (each of which carries a copy of its tx prefix).
+     *        Not serialized: rebuilt from m_transfers on load.
+     */
+    struct transfer_columns
+    {
+      enum : uint8_t
+      {
+        flag_spent = 1 << 0,
+        flag_spent_height_known = 1 << 1,
+        flag_frozen = 1 << 2,
+        flag_rct = 1 << 3,
+      };
+      static constexpr uint32_t invalid_asset_id = std::numeric_limits<uint32_t>::max();
+
+      std::vector<uint64_t> m_amount;
+      std::vector<uint64_t> m_block_height;
+      std::vector<uint32_t> m_asset_id;
+      std::vector<cryptonote::subaddress_index> m_subaddr_index;
+      std::vector<uint8_t> m_flags;
+      std::vector<std::string> m_asset_types; // asset id -> asset type
+
+      size_t size() const { return m_flags.size(); }
+      void clear();
+      void resize(size_t n);
+      void set(size_t idx, const transfer_details &td);
+      uint32_t find_asset_id(const std::string &asset_type) const;
+
+      bool is_spent(size_t idx, bool strict) const
+      {
+        const uint8_t mask = strict ? (flag_spent | flag_spent_height_known) : flag_spent;
+        return (m_flags[idx] & mask) == mask;
+      }
+      bool is_frozen(size_t idx) const { return m_flags[idx] & flag_frozen; }
+      bool is_rct(size_t idx) const { return m_flags[idx] & flag_rct; }
+      // true if the output is neither spent nor frozen and belongs to the given account and asset
+      bool is_available(size_t idx, uint32_t asset_id, uint32_t index_major, bool strict) const
+      {
+        return m_asset_id[idx] == asset_id && m_subaddr_index[idx].major == index_major && !is_spent(idx, strict) && !is_frozen(idx);
+      }
+    };
+
     struct exported_transfer_details
     {
       crypto::public_key m_pubkey;
@@ -1020,6 +1100,10 @@ private:
 
     void max_reorg_depth(uint64_t depth) {m_max_reorg_depth = depth;}
     uint64_t max_reorg_depth() const {return m_max_reorg_depth;}
+    void refresh_prefetch_depth(uint32_t depth) {m_refresh_prefetch_depth = depth;}
+    uint32_t refresh_prefetch_depth() const {return m_refresh_prefetch_depth;}
+    void refresh_prefetch_max_bytes(uint64_t bytes) {m_refresh_prefetch_max_bytes = bytes;}
+    uint64_t refresh_prefetch_max_bytes() const {return m_refresh_prefetch_max_bytes;}
 
     bool deinit();
     bool init(std::string daemon_address = "http://localhost:8080",
@@ -1084,6 +1168,21 @@ private:
     void refresh(bool trusted_daemon, uint64_t start_height, uint64_t & blocks_fetched, bool& received_money, bool check_pool = true, bool try_incremental = true, uint64_t max_blocks = std::numeric_limits<uint64_t>::max());
     bool refresh(bool trusted_daemon, uint64_t & blocks_fetched, bool& received_money, bool& ok);
 
+    /*!
+     * \brief Feeds the blocks this wallet pulls during refresh to another wallet on the same network,
+     *        so a set of wallets can be scanned from a single block stream.
+     *
+     * A follower is only fed batches that continue its own hash chain, so it should be brought up to the
+     * leader's starting height first (usually with one regular refresh). The leader keeps the follower
+     * alive until it is removed, and the follower refuses to refresh on its own while attached. Followers
+     * are processed in parallel on the compute threadpool; their pool state is not updated by the leader.
+     */
+    void add_scan_follower(const std::shared_ptr<wallet2> &follower);
+    void remove_scan_follower(const std::shared_ptr<wallet2> &follower);
+    void remove_scan_followers();
+    size_t get_num_scan_followers() const;
+    bool is_scan_follower() const { return m_scan_leader.load() != nullptr; }
+
     void set_refresh_type(RefreshType refresh_type) { m_refresh_type = refresh_type; }
     RefreshType get_refresh_type() const { return m_refresh_type; }
 
@@ -1782,17 +1881,19 @@ private:
     bool load_keys_buf(const std::string& keys_buf, const epee::wipeable_string& password, boost::optional<crypto::chacha_key>& keys_to_encrypt);
     void process_new_transaction(const crypto::hash &txid, const cryptonote::transaction& tx, const std::vector<uint64_t> &o_indices, const std::vector<uint64_t> &asset_type_output_indices, uint64_t height, uint8_t block_version, uint64_t ts, bool miner_tx, bool pool, bool double_spend_seen, const tx_cache_data &tx_cache_data, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache = NULL, bool ignore_callbacks = false);
     bool should_skip_block(const cryptonote::block &b, uint64_t height) const;
+    bool needs_ring_members(const cryptonote::transaction &tx, const tx_cache_data &tx_cache_data) const;
     void process_new_blockchain_entry(const cryptonote::block& b, const cryptonote::block_complete_entry& bche, const parsed_block &parsed_block, const crypto::hash& bl_id, uint64_t height, const std::vector<tx_cache_data> &tx_cache_data, size_t tx_cache_data_offset, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache = NULL);
     detached_blockchain_data detach_blockchain(uint64_t height, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache = NULL);
     void handle_reorg(uint64_t height, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache = NULL);
     void get_short_chain_history(std::list<crypto::hash>& ids, uint64_t granularity = 1) const;
     bool clear();
     void clear_soft(bool keep_key_images=false);
-    void pull_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> &asset_type_output_indices, uint64_t &current_height);
+    void pull_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_asset_type_output_indices> &asset_type_output_indices, uint64_t &current_height, bool ring_members = false);
     void pull_hashes(uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::vector<crypto::hash> &hashes);
     void fast_refresh(uint64_t stop_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, bool force = false);
-    void pull_and_parse_next_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception);
+    void pull_and_parse_next_blocks(bool first, bool try_incremental, uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<cryptonote::block_complete_entry> &prev_blocks, const std::vector<parsed_block> &prev_parsed_blocks, std::vector<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed_blocks, bool &last, bool &error, std::exception_ptr &exception, bool ring_members = false);
     void process_parsed_blocks(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks, uint64_t& blocks_added, std::map<std::pair<uint64_t, uint64_t>, size_t> *output_tracker_cache = NULL);
+    void process_scan_followers(uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<parsed_block> &parsed_blocks);
     bool accept_pool_tx_for_processing(const crypto::hash &txid);
     void process_unconfirmed_transfer(bool incremental, const crypto::hash &txid, wallet2::unconfirmed_transfer_details &tx_details, bool seen_in_pool, std::chrono::system_clock::time_point now, bool refreshed);
     void process_pool_info_extent(const cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response &res, std::vector<std::tuple<cryptonote::transaction, crypto::hash, bool>> &process_txs, bool refreshed);
@@ -1819,9 +1920,14 @@ private:
     std::vector<size_t> pick_preferred_rct_inputs(uint64_t needed_money, uint32_t subaddr_account, const std::set<uint32_t> &subaddr_indices, const std::string& asset_type);
     void set_spent(size_t idx, uint64_t height);
     void set_unspent(size_t idx);
+    void update_transfer_columns(size_t idx);
+    void rebuild_transfer_columns();
+    void share_tx_prefixes();
+    const transfer_columns &get_transfer_columns() const;
     bool is_spent(const transfer_details &td, bool strict = true) const;
     bool is_spent(size_t idx, bool strict = true) const;
     void get_outs(std::vector<std::vector<get_outs_entry>> &outs, const std::vector<size_t> &selected_transfers, size_t fake_outputs_count, bool rct, std::unordered_set<crypto::public_key> &valid_public_keys_cache);
+    void get_outs(std::vector<std::vector<std::vector<get_outs_entry>>> &outs, const std::vector<std::vector<size_t>> &selected_transfers, size_t fake_outputs_count, const std::vector<bool> &rct, std::unordered_set<crypto::public_key> &valid_public_keys_cache);
     void get_outs(std::vector<std::vector<get_outs_entry>> &outs, const std::vector<size_t> &selected_transfers, size_t fake_outputs_count, std::vector<uint64_t> &rct_offsets, std::unordered_set<crypto::public_key> &valid_public_keys_cache, uint64_t &num_spendable_global_outs, uint64_t &num_outs);
     bool tx_add_fake_output(std::vector<std::vector<tools::wallet2::get_outs_entry>> &outs, uint64_t global_index, const crypto::public_key& tx_public_key, const rct::key& mask, uint64_t real_index, bool unlocked, std::unordered_set<crypto::public_key> &valid_public_keys_cache) const;
     bool should_pick_a_second_output(bool use_rct, size_t n_transfers, const std::vector<size_t> &unused_transfers_indices, const std::vector<size_t> &unused_dust_indices) const;
@@ -1891,6 +1997,7 @@ private:
 
     transfer_container m_transfers;
     transfer_details_indices m_transfers_indices;
+    transfer_columns m_transfer_columns;
     serializable_unordered_map<crypto::public_key, locked_yield_details> m_locked_coins;
     serializable_map<crypto::public_key, size_t> m_salvium_txs;
     payment_container m_payments;
@@ -1911,6 +2018,9 @@ private:
     std::atomic<bool> m_run;
 
     boost::recursive_mutex m_daemon_rpc_mutex;
+    mutable boost::mutex m_scan_followers_lock;
+    std::vector<std::shared_ptr<wallet2>> m_scan_followers;
+    std::atomic<const wallet2*> m_scan_leader;
 
     bool m_trusted_daemon;
     i_wallet2_callback* m_callback;
@@ -1946,6 +2056,8 @@ private:
     bool m_confirm_non_default_ring_size;
     AskPasswordType m_ask_password;
     uint64_t m_max_reorg_depth;
+    uint32_t m_refresh_prefetch_depth;
+    uint64_t m_refresh_prefetch_max_bytes;
     uint32_t m_min_output_count;
     uint64_t m_min_output_value;
     bool m_merge_destinations;
@@ -1995,6 +2107,7 @@ private:
 
     uint64_t m_last_block_reward;
     std::unique_ptr<tools::file_locker> m_keys_file_locker;
+    std::unique_ptr<refresh_prefetcher> m_refresh_prefetcher;
     
     mms::message_store m_message_store;
     bool m_original_keys_available;
@@ -2021,6 +2134,8 @@ private:
 }
 BOOST_CLASS_VERSION(tools::wallet2, 30)
 BOOST_CLASS_VERSION(tools::wallet2::transfer_details, 12)
+BOOST_CLASS_IMPLEMENTATION(tools::wallet2::shared_tx_prefix, boost::serialization::object_serializable)
+BOOST_CLASS_TRACKING(tools::wallet2::shared_tx_prefix, boost::serialization::track_never)
 BOOST_CLASS_VERSION(tools::wallet2::multisig_info, 1)
 BOOST_CLASS_VERSION(tools::wallet2::multisig_info::LR, 0)
 BOOST_CLASS_VERSION(tools::wallet2::multisig_tx_set, 1)
@@ -2051,6 +2166,19 @@ namespace boost
         ar & boost::serialization::make_nvp("t", std::get<2>(t));
     }
 
+    template <class Archive>
+    inline typename std::enable_if<!Archive::is_loading::value, void>::type serialize(Archive &a, tools::wallet2::shared_tx_prefix &x, const boost::serialization::version_type ver)
+    {
+      a & const_cast<cryptonote::transaction_prefix&>(x.get());
+    }
+    template <class Archive>
+    inline typename std::enable_if<Archive::is_loading::value, void>::type serialize(Archive &a, tools::wallet2::shared_tx_prefix &x, const boost::serialization::version_type ver)
+    {
+      cryptonote::transaction_prefix prefix;
+      a & prefix;
+      x = std::move(prefix);
+    }
+
     template <class Archive>
     inline typename std::enable_if<!Archive::is_loading::value, void>::type initialize_transfer_details(Archive &a, tools::wallet2::transfer_details &x, const boost::serialization::version_type ver)
     {
@@ -2061,7 +2189,7 @@ namespace boost
         if (ver < 1)
         {
           x.m_mask = rct::identity();
-          x.m_amount = x.m_tx.vout[x.m_internal_output_index].amount;
+          x.m_amount = x.m_tx->vout[x.m_internal_output_index].amount;
         }
         if (ver < 2)
         {
@@ -2069,7 +2197,7 @@ namespace boost
         }
         if (ver < 4)
         {
-          x.m_rct = x.m_tx.vout[x.m_internal_output_index].amount == 0;
+          x.m_rct = x.m_tx->vout[x.m_internal_output_index].amount == 0;
         }
         if (ver < 6)
         {
@@ -72,6 +72,7 @@ namespace tools
     //         tx_parse_error
     //         get_tx_pool_error
     //         out_of_hashchain_bounds_error
+    //         ring_members_needed_error
     //       signature_check_failed
     //       transfer_error *
     //         get_outs_general_error
@@ -432,6 +433,16 @@ namespace tools
       std::string to_string() const { return refresh_error::to_string(); }
     };
     //----------------------------------------------------------------------------------------------------
+    struct ring_members_needed_error : public refresh_error
+    {
+      explicit ring_members_needed_error(std::string&& loc)
+        : refresh_error(std::move(loc), "Block touches our outputs but came without its ring members")
+      {
+      }
+
+      std::string to_string() const { return refresh_error::to_string(); }
+    };
+    //----------------------------------------------------------------------------------------------------
     struct reorg_depth_error : public refresh_error
     {
       explicit reorg_depth_error(std::string&& loc, const std::string& message)
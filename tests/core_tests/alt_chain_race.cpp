@@ -0,0 +1,149 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "chaingen.h"
+#include "alt_chain_race.h"
+
+using namespace std;
+
+using namespace epee;
+using namespace cryptonote;
+
+
+gen_alt_chain_race::gen_alt_chain_race()
+{
+  REGISTER_CALLBACK("check_race_not_switched", gen_alt_chain_race::check_race_not_switched);
+  REGISTER_CALLBACK("check_race_switched", gen_alt_chain_race::check_race_switched);
+  REGISTER_CALLBACK("pop_to_split", gen_alt_chain_race::pop_to_split);
+  REGISTER_CALLBACK("check_popped_to_split", gen_alt_chain_race::check_popped_to_split);
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_alt_chain_race::generate(std::vector<test_event_entry> &events) const
+{
+  uint64_t ts_start = 1338224400;
+  /*
+   (0)-...-(10)-(M)
+              \-(a0)-(a1)-(a2)- ... -(aN)            <-- main after a1
+              \-(b0)- ... -(b5)- ... -(bN)-(bN+1)     <-- main after bN+1
+                             \-(c0)-(c1)-(c2)-(c3)     <-- off a block whose cached state is long gone
+
+   (c2) comes once b is main, so its state is cached with the split right above (b5). Main is
+   then popped back to (b5) and (c3) is offered: that cached state must not be used where
+   walking the alt chain would fail
+  */
+
+  GENERATE_ACCOUNT(first_miner_account);
+  GENERATE_ACCOUNT(miner_a);
+  GENERATE_ACCOUNT(miner_b);
+  GENERATE_ACCOUNT(miner_c);
+
+  MAKE_GENESIS_BLOCK(events, blk_0, first_miner_account, ts_start);
+  REWIND_BLOCKS_N(events, blk_split, blk_0, first_miner_account, 10);
+  MAKE_NEXT_BLOCK(events, blk_m, blk_split, first_miner_account);
+
+  // a and b take turns; a is always one block ahead after its move, b always catches
+  // up to a tie, so every b block goes through the alternative block path
+  std::vector<cryptonote::block> chain_a(1, blk_split), chain_b(1, blk_split);
+  for (size_t i = 0; i < race_length; ++i)
+  {
+    MAKE_NEXT_BLOCK(events, blk_a, chain_a.back(), miner_a);
+    chain_a.push_back(blk_a);
+    MAKE_NEXT_BLOCK(events, blk_b, chain_b.back(), miner_b);
+    chain_b.push_back(blk_b);
+    if (i > 0 && i % 10 == 0)
+      DO_CALLBACK(events, "check_race_not_switched");
+  }
+
+  MAKE_NEXT_BLOCK(events, blk_c0, chain_b[late_fork_offset + 1], miner_c);
+  MAKE_NEXT_BLOCK(events, blk_c1, blk_c0, miner_c);
+
+  MAKE_NEXT_BLOCK(events, blk_a_last, chain_a.back(), miner_a);
+  MAKE_NEXT_BLOCK(events, blk_b_tie, chain_b.back(), miner_b);
+  DO_CALLBACK(events, "check_race_not_switched");
+
+  MAKE_NEXT_BLOCK(events, blk_b_last, blk_b_tie, miner_b);
+  DO_CALLBACK(events, "check_race_switched");
+
+  MAKE_NEXT_BLOCK(events, blk_c2, blk_c1, miner_c);
+  DO_CALLBACK(events, "pop_to_split");
+  MAKE_NEXT_BLOCK(events, blk_c3, blk_c2, miner_c);
+  DO_CALLBACK(events, "check_popped_to_split");
+
+  return true;
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_alt_chain_race::check_race_not_switched(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_alt_chain_race::check_race_not_switched");
+
+  // the a block just before the tying b block is still the tip
+  const cryptonote::block &blk_a = boost::get<cryptonote::block>(events[ev_index - 2]);
+  CHECK_TEST_CONDITION(c.get_tail_id() == get_block_hash(blk_a));
+  CHECK_TEST_CONDITION(c.get_current_blockchain_height() == get_block_height(blk_a) + 1);
+  return true;
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_alt_chain_race::check_race_switched(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_alt_chain_race::check_race_switched");
+
+  const cryptonote::block &blk_b = boost::get<cryptonote::block>(events[ev_index - 1]);
+  CHECK_TEST_CONDITION(c.get_tail_id() == get_block_hash(blk_b));
+  CHECK_TEST_CONDITION(c.get_current_blockchain_height() == 11 + race_length + 2);
+  // M, the whole of a, and the late fork
+  CHECK_TEST_CONDITION(c.get_alternative_blocks_count() == 1 + race_length + 1 + 2);
+  return true;
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_alt_chain_race::pop_to_split(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_alt_chain_race::pop_to_split");
+
+  // the next event is (c3), three blocks above the split
+  const cryptonote::block &blk_c3 = boost::get<cryptonote::block>(events[ev_index + 1]);
+  const uint64_t split_height = get_block_height(blk_c3) - 3;
+  CHECK_TEST_CONDITION(c.get_current_blockchain_height() > split_height);
+  c.get_blockchain_storage().pop_blocks(c.get_current_blockchain_height() - split_height);
+  CHECK_TEST_CONDITION(c.get_current_blockchain_height() == split_height);
+  return true;
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_alt_chain_race::check_popped_to_split(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_alt_chain_race::check_popped_to_split");
+
+  // (c3) was turned down just as it would have been without the cached state
+  const cryptonote::block &blk_c3 = boost::get<cryptonote::block>(events[ev_index - 1]);
+  CHECK_TEST_CONDITION(c.get_current_blockchain_height() == get_block_height(blk_c3) - 3);
+  CHECK_TEST_CONDITION(c.get_alternative_blocks_count() == 1 + race_length + 1 + 3);
+  int where = HAVE_BLOCK_INVALID;
+  c.get_blockchain_storage().have_block(get_block_hash(blk_c3), &where);
+  CHECK_TEST_CONDITION(where != HAVE_BLOCK_MAIN_CHAIN && where != HAVE_BLOCK_ALT_CHAIN);
+  return true;
+}
@@ -35,6 +35,8 @@
 #include "block_validation.h"
 #include "chain_split_1.h"
 #include "chain_switch_1.h"
+#include "alt_chain_race.h"
+#include "tip_snapshot.h"
 #include "double_spend.h"
 #include "integer_overflow.h"
 #include "ring_signature_1.h"
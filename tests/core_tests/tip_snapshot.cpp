@@ -0,0 +1,203 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <thread>
+#include "chaingen.h"
+#include "tip_snapshot.h"
+
+using namespace std;
+
+using namespace epee;
+using namespace cryptonote;
+
+
+gen_tip_snapshot::gen_tip_snapshot()
+{
+  REGISTER_CALLBACK("check_snapshot", gen_tip_snapshot::check_snapshot);
+  REGISTER_CALLBACK("pop_and_check", gen_tip_snapshot::pop_and_check);
+  REGISTER_CALLBACK("check_concurrent_readers", gen_tip_snapshot::check_concurrent_readers);
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_tip_snapshot::generate(std::vector<test_event_entry> &events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(first_miner_account);
+
+  MAKE_GENESIS_BLOCK(events, blk_0, first_miner_account, ts_start);
+  DO_CALLBACK(events, "check_snapshot");
+  REWIND_BLOCKS_N(events, blk_1, blk_0, first_miner_account, 10);
+  DO_CALLBACK(events, "check_snapshot");
+
+  std::vector<cryptonote::block> chain(1, blk_1);
+  for (size_t i = 0; i < 4; ++i)
+  {
+    MAKE_NEXT_BLOCK(events, blk, chain.back(), first_miner_account);
+    chain.push_back(blk);
+    DO_CALLBACK(events, "check_snapshot");
+  }
+
+  // the next block goes on top of what is left after the pop
+  DO_CALLBACK(events, "pop_and_check");
+  MAKE_NEXT_BLOCK(events, blk_after_pop, chain[chain.size() - 1 - popped_blocks], first_miner_account);
+  DO_CALLBACK(events, "check_snapshot");
+
+  REWIND_BLOCKS_N(events, blk_2, blk_after_pop, first_miner_account, reader_depth);
+  DO_CALLBACK(events, "check_concurrent_readers");
+  DO_CALLBACK(events, "check_snapshot");
+
+  return true;
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_tip_snapshot::check_snapshot(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tip_snapshot::check_snapshot");
+
+  Blockchain &bc = c.get_blockchain_storage();
+  CRITICAL_REGION_LOCAL(bc);
+
+  const std::shared_ptr<const Blockchain::tip_snapshot> snapshot = bc.get_tip_snapshot();
+  CHECK_TEST_CONDITION(snapshot);
+
+  const uint64_t height = bc.get_current_blockchain_height();
+  CHECK_EQ(snapshot->height, height);
+  CHECK_TEST_CONDITION(snapshot->top_hash == bc.get_tail_id());
+  CHECK_TEST_CONDITION(get_block_hash(snapshot->top_block) == bc.get_tail_id());
+  CHECK_TEST_CONDITION(snapshot->top_difficulty == bc.block_difficulty(height - 1));
+  CHECK_TEST_CONDITION(snapshot->top_cumulative_difficulty == bc.get_db().get_block_cumulative_difficulty(height - 1));
+  CHECK_EQ(snapshot->top_weight, bc.get_db().get_block_weight(height - 1));
+  CHECK_EQ(snapshot->top_long_term_weight, bc.get_db().get_block_long_term_weight(height - 1));
+  CHECK_TEST_CONDITION(snapshot->next_difficulty == bc.get_difficulty_for_next_block());
+  CHECK_EQ(snapshot->total_transactions, bc.get_db().get_tx_count());
+  CHECK_EQ(snapshot->alt_blocks_count, bc.get_alternative_blocks_count());
+  CHECK_EQ(snapshot->block_weight_limit, bc.get_current_cumulative_block_weight_limit());
+  CHECK_EQ(snapshot->block_weight_median, bc.get_current_cumulative_block_weight_median());
+
+  std::vector<uint64_t> fees;
+  bc.get_dynamic_base_fee_estimate_2021_scaling(snapshot->fee_grace_blocks, fees);
+  CHECK_TEST_CONDITION(snapshot->fees == fees);
+  return true;
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_tip_snapshot::pop_and_check(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tip_snapshot::pop_and_check");
+
+  const uint64_t height = c.get_current_blockchain_height();
+  c.get_blockchain_storage().pop_blocks(popped_blocks);
+  CHECK_EQ(c.get_current_blockchain_height(), height - popped_blocks);
+  return check_snapshot(c, ev_index, events);
+}
+//-----------------------------------------------------------------------------------------------------
+bool gen_tip_snapshot::check_concurrent_readers(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry> &events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tip_snapshot::check_concurrent_readers");
+
+  // every height the tip will go through, with what a snapshot at that height must hold
+  Blockchain &bc = c.get_blockchain_storage();
+  const uint64_t top_height = c.get_current_blockchain_height();
+  CHECK_TEST_CONDITION(top_height > reader_depth);
+  std::vector<crypto::hash> hashes;
+  std::vector<difficulty_type> cumulative_difficulties;
+  std::vector<uint64_t> weights;
+  std::vector<cryptonote::block> blocks;
+  for (uint64_t h = 0; h < top_height; ++h)
+  {
+    hashes.push_back(bc.get_db().get_block_hash_from_height(h));
+    cumulative_difficulties.push_back(bc.get_db().get_block_cumulative_difficulty(h));
+    weights.push_back(bc.get_db().get_block_weight(h));
+    if (h >= top_height - reader_depth)
+      blocks.push_back(bc.get_db().get_block_from_height(h));
+  }
+
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> reads(0), torn(0);
+  auto reader = [&]()
+  {
+    while (!stop)
+    {
+      const std::shared_ptr<const Blockchain::tip_snapshot> snapshot = bc.get_tip_snapshot();
+      ++reads;
+      if (!snapshot || snapshot->height == 0 || snapshot->height > top_height || snapshot->height <= top_height - reader_depth - 1)
+      {
+        ++torn;
+        continue;
+      }
+      const uint64_t h = snapshot->height - 1;
+      if (snapshot->top_hash != hashes[h] || get_block_hash(snapshot->top_block) != hashes[h] ||
+          get_block_height(snapshot->top_block) != h ||
+          snapshot->top_cumulative_difficulty != cumulative_difficulties[h] ||
+          snapshot->top_weight != weights[h] ||
+          snapshot->fees.empty())
+        ++torn;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < reader_threads; ++i)
+    threads.emplace_back(reader);
+
+  // walk the tip down and back up again, publishing a snapshot at every step
+  bool added = true;
+  for (size_t round = 0; round < reader_rounds && added; ++round)
+  {
+    for (size_t i = 0; i < reader_depth; ++i)
+      bc.pop_blocks(1);
+    for (const cryptonote::block &b: blocks)
+    {
+      cryptonote::block_verification_context bvc = AUTO_VAL_INIT(bvc);
+      const cryptonote::blobdata bd = t_serializable_object_to_blob(b);
+      std::vector<cryptonote::block> pblocks;
+      cryptonote::block_complete_entry bce;
+      bce.pruned = false;
+      bce.block = bd;
+      if (!c.prepare_handle_incoming_blocks(std::vector<cryptonote::block_complete_entry>(1, bce), pblocks))
+      {
+        added = false;
+        break;
+      }
+      c.handle_incoming_block(bd, &b, bvc);
+      c.cleanup_handle_incoming_blocks();
+      if (bvc.m_verifivation_failed || !bvc.m_added_to_main_chain)
+      {
+        added = false;
+        break;
+      }
+    }
+  }
+
+  stop = true;
+  for (std::thread &t: threads)
+    t.join();
+
+  CHECK_TEST_CONDITION(added);
+  CHECK_EQ(c.get_current_blockchain_height(), top_height);
+  CHECK_TEST_CONDITION(reads > 0);
+  CHECK_EQ(torn.load(), 0u);
+  return true;
+}
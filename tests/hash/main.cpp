@@ -38,6 +38,9 @@
 #include "misc_log_ex.h"
 #include "warnings.h"
 #include "crypto/hash.h"
+extern "C" {
+#include "crypto/keccak.h"
+}
 #include "crypto/variant2_int_sqrt.h"
 #include "../io.h"
 
@@ -88,6 +91,7 @@ struct hash_func {
 
 int test_variant2_int_sqrt();
 int test_variant2_int_sqrt_ref();
+int test_fast_batch(const char *path);
 
 int main(int argc, char *argv[]) {
   TRY_ENTRY();
@@ -133,6 +137,9 @@ int main(int argc, char *argv[]) {
     cerr << "Wrong number of arguments" << endl;
     return 1;
   }
+  if (strcmp(argv[1], "fast-batch") == 0) {
+    return test_fast_batch(argv[2]);
+  }
   for (hf = hashes;; hf++) {
     if (hf >= &hashes[sizeof(hashes) / sizeof(hash_func)]) {
       cerr << "Unknown function" << endl;
@@ -189,6 +196,53 @@ int main(int argc, char *argv[]) {
   CATCH_ENTRY_L0("main", 1);
 }
 
+// Hashes every cn_fast_hash vector through keccak_batch, with each lane width and with
+// the groups shifted by every offset, so messages of different block counts share groups
+int test_fast_batch(const char *path) {
+  fstream input;
+  vector<chash> expected;
+  vector<vector<char>> data;
+  input.open(path, ios_base::in);
+  for (;;) {
+    chash h;
+    input.exceptions(ios_base::badbit);
+    get(input, h);
+    if (input.rdstate() & ios_base::eofbit) {
+      break;
+    }
+    input.exceptions(ios_base::badbit | ios_base::failbit | ios_base::eofbit);
+    input.clear(input.rdstate());
+    expected.push_back(h);
+    data.emplace_back();
+    get(input, data.back());
+  }
+
+  const size_t count = data.size();
+  vector<const uint8_t*> in(count);
+  vector<size_t> inlen(count);
+  for (size_t i = 0; i < count; ++i) {
+    in[i] = reinterpret_cast<const uint8_t*>(data[i].data());
+    inlen[i] = data[i].size();
+  }
+
+  for (size_t lanes: {1, 4, 8}) {
+    for (size_t offset = 0; offset < lanes && offset < count; ++offset) {
+      vector<chash> actual(count);
+      uint8_t (*md)[32] = reinterpret_cast<uint8_t (*)[32]>(actual.data());
+      keccak_batch(in.data(), inlen.data(), offset, md, lanes);
+      keccak_batch(in.data() + offset, inlen.data() + offset, count - offset, md + offset, lanes);
+      for (size_t i = 0; i < count; ++i) {
+        if (expected[i] != actual[i]) {
+          cerr << "Hash mismatch on test " << i + 1 << " with " << lanes << " lanes, offset " << offset << endl;
+          return 1;
+        }
+      }
+    }
+  }
+  cout << "keccak_batch runs " << keccak_batch_lanes() << " lanes on this CPU" << endl;
+  return 0;
+}
+
 #if defined(__x86_64__) || (defined(_MSC_VER) && defined(_WIN64))
 
 #include <emmintrin.h>
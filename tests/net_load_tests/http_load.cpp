@@ -0,0 +1,182 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+
+// Drives many concurrent keep-alive HTTP clients against an epee HTTP server
+// with a trivial handler, for several thread counts, both with a shared event
+// loop and with one event loop per thread. Prints requests/s and latencies.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "include_base_utils.h"
+#include "misc_log_ex.h"
+#include "common/util.h"
+#include "crypto/crypto.h"
+#include "net/http_server_impl_base.h"
+
+namespace
+{
+  class ping_server: public epee::http_server_impl_base<ping_server>
+  {
+  public:
+    void set_reactor_per_thread(bool enable) { m_net_server.set_reactor_per_thread(enable); }
+
+    bool handle_http_request(const epee::net_utils::http::http_request_info& query_info,
+      epee::net_utils::http::http_response_info& response,
+      epee::net_utils::connection_context_base& context) override
+    {
+      response.m_response_code = 200;
+      response.m_response_comment = "OK";
+      response.m_mime_tipe = "text/plain";
+      response.m_body = "pong";
+      return true;
+    }
+  };
+
+  struct result
+  {
+    uint64_t requests;
+    std::vector<uint32_t> latencies_us;
+  };
+
+  // one keep-alive connection, sending requests back to back until the deadline
+  bool run_client(int port, std::chrono::steady_clock::time_point deadline, result& res)
+  {
+    try
+    {
+      boost::asio::io_service io;
+      boost::asio::ip::tcp::socket socket(io);
+      socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+      socket.set_option(boost::asio::ip::tcp::no_delay(true));
+
+      static const std::string request = "GET /ping HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: keep-alive\r\n\r\n";
+      boost::asio::streambuf buffer;
+      while (std::chrono::steady_clock::now() < deadline)
+      {
+        const auto start = std::chrono::steady_clock::now();
+        boost::asio::write(socket, boost::asio::buffer(request));
+
+        const size_t header_size = boost::asio::read_until(socket, buffer, "\r\n\r\n");
+        std::string header(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_begin(buffer.data()) + header_size);
+        buffer.consume(header_size);
+
+        size_t body_size = 0;
+        const std::string::size_type cl = header.find("Content-Length:");
+        if (cl != std::string::npos)
+          body_size = std::strtoul(header.c_str() + cl + 15, NULL, 10);
+        if (buffer.size() < body_size)
+          boost::asio::read(socket, buffer, boost::asio::transfer_exactly(body_size - buffer.size()));
+        buffer.consume(body_size);
+
+        res.latencies_us.push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        ++res.requests;
+      }
+      return true;
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "client error: " << e.what() << std::endl;
+      return false;
+    }
+  }
+
+  bool run_one(size_t threads, bool reactor_per_thread, size_t clients, unsigned seconds)
+  {
+    ping_server server;
+    server.set_reactor_per_thread(reactor_per_thread);
+    auto rng = [](size_t len, uint8_t *ptr){ return crypto::rand(len, ptr); };
+    if (!server.init(rng, "0", "127.0.0.1", "::", false, true, {}, boost::none, epee::net_utils::ssl_support_t::e_ssl_support_disabled))
+      return false;
+    if (!server.run(threads, false))
+      return false;
+    const int port = server.get_binded_port();
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::seconds(seconds);
+    std::vector<result> results(clients);
+    std::atomic<size_t> failures(0);
+    std::vector<boost::thread> client_threads;
+    for (size_t i = 0; i < clients; ++i)
+      client_threads.emplace_back([&, i]{ if (!run_client(port, deadline, results[i])) ++failures; });
+    for (auto &t: client_threads)
+      t.join();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    server.send_stop_signal();
+    server.timed_wait_server_stop(5000);
+    server.deinit();
+
+    uint64_t requests = 0;
+    std::vector<uint32_t> latencies;
+    for (const auto &r: results)
+    {
+      requests += r.requests;
+      latencies.insert(latencies.end(), r.latencies_us.begin(), r.latencies_us.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&](double p) -> uint32_t { return latencies.empty() ? 0 : latencies[std::min<size_t>(latencies.size() - 1, latencies.size() * p)]; };
+
+    std::cout << (reactor_per_thread ? "per-thread" : "shared    ") << "  threads " << threads << "  clients " << clients
+      << "  " << (uint64_t)(requests / elapsed) << " req/s"
+      << "  p50 " << percentile(0.50) << " us  p99 " << percentile(0.99) << " us  p99.9 " << percentile(0.999) << " us";
+    if (failures)
+      std::cout << "  (" << failures << " client failures)";
+    std::cout << std::endl;
+    return failures == 0;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  TRY_ENTRY();
+  tools::on_startup();
+  mlog_configure(mlog_get_default_log_path("net_load_tests_http.log"), false);
+  mlog_set_log_level(0);
+
+  const size_t clients = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 64;
+  const unsigned seconds = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 5;
+  const size_t max_threads = std::max<size_t>(boost::thread::hardware_concurrency(), 1);
+
+  bool ok = true;
+  for (size_t threads = 1; threads <= max_threads; threads *= 2)
+  {
+    ok &= run_one(threads, false, clients, seconds);
+    ok &= run_one(threads, true, clients, seconds);
+  }
+  return ok ? 0 : 1;
+  CATCH_ENTRY_L0("main", 1);
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2018-2022, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <vector>
+#include "crypto/crypto.h"
+#include "cryptonote_config.h"
+#include "rolling_median.h"
+#include "window_median.h"
+
+// One reorg of the long term block weights window per run, alternating between
+// two branches of the given depth. With incremental set, the window is rewound
+// past the old branch and extended with the new one, as the blockchain does on
+// pop; otherwise it is rebuilt from scratch, as it was before.
+template<size_t depth, bool incremental>
+class test_block_weights_reorg
+{
+public:
+  static const size_t loop_count = incremental ? 10000 : 50;
+  static const size_t window = CRYPTONOTE_LONG_TERM_BLOCK_WEIGHT_WINDOW_SIZE;
+
+  test_block_weights_reorg(): m_window(window), m_rolling_median(window), m_on_first(true) {}
+
+  bool init()
+  {
+    for (size_t i = 0; i < window; ++i)
+      m_base.push_back(crypto::rand<uint64_t>() % 600000);
+    for (size_t i = 0; i < depth; ++i)
+    {
+      m_branches[0].push_back(crypto::rand<uint64_t>() % 600000);
+      m_branches[1].push_back(crypto::rand<uint64_t>() % 600000);
+    }
+    for (uint64_t w: m_base)
+      m_window.push_back(w);
+    for (uint64_t w: m_branches[0])
+      m_window.push_back(w);
+    return true;
+  }
+
+  bool test()
+  {
+    const std::vector<uint64_t> &to = m_branches[m_on_first ? 1 : 0];
+    m_on_first = !m_on_first;
+    if (incremental)
+    {
+      for (size_t i = 0; i < depth; ++i)
+      {
+        m_window.pop_back();
+        m_window.push_front(m_base[depth - 1 - i]);
+      }
+      for (uint64_t w: to)
+        m_window.push_back(w);
+      return m_window.median() > 0;
+    }
+    m_rolling_median.clear();
+    for (size_t i = depth; i < window; ++i)
+      m_rolling_median.insert(m_base[i]);
+    for (uint64_t w: to)
+      m_rolling_median.insert(w);
+    return m_rolling_median.median() > 0;
+  }
+
+private:
+  std::vector<uint64_t> m_base;
+  std::vector<uint64_t> m_branches[2];
+  epee::misc_utils::window_median_t<uint64_t> m_window;
+  epee::misc_utils::rolling_median_t<uint64_t> m_rolling_median;
+  bool m_on_first;
+};
@@ -61,6 +61,31 @@ private:
   rct::BulletproofPlus proof;
 };
 
+template<size_t n_amounts>
+class test_bulletproof_plus_prover
+{
+public:
+  static const size_t loop_count = 80 / n_amounts + 5;
+
+  bool init()
+  {
+    amounts = std::vector<uint64_t>(n_amounts, 749327532984);
+    gamma = rct::skvGen(n_amounts);
+    return true;
+  }
+
+  bool test()
+  {
+    const rct::BulletproofPlus proof = prover.prove(amounts, gamma);
+    return proof.L.size() > 0;
+  }
+
+private:
+  rct::bulletproof_plus_prover prover;
+  std::vector<uint64_t> amounts;
+  rct::keyV gamma;
+};
+
 template<bool batch, size_t start, size_t repeat, size_t mul, size_t add, size_t N>
 class test_aggregated_bulletproof_plus
 {
@@ -55,3 +55,58 @@ public:
 private:
   std::array<uint8_t, bytes> m_data;
 };
+
+template<size_t bytes, size_t count>
+class test_cn_fast_hash_batch
+{
+public:
+  static const size_t loop_count = bytes < 256 ? 10000 : 1000;
+
+  bool init()
+  {
+    m_data.resize(bytes * count);
+    crypto::rand(m_data.size(), m_data.data());
+    for (size_t i = 0; i < count; ++i)
+    {
+      m_ptrs[i] = m_data.data() + i * bytes;
+      m_lengths[i] = bytes;
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    crypto::cn_fast_hash_batch(m_ptrs.data(), m_lengths.data(), count, m_hashes.data());
+    return true;
+  }
+
+private:
+  std::vector<uint8_t> m_data;
+  std::array<const void*, count> m_ptrs;
+  std::array<size_t, count> m_lengths;
+  std::array<crypto::hash, count> m_hashes;
+};
+
+template<size_t count>
+class test_tree_hash
+{
+public:
+  static const size_t loop_count = count < 256 ? 10000 : 1000;
+
+  bool init()
+  {
+    m_hashes.resize(count);
+    crypto::rand(count * sizeof(crypto::hash), (uint8_t*)m_hashes.data());
+    return true;
+  }
+
+  bool test()
+  {
+    crypto::hash root;
+    crypto::tree_hash(m_hashes.data(), count, root);
+    return true;
+  }
+
+private:
+  std::vector<crypto::hash> m_hashes;
+};
@@ -0,0 +1,67 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "crypto/crypto.h"
+#include "ringct/rctOps.h"
+
+// derives N tx pubkeys with one view key, either one at a time or in a single batch;
+// compare the per call time divided by N to get derivations/s
+template<size_t N, bool batched>
+class test_generate_key_derivations
+{
+public:
+  static const size_t loop_count = 10000 / N;
+
+  bool init()
+  {
+    m_view_sec = rct::rct2sk(rct::skGen());
+    m_pubs.resize(N);
+    for (size_t i = 0; i < N; ++i)
+      m_pubs[i] = rct::rct2pk(rct::pkGen());
+    return true;
+  }
+
+  bool test()
+  {
+    if (batched)
+      return crypto::generate_key_derivations(m_pubs, m_view_sec, m_derivations, m_valid);
+    m_derivations.resize(N);
+    for (size_t i = 0; i < N; ++i)
+      if (!crypto::generate_key_derivation(m_pubs[i], m_view_sec, m_derivations[i]))
+        return false;
+    return true;
+  }
+
+private:
+  crypto::secret_key m_view_sec;
+  std::vector<crypto::public_key> m_pubs;
+  std::vector<crypto::key_derivation> m_derivations;
+  std::vector<bool> m_valid;
+};
@@ -46,6 +46,7 @@
 #include "ge_frombytes_vartime.h"
 #include "ge_tobytes.h"
 #include "generate_key_derivation.h"
+#include "generate_key_derivations.h"
 #include "generate_key_image.h"
 #include "generate_key_image_helper.h"
 #include "generate_keypair.h"
@@ -65,6 +66,9 @@
 #include "multiexp.h"
 #include "sig_mlsag.h"
 #include "sig_clsag.h"
+#include "zk_proof.h"
+#include "zmq_pub.h"
+#include "block_weights_reorg.h"
 
 namespace po = boost::program_options;
 
@@ -201,6 +205,25 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE2(filter, p, test_out_can_be_to_acc, true, true); // use view tag, owned
   TEST_PERFORMANCE0(filter, p, test_generate_key_image_helper);
   TEST_PERFORMANCE0(filter, p, test_generate_key_derivation);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 16, false);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 16, true);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 64, false);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 64, true);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 256, false);
+  TEST_PERFORMANCE2(filter, p, test_generate_key_derivations, 256, true);
+
+  TEST_PERFORMANCE2(filter, p, test_zmq_pub_txpool, 1, false);
+  TEST_PERFORMANCE2(filter, p, test_zmq_pub_txpool, 1, true);
+  TEST_PERFORMANCE2(filter, p, test_zmq_pub_txpool, 100, false);
+  TEST_PERFORMANCE2(filter, p, test_zmq_pub_txpool, 100, true);
+
+  TEST_PERFORMANCE2(filter, p, test_block_weights_reorg, 1, false);
+  TEST_PERFORMANCE2(filter, p, test_block_weights_reorg, 1, true);
+  TEST_PERFORMANCE2(filter, p, test_block_weights_reorg, 10, false);
+  TEST_PERFORMANCE2(filter, p, test_block_weights_reorg, 10, true);
+  TEST_PERFORMANCE2(filter, p, test_block_weights_reorg, 100, false);
+  TEST_PERFORMANCE2(filter, p, test_block_weights_reorg, 100, true);
+
   TEST_PERFORMANCE0(filter, p, test_generate_key_image);
   TEST_PERFORMANCE0(filter, p, test_derive_public_key);
   TEST_PERFORMANCE0(filter, p, test_derive_secret_key);
@@ -221,6 +244,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_cn_slow_hash, 4);
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 32);
   TEST_PERFORMANCE1(filter, p, test_cn_fast_hash, 16384);
+  TEST_PERFORMANCE2(filter, p, test_cn_fast_hash_batch, 64, 64); // tree hash level
+  TEST_PERFORMANCE2(filter, p, test_cn_fast_hash_batch, 96, 64); // tx hash from component hashes
+  TEST_PERFORMANCE2(filter, p, test_cn_fast_hash_batch, 1024, 64);
+  TEST_PERFORMANCE1(filter, p, test_tree_hash, 16);
+  TEST_PERFORMANCE1(filter, p, test_tree_hash, 1024);
 
   TEST_PERFORMANCE3(filter, p, test_sig_mlsag, 4, 2, 2); // MLSAG verification
   TEST_PERFORMANCE3(filter, p, test_sig_mlsag, 8, 2, 2);
@@ -236,6 +264,10 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 64, 2, 2);
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 128, 2, 2);
   TEST_PERFORMANCE3(filter, p, test_sig_clsag, 256, 2, 2);
+  TEST_PERFORMANCE5(filter, p, test_sig_clsag_batch, 16, 50, 2, 5000, false); // block of 50 2-input txs, sparse ring overlap
+  TEST_PERFORMANCE5(filter, p, test_sig_clsag_batch, 16, 50, 2, 5000, true);
+  TEST_PERFORMANCE5(filter, p, test_sig_clsag_batch, 16, 50, 2, 400, false); // dense ring overlap
+  TEST_PERFORMANCE5(filter, p, test_sig_clsag_batch, 16, 50, 2, 400, true);
 
   TEST_PERFORMANCE2(filter, p, test_ringct_mlsag, 11, false);
   TEST_PERFORMANCE2(filter, p, test_ringct_mlsag, 11, true);
@@ -257,6 +289,12 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE2(filter, p, test_bulletproof_plus, true, 15); // 1 bulletproof_plus with 15 amounts
   TEST_PERFORMANCE2(filter, p, test_bulletproof_plus, false, 15);
 
+  TEST_PERFORMANCE1(filter, p, test_bulletproof_plus_prover, 1);
+  TEST_PERFORMANCE1(filter, p, test_bulletproof_plus_prover, 2);
+  TEST_PERFORMANCE1(filter, p, test_bulletproof_plus_prover, 4);
+  TEST_PERFORMANCE1(filter, p, test_bulletproof_plus_prover, 8);
+  TEST_PERFORMANCE1(filter, p, test_bulletproof_plus_prover, 16);
+
   TEST_PERFORMANCE6(filter, p, test_aggregated_bulletproof_plus, false, 2, 1, 1, 0, 4);
   TEST_PERFORMANCE6(filter, p, test_aggregated_bulletproof_plus, true, 2, 1, 1, 0, 4); // 4 proofs, each with 2 amounts
   TEST_PERFORMANCE6(filter, p, test_aggregated_bulletproof_plus, false, 8, 1, 1, 0, 4);
@@ -306,6 +344,7 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_triple_scalarmult_precomp_vartime);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_ge_double_scalarmult_precomp_vartime2);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_addKeys2);
+  TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_addKeys_aGbH);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_addKeys3);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_addKeys3_2);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_addKeys_aGbBcC);
@@ -314,6 +353,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_zeroCommitUncached);
   TEST_PERFORMANCE1(filter, p, test_crypto_ops, op_zeroCommitCached);
 
+  TEST_PERFORMANCE1(filter, p, test_zk_proof, zk_pr_proof_gen);
+  TEST_PERFORMANCE1(filter, p, test_zk_proof, zk_pr_proof_ver);
+  TEST_PERFORMANCE1(filter, p, test_zk_proof, zk_sa_proof_gen);
+  TEST_PERFORMANCE1(filter, p, test_zk_proof, zk_sa_proof_ver);
+
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 2);
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 4);
   TEST_PERFORMANCE2(filter, p, test_multiexp, multiexp_bos_coster, 8);
@@ -378,6 +422,26 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 1024, 7);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2048, 8);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 4096, 9);
+
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus, 64, 1);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus, 64, 2);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus, 64, 4);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus, 64, 8);
+
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus_cached, 232, 1);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus_cached, 232, 2);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus_cached, 232, 4);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_straus_cached, 232, 8);
+
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger, 1024, 1);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger, 1024, 2);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger, 1024, 4);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger, 1024, 8);
+
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger_cached, 1024, 1);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger_cached, 1024, 2);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger_cached, 1024, 4);
+  TEST_PERFORMANCE3(filter, p, test_multiexp_threads, multiexp_pippenger_cached, 1024, 8);
 #else
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2, 1);
   TEST_PERFORMANCE3(filter, p, test_multiexp, multiexp_pippenger_cached, 2, 2);
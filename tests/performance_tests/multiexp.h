@@ -31,7 +31,9 @@
 
 #pragma once
 
+#include <deque>
 #include <vector>
+#include "common/threadpool.h"
 #include "ringct/rctOps.h"
 #include "ringct/multiexp.h"
 
@@ -93,3 +95,77 @@ private:
   std::shared_ptr<rct::pippenger_cached_data> pippenger_cache;
   rct::key res;
 };
+
+// Runs the same multiexp on nthreads threads at once; with no shared state between
+// the calls, the time per run should stay flat as nthreads grows
+template<test_multiexp_algorithm algorithm, size_t npoints, size_t nthreads>
+class test_multiexp_threads
+{
+public:
+  static const size_t loop_count = npoints >= 1024 ? 10 : npoints < 256 ? 100 : 50;
+  static const size_t runs_per_thread = 8;
+
+  bool init()
+  {
+    tpool.reset(tools::threadpool::getNewForUnitTests(nthreads));
+    data.resize(npoints);
+    res = rct::identity();
+    for (size_t n = 0; n < npoints; ++n)
+    {
+      data[n].scalar = rct::skGen();
+      rct::key point = rct::scalarmultBase(rct::skGen());
+      if (ge_frombytes_vartime(&data[n].point, point.bytes))
+        return false;
+      rct::key kn = rct::scalarmultKey(point, data[n].scalar);
+      res = rct::addKeys(res, kn);
+    }
+    straus_cache = rct::straus_init_cache(data);
+    pippenger_cache = rct::pippenger_init_cache(data);
+    return true;
+  }
+
+  bool test()
+  {
+    std::deque<bool> results(nthreads, false);
+    tools::threadpool::waiter waiter(*tpool);
+    for (size_t t = 0; t < nthreads; ++t)
+    {
+      tpool->submit(&waiter, [this, &results, t]() {
+        bool ok = true;
+        for (size_t n = 0; n < runs_per_thread; ++n)
+          ok &= run();
+        results[t] = ok;
+      });
+    }
+    if (!waiter.wait())
+      return false;
+    for (bool r: results)
+      if (!r)
+        return false;
+    return true;
+  }
+
+private:
+  bool run() const
+  {
+    switch (algorithm)
+    {
+      case multiexp_straus:
+        return res == straus(data);
+      case multiexp_straus_cached:
+        return res == straus(data, straus_cache);
+      case multiexp_pippenger:
+        return res == pippenger(data);
+      case multiexp_pippenger_cached:
+        return res == pippenger(data, pippenger_cache);
+      default:
+        return false;
+    }
+  }
+
+  std::unique_ptr<tools::threadpool> tpool;
+  std::vector<rct::MultiexpData> data;
+  std::shared_ptr<rct::straus_cached_data> straus_cache;
+  std::shared_ptr<rct::pippenger_cached_data> pippenger_cache;
+  rct::key res;
+};
@@ -30,6 +30,9 @@
 
 #pragma once
 
+#include <deque>
+
+#include "common/threadpool.h"
 #include "ringct/rctSigs.h"
 #include "ringct/rctTypes.h"
 #include "device/device.hpp"
@@ -170,3 +173,86 @@ class test_sig_clsag
         keyV messages;
         std::vector<clsag> sigs;
 };
+
+// Verification of the CLSAGs of a_txs transactions with a_w inputs each, as a block does.
+// Rings of size a_N are drawn from a pool of a_pool decoys, so that they overlap like rings
+// picking recent outputs do. With a_batched, all signatures go through one clsag_batch,
+// otherwise each transaction verifies its own signatures in turn.
+template<size_t a_N, size_t a_txs, size_t a_w, size_t a_pool, bool a_batched>
+class test_sig_clsag_batch
+{
+    public:
+        static const size_t loop_count = 10;
+        static const size_t N = a_N;
+
+        bool init()
+        {
+            ctkeyV decoys(a_pool);
+            key temp;
+            for (ctkey &d: decoys)
+            {
+                skpkGen(temp,d.dest);
+                skpkGen(temp,d.mask);
+            }
+
+            const size_t n_sigs = a_txs * a_w;
+            messages.resize(n_sigs);
+            rings.resize(n_sigs);
+            C_offsets.resize(n_sigs);
+            sigs.resize(n_sigs);
+            for (size_t n = 0; n < n_sigs; n++)
+            {
+                const size_t l = n % N;
+                rings[n].resize(N);
+                for (size_t i = 0; i < N; i++)
+                    rings[n][i] = decoys[crypto::rand_idx(decoys.size())];
+
+                ctkey sk;
+                skpkGen(sk.dest,rings[n][l].dest);
+                sk.mask = skGen();
+                const key a = skGen();
+                addKeys2(rings[n][l].mask,sk.mask,a,H);
+                const key s1 = skGen();
+                addKeys2(C_offsets[n],s1,a,H);
+
+                messages[n] = skGen();
+                sigs[n] = proveRctCLSAGSimple(messages[n],rings[n],sk,s1,C_offsets[n],l,hw::get_device("default"));
+            }
+            return true;
+        }
+
+        bool test()
+        {
+            if (a_batched)
+            {
+                clsag_batch batch;
+                for (size_t n = 0; n < sigs.size(); n++)
+                    batch.add(messages[n],sigs[n],rings[n],C_offsets[n],n / a_w);
+                return batch.verify();
+            }
+
+            tools::threadpool& tpool = tools::threadpool::getInstanceForCompute();
+            for (size_t tx = 0; tx < a_txs; tx++)
+            {
+                std::deque<bool> results(a_w);
+                tools::threadpool::waiter waiter(tpool);
+                for (size_t u = 0; u < a_w; u++)
+                {
+                    const size_t n = tx * a_w + u;
+                    tpool.submit(&waiter, [&, n, u] { results[u] = verRctCLSAGSimple(messages[n],sigs[n],rings[n],C_offsets[n]); });
+                }
+                if (!waiter.wait())
+                    return false;
+                for (bool r: results)
+                    if (!r)
+                        return false;
+            }
+            return true;
+        }
+
+    private:
+        keyV messages;
+        std::vector<ctkeyV> rings;
+        keyV C_offsets;
+        std::vector<clsag> sigs;
+};
@@ -0,0 +1,79 @@
+// Copyright (c) 2014-2022, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "ringct/rctOps.h"
+#include "ringct/rctSigs.h"
+
+enum test_zk_proof_op
+{
+  zk_pr_proof_gen,
+  zk_pr_proof_ver,
+  zk_sa_proof_gen,
+  zk_sa_proof_ver,
+};
+
+template<test_zk_proof_op op>
+class test_zk_proof
+{
+public:
+  static const size_t loop_count = 10000;
+
+  bool init()
+  {
+    difference = rct::skGen();
+    p_r = rct::commit(0, difference);
+    pr_proof = rct::PRProof_Gen(difference);
+
+    x_change = rct::skGen();
+    P = rct::scalarmultBase(x_change);
+    key_yF = rct::pkGen();
+    sa_proof = rct::SAProof_Gen(P, x_change, key_yF);
+    return true;
+  }
+
+  bool test()
+  {
+    switch (op)
+    {
+      case zk_pr_proof_gen: rct::PRProof_Gen(difference); return true;
+      case zk_pr_proof_ver: return rct::PRProof_Ver(p_r, pr_proof);
+      case zk_sa_proof_gen: rct::SAProof_Gen(P, x_change, key_yF); return true;
+      case zk_sa_proof_ver: return rct::SAProof_Ver(sa_proof, P, key_yF);
+      default: return false;
+    }
+  }
+
+private:
+  rct::key difference, p_r;
+  rct::zk_proof pr_proof;
+  rct::key x_change, P, key_yF;
+  rct::zk_proof sa_proof;
+};
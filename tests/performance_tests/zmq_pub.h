@@ -0,0 +1,106 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "cryptonote_basic/events.h"
+#include "net/zmq.h"
+#include "rpc/zmq_pub.h"
+
+#include "multi_tx_test_base.h"
+
+// publishes a txpool_add event carrying N txes to one subscriber of the
+// json-minimal or bin-minimal topic, including the hop through the relay
+template<size_t N, bool binary>
+class test_zmq_pub_txpool : private multi_tx_test_base<2>
+{
+public:
+  static const size_t loop_count = 20000 / N;
+
+  typedef multi_tx_test_base<2> base_class;
+
+  bool init()
+  {
+    if (!base_class::init())
+      return false;
+
+    cryptonote::account_base alice;
+    alice.generate();
+    std::vector<cryptonote::tx_destination_entry> destinations;
+    destinations.push_back(cryptonote::tx_destination_entry(m_source_amount, alice.get_keys().m_account_address, false));
+
+    cryptonote::transaction tx;
+    crypto::secret_key tx_key;
+    std::vector<crypto::secret_key> additional_tx_keys;
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    subaddresses[m_miners[real_source_idx].get_keys().m_account_address.m_spend_public_key] = {0,0};
+    if (!cryptonote::construct_tx_and_get_tx_key(m_miners[real_source_idx].get_keys(), subaddresses, m_sources, destinations, 1/*hf_version*/, "FULM", "FULM", cryptonote::transaction_type::TRANSFER, cryptonote::account_public_address{}, std::vector<uint8_t>(), tx, 0, tx_key, additional_tx_keys, false))
+      return false;
+
+    cryptonote::txpool_event event{tx, {}, 0, 0, true};
+    if (!cryptonote::get_transaction_hash(event.tx, event.hash, event.blob_size))
+      return false;
+    m_events.assign(N, event);
+
+    m_context.reset(zmq_init(1));
+    m_relay.reset(zmq_socket(m_context.get(), ZMQ_PAIR));
+    m_sink.reset(zmq_socket(m_context.get(), ZMQ_PAIR));
+    m_client.reset(zmq_socket(m_context.get(), ZMQ_PAIR));
+    if (!m_relay || !m_sink || !m_client)
+      return false;
+    if (zmq_bind(m_relay.get(), cryptonote::listener::zmq_pub::relay_endpoint()) != 0)
+      return false;
+    if (zmq_bind(m_sink.get(), "inproc://perf_pub") != 0 || zmq_connect(m_client.get(), "inproc://perf_pub") != 0)
+      return false;
+
+    m_pub.reset(new cryptonote::listener::zmq_pub(m_context.get()));
+    static constexpr const char json_topic[] = "\1json-minimal-txpool_add";
+    static constexpr const char bin_topic[] = "\1bin-minimal-txpool_add";
+    return binary ? m_pub->sub_request(bin_topic) : m_pub->sub_request(json_topic);
+  }
+
+  bool test()
+  {
+    if (m_pub->send_txpool_add(m_events) != 1)
+      return false;
+    if (!m_pub->relay_to_pub(m_relay.get(), m_sink.get()))
+      return false;
+    return bool(net::zmq::receive(m_client.get(), ZMQ_DONTWAIT));
+  }
+
+private:
+  std::vector<cryptonote::txpool_event> m_events;
+  net::zmq::context m_context;
+  net::zmq::socket m_relay;
+  net::zmq::socket m_sink;
+  net::zmq::socket m_client;
+  std::unique_ptr<cryptonote::listener::zmq_pub> m_pub;
+};
@@ -87,3 +87,107 @@ TEST(block_queue, flush_uuid)
   bq.add_blocks(0, 200, uuid1(), na);
   ASSERT_EQ(bq.get_max_block_height(), 399);
 }
+
+namespace
+{
+  // a peer delivering spans in exactly latency + size / bandwidth seconds
+  struct simulated_peer
+  {
+    boost::uuids::uuid id;
+    double bandwidth;
+    double latency;
+    size_t block_size;
+
+    double download(cryptonote::block_queue &bq, uint64_t nblocks) const
+    {
+      const double seconds = latency + nblocks * block_size / bandwidth;
+      bq.record_span_download(id, nblocks, nblocks * block_size, seconds);
+      return seconds;
+    }
+  };
+}
+
+TEST(block_queue, adaptive_span_size_defaults)
+{
+  cryptonote::block_queue bq;
+  const simulated_peer peer{uuid1(), 1000000, 0.2, 10000};
+  ASSERT_EQ(bq.get_adaptive_span_size(peer.id, 20, 100, 5), 20);
+  peer.download(bq, 20);
+  ASSERT_EQ(bq.get_adaptive_span_size(peer.id, 20, 100, 5), 20);
+  peer.download(bq, 20);
+  ASSERT_GT(bq.get_adaptive_span_size(peer.id, 20, 100, 5), 20);
+  ASSERT_EQ(bq.get_adaptive_span_size(peer.id, 20, 100, 0), 20);
+  bq.forget_peer(peer.id);
+  ASSERT_EQ(bq.get_adaptive_span_size(peer.id, 20, 100, 5), 20);
+}
+
+TEST(block_queue, adaptive_span_size_fits_peers)
+{
+  cryptonote::block_queue bq;
+  const simulated_peer fast{uuid1(), 2000000, 0.1, 20000};
+  const simulated_peer slow{uuid2(), 50000, 1.0, 20000};
+
+  uint64_t fast_blocks = 0, slow_blocks = 0;
+  for (int round = 0; round < 10; ++round)
+  {
+    fast_blocks = bq.get_adaptive_span_size(fast.id, 20, 100, 5);
+    slow_blocks = bq.get_adaptive_span_size(slow.id, 20, 100, 5);
+    fast.download(bq, fast_blocks);
+    slow.download(bq, slow_blocks);
+  }
+
+  // the fast peer is capped by the request limit, the slow one gets spans it delivers in about 5 seconds
+  ASSERT_EQ(fast_blocks, 100);
+  ASSERT_NEAR(slow_blocks, 10, 1);
+  ASSERT_NEAR(slow.download(bq, slow_blocks), 5.0, 0.5);
+
+  cryptonote::block_queue::peer_stats stats;
+  ASSERT_TRUE(bq.get_peer_stats(fast.id, stats));
+  ASSERT_NEAR(stats.bandwidth / fast.bandwidth, 1.0, 0.01);
+  ASSERT_NEAR(stats.latency, fast.latency, 0.01);
+  ASSERT_TRUE(bq.get_peer_stats(slow.id, stats));
+  ASSERT_NEAR(stats.bandwidth / slow.bandwidth, 1.0, 0.01);
+  ASSERT_NEAR(stats.latency, slow.latency, 0.01);
+}
+
+TEST(block_queue, adaptive_span_size_growth)
+{
+  cryptonote::block_queue bq;
+  const simulated_peer peer{uuid1(), 10000000, 0.05, 1000};
+  peer.download(bq, 10);
+  peer.download(bq, 10);
+  // one good measurement does not jump straight to the limit
+  ASSERT_EQ(bq.get_adaptive_span_size(peer.id, 10, 100, 5), 20);
+}
+
+TEST(block_queue, overdue_span)
+{
+  cryptonote::block_queue bq;
+  epee::net_utils::network_address na;
+  const simulated_peer slow{uuid1(), 50000, 1.0, 20000};
+  const boost::posix_time::ptime t0 = boost::posix_time::microsec_clock::universal_time();
+  boost::posix_time::ptime time;
+  boost::uuids::uuid connection_id;
+  bool filled;
+
+  // no throughput known yet: left to the fixed timeouts
+  bq.add_blocks(100, 10, slow.id, na, t0);
+  ASSERT_TRUE(bq.has_next_span(100, filled, time, connection_id));
+  ASSERT_FALSE(filled);
+  ASSERT_EQ(connection_id, slow.id);
+  ASSERT_EQ(time, t0);
+  ASSERT_FALSE(bq.is_next_span_overdue(connection_id, time, t0 + boost::posix_time::seconds(60)));
+
+  slow.download(bq, 20);
+  slow.download(bq, 10);
+
+  // 10 blocks are expected in 5 seconds from this peer
+  ASSERT_FALSE(bq.is_next_span_overdue(connection_id, time, t0 + boost::posix_time::seconds(10)));
+  ASSERT_TRUE(bq.is_next_span_overdue(connection_id, time, t0 + boost::posix_time::seconds(16)));
+
+  // the span looked up was since re-requested from another peer
+  bq.flush_spans(slow.id);
+  bq.add_blocks(100, 10, uuid2(), na, t0 + boost::posix_time::seconds(12));
+  ASSERT_FALSE(bq.is_next_span_overdue(connection_id, time, t0 + boost::posix_time::seconds(16)));
+  ASSERT_FALSE(bq.is_next_span_overdue(uuid2(), t0 + boost::posix_time::seconds(12), t0 + boost::posix_time::seconds(60)));
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <boost/filesystem.hpp>
+#include "gtest/gtest.h"
+
+#include "cryptonote_config.h"
+#include "file_io_utils.h"
+#include "blockchain_utilities/blockchain_import_progress.h"
+
+using namespace cryptonote::bootstrap;
+
+namespace
+{
+  crypto::hash make_hash(uint64_t n)
+  {
+    crypto::hash h = crypto::null_hash;
+    memcpy(h.data, &n, sizeof(n));
+    return h;
+  }
+
+  // splits the heights [start, stop] into import batches the way the import reader does
+  std::vector<std::pair<uint64_t, uint64_t>> split_batches(uint64_t start, uint64_t stop, uint64_t batch_size)
+  {
+    std::vector<std::pair<uint64_t, uint64_t>> batches;
+    uint64_t first = start, count = 0;
+    for (uint64_t height = start; height <= stop; ++height)
+    {
+      ++count;
+      if (is_import_batch_end(count, height + 1, batch_size))
+      {
+        batches.emplace_back(first, count);
+        first = height + 1;
+        count = 0;
+      }
+    }
+    if (count)
+      batches.emplace_back(first, count);
+    return batches;
+  }
+}
+
+TEST(blockchain_import_progress, batch_end)
+{
+  ASSERT_FALSE(is_import_batch_end(0, HASH_OF_HASHES_STEP, 1));
+  ASSERT_TRUE(is_import_batch_end(1, HASH_OF_HASHES_STEP, 1));
+  ASSERT_FALSE(is_import_batch_end(1, HASH_OF_HASHES_STEP + 1, 1));
+  ASSERT_FALSE(is_import_batch_end(999, 2 * HASH_OF_HASHES_STEP, 1000));
+  ASSERT_TRUE(is_import_batch_end(1000, 2 * HASH_OF_HASHES_STEP, 1000));
+  ASSERT_TRUE(is_import_batch_end(1500, 3 * HASH_OF_HASHES_STEP, 1000));
+}
+
+TEST(blockchain_import_progress, batches_end_on_hash_of_hashes_steps)
+{
+  const uint64_t start = 1, stop = 10 * HASH_OF_HASHES_STEP + 17, batch_size = 1000;
+  const auto batches = split_batches(start, stop, batch_size);
+  ASSERT_FALSE(batches.empty());
+
+  uint64_t expected_first = start;
+  for (size_t i = 0; i < batches.size(); ++i)
+  {
+    ASSERT_EQ(batches[i].first, expected_first);
+    const uint64_t next = batches[i].first + batches[i].second;
+    if (i + 1 < batches.size())
+    {
+      ASSERT_GE(batches[i].second, batch_size);
+      ASSERT_LT(batches[i].second, batch_size + HASH_OF_HASHES_STEP);
+      ASSERT_EQ(next % HASH_OF_HASHES_STEP, 0);
+    }
+    expected_first = next;
+  }
+  ASSERT_EQ(expected_first, stop + 1);
+}
+
+TEST(blockchain_import_progress, accounting)
+{
+  // every block takes a 100 byte chunk, starting at offset 1000
+  const uint64_t start = 1, stop = 3 * HASH_OF_HASHES_STEP + 5, batch_size = HASH_OF_HASHES_STEP;
+  uint64_t num_imported = 0;
+  import_progress progress{start, crypto::null_hash, 1000};
+  for (const auto &batch: split_batches(start, stop, batch_size))
+  {
+    std::vector<crypto::hash> hashes;
+    for (uint64_t height = batch.first; height < batch.first + batch.second; ++height)
+      hashes.push_back(make_hash(height));
+    ASSERT_EQ(batch.first, progress.height);
+    progress = get_import_progress(batch.first, hashes, 1000 + 100 * (batch.first + batch.second - start));
+    num_imported += hashes.size();
+
+    ASSERT_EQ(progress.height, batch.first + batch.second);
+    ASSERT_EQ(progress.top_hash, make_hash(progress.height - 1));
+  }
+  ASSERT_EQ(num_imported, stop - start + 1);
+  ASSERT_EQ(progress.height, stop + 1);
+  ASSERT_EQ(progress.offset, 1000 + 100 * num_imported);
+
+  ASSERT_THROW(get_import_progress(start, {}, 1000), std::exception);
+}
+
+TEST(blockchain_import_progress, format_parse)
+{
+  const import_progress progress{123456, make_hash(123455), 987654321};
+  import_progress parsed{};
+  ASSERT_TRUE(parse_import_progress(format_import_progress(progress), parsed));
+  ASSERT_EQ(parsed.height, progress.height);
+  ASSERT_EQ(parsed.top_hash, progress.top_hash);
+  ASSERT_EQ(parsed.offset, progress.offset);
+
+  ASSERT_FALSE(parse_import_progress("", parsed));
+  ASSERT_FALSE(parse_import_progress("123 nothex 456", parsed));
+  ASSERT_FALSE(parse_import_progress("123 " + std::string(64, '0'), parsed));
+}
+
+TEST(blockchain_import_progress, save_load)
+{
+  const boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  ASSERT_FALSE(load_import_progress(path.string()));
+
+  const import_progress progress{42, make_hash(41), 4242};
+  ASSERT_TRUE(save_import_progress(path.string(), progress));
+  const boost::optional<import_progress> loaded = load_import_progress(path.string());
+  ASSERT_TRUE(loaded);
+  ASSERT_EQ(loaded->height, progress.height);
+  ASSERT_EQ(loaded->top_hash, progress.top_hash);
+  ASSERT_EQ(loaded->offset, progress.offset);
+
+  ASSERT_TRUE(epee::file_io_utils::save_string_to_file(path.string(), "garbage"));
+  ASSERT_FALSE(load_import_progress(path.string()));
+  boost::filesystem::remove(path);
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <sstream>
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "blockchain_db/testdb.h"
+#include "blockchain_utilities/blockchain_scan_visitors.h"
+
+namespace
+{
+  // UTC timestamps, stamped back and across month ends the way miners do
+  const uint64_t timestamps[] = {
+    1580378400, // 2020-01-30 10:00
+    1580425200, // 2020-01-30 23:00
+    1580432400, // 2020-01-31 01:00
+    1580385600, // 2020-01-30 12:00, stamped back
+    1580517000, // 2020-02-01 00:30
+    1580514600, // 2020-01-31 23:50, stamped back over the month end
+    1580630400, // 2020-02-02 08:00
+    1583049600, // 2020-03-01 08:00, a month skipped
+    1583395200, // 2020-03-05 08:00
+  };
+  const size_t num_blocks = sizeof(timestamps) / sizeof(timestamps[0]);
+
+  std::vector<ScannedBlock> make_blocks()
+  {
+    std::vector<ScannedBlock> blocks(num_blocks);
+    for (size_t i = 0; i < num_blocks; ++i)
+    {
+      blocks[i].height = i;
+      blocks[i].block.timestamp = timestamps[i];
+      blocks[i].block_size = 100;
+      blocks[i].txs.resize(1);
+      blocks[i].tx_hashes.resize(1, crypto::null_hash);
+      blocks[i].tx_sizes.resize(1, 10);
+    }
+    return blocks;
+  }
+
+  // visits blocks the way BlockchainScanner does, with ranges of range_blocks
+  std::string scan_stats(const std::vector<ScannedBlock> &blocks, size_t range_blocks)
+  {
+    cryptonote::BaseTestDB db;
+    StatsVisitor stats(db, StatsVisitor::options());
+    for (size_t start = 0; start < blocks.size(); start += range_blocks)
+    {
+      std::unique_ptr<ScanVisitor> partial = stats.clone();
+      for (size_t h = start; h < std::min(blocks.size(), start + range_blocks); ++h)
+        EXPECT_TRUE(partial->visit(blocks[h]));
+      stats.merge(*partial);
+    }
+    std::stringstream ss;
+    stats.print(ss);
+    return ss.str();
+  }
+}
+
+TEST(blockchain_scan_visitors, stats_days)
+{
+  // the days blockchain_stats printed before the scan was parallelized: a day
+  // only starts when the day of the month moves forward or wraps at a month end
+  const std::string expected =
+    "2020-01-30\t2\t2\t2\t2\t220\t220\n"
+    "2020-01-31\t2\t4\t2\t4\t220\t440\n"
+    "2020-02-01\t2\t6\t2\t6\t220\t660\n"
+    "2020-02-02\t2\t8\t2\t8\t220\t880\n"
+    "2020-03-05\t1\t9\t1\t9\t110\t990\n";
+
+  const std::vector<ScannedBlock> blocks = make_blocks();
+  const std::string serial = scan_stats(blocks, num_blocks);
+  ASSERT_EQ(serial.substr(serial.size() - expected.size()), expected);
+
+  // the ranges the blocks are split into make no difference
+  for (size_t range_blocks = 1; range_blocks < num_blocks; ++range_blocks)
+    ASSERT_EQ(scan_stats(blocks, range_blocks), serial) << "range_blocks " << range_blocks;
+}
+
+TEST(blockchain_scan_visitors, bad_tx)
+{
+  std::vector<ScannedBlock> blocks = make_blocks();
+  blocks[3].bad_txs.push_back(crypto::null_hash);
+
+  // stats and usage abort, as blockchain_stats and blockchain_usage always did
+  cryptonote::BaseTestDB db;
+  StatsVisitor stats(db, StatsVisitor::options());
+  ASSERT_TRUE(stats.visit(blocks[2]));
+  ASSERT_FALSE(stats.visit(blocks[3]));
+  UsageVisitor usage(false);
+  ASSERT_TRUE(usage.visit(blocks[2]));
+  ASSERT_FALSE(usage.visit(blocks[3]));
+
+  // the audit reports it and carries on
+  AssetAuditVisitor audit(",");
+  ASSERT_TRUE(audit.visit(blocks[3]));
+  std::stringstream ss;
+  audit.print(ss);
+  ASSERT_NE(ss.str().find("invalid TX detected"), std::string::npos);
+}
@@ -0,0 +1,174 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <boost/filesystem.hpp>
+#include "gtest/gtest.h"
+
+#include "blockchain_utilities/bootstrap_file.h"
+
+namespace
+{
+  // the raw file magic and header, then chunks each with a 4 byte size prefix
+  const size_t first_chunk_offset = 4 + 1024;
+
+  class bootstrap_index: public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+      boost::filesystem::create_directory(dir);
+      path = (dir / "blockchain.raw").string();
+      std::ofstream f(path, std::ios_base::binary);
+      f << std::string(first_chunk_offset, '\0');
+    }
+
+    void TearDown() override
+    {
+      boost::filesystem::permissions(BootstrapIndex::get_path(path), boost::filesystem::owner_read | boost::filesystem::owner_write);
+      boost::filesystem::remove_all(dir);
+    }
+
+    // appends a chunk to the bootstrap file, returning its index entry
+    BootstrapIndex::entry append_chunk(const std::string &data)
+    {
+      const uint64_t offset = boost::filesystem::file_size(path);
+      std::ofstream f(path, std::ios_base::binary | std::ios_base::app);
+      const uint32_t size = data.size();
+      f.write((const char*)&size, sizeof(size));
+      f.write(data.data(), data.size());
+      return {offset, size, BootstrapIndex::get_checksum(data.data(), data.size())};
+    }
+
+    std::vector<BootstrapIndex::entry> make_file(uint64_t block_first, size_t chunks)
+    {
+      std::vector<BootstrapIndex::entry> entries;
+      BootstrapIndex index;
+      EXPECT_TRUE(index.create(path, block_first));
+      for (size_t i = 0; i < chunks; ++i)
+      {
+        entries.push_back(append_chunk(std::string(10 + i, 'a' + i)));
+        EXPECT_TRUE(index.add(entries.back()));
+      }
+      return entries;
+    }
+
+    boost::filesystem::path dir;
+    std::string path;
+  };
+}
+
+TEST_F(bootstrap_index, load)
+{
+  const auto entries = make_file(5, 3);
+
+  BootstrapIndex index;
+  ASSERT_TRUE(index.open(path));
+  ASSERT_EQ(index.block_first(), 5);
+  ASSERT_EQ(index.size(), 3);
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    BootstrapIndex::entry e;
+    ASSERT_TRUE(index.get(5 + i, e));
+    ASSERT_EQ(e.offset, entries[i].offset);
+    ASSERT_EQ(e.size, entries[i].size);
+    ASSERT_EQ(e.checksum, entries[i].checksum);
+  }
+  ASSERT_EQ(entries[0].offset, first_chunk_offset);
+  BootstrapIndex::entry e;
+  ASSERT_FALSE(index.get(4, e));
+  ASSERT_FALSE(index.get(8, e));
+
+  // opened for reading only, it can't be appended to
+  ASSERT_FALSE(index.add(entries.back()));
+  ASSERT_EQ(index.size(), 3);
+}
+
+TEST_F(bootstrap_index, load_read_only)
+{
+  make_file(0, 2);
+  boost::filesystem::permissions(BootstrapIndex::get_path(path), boost::filesystem::owner_read);
+
+  BootstrapIndex index;
+  ASSERT_TRUE(index.open(path));
+  ASSERT_EQ(index.size(), 2);
+}
+
+TEST_F(bootstrap_index, append)
+{
+  make_file(0, 2);
+
+  BootstrapIndex index;
+  ASSERT_TRUE(index.open(path, true));
+  ASSERT_TRUE(index.add(append_chunk("more")));
+  index.close();
+
+  ASSERT_TRUE(index.open(path));
+  ASSERT_EQ(index.size(), 3);
+}
+
+TEST_F(bootstrap_index, stale)
+{
+  make_file(0, 2);
+
+  // the bootstrap file was appended to without the index
+  append_chunk("unindexed");
+  BootstrapIndex index;
+  ASSERT_FALSE(index.open(path));
+  ASSERT_EQ(index.size(), 0);
+  BootstrapIndex::entry e;
+  ASSERT_FALSE(index.get(0, e));
+}
+
+TEST_F(bootstrap_index, malformed)
+{
+  BootstrapIndex index;
+  ASSERT_FALSE(index.open(path));
+
+  make_file(0, 0);
+  ASSERT_TRUE(index.open(path));
+  index.close();
+  const std::string index_path = BootstrapIndex::get_path(path);
+
+  // a bad magic
+  {
+    std::fstream f(index_path, std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    f.write("junk", 4);
+  }
+  ASSERT_FALSE(index.open(path));
+
+  // a partial record
+  make_file(0, 2);
+  ASSERT_TRUE(index.open(path));
+  index.close();
+  {
+    std::ofstream f(index_path, std::ios_base::binary | std::ios_base::app);
+    f << "x";
+  }
+  ASSERT_FALSE(index.open(path));
+}
@@ -77,6 +77,24 @@ TEST(bulletproofs_plus, valid_multi_random)
   }
 }
 
+TEST(bulletproofs_plus, valid_reused_prover)
+{
+  // the prover's scratch space must not leak between proofs of different sizes
+  rct::bulletproof_plus_prover prover;
+  for (size_t outputs: {16, 1, 5, 2, 16, 3})
+  {
+    std::vector<uint64_t> amounts;
+    rct::keyV gamma;
+    for (size_t i = 0; i < outputs; ++i)
+    {
+      amounts.push_back(crypto::rand<uint64_t>());
+      gamma.push_back(rct::skGen());
+    }
+    rct::BulletproofPlus proof = prover.prove(amounts, gamma);
+    ASSERT_TRUE(rct::bulletproof_plus_VERIFY(proof));
+  }
+}
+
 TEST(bulletproofs_plus, valid_aggregated)
 {
   static const size_t N_PROOFS = 8;
@@ -34,6 +34,7 @@
 
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_basic/merge_mining.h"
+#include "ringct/rctOps.h"
 
 namespace
 {
@@ -312,3 +313,33 @@ TEST(Crypto, tree_branch)
     }
   }
 }
+
+TEST(Crypto, generate_key_derivations)
+{
+  const crypto::secret_key view_sec = rct::rct2sk(rct::skGen());
+  std::vector<crypto::public_key> pubs;
+  for (size_t i = 0; i < 17; ++i)
+    pubs.push_back(rct::rct2pk(rct::pkGen()));
+  // one point that does not decompress
+  crypto::public_key bad;
+  memset(bad.data, 0xff, sizeof(bad.data));
+  pubs.insert(pubs.begin() + 5, bad);
+
+  std::vector<crypto::key_derivation> derivations;
+  std::vector<bool> valid;
+  ASSERT_FALSE(crypto::generate_key_derivations(pubs, view_sec, derivations, valid));
+  ASSERT_EQ(derivations.size(), pubs.size());
+  ASSERT_EQ(valid.size(), pubs.size());
+  for (size_t i = 0; i < pubs.size(); ++i)
+  {
+    crypto::key_derivation expected;
+    ASSERT_EQ(valid[i], crypto::generate_key_derivation(pubs[i], view_sec, expected));
+    if (valid[i])
+      ASSERT_EQ(memcmp(&derivations[i], &expected, sizeof(expected)), 0);
+  }
+
+  pubs.erase(pubs.begin() + 5);
+  ASSERT_TRUE(crypto::generate_key_derivations(pubs, view_sec, derivations, valid));
+  ASSERT_TRUE(crypto::generate_key_derivations({}, view_sec, derivations, valid));
+  ASSERT_TRUE(derivations.empty());
+}
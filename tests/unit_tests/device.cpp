@@ -115,6 +115,45 @@ TEST(device, ops)
   ASSERT_EQ(ki0, ki1);
 }
 
+TEST(device, software_device)
+{
+  hw::core::device_default dev;
+  ASSERT_TRUE(hw::core::is_software(dev));
+
+  crypto::secret_key sk0, sk1;
+  crypto::public_key pk0, pk1, pkd, pks;
+  crypto::key_derivation derd, ders;
+  crypto::ec_scalar scd, scs;
+  crypto::view_tag vtd, vts;
+
+  crypto::generate_keys(pk0, sk0);
+  crypto::generate_keys(pk1, sk1);
+
+  ASSERT_TRUE(dev.generate_key_derivation(pk0, sk0, derd));
+  ASSERT_TRUE(hw::core::software_device::generate_key_derivation(pk0, sk0, ders));
+  ASSERT_FALSE(memcmp(&derd, &ders, sizeof(ders)));
+
+  for (size_t i = 0; i < 4; ++i)
+  {
+    ASSERT_TRUE(dev.derivation_to_scalar(derd, i, scd));
+    ASSERT_TRUE(hw::core::software_device::derivation_to_scalar(derd, i, scs));
+    ASSERT_FALSE(memcmp(&scd, &scs, sizeof(scs)));
+
+    ASSERT_TRUE(dev.derive_public_key(derd, i, pk1, pkd));
+    ASSERT_TRUE(hw::core::software_device::derive_public_key(derd, i, pk1, pks));
+    ASSERT_EQ(pkd, pks);
+
+    ASSERT_TRUE(dev.derive_subaddress_public_key(pkd, derd, i, pk0));
+    ASSERT_TRUE(hw::core::software_device::derive_subaddress_public_key(pkd, derd, i, pks));
+    ASSERT_EQ(pk0, pks);
+    ASSERT_EQ(pk0, pk1);
+
+    ASSERT_TRUE(dev.derive_view_tag(derd, i, vtd));
+    ASSERT_TRUE(hw::core::software_device::derive_view_tag(derd, i, vts));
+    ASSERT_EQ(vtd, vts);
+  }
+}
+
 TEST(device, ecdh32)
 {
   hw::core::device_default dev;
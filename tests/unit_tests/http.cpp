@@ -28,8 +28,12 @@
 
 #include "gtest/gtest.h"
 #include "net/http_auth.h"
+#include "net/http_client.h"
+#include "net/http_protocol_handler.h"
+#include "net/local_stream_server.h"
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/algorithm/string/join.hpp>
 #include <boost/fusion/adapted/std_pair.hpp>
 #include <boost/range/algorithm/find_if.hpp>
@@ -743,3 +747,45 @@ TEST(HTTP, Add_Field)
 
   EXPECT_STREQ("leading textfoo: bar\r\nbar: foo\r\nmoarbars: moarfoo\r\n", str.c_str());
 }
+
+TEST(HTTP, Local_Socket_Round_Trip)
+{
+  using context_t = epee::net_utils::connection_context_base;
+  using server_t = epee::net_utils::local_stream_server<http::http_custom_handler<context_t>>;
+  if (!server_t::is_supported())
+    return;
+
+  struct echo_handler : http::i_http_server_handler<context_t>
+  {
+    bool handle_http_request(const http::http_request_info& query, http::http_response_info& response, context_t&) override
+    {
+      // large enough to be sent as its own slice after the header
+      response.m_body.assign(query.m_body.size() * 1000, query.m_body.empty() ? '-' : query.m_body[0]);
+      return true;
+    }
+  } handler;
+
+  const std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("salvium-%%%%-%%%%.sock")).string();
+  http::custum_handler_config<context_t> config{};
+  config.m_phandler = std::addressof(handler);
+  config.rng = rng;
+  server_t server(config);
+  ASSERT_TRUE(server.init_server(path, 2));
+  ASSERT_TRUE(server.run_server(1));
+
+  http::http_local_client client;
+  client.set_server(path, {}, boost::none, epee::net_utils::ssl_support_t::e_ssl_support_disabled);
+  for (char c : {'a', 'b'})
+  {
+    const http::http_response_info* info = nullptr;
+    ASSERT_TRUE(client.invoke_post("/echo", std::string(100, c), std::chrono::seconds(10), std::addressof(info)));
+    ASSERT_NE(nullptr, info);
+    EXPECT_EQ(200, info->m_response_code);
+    EXPECT_EQ(std::string(100000, c), info->m_body);
+  }
+  EXPECT_TRUE(client.is_connected());
+
+  client.disconnect();
+  server.deinit_server();
+  EXPECT_FALSE(boost::filesystem::exists(path));
+}
@@ -315,3 +315,31 @@ TEST(multiexp, scalarmult_triple)
     }
   }
 }
+
+TEST(multiexp, pippenger_cache_size_without_cache)
+{
+  std::vector<rct::MultiexpData> data;
+  data.push_back({rct::skGen(), get_p3(rct::scalarmultBase(rct::skGen()))});
+  ASSERT_ANY_THROW(pippenger(data, NULL, 1));
+}
+
+TEST(multiexp, scratch_released_after_large_calls)
+{
+  // large enough for both per thread workspaces to be released after use, then reallocated
+  static constexpr size_t N = 8192;
+  std::vector<rct::MultiexpData> data;
+  for (size_t n = 0; n < N; ++n)
+    data.push_back({rct::skGen(), get_p3(rct::scalarmultBase(rct::skGen()))});
+  const std::vector<rct::MultiexpData> small(data.begin(), data.begin() + 16);
+  const std::vector<rct::MultiexpData> straus_data(data.begin(), data.begin() + 1024);
+  const rct::key small_res = basic(small);
+  const rct::key straus_res = basic(straus_data);
+  const rct::key res = basic(data);
+  for (int i = 0; i < 2; ++i)
+  {
+    ASSERT_TRUE(straus_res == straus(straus_data));
+    ASSERT_TRUE(small_res == straus(small));
+    ASSERT_TRUE(res == pippenger(data));
+    ASSERT_TRUE(small_res == pippenger(small));
+  }
+}
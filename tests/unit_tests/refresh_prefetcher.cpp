@@ -0,0 +1,292 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <set>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "wallet/refresh_prefetcher.h"
+
+namespace
+{
+  crypto::hash make_hash(uint64_t height, char tag)
+  {
+    crypto::hash hash = crypto::null_hash;
+    memcpy(&hash, &height, sizeof(height));
+    hash.data[sizeof(height)] = tag;
+    return hash;
+  }
+
+  // answers like a daemon would: from the newest block of the request it has
+  // on its chain, or failing that from where it forked off what it served
+  struct mock_daemon
+  {
+    mock_daemon(uint64_t height, size_t batch_blocks, size_t blob_size): batch_blocks(batch_blocks), blob_size(blob_size), calls(0)
+    {
+      for (uint64_t h = 0; h < height; ++h)
+        chain.push_back(make_hash(h, 'a'));
+    }
+
+    void reorg(uint64_t height, char tag)
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      for (uint64_t h = height; h < chain.size(); ++h)
+        chain[h] = make_hash(h, tag);
+    }
+
+    void fetch(bool first, const tools::refresh_prefetcher::batch &prev, tools::refresh_prefetcher::batch &next)
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      uint64_t start = 0;
+      if (!first)
+      {
+        bool found = false;
+        for (auto i = prev.parsed_blocks.rbegin(); i != prev.parsed_blocks.rend() && !found; ++i)
+        {
+          for (uint64_t h = 0; h < chain.size() && !found; ++h)
+          {
+            if (chain[h] == i->hash)
+            {
+              start = h;
+              found = true;
+            }
+          }
+        }
+        for (uint64_t h = served.size(); !found && h > 0; --h)
+        {
+          if (served[h - 1] == chain[h - 1])
+          {
+            start = h - 1;
+            found = true;
+          }
+        }
+      }
+
+      next.start_height = start;
+      const uint64_t end = std::min<uint64_t>(start + batch_blocks, chain.size());
+      for (uint64_t h = start; h < end; ++h)
+      {
+        cryptonote::block_complete_entry bce;
+        bce.block = std::string(blob_size, 'b');
+        next.blocks.push_back(std::move(bce));
+        next.parsed_blocks.emplace_back();
+        next.parsed_blocks.back().hash = chain[h];
+        if (served.size() <= h)
+          served.resize(h + 1);
+        served[h] = chain[h];
+      }
+      next.last = end == chain.size();
+      threads.insert(boost::this_thread::get_id());
+      ++calls;
+    }
+
+    tools::refresh_prefetcher::fetch_t fetcher()
+    {
+      return [this](bool first, const tools::refresh_prefetcher::batch &prev, tools::refresh_prefetcher::batch &next) { fetch(first, prev, next); };
+    }
+
+    boost::mutex mutex;
+    std::vector<crypto::hash> chain;
+    std::vector<crypto::hash> served;
+    std::set<boost::thread::id> threads;
+    const size_t batch_blocks;
+    const size_t blob_size;
+    std::atomic<size_t> calls;
+  };
+
+  bool wait_for(const std::function<bool()> &condition)
+  {
+    for (int i = 0; i < 5000; ++i)
+    {
+      if (condition())
+        return true;
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+    }
+    return condition();
+  }
+
+  // what the prefetcher charges for one batch of the given shape
+  uint64_t get_batch_bytes(size_t batch_blocks, size_t blob_size)
+  {
+    mock_daemon daemon(batch_blocks, batch_blocks, blob_size);
+    tools::refresh_prefetcher::batch b;
+    daemon.fetch(true, b, b);
+    return tools::refresh_prefetcher::batch_bytes(b);
+  }
+}
+
+TEST(refresh_prefetcher, chained_batches)
+{
+  mock_daemon daemon(100, 10, 16);
+  tools::refresh_prefetcher prefetcher(4, 1024 * 1024);
+  prefetcher.start(daemon.fetcher(), 1000);
+
+  tools::refresh_prefetcher::batch b;
+  uint64_t expected_start = 0;
+  while (prefetcher.pop(b))
+  {
+    ASSERT_FALSE(b.error);
+    ASSERT_EQ(b.start_height, expected_start);
+    ASSERT_EQ(b.bytes, tools::refresh_prefetcher::batch_bytes(b));
+    expected_start = b.start_height + b.blocks.size() - 1;
+  }
+  ASSERT_EQ(expected_start, 99);
+  ASSERT_TRUE(b.last);
+}
+
+TEST(refresh_prefetcher, batch_count_bound)
+{
+  mock_daemon daemon(1000, 10, 16);
+  tools::refresh_prefetcher prefetcher(2, 1024 * 1024);
+  prefetcher.start(daemon.fetcher(), 10000);
+
+  prefetcher.wait_until_blocked();
+  ASSERT_EQ(daemon.calls, 2);
+  ASSERT_EQ(prefetcher.queued_batches(), 2);
+
+  tools::refresh_prefetcher::batch b;
+  ASSERT_TRUE(prefetcher.pop(b));
+  prefetcher.wait_until_blocked();
+  ASSERT_EQ(daemon.calls, 3);
+  ASSERT_EQ(prefetcher.queued_batches(), 2);
+}
+
+TEST(refresh_prefetcher, memory_bound)
+{
+  // the producer stops once two and a half batches worth are queued
+  mock_daemon daemon(1000, 10, 1000);
+  const uint64_t batch_bytes = get_batch_bytes(10, 1000);
+  tools::refresh_prefetcher prefetcher(100, batch_bytes * 5 / 2);
+  prefetcher.start(daemon.fetcher(), 10000);
+
+  prefetcher.wait_until_blocked();
+  ASSERT_EQ(daemon.calls, 3);
+  ASSERT_EQ(prefetcher.queued_batches(), 3);
+  ASSERT_EQ(prefetcher.queued_bytes(), batch_bytes * 3);
+
+  tools::refresh_prefetcher::batch b;
+  ASSERT_TRUE(prefetcher.pop(b));
+  ASSERT_EQ(b.bytes, batch_bytes);
+  prefetcher.wait_until_blocked();
+  ASSERT_EQ(daemon.calls, 4);
+  ASSERT_EQ(prefetcher.queued_bytes(), batch_bytes * 3);
+
+  // draining does not leave anything accounted
+  prefetcher.stop();
+  ASSERT_EQ(prefetcher.queued_batches(), 0);
+  ASSERT_EQ(prefetcher.queued_bytes(), 0);
+  ASSERT_FALSE(prefetcher.pop(b));
+}
+
+TEST(refresh_prefetcher, parsed_data_counted)
+{
+  tools::refresh_prefetcher::batch b;
+  b.blocks.resize(1);
+  b.blocks[0].block = std::string(100, 'b');
+  b.blocks[0].txs.push_back({std::string(1000, 't'), crypto::null_hash});
+  const size_t blobs_only = tools::refresh_prefetcher::batch_bytes(b);
+  ASSERT_GE(blobs_only, 1100);
+
+  // the parsed block and tx are charged on top of their blobs
+  b.parsed_blocks.resize(1);
+  b.parsed_blocks[0].txes.resize(1);
+  b.parsed_blocks[0].o_indices.indices.resize(2);
+  b.parsed_blocks[0].o_indices.indices[1].indices = {1, 2, 3};
+  ASSERT_GE(tools::refresh_prefetcher::batch_bytes(b), blobs_only + 1100 + sizeof(cryptonote::transaction) + 3 * sizeof(uint64_t));
+}
+
+TEST(refresh_prefetcher, one_batch_over_memory_bound)
+{
+  mock_daemon daemon(1000, 10, 1000);
+  tools::refresh_prefetcher prefetcher(100, 1);
+  prefetcher.start(daemon.fetcher(), 10000);
+
+  prefetcher.wait_until_blocked();
+  ASSERT_EQ(daemon.calls, 1);
+
+  tools::refresh_prefetcher::batch b;
+  ASSERT_TRUE(prefetcher.pop(b));
+  ASSERT_EQ(b.blocks.size(), 10);
+  ASSERT_TRUE(wait_for([&]{ return daemon.calls == 2; }));
+}
+
+TEST(refresh_prefetcher, reorg_drops_stale_batches)
+{
+  mock_daemon daemon(100, 10, 16);
+  tools::refresh_prefetcher prefetcher(3, 1024 * 1024);
+  prefetcher.start(daemon.fetcher(), 1000);
+
+  // batches at 0, 9 and 18 are queued when the daemon reorgs from 12
+  ASSERT_TRUE(wait_for([&]{ return prefetcher.queued_batches() == 3; }));
+  daemon.reorg(12, 'b');
+
+  tools::refresh_prefetcher::batch b;
+  ASSERT_TRUE(prefetcher.pop(b));
+  ASSERT_EQ(b.start_height, 0);
+
+  // the batch at 9 is kept since it holds blocks below the split, the one at
+  // 18 is dropped and the chain continues from the split
+  ASSERT_TRUE(wait_for([&]{ return daemon.calls >= 4; }));
+  ASSERT_TRUE(prefetcher.pop(b));
+  ASSERT_EQ(b.start_height, 9);
+  ASSERT_TRUE(prefetcher.pop(b));
+  ASSERT_EQ(b.start_height, 11);
+
+  uint64_t top = 0;
+  do
+  {
+    ASSERT_FALSE(b.error);
+    for (size_t i = 0; i < b.parsed_blocks.size(); ++i)
+      ASSERT_TRUE(b.parsed_blocks[i].hash == daemon.chain[b.start_height + i]);
+    ASSERT_GE(b.start_height, top);
+    top = b.start_height + b.parsed_blocks.size() - 1;
+  } while (prefetcher.pop(b));
+  ASSERT_EQ(top, 99);
+}
+
+TEST(refresh_prefetcher, restart_discards_queued)
+{
+  mock_daemon daemon(1000, 10, 16);
+  tools::refresh_prefetcher prefetcher(4, 1024 * 1024);
+  prefetcher.start(daemon.fetcher(), 10000);
+  ASSERT_TRUE(wait_for([&]{ return prefetcher.queued_batches() == 4; }));
+
+  // restarting from the wallet's own chain never hands out the old batches
+  daemon.reorg(0, 'b');
+  prefetcher.start(daemon.fetcher(), 10000);
+  tools::refresh_prefetcher::batch b;
+  ASSERT_TRUE(prefetcher.pop(b));
+  ASSERT_EQ(b.start_height, 0);
+  ASSERT_TRUE(b.parsed_blocks[0].hash == make_hash(0, 'b'));
+
+  // on the same thread as before
+  prefetcher.wait_until_blocked();
+  ASSERT_EQ(daemon.threads.size(), 1);
+}
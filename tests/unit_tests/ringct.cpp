@@ -37,6 +37,7 @@
 #include "ringct/rctTypes.h"
 #include "ringct/rctSigs.h"
 #include "ringct/rctOps.h"
+#include "crypto/generators.h"
 #include "device/device.hpp"
 #include "string_tools.h"
 
@@ -299,6 +300,79 @@ TEST(ringct, CLSAG)
   ASSERT_TRUE(rct::verRctCLSAGSimple(message,clsag,pubs,Cout));
 }
 
+TEST(ringct, CLSAG_batch)
+{
+  const size_t N = 11;
+  const size_t n_sigs = 6;
+
+  // a pool of decoys, so that rings overlap across signatures
+  ctkeyV decoys;
+  for (size_t i = 0; i < 2 * N; ++i)
+  {
+    key sk;
+    ctkey tmp;
+    skpkGen(sk, tmp.dest);
+    skpkGen(sk, tmp.mask);
+    decoys.push_back(tmp);
+  }
+
+  std::vector<key> messages(n_sigs);
+  std::vector<clsag> sigs(n_sigs);
+  std::vector<ctkeyV> rings(n_sigs);
+  std::vector<key> Couts(n_sigs);
+  for (size_t n = 0; n < n_sigs; ++n)
+  {
+    const size_t idx = n % N;
+    for (size_t i = 0; i < N; ++i)
+      rings[n].push_back(decoys[(n + i) % decoys.size()]);
+
+    ctkey insk;
+    skpkGen(insk.dest, rings[n][idx].dest);
+    insk.mask = skGen();
+    const key u = skGen();
+    addKeys2(rings[n][idx].mask, insk.mask, u, H);
+    const key t2 = skGen();
+    addKeys2(Couts[n], t2, u, H);
+
+    messages[n] = skGen();
+    sigs[n] = rct::proveRctCLSAGSimple(messages[n], rings[n], insk, t2, Couts[n], idx, hw::get_device("default"));
+    ASSERT_TRUE(rct::verRctCLSAGSimple(messages[n], sigs[n], rings[n], Couts[n]));
+  }
+
+  // two signatures per tag, like a transaction with two inputs
+  rct::clsag_batch batch;
+  for (size_t n = 0; n < n_sigs; ++n)
+    batch.add(messages[n], sigs[n], rings[n], Couts[n], n / 2);
+  ASSERT_EQ(batch.size(), n_sigs);
+  std::vector<size_t> failed;
+  ASSERT_TRUE(batch.verify(&failed));
+  ASSERT_TRUE(failed.empty());
+
+  // a bad signature fails the batch and is traced back to its tag
+  batch.clear();
+  for (size_t n = 0; n < n_sigs; ++n)
+    batch.add(n == 3 ? skGen() : messages[n], sigs[n], rings[n], Couts[n], n / 2);
+  ASSERT_FALSE(batch.verify());
+  ASSERT_FALSE(batch.verify(&failed));
+  ASSERT_EQ(failed, std::vector<size_t>({1}));
+
+  // an invalid shared ring member fails every signature using it
+  batch.clear();
+  ctkeyV bad_ring = rings[0];
+  bad_ring[1].dest.bytes[31] ^= 0x80;
+  bad_ring[1].dest.bytes[0] ^= 0x01;
+  batch.add(messages[0], sigs[0], bad_ring, Couts[0], 0);
+  batch.add(messages[0], sigs[0], bad_ring, Couts[0], 1);
+  batch.add(messages[2], sigs[2], rings[2], Couts[2], 2);
+  failed.clear();
+  ASSERT_FALSE(batch.verify(&failed));
+  ASSERT_EQ(failed, std::vector<size_t>({0, 1}));
+
+  batch.clear();
+  ASSERT_TRUE(batch.empty());
+  ASSERT_TRUE(batch.verify());
+}
+
 TEST(ringct, range_proofs)
 {
         //Ring CT Stuff
@@ -513,6 +587,45 @@ TEST(ringct, simple)
         decodeRctSimple(s, amount_keys[1], 1, mask,  hw::get_device("default"));
 }
 
+TEST(ringct, simple_clsag_many_inputs)
+{
+        // enough inputs for the software device to sign them concurrently
+        ctkeyV sc, pc;
+        ctkey sctmp, pctmp;
+        vector<xmr_amount> inamounts, outamounts;
+        keyV destinations, amount_keys;
+        key Sk, Pk;
+
+        for (int n = 0; n < 12; ++n) {
+            tie(sctmp, pctmp) = ctskpkGen(1000 + n);
+            sc.push_back(sctmp);
+            pc.push_back(pctmp);
+            inamounts.push_back(1000 + n);
+        }
+        for (xmr_amount amount: {10000, 2064}) {
+            outamounts.push_back(amount);
+            amount_keys.push_back(rct::hash_to_scalar(rct::zero()));
+            skpkGen(Sk, Pk);
+            destinations.push_back(Pk);
+        }
+
+        const rct::RCTConfig rct_config { RangeProofPaddedBulletproof, 4 };
+        cryptonote::transaction_type tx_type = cryptonote::transaction_type::TRANSFER;
+        std::string in_asset_type = "SAL";
+        std::vector<std::string> destination_asset_types(destinations.size(), "SAL");
+
+        rctSig s = genRctSimple(skGen(), sc, pc, destinations, tx_type, in_asset_type, destination_asset_types, inamounts, outamounts, amount_keys, 2, 10, rct_config, hw::get_device("default"));
+        ASSERT_EQ(s.p.CLSAGs.size(), inamounts.size());
+        ASSERT_TRUE(verRctSimple(s));
+
+        // each input signed its own ring
+        for (size_t i = 0; i < s.p.CLSAGs.size(); ++i)
+            ASSERT_TRUE(verRctCLSAGSimple(get_pre_mlsag_hash(s, hw::get_device("default")), s.p.CLSAGs[i], s.mixRing[i], s.p.pseudoOuts[i]));
+
+        std::swap(s.p.CLSAGs[0], s.p.CLSAGs[1]);
+        ASSERT_FALSE(verRctSimple(s));
+}
+
 static rct::rctSig make_sample_rct_sig(int n_inputs, const uint64_t input_amounts[], int n_outputs, const uint64_t output_amounts[], bool last_is_fee)
 {
     ctkeyV sc, pc;
@@ -1261,6 +1374,47 @@ TEST(ringct, H)
   ASSERT_EQ(memcmp(&p3, &ge_p3_H, sizeof(ge_p3)), 0);
 }
 
+TEST(ringct, fixed_base_tables)
+{
+  // a table built at runtime for G must act like the compiled-in one
+  static ge_fixed_base_table G_table;
+  ge_p3 G_p3 = crypto::get_G_p3();
+  ge_fixed_base_table_init(G_table, &G_p3);
+
+  std::vector<rct::key> scalars{rct::zero(), rct::identity(), rct::EIGHT, rct::INV_EIGHT, rct::d2h(0xffffffffffffffff)};
+  rct::key l_minus_one;
+  sc_sub(l_minus_one.bytes, rct::zero().bytes, rct::identity().bytes);
+  scalars.push_back(l_minus_one);
+  for (size_t n = 0; n < 32; ++n)
+    scalars.push_back(rct::skGen());
+
+  for (const rct::key &a: scalars)
+  {
+    ge_p3 p3;
+    rct::key expected, got;
+
+    ge_scalarmult_base(&p3, a.bytes);
+    ge_p3_tobytes(expected.bytes, &p3);
+    ge_scalarmult_fixed_base(&p3, a.bytes, G_table);
+    ge_p3_tobytes(got.bytes, &p3);
+    ASSERT_EQ(expected, got);
+
+    ASSERT_EQ(rct::scalarmultH(a), rct::scalarmultKey(rct::H, a));
+
+    for (const rct::key &b: {rct::zero(), a, rct::skGen()})
+    {
+      rct::key aGbH, aGbB;
+      rct::addKeys_aGbH(aGbH, a, b);
+      rct::addKeys2(aGbB, a, b, rct::H);
+      ASSERT_EQ(aGbH, aGbB);
+    }
+  }
+
+  // commitments are unchanged
+  const rct::key mask = rct::skGen();
+  ASSERT_EQ(rct::commit(1000, mask), rct::addKeys(rct::scalarmultBase(mask), rct::scalarmultKey(rct::H, rct::d2h(1000))));
+}
+
 TEST(ringct, mul8)
 {
   ge_p3 p3;
@@ -1310,6 +1464,80 @@ TEST(ringct, pr_proof)
   ASSERT_EQ(failure, 9);
 }
 
+TEST(ringct, sa_proof_verify)
+{
+  for (size_t i=0; i<100; i++) {
+    const key x_change = skGen();
+    const key P = scalarmultBase(x_change);
+    const key key_yF = pkGen();
+    zk_proof proof = SAProof_Gen(P, x_change, key_yF);
+    ASSERT_TRUE(SAProof_Ver(proof, P, key_yF));
+    ASSERT_FALSE(SAProof_Ver(proof, pkGen(), key_yF));
+    ASSERT_FALSE(SAProof_Ver(proof, P, pkGen()));
+    proof.z1 = skGen();
+    ASSERT_FALSE(SAProof_Ver(proof, P, key_yF));
+  }
+}
+
+// builds R = r * G + t * T with t = -c mod 8, grinding r until the challenge
+// on R lands on the torsion multiple that was guessed
+template<typename F>
+static void make_torsioned_R(const key &T, key &r, key &R, key &c, F challenge)
+{
+  for (uint8_t t = 0; ; t = (t + 1) & 7)
+  {
+    r = skGen();
+    R = addKeys(scalarmultBase(r), scalarmultKey(T, d2h(t)));
+    c = challenge(R);
+    if (((8 - (c.bytes[0] & 7)) & 7) == t)
+      return;
+  }
+}
+
+TEST(ringct, proofs_with_torsioned_points)
+{
+  // the verifiers must keep computing z * G - c * X, which differs from (l - c) * X
+  // by l * T when X has a torsion component
+  key T;
+  ASSERT_TRUE(epee::string_tools::hex_to_pod("c7176a703d4dd84fba3c0b760d10670f2a2053fa2c39ccc64ec7fd7792ac037a", T));
+  ASSERT_FALSE(isInMainSubgroup(T));
+
+  for (size_t i = 0; i < 8; ++i)
+  {
+    const key x = skGen();
+    const key X = addKeys(scalarmultBase(x), T);
+    key r, c;
+    zk_proof proof{};
+
+    make_torsioned_R(T, r, proof.R, c, [&](const key &R){ return hash_to_scalar(keyV{R, X}); });
+    sc_muladd(proof.z1.bytes, x.bytes, c.bytes, r.bytes);
+    ASSERT_TRUE(PRProof_Ver(X, proof));
+
+    const key key_yF = pkGen();
+    make_torsioned_R(T, r, proof.R, c, [&](const key &R){ return hash_to_scalar(keyV{R, X, key_yF}); });
+    sc_muladd(proof.z1.bytes, x.bytes, c.bytes, r.bytes);
+    ASSERT_TRUE(SAProof_Ver(proof, X, key_yF));
+  }
+}
+
+TEST(ringct, fixed_base_unreduced_scalars)
+{
+  // scalars at or above 2^255 must not break the table lookups
+  key a, a_reduced;
+  memset(a.bytes, 0xff, sizeof(a.bytes));
+  sc_reduce32copy(a_reduced.bytes, a.bytes);
+  const key b = skGen();
+
+  key aGbH, aGbB;
+  addKeys_aGbH(aGbH, a, b);
+  addKeys2(aGbB, a_reduced, b, H);
+  ASSERT_EQ(aGbH, aGbB);
+  addKeys_aGbH(aGbH, b, a);
+  addKeys2(aGbB, b, a_reduced, H);
+  ASSERT_EQ(aGbH, aGbB);
+  ASSERT_EQ(scalarmultH(a), scalarmultKey(H, a_reduced));
+}
+
 TEST(ringct, sa_proof)
 {
   // Create a random commitment with 0 amount
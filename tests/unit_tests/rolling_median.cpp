@@ -30,6 +30,7 @@
 #include "gtest/gtest.h"
 #include "misc_language.h"
 #include "rolling_median.h"
+#include "window_median.h"
 #include "crypto/crypto.h"
 
 TEST(rolling_median, one)
@@ -229,3 +230,119 @@ TEST(rolling_median, copy)
     ASSERT_EQ(m.median(), copy.median());
   }
 }
+
+TEST(window_median, series)
+{
+  epee::misc_utils::window_median_t<uint64_t> m(100);
+  epee::misc_utils::rolling_median_t<uint64_t> rm(100);
+  std::vector<uint64_t> v;
+  v.reserve(100);
+  for (int i = 0; i < 10000; ++i)
+  {
+    // small range, so there are plenty of duplicates
+    uint64_t r = crypto::rand<uint64_t>() % 50;
+    v.push_back(r);
+    if (v.size() > 100)
+      v.erase(v.begin());
+    m.push_back(r);
+    rm.insert(r);
+    ASSERT_EQ(m.size(), v.size());
+    std::vector<uint64_t> vcopy = v;
+    ASSERT_EQ(m.median(), epee::misc_utils::median(vcopy));
+    ASSERT_EQ(m.median(), rm.median());
+  }
+}
+
+TEST(window_median, both_ends)
+{
+  epee::misc_utils::window_median_t<uint64_t> m(64);
+  std::deque<uint64_t> v;
+  for (int i = 0; i < 20000; ++i)
+  {
+    const uint64_t r = crypto::rand<uint64_t>() % 1000;
+    switch (crypto::rand<uint8_t>() % 4)
+    {
+      case 0:
+        m.push_back(r);
+        v.push_back(r);
+        if (v.size() > 64)
+          v.pop_front();
+        break;
+      case 1:
+        if (v.size() < 64)
+        {
+          m.push_front(r);
+          v.push_front(r);
+        }
+        break;
+      case 2:
+        if (!v.empty())
+        {
+          m.pop_back();
+          v.pop_back();
+        }
+        break;
+      case 3:
+        if (!v.empty())
+        {
+          m.pop_front();
+          v.pop_front();
+        }
+        break;
+    }
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), m.items().begin(), m.items().end()));
+    std::vector<uint64_t> vcopy(v.begin(), v.end());
+    ASSERT_EQ(m.median(), epee::misc_utils::median(vcopy));
+  }
+}
+
+TEST(window_median, rewind)
+{
+  // a window over a chain, rewound past a few blocks and moved onto another branch
+  std::vector<uint64_t> chain, branch;
+  for (int i = 0; i < 1000; ++i)
+    chain.push_back(crypto::rand<uint64_t>() % 100000);
+  for (int i = 0; i < 30; ++i)
+    branch.push_back(crypto::rand<uint64_t>() % 100000);
+
+  epee::misc_utils::window_median_t<uint64_t> m(100);
+  for (uint64_t w: chain)
+    m.push_back(w);
+  for (size_t i = 0; i < branch.size(); ++i)
+  {
+    m.pop_back();
+    m.push_front(chain[chain.size() - 100 - 1 - i]);
+  }
+  for (uint64_t w: branch)
+    m.push_back(w);
+
+  epee::misc_utils::window_median_t<uint64_t> expected(100);
+  for (size_t i = 0; i < chain.size() - branch.size(); ++i)
+    expected.push_back(chain[i]);
+  for (uint64_t w: branch)
+    expected.push_back(w);
+  ASSERT_TRUE(m.items() == expected.items());
+  ASSERT_EQ(m.median(), expected.median());
+}
+
+TEST(window_median, full)
+{
+  epee::misc_utils::window_median_t<uint64_t> m(3);
+
+  ASSERT_TRUE(m.empty());
+  ASSERT_EQ(m.median(), 0);
+  m.push_back(5);
+  m.push_back(1);
+  ASSERT_FALSE(m.full());
+  ASSERT_EQ(m.median(), 3);
+  m.push_back(9);
+  ASSERT_TRUE(m.full());
+  ASSERT_EQ(m.median(), 5);
+  m.push_front(100);
+  ASSERT_EQ(m.size(), 3);
+  ASSERT_EQ(m.front(), 5);
+  m.push_back(2);
+  ASSERT_EQ(m.front(), 1);
+  ASSERT_EQ(m.back(), 2);
+  ASSERT_EQ(m.median(), 2);
+}
@@ -0,0 +1,158 @@
+// Copyright (c) 2014-2022, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "gtest/gtest.h"
+
+#include "rpc/rpc_block_cache.h"
+
+namespace
+{
+  std::shared_ptr<const cryptonote::rpc_block_cache::entry> make_entry(uint64_t height, size_t blob_size)
+  {
+    crypto::hash hash = crypto::null_hash;
+    memcpy(&hash, &height, sizeof(height));
+    cryptonote::block_complete_entry bce;
+    bce.block = std::string(blob_size, 'b');
+    return std::make_shared<const cryptonote::rpc_block_cache::entry>(hash, std::move(bce));
+  }
+}
+
+TEST(rpc_block_cache, get_add)
+{
+  cryptonote::rpc_block_cache cache(16 * 1024 * 1024, 10);
+  ASSERT_EQ(cache.min_depth(), 10);
+  ASSERT_EQ(cache.get(5, cryptonote::rpc_block_cache::pruned), nullptr);
+
+  cache.add(5, cryptonote::rpc_block_cache::pruned, make_entry(5, 100));
+  const auto e = cache.get(5, cryptonote::rpc_block_cache::pruned);
+  ASSERT_NE(e, nullptr);
+  ASSERT_EQ(e->block.block.size(), 100);
+  ASSERT_EQ(memcmp(&e->hash, &make_entry(5, 1)->hash, sizeof(crypto::hash)), 0);
+
+  // same height with other flags is another entry
+  ASSERT_EQ(cache.get(5, cryptonote::rpc_block_cache::pruned | cryptonote::rpc_block_cache::no_ring_members), nullptr);
+  ASSERT_EQ(cache.get(6, cryptonote::rpc_block_cache::pruned), nullptr);
+
+  ASSERT_EQ(cache.get_hits(), 1);
+  ASSERT_EQ(cache.get_misses(), 3);
+  ASSERT_GE(cache.get_bytes(), 100);
+
+  // replacing an entry does not count it twice
+  const size_t bytes = cache.get_bytes();
+  cache.add(5, cryptonote::rpc_block_cache::pruned, make_entry(5, 100));
+  ASSERT_EQ(cache.get_bytes(), bytes);
+
+  cache.clear();
+  ASSERT_EQ(cache.get(5, cryptonote::rpc_block_cache::pruned), nullptr);
+  ASSERT_EQ(cache.get_bytes(), 0);
+}
+
+TEST(rpc_block_cache, evicts_least_recently_used)
+{
+  // 16 shards of 64 kB, heights 0, 16, 32... all land in the same shard
+  cryptonote::rpc_block_cache cache(16 * 64 * 1024, 10);
+  cache.add(0, 0, make_entry(0, 30 * 1024));
+  cache.add(16, 0, make_entry(16, 30 * 1024));
+  ASSERT_NE(cache.get(0, 0), nullptr);
+  cache.add(32, 0, make_entry(32, 30 * 1024));
+  ASSERT_NE(cache.get(0, 0), nullptr);
+  ASSERT_EQ(cache.get(16, 0), nullptr);
+  ASSERT_NE(cache.get(32, 0), nullptr);
+
+  // other shards are untouched
+  cache.add(1, 0, make_entry(1, 30 * 1024));
+  ASSERT_NE(cache.get(1, 0), nullptr);
+  ASSERT_NE(cache.get(0, 0), nullptr);
+
+  // entries larger than a shard are not cached at all
+  cache.add(2, 0, make_entry(2, 128 * 1024));
+  ASSERT_EQ(cache.get(2, 0), nullptr);
+}
+
+TEST(rpc_block_cache, get_run)
+{
+  cryptonote::rpc_block_cache cache(16 * 1024 * 1024, 10);
+  const auto get_hash = [](uint64_t height) { return make_entry(height, 1)->hash; };
+  for (uint64_t height = 0; height < 20; ++height)
+    cache.add(height, 0, make_entry(height, 100));
+
+  std::vector<std::shared_ptr<const cryptonote::rpc_block_cache::entry>> entries;
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 1, 5, 1024 * 1024, 1000, get_hash, entries));
+  ASSERT_EQ(entries.size(), 5);
+  for (size_t i = 0; i < entries.size(); ++i)
+    ASSERT_EQ(entries[i]->hash, get_hash(2 + i));
+
+  // size and tx limits count blob bytes and txes like the database does, and cut the run after min_blocks
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 1, 10, 300, 1000, get_hash, entries));
+  ASSERT_EQ(entries.size(), 3);
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 1, 10, 301, 1000, get_hash, entries));
+  ASSERT_EQ(entries.size(), 4);
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 1, 10, 1, 1000, get_hash, entries));
+  ASSERT_EQ(entries.size(), 1);
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 3, 10, 1, 1000, get_hash, entries));
+  ASSERT_EQ(entries.size(), 3);
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 3, 10, 1024 * 1024, 0, get_hash, entries));
+  ASSERT_EQ(entries.size(), 3);
+
+  // running out of cacheable heights before max_blocks is left to the database
+  ASSERT_FALSE(cache.get_run(15, 20, 0, 1, 10, 1024 * 1024, 1000, get_hash, entries));
+  ASSERT_TRUE(entries.empty());
+}
+
+TEST(rpc_block_cache, get_run_with_hole)
+{
+  cryptonote::rpc_block_cache cache(16 * 1024 * 1024, 10);
+  const auto get_hash = [](uint64_t height) { return make_entry(height, 1)->hash; };
+  for (uint64_t height = 0; height < 20; ++height)
+    if (height != 6)
+      cache.add(height, 0, make_entry(height, 100));
+
+  // a hole before max_blocks does not give a short response, nor hits for the entries it skipped
+  std::vector<std::shared_ptr<const cryptonote::rpc_block_cache::entry>> entries;
+  ASSERT_FALSE(cache.get_run(2, 20, 0, 1, 10, 1024 * 1024, 1000, get_hash, entries));
+  ASSERT_TRUE(entries.empty());
+  ASSERT_EQ(cache.get_hits(), 0);
+  ASSERT_EQ(cache.get_misses(), 1);
+
+  // a run ending before the hole is still served
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 1, 4, 1024 * 1024, 1000, get_hash, entries));
+  ASSERT_EQ(entries.size(), 4);
+  ASSERT_EQ(cache.get_hits(), 4);
+  ASSERT_EQ(cache.get_misses(), 1);
+
+  // the database path fills the hole, after which the cache serves the run
+  cache.add(6, 0, make_entry(6, 100));
+  ASSERT_TRUE(cache.get_run(2, 20, 0, 1, 10, 1024 * 1024, 1000, get_hash, entries));
+  ASSERT_EQ(entries.size(), 10);
+
+  // a stale entry counts as a hole
+  cache.add(8, 0, make_entry(1000, 100));
+  ASSERT_FALSE(cache.get_run(2, 20, 0, 1, 10, 1024 * 1024, 1000, get_hash, entries));
+  ASSERT_TRUE(entries.empty());
+}
@@ -357,3 +357,22 @@ TEST(remove_field_from_tx_extra, invalid_varint)
   ASSERT_FALSE(cryptonote::remove_field_from_tx_extra(extra, typeid(cryptonote::tx_extra_nonce)));
   ASSERT_EQ(sizeof(extra_arr), extra.size());
 }
+
+TEST(get_burnt_amount, by_tx_type)
+{
+  std::vector<cryptonote::tx_destination_entry> dsts(3);
+  dsts[0].amount = 1;
+  dsts[0].asset_type = "SAL";
+  dsts[1].amount = 10;
+  dsts[1].asset_type = "BURN";
+  dsts[2].amount = 100;
+  dsts[2].asset_type = "SAL";
+  dsts[2].is_change = true;
+
+  ASSERT_EQ(0, cryptonote::get_burnt_amount(dsts, cryptonote::transaction_type::TRANSFER, "BURN"));
+  ASSERT_EQ(10, cryptonote::get_burnt_amount(dsts, cryptonote::transaction_type::BURN, "BURN"));
+  ASSERT_EQ(10, cryptonote::get_burnt_amount(dsts, cryptonote::transaction_type::CONVERT, "BURN"));
+  ASSERT_EQ(11, cryptonote::get_burnt_amount(dsts, cryptonote::transaction_type::STAKE, "SAL"));
+  ASSERT_FALSE(cryptonote::is_burnt_destination(dsts[2], cryptonote::transaction_type::STAKE, "SAL"));
+  ASSERT_TRUE(cryptonote::is_burnt_destination(dsts[2], cryptonote::transaction_type::BURN, "SAL"));
+}
@@ -0,0 +1,196 @@
+// Copyright (c) 2014-2022, The Monero Project
+
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/account.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "ringct/rctOps.h"
+
+using namespace cryptonote;
+
+namespace
+{
+  static const size_t ring_size = 16;
+  static const uint64_t input_amount = 1000000000000ull;
+
+  bool burns(transaction_type type)
+  {
+    return type == transaction_type::CONVERT || type == transaction_type::BURN || type == transaction_type::STAKE;
+  }
+
+  // builds txes of one type and shape the way the wallet does, so that only the fee and burnt amount vary between them
+  class tx_builder
+  {
+  public:
+    tx_builder(transaction_type type, size_t n_inputs, size_t n_outputs): m_type(type), m_n_outputs(n_outputs)
+    {
+      m_sender.generate();
+      m_receiver.generate();
+      m_subaddresses[m_sender.get_keys().m_account_address.m_spend_public_key] = {0, 0};
+      for (size_t i = 0; i < n_inputs; ++i)
+        m_sources.push_back(make_source());
+    }
+
+    const char *dest_asset() const
+    {
+      return m_type == transaction_type::CONVERT ? "VSD" : m_type == transaction_type::BURN ? "BURN" : "SAL";
+    }
+
+    // CONVERT, BURN and STAKE burn one destination and keep the change, TRANSFER and RETURN pay n_outputs - 1 destinations
+    transaction build(uint64_t fee, uint64_t amount_burnt) const
+    {
+      const bool burning = burns(m_type);
+      const uint64_t amount_paid = burning ? amount_burnt : 1000000000;
+      std::vector<tx_destination_entry> destinations;
+      uint64_t change = input_amount * m_sources.size() - fee;
+      for (size_t i = 0; i + 1 < (burning ? 2 : m_n_outputs); ++i)
+      {
+        destinations.push_back(tx_destination_entry(amount_paid, m_receiver.get_keys().m_account_address, false));
+        destinations.back().asset_type = burning ? dest_asset() : "SAL";
+        change -= amount_paid;
+      }
+      destinations.push_back(tx_destination_entry(change, m_sender.get_keys().m_account_address, false));
+      destinations.back().asset_type = "SAL";
+      destinations.back().is_change = true;
+
+      std::vector<tx_source_entry> sources = m_sources;
+      transaction tx;
+      crypto::secret_key tx_key;
+      std::vector<crypto::secret_key> additional_tx_keys;
+      const bool r = construct_tx_and_get_tx_key(m_sender.get_keys(), m_subaddresses, sources, destinations, HF_VERSION_FULL_PROOFS, "SAL", dest_asset(), m_type,
+          m_sender.get_keys().m_account_address, {}, tx, 0, tx_key, additional_tx_keys, true, {rct::RangeProofPaddedBulletproof, 5}, true);
+      CHECK_AND_ASSERT_THROW_MES(r, "Failed to construct tx");
+      CHECK_AND_ASSERT_THROW_MES(tx.rct_signatures.txnFee == fee && tx.amount_burnt == (burning ? amount_burnt : 0), "Unexpected fee or burnt amount");
+      return tx;
+    }
+
+  private:
+    // an output to the sender, hidden in a ring of random decoys
+    tx_source_entry make_source() const
+    {
+      const account_public_address &address = m_sender.get_keys().m_account_address;
+      const keypair tx_keys = keypair::generate(hw::get_device("default"));
+      crypto::key_derivation derivation;
+      crypto::public_key out_key;
+      CHECK_AND_ASSERT_THROW_MES(crypto::generate_key_derivation(address.m_view_public_key, tx_keys.sec, derivation), "Failed to generate key derivation");
+      CHECK_AND_ASSERT_THROW_MES(crypto::derive_public_key(derivation, 0, address.m_spend_public_key, out_key), "Failed to derive public key");
+
+      tx_source_entry src;
+      src.real_output = crypto::rand_idx(ring_size);
+      src.real_out_tx_key = tx_keys.pub;
+      src.real_output_in_tx_index = 0;
+      src.amount = input_amount;
+      src.rct = true;
+      src.mask = rct::skGen();
+      src.asset_type = "SAL";
+      src.origin_tx_data.tx_type = transaction_type::UNSET;
+      uint64_t offset = crypto::rand_range<uint64_t>(0, 5000000);
+      for (size_t i = 0; i < ring_size; ++i)
+      {
+        offset += crypto::rand_range<uint64_t>(1, 200000);
+        if (i == src.real_output)
+          src.outputs.push_back({offset, {rct::pk2rct(out_key), rct::commit(input_amount, src.mask)}});
+        else
+          src.outputs.push_back({offset, {rct::pkGen(), rct::pkGen()}});
+      }
+      return src;
+    }
+
+    transaction_type m_type;
+    size_t m_n_outputs;
+    account_base m_sender;
+    account_base m_receiver;
+    std::unordered_map<crypto::public_key, subaddress_index> m_subaddresses;
+    std::vector<tx_source_entry> m_sources;
+  };
+
+  uint64_t get_weight(const transaction &tx)
+  {
+    return get_transaction_weight(tx, t_serializable_object_to_blob(tx).size());
+  }
+
+  uint64_t predict_weight(const transaction &tx, uint64_t fee, uint64_t amount_burnt)
+  {
+    return get_transaction_weight_for_fee(tx, t_serializable_object_to_blob(tx).size(), fee, amount_burnt);
+  }
+}
+
+TEST(tx_weight, predicted_for_fee)
+{
+  // fees across varint size boundaries, in both directions
+  static const uint64_t fees[] = {127, 128, 16383, 16384, 2097151, 2097152, 1ull << 35};
+  static const size_t n_fees = sizeof(fees) / sizeof(fees[0]);
+  for (transaction_type type: {transaction_type::TRANSFER, transaction_type::CONVERT, transaction_type::BURN, transaction_type::STAKE, transaction_type::RETURN})
+    for (size_t n_inputs: {1, 2})
+      for (size_t n_outputs: {2, 5})
+      {
+        if (burns(type) && n_outputs != 2)
+          continue;
+        const tx_builder builder(type, n_inputs, n_outputs);
+        std::vector<transaction> txes;
+        for (uint64_t fee: fees)
+          txes.push_back(builder.build(fee, 1000000000));
+        for (size_t i = 0; i < n_fees; ++i)
+          for (size_t j = 0; j < n_fees; ++j)
+            ASSERT_EQ(predict_weight(txes[i], fees[j], txes[i].amount_burnt), get_weight(txes[j]))
+                << "type " << type << ", " << n_inputs << " inputs, " << n_outputs << " outputs, fee " << fees[i] << " -> " << fees[j];
+      }
+}
+
+TEST(tx_weight, predicted_for_burnt_amount)
+{
+  // burning txes can have the fee taken out of the burnt amount
+  static const std::pair<uint64_t, uint64_t> changes[][2] = {
+    {{30720000, 1000000000000ull}, {30720000 + 200, 1000000000000ull - 200}},
+    {{30720000, 1ull << 35}, {30721000, (1ull << 35) - 1000}},
+    {{100, 200}, {200, 100}},
+  };
+  for (transaction_type type: {transaction_type::CONVERT, transaction_type::BURN, transaction_type::STAKE})
+  {
+    const tx_builder builder(type, 2, 2);
+    for (const auto &change: changes)
+    {
+      const transaction tx0 = builder.build(change[0].first, change[0].second);
+      const transaction tx1 = builder.build(change[1].first, change[1].second);
+      ASSERT_EQ(predict_weight(tx0, change[1].first, change[1].second), get_weight(tx1)) << "type " << type;
+      ASSERT_EQ(predict_weight(tx1, change[0].first, change[0].second), get_weight(tx0)) << "type " << type;
+    }
+  }
+}
+
+TEST(tx_weight, rejects_miner_and_protocol_txes)
+{
+  transaction tx = tx_builder(transaction_type::TRANSFER, 1, 2).build(1000, 0);
+  tx.type = transaction_type::MINER;
+  ASSERT_ANY_THROW(predict_weight(tx, 2000, 0));
+  tx.type = transaction_type::PROTOCOL;
+  ASSERT_ANY_THROW(predict_weight(tx, 2000, 0));
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <ctime>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "wallet/wallet2.h"
+
+// the wallet internals the wallet tests look at, wallet2 lets this class in
+class wallet_accessor_test
+{
+public:
+  static const crypto::hash &genesis_hash(const tools::wallet2 &w) { return w.m_blockchain[0]; }
+  static tools::wallet2::transfer_container &transfers(tools::wallet2 &w) { return w.m_transfers; }
+  static auto &key_images(tools::wallet2 &w) { return w.m_key_images; }
+  static const auto &confirmed_txs(const tools::wallet2 &w) { return w.m_confirmed_txs; }
+  static const tools::wallet2::transfer_columns &transfer_columns(const tools::wallet2 &w) { return w.get_transfer_columns(); }
+  static void update_transfer_columns(tools::wallet2 &w, size_t idx) { w.update_transfer_columns(idx); }
+  static void set_spent(tools::wallet2 &w, size_t idx, uint64_t height) { w.set_spent(idx, height); }
+  static void set_unspent(tools::wallet2 &w, size_t idx) { w.set_unspent(idx); }
+  static void detach_blockchain(tools::wallet2 &w, uint64_t height) { w.detach_blockchain(height); }
+  static void share_tx_prefixes(tools::wallet2 &w) { w.share_tx_prefixes(); }
+  static void process_parsed_blocks(tools::wallet2 &w, uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<tools::wallet2::parsed_block> &parsed_blocks, uint64_t &blocks_added)
+  {
+    w.process_parsed_blocks(start_height, blocks, parsed_blocks, blocks_added);
+  }
+  static void process_scan_followers(tools::wallet2 &w, uint64_t start_height, const std::vector<cryptonote::block_complete_entry> &blocks, const std::vector<tools::wallet2::parsed_block> &parsed_blocks)
+  {
+    w.process_scan_followers(start_height, blocks, parsed_blocks);
+  }
+};
+
+namespace unit_test
+{
+  // a chain on top of the wallets' genesis, each block paying its coinbase
+  // to the next address in turn
+  inline void make_wallet_chain(const crypto::hash &genesis_hash, const std::vector<cryptonote::account_public_address> &miners, size_t length,
+      std::vector<cryptonote::block_complete_entry> &blocks, std::vector<tools::wallet2::parsed_block> &parsed_blocks)
+  {
+    blocks.resize(1);
+    parsed_blocks.resize(1);
+    parsed_blocks[0].hash = genesis_hash;
+    parsed_blocks[0].error = false;
+
+    uint64_t global_index = 1;
+    for (size_t height = 1; height < length; ++height)
+    {
+      cryptonote::block b;
+      b.major_version = HF_VERSION_BULLETPROOF_PLUS;
+      b.minor_version = HF_VERSION_BULLETPROOF_PLUS;
+      b.timestamp = time(NULL);
+      b.prev_id = parsed_blocks.back().hash;
+      ASSERT_TRUE(cryptonote::construct_miner_tx(height, 0, 0, 0, 0, miners[height % miners.size()], b.miner_tx, cryptonote::blobdata(), 999, HF_VERSION_BULLETPROOF_PLUS));
+
+      tools::wallet2::parsed_block pb;
+      pb.block = b;
+      pb.hash = cryptonote::get_block_hash(b);
+      pb.error = false;
+      pb.o_indices.indices.resize(2);
+      pb.asset_type_output_indices.indices.resize(2);
+      for (size_t o = 0; o < b.miner_tx.vout.size(); ++o, ++global_index)
+      {
+        pb.o_indices.indices[0].indices.push_back(global_index);
+        pb.asset_type_output_indices.indices[0].indices.push_back(global_index);
+      }
+      blocks.emplace_back();
+      parsed_blocks.push_back(std::move(pb));
+    }
+  }
+
+  // a tx spending the given key image out of a small ring
+  inline cryptonote::transaction make_spend(const crypto::key_image &ki)
+  {
+    cryptonote::transaction tx;
+    tx.version = 2;
+    tx.type = cryptonote::transaction_type::TRANSFER;
+    tx.source_asset_type = "SAL";
+    tx.destination_asset_type = "SAL";
+    cryptonote::txin_to_key in;
+    in.amount = 0;
+    in.asset_type = "SAL";
+    in.key_offsets = {12, 7, 3, 1};
+    in.k_image = ki;
+    tx.vin.push_back(in);
+    tx.rct_signatures.type = rct::RCTTypeNull;
+    tx.rct_signatures.txnFee = 0;
+    return tx;
+  }
+
+  // appends a tx to the top block, as the daemon would send it
+  inline void add_tx(std::vector<cryptonote::block_complete_entry> &blocks, std::vector<tools::wallet2::parsed_block> &parsed_blocks, const crypto::hash &txid, const cryptonote::transaction &tx)
+  {
+    tools::wallet2::parsed_block &pb = parsed_blocks.back();
+    pb.block.tx_hashes.push_back(txid);
+    pb.hash = cryptonote::get_block_hash(pb.block);
+    pb.txes.push_back(tx);
+    pb.o_indices.indices.emplace_back();
+    pb.asset_type_output_indices.indices.emplace_back();
+    for (size_t o = 0; o < tx.vout.size(); ++o)
+    {
+      pb.o_indices.indices.back().indices.push_back(1000 + o);
+      pb.asset_type_output_indices.indices.back().indices.push_back(1000 + o);
+    }
+    blocks.back().txs.push_back({cryptonote::tx_to_blob(tx), crypto::null_hash});
+  }
+}
@@ -0,0 +1,204 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "wallet/wallet2.h"
+#include "wallet_chain.h"
+
+namespace
+{
+  std::shared_ptr<tools::wallet2> make_wallet()
+  {
+    crypto::public_key pkey;
+    crypto::secret_key skey;
+    crypto::generate_keys(pkey, skey);
+    std::shared_ptr<tools::wallet2> w = std::make_shared<tools::wallet2>();
+    w->generate("", "", skey, true, false);
+    return w;
+  }
+
+  crypto::key_image make_key_image()
+  {
+    crypto::key_image ki;
+    crypto::public_key pkey;
+    crypto::secret_key skey;
+    crypto::generate_keys(pkey, skey);
+    crypto::generate_key_image(pkey, skey, ki);
+    return ki;
+  }
+
+  // what getblocks.bin sends when asked for no_ring_members
+  cryptonote::transaction strip_rings(cryptonote::transaction tx)
+  {
+    cryptonote::blobdata blob = cryptonote::tx_to_blob(tx);
+    EXPECT_TRUE(cryptonote::strip_ring_members_from_tx_blob(blob));
+    cryptonote::transaction stripped;
+    EXPECT_TRUE(cryptonote::parse_and_validate_tx_base_from_blob(blob, stripped));
+    return stripped;
+  }
+
+  void add_transfer(std::vector<tools::wallet2::transfer_details> &transfers, std::unordered_map<crypto::key_image, size_t> &key_images, const crypto::key_image &ki)
+  {
+    tools::wallet2::transfer_details td = AUTO_VAL_INIT(td);
+    td.m_block_height = 10;
+    td.m_amount = 1000;
+    td.m_key_image = ki;
+    td.m_key_image_known = true;
+    td.m_spent = false;
+    td.m_subaddr_index = {0, 0};
+    td.asset_type = "SAL";
+    transfers.push_back(td);
+    key_images[ki] = transfers.size() - 1;
+  }
+}
+
+TEST(wallet_rings, strip_tx_blob)
+{
+  const crypto::key_image last_ki = make_key_image();
+  cryptonote::transaction tx = unit_test::make_spend(make_key_image());
+  tx.vin.push_back(tx.vin.front());
+  boost::get<cryptonote::txin_to_key>(tx.vin.back()).key_offsets = {300000, 1, 128, 16384};
+  boost::get<cryptonote::txin_to_key>(tx.vin.back()).k_image = last_ki;
+  tx.extra = {1, 2, 3};
+  const cryptonote::blobdata blob = cryptonote::tx_to_blob(tx);
+  const size_t inputs_end = blob.find(std::string((const char*)&last_ki, sizeof(last_ki))) + sizeof(last_ki);
+  ASSERT_LT(inputs_end, blob.size());
+
+  // same bytes as the tx parsed, stripped and serialized again
+  cryptonote::transaction expected = tx;
+  for (cryptonote::txin_v &in: expected.vin)
+    boost::get<cryptonote::txin_to_key>(in).key_offsets.clear();
+  expected.invalidate_hashes();
+  cryptonote::blobdata stripped = blob;
+  ASSERT_TRUE(cryptonote::strip_ring_members_from_tx_blob(stripped));
+  ASSERT_EQ(stripped, cryptonote::tx_to_blob(expected));
+  ASSERT_LT(stripped.size(), blob.size());
+
+  // coinbase inputs have no ring to strip
+  cryptonote::transaction miner_tx;
+  ASSERT_TRUE(cryptonote::construct_miner_tx(1, 0, 0, 0, 0, make_wallet()->get_address(), miner_tx, cryptonote::blobdata(), 999, HF_VERSION_BULLETPROOF_PLUS));
+  const cryptonote::blobdata miner_blob = cryptonote::tx_to_blob(miner_tx);
+  stripped = miner_blob;
+  ASSERT_TRUE(cryptonote::strip_ring_members_from_tx_blob(stripped));
+  ASSERT_EQ(stripped, miner_blob);
+
+  // a tx cut short in its inputs is refused
+  for (size_t size = 0; size < inputs_end; ++size)
+  {
+    cryptonote::blobdata truncated = blob.substr(0, size);
+    ASSERT_FALSE(cryptonote::strip_ring_members_from_tx_blob(truncated));
+  }
+}
+
+TEST(wallet_rings, stripped_spend_pulled_again)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  const crypto::key_image ki = make_key_image();
+  add_transfer(wallet_accessor_test::transfers(*w), wallet_accessor_test::key_images(*w), ki);
+  wallet_accessor_test::update_transfer_columns(*w, 0);
+
+  const cryptonote::transaction tx = unit_test::make_spend(ki);
+  const crypto::hash txid = cryptonote::get_transaction_hash(tx);
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {make_wallet()->get_address()}, 3, blocks, parsed_blocks);
+  std::vector<cryptonote::block_complete_entry> stripped_blocks = blocks;
+  std::vector<tools::wallet2::parsed_block> stripped_parsed_blocks = parsed_blocks;
+  unit_test::add_tx(blocks, parsed_blocks, txid, tx);
+  unit_test::add_tx(stripped_blocks, stripped_parsed_blocks, txid, strip_rings(tx));
+
+  // nothing of the block with our spend is recorded without its rings
+  uint64_t blocks_added = 0;
+  ASSERT_THROW(wallet_accessor_test::process_parsed_blocks(*w, 0, stripped_blocks, stripped_parsed_blocks, blocks_added), tools::error::ring_members_needed_error);
+  ASSERT_EQ(w->get_blockchain_current_height(), 2);
+  ASSERT_FALSE(wallet_accessor_test::transfers(*w)[0].m_spent);
+  ASSERT_EQ(wallet_accessor_test::confirmed_txs(*w).count(txid), 0);
+
+  // and pulled again with them, it is
+  wallet_accessor_test::process_parsed_blocks(*w, 2, std::vector<cryptonote::block_complete_entry>(blocks.begin() + 2, blocks.end()),
+      std::vector<tools::wallet2::parsed_block>(parsed_blocks.begin() + 2, parsed_blocks.end()), blocks_added);
+  ASSERT_EQ(w->get_blockchain_current_height(), 3);
+  ASSERT_TRUE(wallet_accessor_test::transfers(*w)[0].m_spent);
+  std::vector<std::pair<crypto::key_image, std::vector<uint64_t>>> rings;
+  ASSERT_TRUE(w->get_rings(txid, rings));
+  ASSERT_EQ(rings.size(), 1);
+  ASSERT_TRUE(rings[0].first == ki);
+  ASSERT_EQ(rings[0].second, cryptonote::relative_output_offsets_to_absolute(boost::get<cryptonote::txin_to_key>(tx.vin[0]).key_offsets));
+  const auto i = wallet_accessor_test::confirmed_txs(*w).find(txid);
+  ASSERT_NE(i, wallet_accessor_test::confirmed_txs(*w).end());
+  ASSERT_EQ(boost::get<cryptonote::txin_to_key>(i->second.m_tx.vin[0]).key_offsets, boost::get<cryptonote::txin_to_key>(tx.vin[0]).key_offsets);
+}
+
+TEST(wallet_rings, stripped_receive_pulled_again)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+
+  // a tx paying us, whose output must be kept with its rings
+  cryptonote::transaction tx;
+  ASSERT_TRUE(cryptonote::construct_miner_tx(2, 0, 0, 0, 0, w->get_address(), tx, cryptonote::blobdata(), 999, HF_VERSION_BULLETPROOF_PLUS));
+  const cryptonote::transaction spend = unit_test::make_spend(make_key_image());
+  tx.vin = spend.vin;
+  tx.type = spend.type;
+  tx.source_asset_type = spend.source_asset_type;
+  tx.destination_asset_type = spend.destination_asset_type;
+  tx.invalidate_hashes();
+  const crypto::hash txid = cryptonote::get_transaction_hash(tx);
+
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {make_wallet()->get_address()}, 3, blocks, parsed_blocks);
+  unit_test::add_tx(blocks, parsed_blocks, txid, strip_rings(tx));
+
+  uint64_t blocks_added = 0;
+  ASSERT_THROW(wallet_accessor_test::process_parsed_blocks(*w, 0, blocks, parsed_blocks, blocks_added), tools::error::ring_members_needed_error);
+  ASSERT_EQ(w->get_blockchain_current_height(), 2);
+  ASSERT_EQ(w->get_num_transfer_details(), 0);
+}
+
+TEST(wallet_rings, stripped_others_scanned)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  const crypto::key_image ki = make_key_image();
+  add_transfer(wallet_accessor_test::transfers(*w), wallet_accessor_test::key_images(*w), ki);
+  wallet_accessor_test::update_transfer_columns(*w, 0);
+
+  // a tx which neither pays nor spends ours is scanned as sent
+  const cryptonote::transaction tx = unit_test::make_spend(make_key_image());
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {make_wallet()->get_address()}, 3, blocks, parsed_blocks);
+  unit_test::add_tx(blocks, parsed_blocks, cryptonote::get_transaction_hash(tx), strip_rings(tx));
+
+  uint64_t blocks_added = 0;
+  wallet_accessor_test::process_parsed_blocks(*w, 0, blocks, parsed_blocks, blocks_added);
+  ASSERT_EQ(w->get_blockchain_current_height(), 3);
+  ASSERT_FALSE(wallet_accessor_test::transfers(*w)[0].m_spent);
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "wallet/wallet2.h"
+#include "wallet_chain.h"
+
+namespace
+{
+  std::shared_ptr<tools::wallet2> make_wallet(const crypto::secret_key &recovery_key)
+  {
+    std::shared_ptr<tools::wallet2> w = std::make_shared<tools::wallet2>();
+    w->generate("", "", recovery_key, true, false);
+    return w;
+  }
+
+  crypto::secret_key make_recovery_key()
+  {
+    crypto::public_key pkey;
+    crypto::secret_key skey;
+    crypto::generate_keys(pkey, skey);
+    return skey;
+  }
+}
+
+TEST(wallet_scan_followers, match_solo_refresh)
+{
+  const crypto::secret_key leader_key = make_recovery_key(), follower_key0 = make_recovery_key(), follower_key1 = make_recovery_key();
+  std::shared_ptr<tools::wallet2> leader = make_wallet(leader_key);
+  std::vector<std::shared_ptr<tools::wallet2>> followers = {make_wallet(follower_key0), make_wallet(follower_key1)};
+  std::vector<std::shared_ptr<tools::wallet2>> solos = {make_wallet(follower_key0), make_wallet(follower_key1)};
+  for (const auto &follower: followers)
+    leader->add_scan_follower(follower);
+  ASSERT_EQ(leader->get_num_scan_followers(), 2);
+
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*leader), {leader->get_address(), followers[0]->get_address(), followers[1]->get_address()}, 30, blocks, parsed_blocks);
+
+  // the leader feeds both followers from the blocks it processes, in two batches
+  const size_t split = 12;
+  const std::vector<cryptonote::block_complete_entry> blocks0(blocks.begin(), blocks.begin() + split), blocks1(blocks.begin() + split - 1, blocks.end());
+  const std::vector<tools::wallet2::parsed_block> parsed_blocks0(parsed_blocks.begin(), parsed_blocks.begin() + split), parsed_blocks1(parsed_blocks.begin() + split - 1, parsed_blocks.end());
+  uint64_t blocks_added = 0;
+  wallet_accessor_test::process_parsed_blocks(*leader, 0, blocks0, parsed_blocks0, blocks_added);
+  wallet_accessor_test::process_scan_followers(*leader, 0, blocks0, parsed_blocks0);
+  wallet_accessor_test::process_parsed_blocks(*leader, split - 1, blocks1, parsed_blocks1, blocks_added);
+  wallet_accessor_test::process_scan_followers(*leader, split - 1, blocks1, parsed_blocks1);
+
+  for (size_t i = 0; i < solos.size(); ++i)
+  {
+    wallet_accessor_test::process_parsed_blocks(*solos[i], 0, blocks, parsed_blocks, blocks_added);
+
+    ASSERT_EQ(followers[i]->get_blockchain_current_height(), blocks.size());
+    ASSERT_EQ(followers[i]->get_blockchain_current_height(), solos[i]->get_blockchain_current_height());
+    ASSERT_EQ(followers[i]->get_num_transfer_details(), solos[i]->get_num_transfer_details());
+    ASSERT_GT(followers[i]->get_num_transfer_details(), 0);
+    ASSERT_EQ(followers[i]->balance_all(false), solos[i]->balance_all(false));
+  }
+  ASSERT_EQ(leader->get_blockchain_current_height(), blocks.size());
+  ASSERT_NE(leader->balance_all(false), followers[0]->balance_all(false));
+}
+
+TEST(wallet_scan_followers, attach_detach)
+{
+  std::shared_ptr<tools::wallet2> leader = make_wallet(make_recovery_key());
+  std::shared_ptr<tools::wallet2> follower = make_wallet(make_recovery_key());
+  std::shared_ptr<tools::wallet2> other = make_wallet(make_recovery_key());
+
+  ASSERT_THROW(leader->add_scan_follower(leader), tools::error::wallet_internal_error);
+  ASSERT_THROW(leader->add_scan_follower(nullptr), tools::error::wallet_internal_error);
+
+  leader->add_scan_follower(follower);
+  leader->add_scan_follower(follower);
+  ASSERT_EQ(leader->get_num_scan_followers(), 1);
+  ASSERT_TRUE(follower->is_scan_follower());
+  ASSERT_FALSE(leader->is_scan_follower());
+
+  // attached, a follower cannot refresh, lead, or follow anyone else
+  ASSERT_THROW(follower->refresh(false), tools::error::wallet_internal_error);
+  ASSERT_THROW(follower->add_scan_follower(other), tools::error::wallet_internal_error);
+  ASSERT_THROW(other->add_scan_follower(follower), tools::error::wallet_internal_error);
+  ASSERT_THROW(other->add_scan_follower(leader), tools::error::wallet_internal_error);
+
+  leader->remove_scan_follower(follower);
+  ASSERT_EQ(leader->get_num_scan_followers(), 0);
+  ASSERT_FALSE(follower->is_scan_follower());
+
+  // the leader going away releases its followers
+  other->add_scan_follower(follower);
+  ASSERT_TRUE(follower->is_scan_follower());
+  other.reset();
+  ASSERT_FALSE(follower->is_scan_follower());
+
+  // a leader pulls ring members for its followers, whether it tracks output uses or not
+  follower->track_uses(true);
+  leader->add_scan_follower(follower);
+  ASSERT_TRUE(follower->is_scan_follower());
+}
+
+TEST(wallet_scan_followers, spends_detected)
+{
+  const crypto::secret_key follower_key = make_recovery_key();
+  std::shared_ptr<tools::wallet2> leader = make_wallet(make_recovery_key());
+  std::shared_ptr<tools::wallet2> follower = make_wallet(follower_key), solo = make_wallet(follower_key);
+  leader->add_scan_follower(follower);
+
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*leader), {follower->get_address()}, 8, blocks, parsed_blocks);
+
+  // the follower receives in the first batch
+  const size_t split = 6;
+  uint64_t blocks_added = 0;
+  const std::vector<cryptonote::block_complete_entry> blocks0(blocks.begin(), blocks.begin() + split);
+  const std::vector<tools::wallet2::parsed_block> parsed_blocks0(parsed_blocks.begin(), parsed_blocks.begin() + split);
+  wallet_accessor_test::process_parsed_blocks(*leader, 0, blocks0, parsed_blocks0, blocks_added);
+  wallet_accessor_test::process_scan_followers(*leader, 0, blocks0, parsed_blocks0);
+  const tools::wallet2::transfer_container &transfers = wallet_accessor_test::transfers(*follower);
+  ASSERT_FALSE(transfers.empty());
+  ASSERT_TRUE(transfers[0].m_key_image_known);
+  ASSERT_FALSE(transfers[0].m_spent);
+
+  // and spends in the second, which only the leader pulls
+  const cryptonote::transaction tx = unit_test::make_spend(transfers[0].m_key_image);
+  const crypto::hash txid = cryptonote::get_transaction_hash(tx);
+  unit_test::add_tx(blocks, parsed_blocks, txid, tx);
+  const std::vector<cryptonote::block_complete_entry> blocks1(blocks.begin() + split - 1, blocks.end());
+  const std::vector<tools::wallet2::parsed_block> parsed_blocks1(parsed_blocks.begin() + split - 1, parsed_blocks.end());
+  wallet_accessor_test::process_parsed_blocks(*leader, split - 1, blocks1, parsed_blocks1, blocks_added);
+  wallet_accessor_test::process_scan_followers(*leader, split - 1, blocks1, parsed_blocks1);
+  ASSERT_EQ(follower->get_blockchain_current_height(), blocks.size());
+  ASSERT_TRUE(transfers[0].m_spent);
+  ASSERT_EQ(transfers[0].m_spent_height, blocks.size() - 1);
+  ASSERT_EQ(wallet_accessor_test::confirmed_txs(*follower).count(txid), 1);
+  ASSERT_EQ(wallet_accessor_test::confirmed_txs(*leader).count(txid), 0);
+
+  wallet_accessor_test::process_parsed_blocks(*solo, 0, blocks, parsed_blocks, blocks_added);
+  ASSERT_TRUE(wallet_accessor_test::transfers(*solo)[0].m_spent);
+  ASSERT_EQ(follower->balance_all(false), solo->balance_all(false));
+}
@@ -0,0 +1,207 @@
+// Copyright (c) 2014-2022, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "wallet/wallet2.h"
+#include "wallet_chain.h"
+
+namespace
+{
+  void check_columns(const tools::wallet2::transfer_container &transfers, const tools::wallet2::transfer_columns &cols)
+  {
+    ASSERT_EQ(cols.size(), transfers.size());
+    for (size_t i = 0; i < transfers.size(); ++i)
+    {
+      const tools::wallet2::transfer_details &td = transfers[i];
+      ASSERT_EQ(cols.m_amount[i], td.m_amount);
+      ASSERT_EQ(cols.m_block_height[i], td.m_block_height);
+      ASSERT_LT(cols.m_asset_id[i], cols.m_asset_types.size());
+      ASSERT_EQ(cols.m_asset_types[cols.m_asset_id[i]], td.asset_type);
+      ASSERT_EQ(cols.m_subaddr_index[i], td.m_subaddr_index);
+      ASSERT_EQ(cols.is_spent(i, false), td.m_spent);
+      ASSERT_EQ(cols.is_spent(i, true), td.m_spent && td.m_spent_height > 0);
+      ASSERT_EQ(cols.is_frozen(i), td.m_frozen);
+      ASSERT_EQ(cols.is_rct(i), td.m_rct);
+    }
+  }
+
+  std::shared_ptr<tools::wallet2> make_wallet()
+  {
+    std::shared_ptr<tools::wallet2> w = std::make_shared<tools::wallet2>();
+    w->generate("", "");
+    return w;
+  }
+}
+
+TEST(wallet_transfer_columns, freeze_thaw)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {w->get_address()}, 10, blocks, parsed_blocks);
+  uint64_t blocks_added = 0;
+  wallet_accessor_test::process_parsed_blocks(*w, 0, blocks, parsed_blocks, blocks_added);
+  ASSERT_EQ(w->get_num_transfer_details(), 9);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+
+  w->freeze(1);
+  w->freeze(3);
+  w->thaw(1);
+  wallet_accessor_test::set_spent(*w, 2, 8);
+  wallet_accessor_test::set_spent(*w, 4, 9);
+  wallet_accessor_test::set_unspent(*w, 4);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+  ASSERT_TRUE(wallet_accessor_test::transfer_columns(*w).is_frozen(3));
+  ASSERT_FALSE(wallet_accessor_test::transfer_columns(*w).is_frozen(1));
+  ASSERT_TRUE(wallet_accessor_test::transfer_columns(*w).is_spent(2, true));
+  ASSERT_FALSE(wallet_accessor_test::transfer_columns(*w).is_spent(4, false));
+}
+
+TEST(wallet_transfer_columns, detach_blockchain)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {w->get_address()}, 20, blocks, parsed_blocks);
+  uint64_t blocks_added = 0;
+  wallet_accessor_test::process_parsed_blocks(*w, 0, blocks, parsed_blocks, blocks_added);
+  ASSERT_EQ(w->get_num_transfer_details(), 19);
+
+  wallet_accessor_test::set_spent(*w, 2, 15);
+  w->freeze(2);
+  wallet_accessor_test::set_spent(*w, 3, 5);
+  wallet_accessor_test::detach_blockchain(*w, 10);
+  ASSERT_EQ(w->get_num_transfer_details(), 9);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+  ASSERT_FALSE(wallet_accessor_test::transfer_columns(*w).is_spent(2, false));
+  ASSERT_FALSE(wallet_accessor_test::transfer_columns(*w).is_frozen(2));
+  ASSERT_TRUE(wallet_accessor_test::transfer_columns(*w).is_spent(3, true));
+
+  // the detached outputs come back on the same rows
+  const std::vector<cryptonote::block_complete_entry> tail_blocks(blocks.begin() + 9, blocks.end());
+  const std::vector<tools::wallet2::parsed_block> tail_parsed_blocks(parsed_blocks.begin() + 9, parsed_blocks.end());
+  wallet_accessor_test::process_parsed_blocks(*w, 9, tail_blocks, tail_parsed_blocks, blocks_added);
+  ASSERT_EQ(w->get_num_transfer_details(), 19);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+}
+
+TEST(wallet_transfer_columns, import_outputs)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {w->get_address()}, 10, blocks, parsed_blocks);
+  uint64_t blocks_added = 0;
+  wallet_accessor_test::process_parsed_blocks(*w, 0, blocks, parsed_blocks, blocks_added);
+  ASSERT_EQ(w->get_num_transfer_details(), 9);
+
+  // flags carried by exported outputs land in the columns
+  auto exported = w->export_outputs(true);
+  std::get<2>(exported)[2].m_flags.m_frozen = true;
+  std::get<2>(exported)[4].m_flags.m_spent = true;
+  ASSERT_EQ(w->import_outputs(exported), 9);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+  ASSERT_TRUE(wallet_accessor_test::transfer_columns(*w).is_frozen(2));
+  ASSERT_TRUE(wallet_accessor_test::transfer_columns(*w).is_spent(4, false));
+  ASSERT_FALSE(wallet_accessor_test::transfer_columns(*w).is_spent(4, true));
+
+  // a smaller export set truncates
+  std::get<1>(exported) = 6;
+  std::get<2>(exported).resize(6);
+  ASSERT_EQ(w->import_outputs(exported), 6);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+
+  std::tuple<uint64_t, uint64_t, std::vector<tools::wallet2::transfer_details>> outputs(0, 4, wallet_accessor_test::transfers(*w));
+  std::get<2>(outputs).resize(4);
+  std::get<2>(outputs)[1].m_frozen = true;
+  ASSERT_EQ(w->import_outputs(outputs), 4);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+  ASSERT_TRUE(wallet_accessor_test::transfer_columns(*w).is_frozen(1));
+}
+
+TEST(wallet_transfer_columns, mismatch_throws)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  wallet_accessor_test::transfers(*w).push_back(tools::wallet2::transfer_details{});
+  ASSERT_THROW(wallet_accessor_test::transfer_columns(*w), std::runtime_error);
+  wallet_accessor_test::update_transfer_columns(*w, 0);
+  check_columns(wallet_accessor_test::transfers(*w), wallet_accessor_test::transfer_columns(*w));
+}
+
+TEST(wallet_transfer_columns, balance_per_subaddress)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {w->get_address()}, 10, blocks, parsed_blocks);
+  uint64_t blocks_added = 0;
+  wallet_accessor_test::process_parsed_blocks(*w, 0, blocks, parsed_blocks, blocks_added);
+
+  uint64_t expected = 0;
+  for (const tools::wallet2::transfer_details &td: wallet_accessor_test::transfers(*w))
+    expected += td.amount();
+  wallet_accessor_test::set_spent(*w, 3, 9);
+  expected -= wallet_accessor_test::transfers(*w)[3].amount();
+  const std::string asset_type = wallet_accessor_test::transfers(*w)[0].asset_type;
+  const std::map<uint32_t, uint64_t> balance = w->balance_per_subaddress(0, asset_type, false);
+  ASSERT_EQ(balance.size(), 1);
+  ASSERT_EQ(balance.at(0), expected);
+  ASSERT_TRUE(w->balance_per_subaddress(1, asset_type, false).empty());
+
+  // an asset the wallet never saw is an error, as it was before the columns
+  ASSERT_THROW(w->balance_per_subaddress(0, "NOTANASSET", false), std::out_of_range);
+}
+
+TEST(wallet_transfer_columns, shared_tx_prefixes)
+{
+  std::shared_ptr<tools::wallet2> w = make_wallet();
+  std::vector<cryptonote::block_complete_entry> blocks;
+  std::vector<tools::wallet2::parsed_block> parsed_blocks;
+  unit_test::make_wallet_chain(wallet_accessor_test::genesis_hash(*w), {w->get_address()}, 5, blocks, parsed_blocks);
+  uint64_t blocks_added = 0;
+  wallet_accessor_test::process_parsed_blocks(*w, 0, blocks, parsed_blocks, blocks_added);
+  tools::wallet2::transfer_container &transfers = wallet_accessor_test::transfers(*w);
+  ASSERT_EQ(transfers.size(), 4);
+
+  // as read back from a cache: two outputs of one tx with a copy of its prefix each
+  transfers[1].m_txid = transfers[0].m_txid;
+  transfers[1].m_tx = transfers[0].m_tx.get();
+  // and one with the same txid but a made up prefix, as import_outputs makes
+  cryptonote::transaction_prefix made_up = transfers[0].m_tx.get();
+  made_up.extra.clear();
+  transfers[2].m_txid = transfers[0].m_txid;
+  transfers[2].m_tx = made_up;
+  ASSERT_FALSE(transfers[1].m_tx.shares_with(transfers[0].m_tx));
+
+  wallet_accessor_test::share_tx_prefixes(*w);
+  ASSERT_TRUE(transfers[1].m_tx.shares_with(transfers[0].m_tx));
+  ASSERT_FALSE(transfers[2].m_tx.shares_with(transfers[0].m_tx));
+  ASSERT_TRUE(transfers[2].m_tx->extra.empty());
+  ASSERT_FALSE(transfers[3].m_tx.shares_with(transfers[0].m_tx));
+}
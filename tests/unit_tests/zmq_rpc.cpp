@@ -28,12 +28,17 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <boost/preprocessor/stringize.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility/string_ref.hpp>
+#include <chrono>
+#include <cstring>
 #include <gtest/gtest.h>
 #include <rapidjson/document.h>
 
 #include "cryptonote_basic/account.h"
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/events.h"
+#include "common/varint.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "json_serialization.h"
 #include "net/zmq.h"
@@ -706,8 +711,7 @@ TEST_F(zmq_pub, JsonAll)
   {
     const std::array<cryptonote::block, 1> blocks{{make_block()}};
 
-    EXPECT_EQ(2u, pub->send_chain_main(100, epee::to_span(blocks)));
-    EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+    EXPECT_EQ(1u, pub->send_chain_main(100, epee::to_span(blocks)));
     EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
 
     auto pubs = get_published(dummy_client.get());
@@ -718,7 +722,6 @@ TEST_F(zmq_pub, JsonAll)
 
     EXPECT_NO_THROW(cryptonote::listener::zmq_pub::chain_main{pub}(533, epee::to_span(blocks)));
     EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
-    EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
 
     pubs = get_published(dummy_client.get());
     EXPECT_EQ(2u, pubs.size());
@@ -728,6 +731,158 @@ TEST_F(zmq_pub, JsonAll)
   }
 }
 
+TEST_F(zmq_pub, BinMinimalTxpool)
+{
+  static constexpr const char topic[] = "\1bin-minimal-txpool_add";
+
+  ASSERT_TRUE(sub_request(topic));
+
+  std::vector<cryptonote::txpool_event> events
+  {
+   {make_transaction(), {}, 0, 0, true}, {make_transaction(), {}, 0, 0, false}, {make_transaction(), {}, 0, 0, true}
+  };
+  for (cryptonote::txpool_event& event : events)
+    ASSERT_TRUE(cryptonote::get_transaction_hash(event.tx, event.hash, event.blob_size));
+
+  EXPECT_EQ(1u, pub->send_txpool_add(events));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+
+  const auto messages = get_messages(dummy_client.get());
+  ASSERT_EQ(1u, messages.size());
+
+  static constexpr const char prefix[] = "bin-minimal-txpool_add:";
+  ASSERT_TRUE(boost::string_ref{messages.front()}.starts_with(prefix));
+  std::string payload = messages.front().substr(sizeof(prefix) - 1);
+
+  auto next = payload.cbegin();
+  auto end = payload.cend();
+  const auto read_varint = [&]()
+  {
+    std::uint64_t value = 0;
+    EXPECT_LT(0, tools::read_varint(next, end, value));
+    return value;
+  };
+
+  EXPECT_EQ(2u, read_varint());
+  for (const cryptonote::txpool_event& event : {events[0], events[2]})
+  {
+    ASSERT_LE(sizeof(crypto::hash), std::size_t(end - next));
+    EXPECT_EQ(0, std::memcmp(event.hash.data, std::addressof(*next), sizeof(crypto::hash)));
+    next += sizeof(crypto::hash);
+    EXPECT_EQ(event.blob_size, read_varint());
+    EXPECT_EQ(event.weight, read_varint());
+    EXPECT_EQ(cryptonote::get_tx_fee(event.tx), read_varint());
+    EXPECT_EQ(std::uint64_t(cryptonote::transaction_type::TRANSFER), read_varint());
+  }
+  EXPECT_TRUE(next == end);
+}
+
+TEST_F(zmq_pub, BinMinimalChain)
+{
+  static constexpr const char topic[] = "\1bin-minimal-chain_main";
+
+  ASSERT_TRUE(sub_request(topic));
+
+  const std::array<cryptonote::block, 2> blocks{{make_block(), make_block()}};
+
+  EXPECT_EQ(1u, pub->send_chain_main(100, epee::to_span(blocks)));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+
+  const auto messages = get_messages(dummy_client.get());
+  ASSERT_EQ(1u, messages.size());
+
+  static constexpr const char prefix[] = "bin-minimal-chain_main:";
+  ASSERT_TRUE(boost::string_ref{messages.front()}.starts_with(prefix));
+  const std::string payload = messages.front().substr(sizeof(prefix) - 1);
+
+  std::string expected;
+  expected += tools::get_varint_data(std::uint64_t(100));
+  expected.append(blocks[0].prev_id.data, sizeof(crypto::hash));
+  expected += tools::get_varint_data(std::uint64_t(2));
+  for (const cryptonote::block& bl : blocks)
+  {
+    const crypto::hash id = cryptonote::get_block_hash(bl);
+    expected.append(id.data, sizeof(id));
+  }
+  EXPECT_EQ(expected, payload);
+}
+
+TEST_F(zmq_pub, TxTypeFilter)
+{
+  ASSERT_TRUE(sub_request("\1txtype_stake-json-minimal-txpool_add"));
+  ASSERT_TRUE(sub_request("\1txtype_transfer-json-minimal-txpool_add"));
+
+  std::vector<cryptonote::txpool_event> events
+  {
+   {make_transaction(), {}, 0, 0, true}, {make_transaction(), {}, 0, 0, true}
+  };
+  events[1].tx.type = cryptonote::transaction_type::STAKE;
+
+  EXPECT_EQ(1u, pub->send_txpool_add(events));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+
+  auto pubs = get_published(dummy_client.get());
+  ASSERT_EQ(2u, pubs.size());
+  EXPECT_EQ("txtype_stake-json-minimal-txpool_add", pubs.front().first);
+  EXPECT_EQ(1u, pubs.front().second.Size());
+  EXPECT_EQ("txtype_transfer-json-minimal-txpool_add", pubs.back().first);
+  EXPECT_EQ(1u, pubs.back().second.Size());
+
+  // no stake tx, so only the transfer topic is published
+  events.pop_back();
+  EXPECT_EQ(1u, pub->send_txpool_add(events));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+
+  pubs = get_published(dummy_client.get());
+  ASSERT_EQ(1u, pubs.size());
+  EXPECT_EQ("txtype_transfer-json-minimal-txpool_add", pubs.front().first);
+}
+
+TEST_F(zmq_pub, TxpoolBatch)
+{
+  static constexpr const char topic[] = "\1json-minimal";
+
+  ASSERT_TRUE(sub_request(topic));
+  pub->set_txpool_batch(std::chrono::hours{1});
+
+  std::vector<cryptonote::txpool_event> first{{make_transaction(), {}, 0, 0, true}};
+  std::vector<cryptonote::txpool_event> second{{make_transaction(), {}, 0, 0, true}, {make_transaction(), {}, 0, 0, true}};
+  std::vector<cryptonote::txpool_event> all = first;
+  all.insert(all.end(), second.begin(), second.end());
+
+  EXPECT_EQ(1u, pub->send_txpool_add(first));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+  EXPECT_EQ(0u, get_messages(dummy_client.get()).size());
+  EXPECT_LT(0, pub->txpool_flush_timeout());
+  EXPECT_FALSE(pub->flush_txpool(dummy_pub.get()));
+
+  EXPECT_EQ(0u, pub->send_txpool_add(second));
+  EXPECT_EQ(0u, get_messages(dummy_client.get()).size());
+
+  // a block closes the batch, and its txes are published first
+  const std::array<cryptonote::block, 1> blocks{{make_block()}};
+  EXPECT_EQ(1u, pub->send_chain_main(100, epee::to_span(blocks)));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+  EXPECT_EQ(-1, pub->txpool_flush_timeout());
+
+  auto pubs = get_published(dummy_client.get());
+  ASSERT_EQ(2u, pubs.size());
+  EXPECT_TRUE(compare_minimal_txpool(epee::to_span(all), pubs.front()));
+  EXPECT_EQ(3u, pubs.front().second.Size());
+  EXPECT_TRUE(compare_minimal_block(100, epee::to_span(blocks), pubs.back()));
+
+  // due batches are flushed without waiting for more relay traffic
+  pub->set_txpool_batch(std::chrono::milliseconds{1});
+  EXPECT_EQ(1u, pub->send_txpool_add(first));
+  EXPECT_TRUE(pub->relay_to_pub(relay.get(), dummy_pub.get()));
+  boost::this_thread::sleep_for(boost::chrono::milliseconds{5});
+  pub->flush_txpool(dummy_pub.get());
+
+  pubs = get_published(dummy_client.get());
+  ASSERT_EQ(1u, pubs.size());
+  EXPECT_TRUE(compare_minimal_txpool(epee::to_span(first), pubs.front()));
+}
+
 TEST_F(zmq_pub, JsonChainWeakPtrSkip)
 {
   static constexpr const char topic[] = "\1json";